@@ -0,0 +1,15 @@
+#pragma once
+
+// Assert without the rest of Common.h, for code that builds without the D3D12 headers
+
+void DoAssert(bool success, const wchar_t* file_name, int line);
+
+#define WIDE2(x) L##x
+#define WIDE1(x) WIDE2(x)
+#define WFILE WIDE1(__FILE__)
+
+#ifdef _DEBUG
+#define Assert(s) DoAssert(s, WFILE, __LINE__)
+#else
+#define Assert(s)
+#endif
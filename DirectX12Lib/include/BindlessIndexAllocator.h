@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include "RangeAllocator.h"
+
+// Indices into the bindless table. A freed index may still be read by work in flight, it waits with the
+// fence of that work and only goes back to the free ranges once Reclaim sees the fence complete. Fences
+// have to grow from Free to Free, they all come from one queue. Knows nothing of the device and is not
+// thread safe.
+class FBindlessIndexAllocator
+{
+public:
+	static const uint32_t INVALID_INDEX = FRangeAllocator::INVALID_OFFSET;
+
+	struct FStats
+	{
+		uint32_t Capacity;
+		uint32_t Allocated;		// pending indices included
+		uint32_t Pending;
+		uint32_t LargestFreeRange;
+	};
+
+	explicit FBindlessIndexAllocator(uint32_t Capacity = 0);
+
+	// forgets every index, the pending ones included
+	void Reset(uint32_t Capacity);
+
+	// first of Count consecutive indices, INVALID_INDEX when there is no room before a Reclaim
+	uint32_t Allocate(uint32_t Count);
+	// Fence is signaled after the last work that may read the indices
+	void Free(uint32_t Index, uint32_t Count, uint64_t Fence);
+
+	// frees the indices whose fence completed. IsComplete(Fence) asks the fence
+	template<typename FenceFunction>
+	void Reclaim(const FenceFunction& IsComplete)
+	{
+		while (!m_Pending.empty() && IsComplete(m_Pending.front().Fence))
+		{
+			m_Ranges.Free(m_Pending.front().Index, m_Pending.front().Count);
+			m_PendingCount -= m_Pending.front().Count;
+			m_Pending.pop_front();
+		}
+	}
+
+	// fence of the oldest pending indices, 0 when none are
+	uint64_t GetOldestFence() const { return m_Pending.empty() ? 0 : m_Pending.front().Fence; }
+	FStats GetStats() const;
+
+private:
+	struct FPending
+	{
+		uint64_t Fence;
+		uint32_t Index;
+		uint32_t Count;
+	};
+
+	FRangeAllocator m_Ranges;
+	std::deque<FPending> m_Pending;
+	uint32_t m_PendingCount;
+};
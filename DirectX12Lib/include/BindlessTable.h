@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <d3d12.h>
+#include "Common.h"
+#include "BindlessIndexAllocator.h"
+
+// One shader visible CBV/SRV/UAV heap the views stay in for their whole life. Register copies views in and
+// returns their index, which materials pass to the shaders through root constants or a material buffer, a
+// draw then copies no descriptors at all. A freed index is handed out again once the GPU finished the frame
+// of the Free, on the graphics and the compute queue.
+class FBindlessTable
+{
+public:
+	static const uint32_t DEFAULT_CAPACITY = 65536;
+
+	static FBindlessTable& Get();
+
+	void Create(ID3D12Device* Device, uint32_t Capacity = DEFAULT_CAPACITY);
+	void Destroy();
+	bool IsCreated() const { return m_Heap != nullptr; }
+
+	// copies the Count views from Views on into the table, returns the index of the first. INVALID_INDEX
+	// when the table is still full after the frames that freed indices finished
+	uint32_t Register(D3D12_CPU_DESCRIPTOR_HANDLE Views, uint32_t Count = 1);
+	// overwrites registered views, only for indices no work in flight reads
+	void Update(uint32_t Index, D3D12_CPU_DESCRIPTOR_HANDLE Views, uint32_t Count = 1);
+	// lists of the frame may still be recording with the index, it retires with the frame at EndFrame
+	void Free(uint32_t Index, uint32_t Count = 1);
+	// the fences after the last graphics and compute submission of the frame
+	void EndFrame(uint64_t GraphicsFence, uint64_t ComputeFence);
+
+	ID3D12DescriptorHeap* GetHeap() const { return m_Heap.Get(); }
+	// the table to bind at a root parameter, shaders index it from its start
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint32_t Index = 0) const;
+
+	FBindlessIndexAllocator::FStats GetStats();
+
+private:
+	FBindlessTable();
+
+	// hands the frames whose fences completed back to m_Indices, m_Mutex held
+	void ReclaimLocked();
+
+	struct FRetiredFrame
+	{
+		uint64_t Serial;	// the fence of its indices in m_Indices
+		uint64_t GraphicsFence;
+		uint64_t ComputeFence;
+	};
+
+	ID3D12Device* m_Device;
+	ComPtr<ID3D12DescriptorHeap> m_Heap;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_CpuStart;
+	D3D12_GPU_DESCRIPTOR_HANDLE m_GpuStart;
+	uint32_t m_DescriptorSize;
+
+	std::mutex m_Mutex;
+	FBindlessIndexAllocator m_Indices;
+	std::vector<std::pair<uint32_t, uint32_t> > m_FreedThisFrame;	// index, count
+	std::deque<FRetiredFrame> m_RetiredFrames;
+	uint64_t m_FrameSerial;
+	uint64_t m_CompletedFrameSerial;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MathLib.h"
+
+// Bounding volume hierarchy over a set of boxes, built with binned SAH. The boxes are referred to by
+// their index in the array given to Build, moved boxes are handled by refitting the existing tree.
+class FBvh
+{
+public:
+	static const uint32_t INVALID_INDEX = 0xffffffff;
+	static const uint32_t MAX_LEAF_SIZE = 4;
+	static const uint32_t BIN_COUNT = 16;
+
+	void Build(const FBoundingBox* Bounds, uint32_t Count);
+	void Clear();
+	uint32_t GetCount() const { return (uint32_t)m_PrimLeaves.size(); }
+	uint32_t GetNodeCount() const { return (uint32_t)m_Nodes.size(); }
+	FBoundingBox GetBounds() const { return m_Nodes.empty() ? FBoundingBox() : m_Nodes[0].Bounds; }
+
+	// Bounds holds every box in the order of Build, refitting keeps the topology so the tree
+	// slowly degrades when boxes travel far, rebuild then
+	void Refit(const FBoundingBox* Bounds);
+	// only the leaves of the Changed boxes and their ancestors
+	void Refit(const FBoundingBox* Bounds, const uint32_t* Changed, uint32_t ChangedCount);
+
+	// append the index of every box that passes, in no particular order
+	void QueryFrustum(const FFrustum& Frustum, std::vector<uint32_t>& Result) const;
+	void QueryBox(const FBoundingBox& Box, std::vector<uint32_t>& Result) const;
+	void QueryRay(const Vector3f& Origin, const Vector3f& Direction, float MaxDistance, std::vector<uint32_t>& Result) const;
+	// box with the nearest entry point along the ray, INVALID_INDEX on a miss, Direction need not be normalized
+	// and HitDistance is in units of it
+	uint32_t RayCast(const Vector3f& Origin, const Vector3f& Direction, float MaxDistance = (std::numeric_limits<float>::max)(), float* HitDistance = nullptr) const;
+
+private:
+	// the boxes of a subtree are m_PrimIndices[First, First + Count), children sit at Left and Left + 1
+	struct FNode
+	{
+		FBoundingBox Bounds;
+		uint32_t First;
+		uint32_t Count;
+		uint32_t Left;		// 0 for a leaf, the root is never a child
+		uint32_t Parent;
+	};
+
+	void Split(uint32_t NodeIndex, const std::vector<Vector3f>& Centroids, const FBoundingBox* Bounds);
+	void RefitLeaf(FNode& Node, const FBoundingBox* Bounds);
+	void AppendSubtree(const FNode& Node, std::vector<uint32_t>& Result) const;
+
+	std::vector<FNode> m_Nodes;
+	std::vector<uint32_t> m_PrimIndices;
+	std::vector<FBoundingBox> m_PrimBounds;	// parallel to m_PrimIndices
+	std::vector<uint32_t> m_PrimLeaves;		// leaf node of every box
+};
@@ -34,6 +34,7 @@ public:
 	float GetFovY() const { return m_VerticalFov; }
 
 	const FMatrix& GetViewProjMatrix() const { return m_ViewProjMatrix; }
+	FFrustum GetFrustum() const { return FFrustum(m_ViewProjMatrix); }
 
 	const FMatrix& GetPreviousViewMatrix() const { return m_PreviousViewMat; }
 	const FMatrix& GetPreviousProjectionMatrix() const { return m_PreviousProjMat; }
@@ -10,6 +10,7 @@ public:
 	FColorBuffer(const Vector4f& Color = Vector4f(0.0f))
 		: m_ClearColor(Color)
 		, m_NumMipMaps(0)
+		, m_NumMipDescriptors(0)
 		, m_SampleCount(1)
 	{
 		m_RTVHandle.ptr = 0;
@@ -58,6 +59,7 @@ protected:
 protected:
 	Vector4f m_ClearColor;
 	uint32_t m_NumMipMaps;
+	uint32_t m_NumMipDescriptors;	// in each of the mip ranges
 	uint32_t m_SampleCount;
 
 	D3D12_CPU_DESCRIPTOR_HANDLE m_RTVHandle;
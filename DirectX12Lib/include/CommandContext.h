@@ -3,10 +3,14 @@
 #include <vector>
 #include <queue>
 #include <memory>
+#include <atomic>
+#include <mutex>
 #include <d3d12.h>
 
 #include "LinearAllocator.h"
 #include "DynamicDescriptorHeap.h"
+#include "GraphicsStateCache.h"
+#include "UploadService.h"
 
 class FColorBuffer;
 class FDepthBuffer;
@@ -15,7 +19,9 @@ class FCommandContext;
 class FRootSignature;
 class FD3D12Resource;
 class FPipelineState;
+class FCommandQueue;
 
+// hands out contexts to several recording threads
 class FContextManager
 {
 public:
@@ -26,6 +32,7 @@ public:
 	void DestroyAllContexts();
 
 private:
+	std::mutex m_ContextAllocationMutex;
 	std::vector<std::unique_ptr<FCommandContext>> m_ContextPool[4];
 	std::queue<FCommandContext*> m_AvailableContexts[4];
 };
@@ -51,8 +58,16 @@ private:
 public:
 	static void DestroyAllContexts();
 	static FCommandContext& Begin(D3D12_COMMAND_LIST_TYPE Type=D3D12_COMMAND_LIST_TYPE_DIRECT, const std::wstring& ID = L"");
-	static void InitializeBuffer(FD3D12Resource& Dest, const void* Data, uint32_t NumBytes, size_t Offset = 0);
-	static void InitializeTexture(FD3D12Resource& Dest, UINT NumSubResources, D3D12_SUBRESOURCE_DATA SubData[]);
+	// copies on the upload service when Dest is in a state the copy queue can write. A context that uses Dest
+	// in the same frame passes the ticket to WaitForUpload, transitioning Dest does the same
+	static FUploadTicket InitializeBuffer(FD3D12Resource& Dest, const void* Data, uint32_t NumBytes, size_t Offset = 0);
+	static FUploadTicket InitializeTexture(FD3D12Resource& Dest, UINT NumSubResources, D3D12_SUBRESOURCE_DATA SubData[]);
+	// covers every InitializeBuffer and InitializeTexture so far, RenderWindow::BeginFrame makes the graphics
+	// queue wait for it once
+	static FUploadTicket GetInitializeTicket();
+	// issued and elided state sets of all contexts finished in the last frame, EndFrame rolls the counts over
+	static const FGraphicsStateCache::FStats& GetFrameStateStats() { return ms_LastFrameStateStats; }
+	static void EndFrame();
 
 public:
 	~FCommandContext();
@@ -67,9 +82,17 @@ public:
 	}
 
 	FAllocation ReserveUploadMemory(size_t SizeInBytes);
+	// the queue waits on the GPU for the upload before it runs this context, transitioning a resource
+	// the upload service wrote does the same
+	void WaitForUpload(FUploadTicket Ticket);
+	// the same for the last upload into Resource, for resources bound without a transition like vertex buffers
+	void WaitForUpload(const FD3D12Resource& Resource);
 
 	void FlushResourceBarriers();
+	// state set directly on the list is not seen by the caches, call InvalidateState after it
 	ID3D12GraphicsCommandList* GetCommandList() { return m_CommandList; }
+	// forgets the cached pipeline state and rebinds the descriptor heaps and tables on their next use
+	void InvalidateState();
 
 	void TransitionResource(FD3D12Resource& Resource, D3D12_RESOURCE_STATES NewState, bool Flush = false);
 	void TransitionSubResource(FD3D12Resource& Resource, D3D12_RESOURCE_STATES NewState, uint32_t Subresource, bool Flush);
@@ -105,6 +128,10 @@ public:
 
 	void SetConstantArray(UINT RootIndex, UINT NumConstants, const void* Contents);
 	void SetDynamicConstantBufferView(UINT RootIndex, size_t BufferSize, const void* BufferData);
+	// binds the bindless table at an unbounded descriptor table, the indices go in through SetConstantArray.
+	// Switches the heap away from the dynamic descriptors, tables set through them have to be set again.
+	// Handles staged for RootIndex before are dropped, they would overwrite the table
+	void SetBindlessTable(UINT RootIndex);
 
 	void Draw(UINT VertexCount, UINT VertexStartOffset = 0);
 	void DrawIndexed(UINT IndexCount, UINT StartIndexLocation = 0, INT BaseVertexLocation = 0);
@@ -115,19 +142,23 @@ public:
 
 protected:
 	void BindDescriptorHeaps();
+	void UnbindDynamicTables(D3D12_DESCRIPTOR_HEAP_TYPE Type);
+	void WaitForUploads(FCommandQueue& Queue);
 
 protected:
 	std::wstring m_ID;
 	ID3D12GraphicsCommandList* m_CommandList;
 	ID3D12CommandAllocator* m_CurrentAllocator;
 
-	ID3D12RootSignature* m_CurGraphicsRootSignature;
-	ID3D12PipelineState* m_CurPipelineState;
+	FGraphicsStateCache m_StateCache;
 	ID3D12RootSignature* m_CurComputeRootSignature;
 
 	D3D12_RESOURCE_BARRIER m_ResourceBarrierBuffer[16];
 	UINT m_NumBarriersToFlush;
 
+	// newest upload batch the recorded commands need
+	uint64_t m_UploadWaitBatch;
+
 	ID3D12DescriptorHeap* m_CurrentDescriptorHeaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
 	D3D12_COMMAND_LIST_TYPE m_Type;
@@ -137,6 +168,12 @@ protected:
 
 	FDynamicDescriptorHeap m_DynamicViewDescriptorHeap;
 	FDynamicDescriptorHeap m_DynamicSamplerDescriptorHeap;
+
+	static FGraphicsStateCache::FStats ms_FrameStateStats;
+	static FGraphicsStateCache::FStats ms_LastFrameStateStats;
+	static FUploadTicket RecordInitializeUpload(FUploadTicket Ticket);
+	// newest batch of InitializeBuffer and InitializeTexture
+	static std::atomic<uint64_t> ms_InitializeBatch;
 };
 
 class FComputeContext : public FCommandContext
@@ -151,6 +188,7 @@ public:
 
 	void SetConstantArray(UINT RootIndex, UINT NumConstants, const void* Contents);
 	void SetDynamicConstantBufferView(UINT RootIndex, size_t BufferSize, const void* BufferData);
+	void SetBindlessTable(UINT RootIndex);
 
 	void ClearUAV(FColorBuffer& Target, int Mip);
 
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "CommandQueue.h"
+#include "FramePacer.h"
 
 class FCommandListManager
 {
@@ -26,11 +27,22 @@ public:
 
 	bool IsFenceComplete(uint64_t FenceValue);
 	void WaitForFence(uint64_t FenceValue);
-
+	// waits until every queue ran out of work
+	void IdleGPU();
+
+	// frame pacing on the graphics queue, BeginFrame blocks while the CPU is FramesInFlight frames ahead
+	void SetFramesInFlight(uint32_t Count) { m_FramePacer.SetFramesInFlight(Count); }
+	uint32_t GetFramesInFlight() const { return m_FramePacer.GetFramesInFlight(); }
+	uint32_t GetFrameIndex() const { return m_FramePacer.GetFrameIndex(); }
+	void BeginFrame();
+	// signals the graphics queue after the last submission of the frame, the bindless indices freed during
+	// the frame retire with it, and idle large upload pages are trimmed
+	uint64_t EndFrame();
 
 private:
 	ID3D12Device* m_Device;
 	FCommandQueue m_GraphicsQueue;
 	FCommandQueue m_ComputeQueue;
 	FCommandQueue m_CopyQueue;
+	FFramePacer m_FramePacer;
 };
\ No newline at end of file
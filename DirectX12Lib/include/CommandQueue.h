@@ -2,8 +2,12 @@
 
 #include "Common.h"
 #include <queue>
+#include <atomic>
+#include <mutex>
 #include <d3d12.h>
 
+// Submission, signals, waits and the allocator pool are safe to use from several threads. The lists
+// submitted from them are signaled in the order they are executed.
 class FCommandQueue
 {
 public:
@@ -18,6 +22,8 @@ public:
 	uint64_t ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList> commandList);
 
 	uint64_t Signal();
+	// fence of the latest signal, it completes once all work submitted so far is done
+	uint64_t GetLastSignaledFence();
 	bool IsFenceComplete(uint64_t FenceValue);
 	void WaitForFenceValue(uint64_t FenceValue);
 	void StallForFence(uint64_t FenceValue);
@@ -30,6 +36,9 @@ public:
 
 protected:
 	ID3D12CommandAllocator* CreateCommandAllocator();
+	void UpdateCompletedFence(uint64_t FenceValue);
+	// m_FenceMutex held
+	uint64_t SignalLocked();
 
 private:
     // Keep track of command allocators that are "in-flight"
@@ -45,10 +54,16 @@ private:
 	ID3D12Device*				m_d3d12Device;
 	ComPtr<ID3D12CommandQueue>	m_d3d12CommandQueue;
 	ComPtr<ID3D12Fence>			m_d3d12Fence;
+	// one event serves all waiting threads, one at a time
 	HANDLE						m_FenceEvent;
+	std::mutex					m_EventMutex;
+	// guards the queue's submissions and m_NextFenceValue
+	std::mutex					m_FenceMutex;
 	uint64_t					m_NextFenceValue;
-	uint64_t					m_LastCompletedFenceValue;
+	// polled from every recording thread through the page managers
+	std::atomic<uint64_t>		m_LastCompletedFenceValue;
  
+	std::mutex								m_AllocatorMutex;
 	std::queue< CommandAllocatorEntry>		m_ReadyAllocators;
 	std::vector<ID3D12CommandAllocator*>	m_AllocatorPool;
 
@@ -8,6 +8,7 @@
 #include <stdint.h>
 
 #include <d3d12.h>
+#include "Assertion.h"
 
 #define D3D12_GPU_VIRTUAL_ADDRESS_NULL      ((D3D12_GPU_VIRTUAL_ADDRESS)0)
 #define D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN   ((D3D12_GPU_VIRTUAL_ADDRESS)-1)
@@ -24,17 +25,15 @@ inline void ThrowIfFailed(HRESULT hr)
 	}
 }
 
-void DoAssert(bool success, const wchar_t* file_name, int line);
-
-#define WIDE2(x) L##x
-#define WIDE1(x) WIDE2(x)
-#define WFILE WIDE1(__FILE__)
-
-#ifdef _DEBUG
-#define Assert(s) DoAssert(s, WFILE, __LINE__)
-#else
-#define Assert(s)
-#endif
+// memory of the process in bytes. Committed is the private commit charge, ProcessPeak the largest working set
+// since process start, it can't be reset so compare samples of the other two around the work to measure
+struct FMemoryUsage
+{
+	size_t WorkingSet;
+	size_t Committed;
+	size_t ProcessPeak;
+};
+FMemoryUsage GetMemoryUsage();
 
 inline std::wstring ToWideString(const std::string& str)
 {
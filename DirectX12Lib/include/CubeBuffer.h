@@ -11,6 +11,7 @@ public:
 	FCubeBuffer(const Vector4f& Color = Vector4f(0.2f))
 		: m_ClearColor(Color)
 		, m_NumMipMaps(1)
+		, m_NumViewMips(0)
 		, m_SampleCount(1)
 	{
 		m_CubeSRVHandle.ptr = 0;
@@ -66,6 +67,7 @@ protected:
 protected:
 	Vector4f m_ClearColor;
 	uint32_t m_NumMipMaps;
+	uint32_t m_NumViewMips;		// the views were created for, 0 before the first Create
 	uint32_t m_SampleCount;
 
 	D3D12_CPU_DESCRIPTOR_HANDLE m_CubeSRVHandle, m_FaceMipSRVHandle;
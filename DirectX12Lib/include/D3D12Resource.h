@@ -7,15 +7,18 @@
 class FD3D12Resource
 {
 	friend class FCommandContext;
+	friend class FUploadService;
 
 public:
 	FD3D12Resource()
 		: m_GpuAddress(0)
+		, m_UploadBatch(0)
 	{
 	}
 
 	FD3D12Resource(ID3D12Resource* Resource, D3D12_RESOURCE_STATES State)
 		: m_GpuAddress(0)
+		, m_UploadBatch(0)
 	{
 		m_Resource.Attach(Resource);
 		
@@ -42,4 +45,6 @@ protected:
 	ComPtr<ID3D12Resource> m_Resource;
 	std::vector<D3D12_RESOURCE_STATES> m_AllCurrentState;
 	D3D12_GPU_VIRTUAL_ADDRESS m_GpuAddress;
+	// batch of the last FUploadService copy into it, the contexts transitioning it wait for that
+	uint64_t m_UploadBatch;
 };
\ No newline at end of file
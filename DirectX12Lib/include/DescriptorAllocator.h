@@ -1,31 +1,56 @@
 ﻿#pragma once
 
-#include <set>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <d3d12.h>
 #include "Common.h"
+#include "RangeAllocator.h"
 
+// CPU only descriptors of one heap type. Ranges come from heaps of sm_NumDescriptorsPerHeap through a
+// FRangeAllocator each and go back with Free, a new heap is only created when no heap has a free range
+// large enough. Thread safe.
 class FDescriptorAllocator
 {
 public:
+	struct FStats
+	{
+		uint32_t NumHeaps;
+		uint32_t Capacity;
+		uint32_t Allocated;
+		uint32_t NumFreeRanges;
+		uint32_t LargestFreeRange;
+		float Fragmentation;	// share of the free descriptors outside the largest free range
+	};
+
 	FDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type);
 
 	D3D12_CPU_DESCRIPTOR_HANDLE Allocate(uint32_t Count);
+	// Handle and Count as they came from Allocate, the views in the range may be overwritten right away.
+	// Does nothing after Destroy, for resources destroyed after the device
+	void Free(D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count);
 	uint32_t GetDescriptorSize() const { return m_DescriptorSize; }
 
-	static void DestroyAll();
+	FStats GetStats();
+	void Destroy();
 
 protected:
-	static const uint32_t sm_NumDescriptorsPerHeap = 256;
-	static std::vector<ComPtr<ID3D12DescriptorHeap> > sm_DescriptorPool;
-	static ID3D12DescriptorHeap* RequestNewHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type);
+	static const uint32_t sm_NumDescriptorsPerHeap = 1024;
+
+	struct FHeap
+	{
+		ComPtr<ID3D12DescriptorHeap> Heap;
+		SIZE_T Start;
+		uint32_t NumDescriptors;
+		FRangeAllocator Ranges;
+	};
+
+	FHeap* RequestNewHeap(uint32_t NumDescriptors);
  
 	D3D12_DESCRIPTOR_HEAP_TYPE m_HeapType;
-	ID3D12DescriptorHeap* m_CurrentHeap;
-	D3D12_CPU_DESCRIPTOR_HANDLE m_CurrentCpuAddress;
 	uint32_t m_DescriptorSize;
-	uint32_t m_RemainingFreeHandles;
-	 
+	std::mutex m_Mutex;
+	std::vector<std::unique_ptr<FHeap> > m_Heaps;
 };
 
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MathLib.h"
+#include "MeshData.h"
+
+class Scene;
+
+// Submesh draws of a scene with 64 bit sort keys. The commands are collected once and kept across frames
+// until the scene changes, every frame only the visible ones are keyed with their depth and radix sorted.
+//
+// SortKey of a collected command, from the top bit: pass 4, pso 12, material 16, mesh 16, depth 16 bits.
+// Material and mesh are small ids given in scene order, equal ids share the textures or the vertex and index buffers.
+class FDrawCommandList
+{
+public:
+	enum ESortMode
+	{
+		SORT_STATE,				// pass, pso, material, mesh, depth: fewest state changes
+		SORT_FRONT_TO_BACK,		// pass, pso, depth, material, mesh: nearest first for early z
+	};
+
+	static uint64_t MakeSortKey(uint32_t Pass, uint32_t Pso, uint32_t Material, uint32_t Mesh, uint32_t Depth);
+	// the key of a collected command in the layout of Mode
+	static uint64_t ApplySortMode(uint64_t SortKey, uint32_t Depth, ESortMode Mode);
+	// non negative view depths to 16 bits keeping their order, the steps grow with the distance
+	static uint32_t QuantizeDepth(float Depth);
+	// stable LSD radix sort by byte carrying Values along, the bytes all keys agree on are skipped.
+	// The temporaries hold Count entries each
+	static void RadixSort(uint64_t* Keys, uint32_t* Values, uint32_t Count, uint64_t* TempKeys, uint32_t* TempValues);
+
+	FDrawCommandList();
+
+	// recollects the commands when the scene, its version or the pass differ from the last call, returns whether it did
+	bool Update(Scene* pScene, uint32_t Pass = 0, uint32_t Pso = 0);
+	void Invalidate() { m_Scene = nullptr; }
+
+	uint32_t GetCount() const { return (uint32_t)m_Commands.size(); }
+	const MeshDrawCommand& GetCommand(uint32_t Index) const { return m_Commands[Index]; }
+	// the commands of a scene mesh are contiguous and in submesh order
+	uint32_t GetFirstCommand(uint32_t MeshIndex) const { return m_MeshFirstCommand[MeshIndex]; }
+	uint32_t GetMaterialCount() const { return m_MaterialCount; }
+	uint32_t GetMeshDataCount() const { return m_MeshDataCount; }
+
+	// every command by its key without depth, sorted by Update
+	const std::vector<uint32_t>& GetStateOrder() const { return m_StateOrder; }
+	// sorts the command indices in Visible into Order, depth is the distance along ViewDirection from ViewOrigin
+	// to the center of the world bounds of the mesh, the scene transforms have to be up to date
+	void Sort(const Scene* pScene, const uint32_t* Visible, uint32_t Count, ESortMode Mode,
+		const Vector3f& ViewOrigin, const Vector3f& ViewDirection, std::vector<uint32_t>& Order);
+
+private:
+	std::vector<MeshDrawCommand> m_Commands;
+	std::vector<uint32_t> m_MeshFirstCommand;
+	std::vector<uint32_t> m_StateOrder;
+	uint32_t m_MaterialCount;
+	uint32_t m_MeshDataCount;
+
+	// what the commands were collected for
+	const Scene* m_Scene;
+	uint32_t m_SceneVersion;
+	uint32_t m_Pass;
+	uint32_t m_Pso;
+
+	// scratch of Sort
+	std::vector<uint64_t> m_Keys;
+	std::vector<uint64_t> m_TempKeys;
+	std::vector<uint32_t> m_TempValues;
+};
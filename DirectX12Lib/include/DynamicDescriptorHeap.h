@@ -83,14 +83,15 @@ public:
 		m_ComputeHandleCache.ParseRootSignature(m_HeapType, RootSignature);
 	}
 
-	void SetGraphicsDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[])
+	// false when the table already holds the same handles, then it is left as bound
+	bool SetGraphicsDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[])
 	{
-		m_GraphicsHandleCache.StageDescriptorHandles(RootIndex, Offset, Count, Handles);
+		return m_GraphicsHandleCache.StageDescriptorHandles(RootIndex, Offset, Count, Handles);
 	}
 
-	void SetComputeDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[])
+	bool SetComputeDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[])
 	{
-		m_ComputeHandleCache.StageDescriptorHandles(RootIndex, Offset, Count, Handles);
+		return m_ComputeHandleCache.StageDescriptorHandles(RootIndex, Offset, Count, Handles);
 	}
 
 	void CommitGraphicsRootDescriptorTables(ID3D12GraphicsCommandList* CommandList)
@@ -109,7 +110,13 @@ public:
 		}
 	}
 
+	// the root parameter was written past the cache, the handles set for it are forgotten and staged again
+	void ForgetGraphicsTable(UINT RootIndex) { m_GraphicsHandleCache.ForgetTable(RootIndex); }
+	void ForgetComputeTable(UINT RootIndex) { m_ComputeHandleCache.ForgetTable(RootIndex); }
+
 	void CleanupUsedHeaps(uint64_t FenceValue);
+	// marks every table with handles for rebinding, when the command list lost its bindings
+	void UnbindAllInvalid();
 
 private:
 	bool HasSpace(uint32_t Count)
@@ -118,7 +125,6 @@ private:
 	}
 	void RetireCurrentHeap();
 	void RetireUsedHeaps(uint64_t FenceValue);
-	void UnbindAllInvalid();
 	ID3D12DescriptorHeap* GetHeapPointer();
 	ID3D12DescriptorHeap* RequestDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE HeapType);
 
@@ -165,10 +171,11 @@ private:
 		}
 
 		void UnbindAllInvalid();
+		void ForgetTable(UINT RootIndex);
 
 		uint32_t ComputeStagedSize();
 		void ParseRootSignature(D3D12_DESCRIPTOR_HEAP_TYPE Type, const FRootSignature& RootSignature);
-		void StageDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[]);
+		bool StageDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[]);
 		void CopyAndBindStaleTables(D3D12_DESCRIPTOR_HEAP_TYPE Type, uint32_t DescriptorSize, FDescriptorHandle DestHandleStart, ID3D12GraphicsCommandList* CmdList,
 			void (STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE));
 
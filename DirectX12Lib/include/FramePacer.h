@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fence bookkeeping of the frames in flight. The CPU records frame N while the GPU may still run the
+// FramesInFlight - 1 frames before it, every frame owns a slot and its per frame resources are reused
+// once the fence that ended the frame last in that slot has passed. Knows nothing of the device, the
+// caller waits and signals.
+class FFramePacer
+{
+public:
+	static const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+	explicit FFramePacer(uint32_t FramesInFlight = 2);
+
+	// clamped to [1, MAX_FRAMES_IN_FLIGHT], the next frame then waits for all earlier ones
+	void SetFramesInFlight(uint32_t Count);
+	uint32_t GetFramesInFlight() const { return m_FramesInFlight; }
+
+	// slot of the frame being recorded, indexes per frame resources
+	uint32_t GetFrameIndex() const { return m_FrameIndex; }
+	uint64_t GetFrameNumber() const { return m_FrameNumber; }
+	// fence to pass before the current slot is reused, 0 when the slot is fresh
+	uint64_t GetWaitFence() const { return m_FrameFences[m_FrameIndex]; }
+	// fence the last ended frame signaled, the GPU is idle once it passed
+	uint64_t GetLastFence() const { return m_LastFence; }
+
+	// FenceValue is signaled after the last work of the frame, moves on to the next slot
+	void EndFrame(uint64_t FenceValue);
+
+private:
+	uint32_t m_FramesInFlight;
+	uint32_t m_FrameIndex;
+	uint64_t m_FrameNumber;
+	uint64_t m_LastFence;
+	uint64_t m_FrameFences[MAX_FRAMES_IN_FLIGHT];
+};
@@ -22,6 +22,10 @@ public:
 	static Scene* LoadFromFile(const std::string& FilePath);
 
 private:
-	static SceneNode* LoadNode(SceneNode* Parent, const tinygltf::Node& TinyNode, const tinygltf::Model& TinyModel, const std::vector<MaterialData>& Materials);
-	static MeshNode* LoadMesh(const tinygltf::Mesh& TinyNode, const tinygltf::Model& TinyModel, const std::vector<MaterialData>& Materials);
+	static SceneNode* LoadNode(SceneNode* Parent, const tinygltf::Node& TinyNode, const tinygltf::Model& TinyModel, const std::shared_ptr<FMaterialTable>& Materials, std::vector<SceneNode*>& LoadedNodes);
+	static MeshNode* LoadMesh(const tinygltf::Mesh& TinyNode, const tinygltf::Model& TinyModel, const std::shared_ptr<FMaterialTable>& Materials);
+
+	static uint64_t ComputeCacheKey(const std::string& FilePath);
+	static Scene* LoadFromCache(const std::string& FilePath, uint64_t CacheKey);
+	static void SaveToCache(const std::string& FilePath, uint64_t CacheKey, const std::vector<SceneNode*>& LoadedNodes, const FMaterialTable& Materials);
 };
\ No newline at end of file
@@ -45,14 +45,20 @@ class FConstBuffer : public FGpuBuffer
 {
 public:
 	FConstBuffer() : m_MappedData(nullptr) {}
-	~FConstBuffer() { Unmap(); }
+	~FConstBuffer() { Unmap(); FreeConstantBufferViews(); }
 
 	void CreateUpload(const std::wstring& Name, uint32_t Size);
+	// the view belongs to the buffer and is freed by Destroy, also when the buffer is created again
 	D3D12_CPU_DESCRIPTOR_HANDLE CreateConstantBufferView(uint32_t Offset, uint32_t Size);
 
+	virtual void Destroy() override;
+
 	void* Map();
 	void Unmap();
 
 private:
+	void FreeConstantBufferViews();
+
 	void* m_MappedData;
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_ConstantBufferViews;
 };
\ No newline at end of file
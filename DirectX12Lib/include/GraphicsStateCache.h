@@ -0,0 +1,216 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <d3d12.h>
+#include "Assertion.h"
+
+// Shadow copy of the state set on a graphics command list. The setters compare against what the list already has
+// and only forward a change, so callers can set their whole state for every draw. The list is a template parameter
+// of the setters so that the cache runs against a recording list in tests, FCommandContext passes its real one.
+class FGraphicsStateCache
+{
+public:
+	enum EStateType
+	{
+		STATE_PipelineState,
+		STATE_RootSignature,
+		STATE_PrimitiveTopology,
+		STATE_VertexBuffer,
+		STATE_IndexBuffer,
+		STATE_Viewport,
+		STATE_Scissor,
+		STATE_RenderTargets,
+		STATE_StencilRef,
+		STATE_DescriptorTable,
+		STATE_Count
+	};
+
+	// set calls forwarded to the list and elided, by state
+	struct FStats
+	{
+		uint32_t Issued[STATE_Count];
+		uint32_t Skipped[STATE_Count];
+
+		FStats() { Reset(); }
+		void Reset() { memset(this, 0, sizeof(*this)); }
+		void Add(const FStats& Other)
+		{
+			for (int i = 0; i < STATE_Count; ++i)
+			{
+				Issued[i] += Other.Issued[i];
+				Skipped[i] += Other.Skipped[i];
+			}
+		}
+		uint32_t GetIssued() const { uint32_t Sum = 0; for (int i = 0; i < STATE_Count; ++i) Sum += Issued[i]; return Sum; }
+		uint32_t GetSkipped() const { uint32_t Sum = 0; for (int i = 0; i < STATE_Count; ++i) Sum += Skipped[i]; return Sum; }
+	};
+
+	static const uint32_t MAX_VERTEX_BUFFERS = D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+	static const uint32_t MAX_RENDER_TARGETS = D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT;
+
+	FGraphicsStateCache() { Invalidate(); }
+
+	// forgets all state, after the list was reset or recorded into behind the cache's back
+	void Invalidate()
+	{
+		m_ValidStates = 0;
+		m_ValidVertexBuffers = 0;
+		m_PipelineState = nullptr;
+		m_RootSignature = nullptr;
+	}
+
+	const FStats& GetStats() const { return m_Stats; }
+	void ResetStats() { m_Stats.Reset(); }
+	// for state filtered elsewhere, like the descriptor tables staged in FDynamicDescriptorHeap
+	void RecordSet(EStateType Type, bool Issued) { (Issued ? m_Stats.Issued : m_Stats.Skipped)[Type]++; }
+
+	// nullptr while unknown
+	ID3D12PipelineState* GetPipelineState() const { return m_PipelineState; }
+	ID3D12RootSignature* GetRootSignature() const { return m_RootSignature; }
+
+	// the setters return whether the list was called
+	template<typename ListType>
+	bool SetPipelineState(ListType* List, ID3D12PipelineState* PipelineState)
+	{
+		if (!Update(STATE_PipelineState, m_PipelineState, PipelineState))
+			return false;
+		List->SetPipelineState(PipelineState);
+		return true;
+	}
+
+	template<typename ListType>
+	bool SetRootSignature(ListType* List, ID3D12RootSignature* RootSignature)
+	{
+		if (!Update(STATE_RootSignature, m_RootSignature, RootSignature))
+			return false;
+		List->SetGraphicsRootSignature(RootSignature);
+		return true;
+	}
+
+	template<typename ListType>
+	bool SetPrimitiveTopology(ListType* List, D3D12_PRIMITIVE_TOPOLOGY Topology)
+	{
+		if (!Update(STATE_PrimitiveTopology, m_Topology, Topology))
+			return false;
+		List->IASetPrimitiveTopology(Topology);
+		return true;
+	}
+
+	// only the span from the first to the last changed slot is forwarded
+	template<typename ListType>
+	bool SetVertexBuffers(ListType* List, UINT StartSlot, UINT Count, const D3D12_VERTEX_BUFFER_VIEW Views[])
+	{
+		Assert(StartSlot + Count <= MAX_VERTEX_BUFFERS);
+		UINT First = Count, Last = 0;
+		for (UINT i = 0; i < Count; ++i)
+		{
+			UINT Slot = StartSlot + i;
+			if (!(m_ValidVertexBuffers & (1u << Slot)) || memcmp(&m_VertexBuffers[Slot], &Views[i], sizeof(Views[i])) != 0)
+			{
+				First = (std::min)(First, i);
+				Last = i;
+				m_VertexBuffers[Slot] = Views[i];
+				m_ValidVertexBuffers |= 1u << Slot;
+			}
+		}
+		RecordSet(STATE_VertexBuffer, First < Count);
+		if (First == Count)
+			return false;
+		List->IASetVertexBuffers(StartSlot + First, Last - First + 1, Views + First);
+		return true;
+	}
+
+	template<typename ListType>
+	bool SetIndexBuffer(ListType* List, const D3D12_INDEX_BUFFER_VIEW& View)
+	{
+		if (!Update(STATE_IndexBuffer, m_IndexBuffer, View))
+			return false;
+		List->IASetIndexBuffer(&View);
+		return true;
+	}
+
+	template<typename ListType>
+	bool SetViewport(ListType* List, const D3D12_VIEWPORT& Viewport)
+	{
+		if (!Update(STATE_Viewport, m_Viewport, Viewport))
+			return false;
+		List->RSSetViewports(1, &Viewport);
+		return true;
+	}
+
+	template<typename ListType>
+	bool SetScissor(ListType* List, const D3D12_RECT& Rect)
+	{
+		if (!Update(STATE_Scissor, m_Scissor, Rect))
+			return false;
+		List->RSSetScissorRects(1, &Rect);
+		return true;
+	}
+
+	// DSV nullptr binds no depth target
+	template<typename ListType>
+	bool SetRenderTargets(ListType* List, UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[], const D3D12_CPU_DESCRIPTOR_HANDLE* DSV)
+	{
+		Assert(NumRTVs <= MAX_RENDER_TARGETS);
+		FRenderTargets Targets;
+		memset(&Targets, 0, sizeof(Targets));
+		Targets.NumRTVs = NumRTVs;
+		for (UINT i = 0; i < NumRTVs; ++i)
+			Targets.RTVs[i] = RTVs[i];
+		Targets.HasDSV = DSV != nullptr;
+		if (DSV)
+			Targets.DSV = *DSV;
+		if (!Update(STATE_RenderTargets, m_RenderTargets, Targets))
+			return false;
+		List->OMSetRenderTargets(NumRTVs, RTVs, FALSE, DSV);
+		return true;
+	}
+
+	template<typename ListType>
+	bool SetStencilRef(ListType* List, UINT StencilRef)
+	{
+		if (!Update(STATE_StencilRef, m_StencilRef, StencilRef))
+			return false;
+		List->OMSetStencilRef(StencilRef);
+		return true;
+	}
+
+private:
+	struct FRenderTargets
+	{
+		UINT NumRTVs;
+		UINT HasDSV;
+		D3D12_CPU_DESCRIPTOR_HANDLE RTVs[MAX_RENDER_TARGETS];
+		D3D12_CPU_DESCRIPTOR_HANDLE DSV;
+	};
+
+	// bitwise compare, a value equal in another representation like -0 only costs a redundant call
+	template<typename T>
+	bool Update(EStateType Type, T& Current, const T& Value)
+	{
+		const uint32_t Bit = 1u << Type;
+		bool Changed = !(m_ValidStates & Bit) || memcmp(&Current, &Value, sizeof(T)) != 0;
+		RecordSet(Type, Changed);
+		if (Changed)
+		{
+			Current = Value;
+			m_ValidStates |= Bit;
+		}
+		return Changed;
+	}
+
+	uint32_t m_ValidStates;			// a bit per EStateType
+	uint32_t m_ValidVertexBuffers;	// a bit per slot
+	ID3D12PipelineState* m_PipelineState;
+	ID3D12RootSignature* m_RootSignature;
+	D3D12_PRIMITIVE_TOPOLOGY m_Topology;
+	D3D12_VERTEX_BUFFER_VIEW m_VertexBuffers[MAX_VERTEX_BUFFERS];
+	D3D12_INDEX_BUFFER_VIEW m_IndexBuffer;
+	D3D12_VIEWPORT m_Viewport;
+	D3D12_RECT m_Scissor;
+	FRenderTargets m_RenderTargets;
+	UINT m_StencilRef;
+	FStats m_Stats;
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "Assertion.h"
+
+// Keeps the pages of allocations larger than a standard page for reuse instead of freeing them with their
+// fence. Every power of two is split in four size classes, a size rounds up to its class and a page serves
+// every later request of its class, at most a quarter of a page goes unused. Trim frees the pages idle for
+// longer than MaxIdleTicks, and then the least recently used ones while the resident bytes are over the
+// budget, pages still in flight are never trimmed. Knows nothing of the device, the caller creates and
+// frees the pages and says which fences completed.
+template<typename PageType>
+class FLargePagePool
+{
+public:
+	static const uint32_t CLASSES_PER_POWER = 4;
+	static const uint32_t NUM_BUCKETS = 64 * CLASSES_PER_POWER;
+
+	struct FStats
+	{
+		uint64_t Hits;
+		uint64_t Misses;
+		uint64_t Trimmed;
+		uint64_t BytesResident;		// every page the pool counted, in use or pooled
+		uint64_t BytesPooled;
+		uint64_t PeakBytesResident;
+	};
+
+	FLargePagePool(uint64_t BudgetBytes, uint64_t MaxIdleTicks)
+		: m_BudgetBytes(BudgetBytes)
+		, m_MaxIdleTicks(MaxIdleTicks)
+	{
+		memset(&m_Stats, 0, sizeof(m_Stats));
+	}
+
+	// the size of the pages that serve Size bytes
+	static uint64_t GetBucketSize(uint64_t Size)
+	{
+		if (Size <= 2 * CLASSES_PER_POWER)
+			return 2 * CLASSES_PER_POWER;
+		const uint64_t Step = (1ull << GetPower(Size - 1)) / CLASSES_PER_POWER;
+		return (Size + Step - 1) / Step * Step;
+	}
+
+	void SetBudget(uint64_t BudgetBytes, uint64_t MaxIdleTicks)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_BudgetBytes = BudgetBytes;
+		m_MaxIdleTicks = MaxIdleTicks;
+	}
+
+	// a pooled page for Size bytes whose fence passed. On nullptr the caller creates one of GetBucketSize(Size)
+	// bytes, which counts as resident from here on
+	template<typename FenceFunction>
+	PageType* Request(uint64_t Size, const FenceFunction& IsComplete)
+	{
+		const uint64_t BucketSize = GetBucketSize(Size);
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		// the most recently used first, the others get the chance to idle out
+		std::vector<FEntry>& Bucket = m_Buckets[GetBucket(BucketSize)];
+		for (size_t i = Bucket.size(); i-- > 0; )
+		{
+			if (IsComplete(Bucket[i].Fence))
+			{
+				PageType* Page = Bucket[i].Page;
+				Bucket.erase(Bucket.begin() + i);
+				m_Stats.BytesPooled -= BucketSize;
+				m_Stats.Hits++;
+				return Page;
+			}
+		}
+
+		m_Stats.Misses++;
+		m_Stats.BytesResident += BucketSize;
+		m_Stats.PeakBytesResident = (std::max)(m_Stats.PeakBytesResident, m_Stats.BytesResident);
+		return nullptr;
+	}
+
+	// PageSize is what Request asked for, the page is free again once Fence passed
+	void Discard(uint64_t Fence, PageType* Page, uint64_t PageSize, uint64_t Tick)
+	{
+		Assert(PageSize == GetBucketSize(PageSize));
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Buckets[GetBucket(PageSize)].push_back(FEntry{ Fence, Tick, PageSize, Page });
+		m_Stats.BytesPooled += PageSize;
+	}
+
+	// appends the pages to free to Freed
+	template<typename FenceFunction>
+	void Trim(uint64_t Tick, const FenceFunction& IsComplete, std::vector<PageType*>& Freed)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		for (uint32_t b = 0; b < NUM_BUCKETS; ++b)
+		{
+			std::vector<FEntry>& Bucket = m_Buckets[b];
+			for (size_t i = 0; i < Bucket.size(); )
+			{
+				if (Tick - Bucket[i].LastUsed > m_MaxIdleTicks && IsComplete(Bucket[i].Fence))
+					Free(Bucket, i, Freed);
+				else
+					++i;
+			}
+		}
+
+		while (m_Stats.BytesResident > m_BudgetBytes)
+		{
+			// the least recently used page that is done
+			std::vector<FEntry>* OldestBucket = nullptr;
+			size_t OldestIndex = 0;
+			for (uint32_t b = 0; b < NUM_BUCKETS; ++b)
+			{
+				std::vector<FEntry>& Bucket = m_Buckets[b];
+				for (size_t i = 0; i < Bucket.size(); ++i)
+				{
+					if ((OldestBucket == nullptr || Bucket[i].LastUsed < (*OldestBucket)[OldestIndex].LastUsed) && IsComplete(Bucket[i].Fence))
+					{
+						OldestBucket = &Bucket;
+						OldestIndex = i;
+					}
+				}
+			}
+			if (OldestBucket == nullptr)
+				break;
+			Free(*OldestBucket, OldestIndex, Freed);
+		}
+	}
+
+	// hands back every pooled page to free
+	void Reset(std::vector<PageType*>& Freed)
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		for (uint32_t b = 0; b < NUM_BUCKETS; ++b)
+		{
+			while (!m_Buckets[b].empty())
+				Free(m_Buckets[b], m_Buckets[b].size() - 1, Freed);
+		}
+	}
+
+	FStats GetStats()
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		return m_Stats;
+	}
+
+private:
+	struct FEntry
+	{
+		uint64_t Fence;
+		uint64_t LastUsed;
+		uint64_t Size;
+		PageType* Page;
+	};
+
+	// index of the highest bit
+	static uint32_t GetPower(uint64_t Value)
+	{
+		uint32_t Power = 0;
+		while (Value >>= 1)
+			++Power;
+		return Power;
+	}
+
+	static uint32_t GetBucket(uint64_t BucketSize)
+	{
+		const uint32_t Power = GetPower(BucketSize - 1);
+		const uint64_t Step = (1ull << Power) / CLASSES_PER_POWER;
+		return Power * CLASSES_PER_POWER + (uint32_t)((BucketSize - (1ull << Power)) / Step) - 1;
+	}
+
+	void Free(std::vector<FEntry>& Bucket, size_t Index, std::vector<PageType*>& Freed)
+	{
+		Freed.push_back(Bucket[Index].Page);
+		m_Stats.BytesPooled -= Bucket[Index].Size;
+		m_Stats.BytesResident -= Bucket[Index].Size;
+		m_Stats.Trimmed++;
+		// keeps the bucket in the order of use Request relies on
+		Bucket.erase(Bucket.begin() + Index);
+	}
+
+	std::mutex m_Mutex;
+	std::vector<FEntry> m_Buckets[NUM_BUCKETS];
+	uint64_t m_BudgetBytes;
+	uint64_t m_MaxIdleTicks;
+	FStats m_Stats;
+};
@@ -2,13 +2,22 @@
 
 #include <queue>
 #include <memory>
+#include <mutex>
 #include <d3d12.h>
 #include "Common.h"
 #include "D3D12Resource.h"
+#include "PagePool.h"
+#include "LargePagePool.h"
+#include "UploadRing.h"
 
 const static uint32_t DEFAULT_ALIGN = 256;
 const static uint32_t GpuAllocatorPageSize = 0x10000;	// 64k
 const static uint32_t CpuAllocatorPageSize = 0x200000;	// 2MB
+// ring of the upload allocator of a context, room for a few submissions in flight
+const static uint32_t CpuAllocatorRingSize = 0x800000;	// 8MB
+// large pages kept by each page manager, and how long one may sit unused before it is freed
+const static uint64_t LargePageBudget = 0x4000000;	// 64MB
+const static uint64_t LargePageMaxIdleMs = 2000;
 
 
 enum ELinearAllocatorType
@@ -37,6 +46,7 @@ public:
 	~LinearAllocationPage();
 
 	uint64_t GetFenceValue() const { return m_FenceValue; }
+	size_t GetPageSize() const { return m_PageSize; }
 	void SetFenceValue(uint64_t FenceValue) { m_FenceValue = FenceValue; }
 
 private:
@@ -51,22 +61,30 @@ private:
 	
 };
 
+// Shared by the contexts of all threads, the standard pages go through a FPagePool, the large ones through
+// a FLargePagePool
 class LinearAllocationPagePageManager
 {
 public:
 	LinearAllocationPagePageManager();
 	LinearAllocationPage* RequestPage();
 	void DiscardStandardPages(uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages);
+	// a page of at least SizeInBytes, its size rounded up to a size class of the pool
+	LinearAllocationPage* RequestLargePage(size_t SizeInBytes);
 	void DiscardLargePages(uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages);
+	// frees the large pages over the budget or idle for too long
+	void TrimLargePages();
 	LinearAllocationPage* CreateNewPage(size_t SizeInBytes = 0);
+	void SetLargePageBudget(uint64_t BudgetBytes, uint64_t MaxIdleMs);
+	FLargePagePool<LinearAllocationPage>::FStats GetLargePageStats() { return m_LargePagePool.GetStats(); }
 	void Destroy();
 
 private:
-	using PagePool = std::queue<LinearAllocationPage* >;
-
-	PagePool m_RetiredPages;
-	PagePool m_LargePagePool;
-	PagePool m_StandardPagePool;
+	FPagePool<LinearAllocationPage> m_RetiredPages;
+	FLargePagePool<LinearAllocationPage> m_LargePagePool;
+	// every standard page ever created, for Destroy
+	std::vector<LinearAllocationPage*> m_StandardPagePool;
+	std::mutex m_Mutex;
 
 	static ELinearAllocatorType ms_TypeCounter;
 	ELinearAllocatorType m_AllocatorType;
@@ -75,15 +93,23 @@ private:
 class LinearAllocator
 {
 public:
-	LinearAllocator(ELinearAllocatorType Type);
+	// with a RingSize, allocations up to a page come from a persistently mapped ring of that size, the space
+	// of a submission is reused once its fence passed. Bigger ones, and the ones that find the ring full,
+	// fall back to pages
+	LinearAllocator(ELinearAllocatorType Type, size_t RingSize = 0);
+	~LinearAllocator();
 
 	FAllocation Allocate(size_t SizeInBytes, size_t Alignment = DEFAULT_ALIGN);
 
 	void CleanupUsedPages(uint64_t FenceID);
 	static void DestroyAll();
+	// once per frame, so that idle large pages are freed also when no large allocations are made any more
+	static void TrimAll();
+	static LinearAllocationPagePageManager& GetPageManager(ELinearAllocatorType Type) { return ms_PageManager[Type]; }
 
 private:
 	FAllocation AllocateLargePage(size_t SizeInBytes);
+	bool AllocateFromRing(size_t SizeInBytes, size_t Alignment, FAllocation& Allocation);
 
 	ELinearAllocatorType m_AllocatorType;
 	size_t m_PageSize;
@@ -94,5 +120,9 @@ private:
 
 	LinearAllocationPage* m_CurrentPage;
 
+	size_t m_RingSize;
+	FUploadRing m_Ring;
+	LinearAllocationPage* m_RingPage;	// created on the first allocation
+
 	static LinearAllocationPagePageManager ms_PageManager[2];
 };
\ No newline at end of file
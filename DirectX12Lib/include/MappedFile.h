@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class FMappedFile
+{
+public:
+	FMappedFile();
+	~FMappedFile();
+
+	bool Open(const std::string& FilePath);
+	void Close();
+
+	bool IsOpen() const { return m_File != nullptr; }
+	const char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	FMappedFile(const FMappedFile&) = delete;
+	FMappedFile& operator=(const FMappedFile&) = delete;
+
+	void* m_File;
+	void* m_Mapping;
+	const char* m_Data;
+	size_t m_Size;
+};
@@ -2,13 +2,18 @@
 
 #include <math.h>
 #include <stdint.h>
-#include <intrin.h>
+#include "MathSimd.h"
 #include <functional>
 #include <algorithm>
 #include <limits>
 #include <cmath>
 #include <random>
 #include <chrono>
+#include <vector>
+
+#if !defined(_MSC_VER) && !defined(__forceinline)
+#define __forceinline inline __attribute__((always_inline))
+#endif
 
 const float MATH_PI = 3.141592654f;
 const float MATH_2PI = 2.f * MATH_PI;
@@ -252,16 +257,30 @@ struct FBoundingBox
 	{}
 
 	void Include(const FBoundingBox& Other);
+
+	Vector3f GetCenter() const { return (BoundMin + BoundMax) * 0.5f; }
+	// half size along each axis
+	Vector3f GetExtent() const { return (BoundMax - BoundMin) * 0.5f; }
+};
+
+
+// boxes split into one array per component so that 4 of them fill a SIMD register
+struct FBoundingBoxSoA
+{
+	std::vector<float> MinX, MinY, MinZ;
+	std::vector<float> MaxX, MaxY, MaxZ;
+
+	size_t Size() const { return MinX.size(); }
+	void Resize(size_t Count);
+	void Set(size_t Index, const FBoundingBox& Box);
+	FBoundingBox Get(size_t Index) const;
 };
 
 
 struct FMatrix
 {
-	union 
-	{
-		Vector4f row[4];
-		struct { Vector4f r0, r1, r2, r3;};
-	};
+	// rows are contiguous, operator[] indexes from r0
+	Vector4f r0, r1, r2, r3;
 	FMatrix();
 
 	FMatrix(const Vector3f& r0, const Vector3f& r1, const Vector3f& r2, const Vector3f& r3);
@@ -279,15 +298,29 @@ struct FMatrix
 	FMatrix operator * (float rhs) const;
 	FMatrix& operator *= (float rhs);
 
-	Vector4f& operator[](int r) { return row[r]; }
-	const Vector4f& operator[](int r) const { return row[r]; }
+	Vector4f& operator[](int r) { return (&r0)[r]; }
+	const Vector4f& operator[](int r) const { return (&r0)[r]; }
 
 	Vector3f TranslateVector(const Vector3f& vector) const;
 	Vector3f TransformPosition(const Vector3f& position) const;
 	FBoundingBox TransformBoundingBox(const FBoundingBox& BoundBox) const;
 	FBoundingBox TransformBoundingBox(const Vector3f& BoundMin, const Vector3f& BoundMax) const;
+	// 4 boxes per iteration, Out is resized to In and gets the same bits as TransformBoundingBox
+	void TransformBoundingBoxes(const FBoundingBoxSoA& In, FBoundingBoxSoA& Out) const;
+	// Out[i] = Matrices[i].TransformBoundingBox(In[i]), In and Out may alias
+	static void TransformBoundingBoxes(const FMatrix* Matrices, const FBoundingBox* In, FBoundingBox* Out, size_t Count);
+	// largest length of the 3 axis rows, what a radius scales by
+	float GetMaxScale() const;
+	// xyz center and w radius
+	Vector4f TransformSphere(const Vector4f& Sphere) const;
 	FMatrix Transpose() const;
+	// blockwise over 2x2 sub matrices. Element errors stay within 16 * FLT_EPSILON * |m| * |m^-1| of the largest
+	// element of the inverse (max norms), the cofactor expansion it replaced reaches about twice that
 	FMatrix Inverse() const;
+	// last column (0, 0, 0, 1), any invertible 3x3 part
+	FMatrix InverseAffine() const;
+	// rotation and translation only, the 3x3 part is transposed
+	FMatrix InverseRigid() const;
 
 	static FMatrix TranslateMatrix(const Vector3f& T);
 	static FMatrix ScaleMatrix(float s);
@@ -302,6 +335,41 @@ struct FMatrix
 };
 
 
+// a box after an arbitrary affine transform, Axes are the transformed half extents
+struct FOrientedBox
+{
+	Vector3f Center;
+	Vector3f Axes[3];
+
+	FOrientedBox() {}
+	FOrientedBox(const FBoundingBox& Box, const FMatrix& Transform);
+
+	// tight axis aligned box, the same as FMatrix::TransformBoundingBox up to rounding
+	FBoundingBox GetBoundingBox() const;
+};
+
+
+// world space planes of a view projection matrix, the normals point inside
+struct FFrustum
+{
+	enum { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+	Vector4f Planes[PlaneCount];
+
+	FFrustum() {}
+	explicit FFrustum(const FMatrix& ViewProj);
+
+	bool IntersectSphere(const Vector3f& Center, float Radius) const;
+	bool IntersectBox(const FBoundingBox& Box) const;
+	bool IntersectOrientedBox(const FOrientedBox& Box) const;
+
+	// append the index of every box or sphere that is not fully outside, 4 per SIMD step with the
+	// same arithmetic as IntersectBox and IntersectSphere
+	void CullBoxes(const FBoundingBoxSoA& Boxes, std::vector<uint32_t>& Visible) const;
+	// xyz center and w radius
+	void CullSpheres(const Vector4f* Spheres, uint32_t Count, std::vector<uint32_t>& Visible) const;
+};
+
+
 struct FQuaternion
 {
 	Vector4f q;
@@ -343,11 +411,19 @@ struct FQuaternion
 
 	static FQuaternion Mul(const FQuaternion& q1, const FQuaternion& q2)
 	{
+		// x = +q1.x * q2.w + q1.y * q2.z - q1.z * q2.y + q1.w * q2.x
+		// y = -q1.x * q2.z + q1.y * q2.w + q1.z * q2.x + q1.w * q2.y
+		// z = +q1.x * q2.y - q1.y * q2.x + q1.z * q2.w + q1.w * q2.z
+		// w = -q1.x * q2.x - q1.y * q2.y - q1.z * q2.z + q1.w * q2.w
+		FSimdFloat4 A = FSimd::Load(&q1.q.x);
+		FSimdFloat4 B = FSimd::Load(&q2.q.x);
+		FSimdFloat4 Result = FSimd::Mul(FSimd::SplatLane<0>(A), FSimd::Mul(FSimd::Swizzle<3, 2, 1, 0>(B), FSimd::Set(1.f, -1.f, 1.f, -1.f)));
+		Result = FSimd::Add(Result, FSimd::Mul(FSimd::SplatLane<1>(A), FSimd::Mul(FSimd::Swizzle<2, 3, 0, 1>(B), FSimd::Set(1.f, 1.f, -1.f, -1.f))));
+		Result = FSimd::Add(Result, FSimd::Mul(FSimd::SplatLane<2>(A), FSimd::Mul(FSimd::Swizzle<1, 0, 3, 2>(B), FSimd::Set(-1.f, 1.f, 1.f, -1.f))));
+		Result = FSimd::Add(Result, FSimd::Mul(FSimd::SplatLane<3>(A), B));
+
 		FQuaternion q1_q2;
-		q1_q2.q.x = +q1.q.x * q2.q.w + q1.q.y * q2.q.z - q1.q.z * q2.q.y + q1.q.w * q2.q.x;
-		q1_q2.q.y = -q1.q.x * q2.q.z + q1.q.y * q2.q.w + q1.q.z * q2.q.x + q1.q.w * q2.q.y;
-		q1_q2.q.z = +q1.q.x * q2.q.y - q1.q.y * q2.q.x + q1.q.z * q2.q.w + q1.q.w * q2.q.z;
-		q1_q2.q.w = -q1.q.x * q2.q.x - q1.q.y * q2.q.y - q1.q.z * q2.q.z + q1.q.w * q2.q.w;
+		FSimd::Store(&q1_q2.q.x, Result);
 		return q1_q2;
 	}
 
@@ -384,7 +460,12 @@ struct FQuaternion
 
 //inline Vector4f operator*(const FMatrix& mat, const Vector4f& vec);
 
-inline Vector4f operator*(const Vector4f& vec, const FMatrix& mat);
+inline Vector4f operator*(const Vector4f& vec, const FMatrix& mat)
+{
+	Vector4f Result;
+	FSimd::Store(&Result.x, FSimd::Transform(FSimd::Load(&vec.x), FSimd::Load(&mat[0].x), FSimd::Load(&mat[1].x), FSimd::Load(&mat[2].x), FSimd::Load(&mat[3].x)));
+	return Result;
+}
 
 template <typename T>
 T AlignUpWithMask(T Value, size_t Mask)
@@ -417,16 +498,19 @@ bool IsAligned(T value, size_t alignment)
 }
 
 
-#ifdef _M_X64
+#if defined(_M_X64) || (defined(__x86_64__) && defined(__SSE4_2__))
 #define ENABLE_SSE_CRC32 1
 #else
 #define ENABLE_SSE_CRC32 0
 #endif
 
 #if ENABLE_SSE_CRC32
+#include <nmmintrin.h>
+#ifdef _MSC_VER
 #pragma intrinsic(_mm_crc32_u32)
 #pragma intrinsic(_mm_crc32_u64)
 #endif
+#endif
 
 inline size_t HashRange(const uint32_t* const Begin, const uint32_t* const End, size_t Hash)
 {
@@ -0,0 +1,120 @@
+#pragma once
+
+// 4 wide float vector behind the FMatrix and FQuaternion math: SSE2 on x86 and x64, NEON on ARM, plain floats
+// elsewhere. Define MATH_NO_SIMD to force the scalar path. Only lane wise mul/add/sub are used on the hot paths,
+// in the order of the scalar code, so every backend gives the same bits.
+#if !defined(MATH_NO_SIMD) && (defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__))
+#include <emmintrin.h>
+#define MATH_USE_SSE 1
+#define MATH_USE_NEON 0
+#elif !defined(MATH_NO_SIMD) && (defined(_M_ARM64) || defined(__ARM_NEON))
+#include <arm_neon.h>
+#define MATH_USE_SSE 0
+#define MATH_USE_NEON 1
+#else
+#include <math.h>
+#define MATH_USE_SSE 0
+#define MATH_USE_NEON 0
+#endif
+
+#if MATH_USE_SSE
+typedef __m128 FSimdFloat4;
+#elif MATH_USE_NEON
+typedef float32x4_t FSimdFloat4;
+#else
+struct FSimdFloat4 { float v[4]; };
+#endif
+
+struct FSimd
+{
+#if MATH_USE_SSE
+	static FSimdFloat4 Load(const float* p) { return _mm_loadu_ps(p); }
+	static void Store(float* p, FSimdFloat4 a) { _mm_storeu_ps(p, a); }
+	static FSimdFloat4 Set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+	static FSimdFloat4 Splat(float s) { return _mm_set1_ps(s); }
+	static FSimdFloat4 Add(FSimdFloat4 a, FSimdFloat4 b) { return _mm_add_ps(a, b); }
+	static FSimdFloat4 Sub(FSimdFloat4 a, FSimdFloat4 b) { return _mm_sub_ps(a, b); }
+	static FSimdFloat4 Mul(FSimdFloat4 a, FSimdFloat4 b) { return _mm_mul_ps(a, b); }
+	static FSimdFloat4 Div(FSimdFloat4 a, FSimdFloat4 b) { return _mm_div_ps(a, b); }
+	static FSimdFloat4 Min(FSimdFloat4 a, FSimdFloat4 b) { return _mm_min_ps(a, b); }
+	static FSimdFloat4 Max(FSimdFloat4 a, FSimdFloat4 b) { return _mm_max_ps(a, b); }
+	static FSimdFloat4 Abs(FSimdFloat4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+	// bit i set when lane i of a is less than lane i of b
+	static int LessMask(FSimdFloat4 a, FSimdFloat4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+
+	// lanes X, Y, Z, W of a
+	template<int X, int Y, int Z, int W>
+	static FSimdFloat4 Swizzle(FSimdFloat4 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(W, Z, Y, X)); }
+	// lanes X, Y of a and Z, W of b
+	template<int X, int Y, int Z, int W>
+	static FSimdFloat4 Shuffle(FSimdFloat4 a, FSimdFloat4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+#elif MATH_USE_NEON
+	static FSimdFloat4 Load(const float* p) { return vld1q_f32(p); }
+	static void Store(float* p, FSimdFloat4 a) { vst1q_f32(p, a); }
+	static FSimdFloat4 Set(float x, float y, float z, float w) { float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+	static FSimdFloat4 Splat(float s) { return vdupq_n_f32(s); }
+	static FSimdFloat4 Add(FSimdFloat4 a, FSimdFloat4 b) { return vaddq_f32(a, b); }
+	static FSimdFloat4 Sub(FSimdFloat4 a, FSimdFloat4 b) { return vsubq_f32(a, b); }
+	static FSimdFloat4 Mul(FSimdFloat4 a, FSimdFloat4 b) { return vmulq_f32(a, b); }
+#if defined(_M_ARM64) || defined(__aarch64__)
+	static FSimdFloat4 Div(FSimdFloat4 a, FSimdFloat4 b) { return vdivq_f32(a, b); }
+#else
+	static FSimdFloat4 Div(FSimdFloat4 a, FSimdFloat4 b) { return Set(vgetq_lane_f32(a, 0) / vgetq_lane_f32(b, 0), vgetq_lane_f32(a, 1) / vgetq_lane_f32(b, 1), vgetq_lane_f32(a, 2) / vgetq_lane_f32(b, 2), vgetq_lane_f32(a, 3) / vgetq_lane_f32(b, 3)); }
+#endif
+	static FSimdFloat4 Min(FSimdFloat4 a, FSimdFloat4 b) { return vminq_f32(a, b); }
+	static FSimdFloat4 Max(FSimdFloat4 a, FSimdFloat4 b) { return vmaxq_f32(a, b); }
+	static FSimdFloat4 Abs(FSimdFloat4 a) { return vabsq_f32(a); }
+	static int LessMask(FSimdFloat4 a, FSimdFloat4 b)
+	{
+		uint32x4_t Less = vcltq_f32(a, b);
+		return (vgetq_lane_u32(Less, 0) & 1) | (vgetq_lane_u32(Less, 1) & 2) | (vgetq_lane_u32(Less, 2) & 4) | (vgetq_lane_u32(Less, 3) & 8);
+	}
+
+	template<int X, int Y, int Z, int W>
+	static FSimdFloat4 Swizzle(FSimdFloat4 a) { return Set(vgetq_lane_f32(a, X), vgetq_lane_f32(a, Y), vgetq_lane_f32(a, Z), vgetq_lane_f32(a, W)); }
+	template<int X, int Y, int Z, int W>
+	static FSimdFloat4 Shuffle(FSimdFloat4 a, FSimdFloat4 b) { return Set(vgetq_lane_f32(a, X), vgetq_lane_f32(a, Y), vgetq_lane_f32(b, Z), vgetq_lane_f32(b, W)); }
+#else
+	static FSimdFloat4 Load(const float* p) { FSimdFloat4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+	static void Store(float* p, FSimdFloat4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+	static FSimdFloat4 Set(float x, float y, float z, float w) { FSimdFloat4 r = { { x, y, z, w } }; return r; }
+	static FSimdFloat4 Splat(float s) { return Set(s, s, s, s); }
+	static FSimdFloat4 Add(FSimdFloat4 a, FSimdFloat4 b) { return Set(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]); }
+	static FSimdFloat4 Sub(FSimdFloat4 a, FSimdFloat4 b) { return Set(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]); }
+	static FSimdFloat4 Mul(FSimdFloat4 a, FSimdFloat4 b) { return Set(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]); }
+	static FSimdFloat4 Div(FSimdFloat4 a, FSimdFloat4 b) { return Set(a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]); }
+	// picks b on NaN as minps and maxps do
+	static FSimdFloat4 Min(FSimdFloat4 a, FSimdFloat4 b) { return Set(a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1], a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3]); }
+	static FSimdFloat4 Max(FSimdFloat4 a, FSimdFloat4 b) { return Set(a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1], a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3]); }
+	static FSimdFloat4 Abs(FSimdFloat4 a) { return Set(fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])); }
+	static int LessMask(FSimdFloat4 a, FSimdFloat4 b) { return (a.v[0] < b.v[0]) | (a.v[1] < b.v[1]) << 1 | (a.v[2] < b.v[2]) << 2 | (a.v[3] < b.v[3]) << 3; }
+
+	template<int X, int Y, int Z, int W>
+	static FSimdFloat4 Swizzle(FSimdFloat4 a) { return Set(a.v[X], a.v[Y], a.v[Z], a.v[W]); }
+	template<int X, int Y, int Z, int W>
+	static FSimdFloat4 Shuffle(FSimdFloat4 a, FSimdFloat4 b) { return Set(a.v[X], a.v[Y], b.v[Z], b.v[W]); }
+#endif
+
+	template<int Lane>
+	static FSimdFloat4 SplatLane(FSimdFloat4 a) { return Swizzle<Lane, Lane, Lane, Lane>(a); }
+
+	// ((x * r0 + y * r1) + z * r2) + w * r3, a row vector times the matrix with rows r0..r3
+	static FSimdFloat4 Transform(FSimdFloat4 v, FSimdFloat4 r0, FSimdFloat4 r1, FSimdFloat4 r2, FSimdFloat4 r3)
+	{
+		FSimdFloat4 Result = Add(Mul(SplatLane<0>(v), r0), Mul(SplatLane<1>(v), r1));
+		Result = Add(Result, Mul(SplatLane<2>(v), r2));
+		return Add(Result, Mul(SplatLane<3>(v), r3));
+	}
+
+	static void Transpose(FSimdFloat4& r0, FSimdFloat4& r1, FSimdFloat4& r2, FSimdFloat4& r3)
+	{
+		FSimdFloat4 t0 = Shuffle<0, 1, 0, 1>(r0, r1);
+		FSimdFloat4 t1 = Shuffle<2, 3, 2, 3>(r0, r1);
+		FSimdFloat4 t2 = Shuffle<0, 1, 0, 1>(r2, r3);
+		FSimdFloat4 t3 = Shuffle<2, 3, 2, 3>(r2, r3);
+		r0 = Shuffle<0, 2, 0, 2>(t0, t2);
+		r1 = Shuffle<1, 3, 1, 3>(t0, t2);
+		r2 = Shuffle<0, 2, 0, 2>(t1, t3);
+		r3 = Shuffle<1, 3, 1, 3>(t1, t3);
+	}
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include "MathLib.h"
+
+class MeshData;
+struct MaterialData;
+
+// scene node saved with the meshes, so that warm loads of a glTF skip the source file entirely
+struct FMeshCacheNode
+{
+	std::string Name;
+	int32_t Parent = -1;	// index into the node array, -1 for a root
+	int32_t Mesh = -1;		// index into the mesh array, -1 for a plain node
+	Vector3f Scale = Vector3f(1.f);
+	Vector3f Translation;
+	Vector4f Rotation = Vector4f(0.f, 0.f, 0.f, 1.f);
+};
+
+// versioned binary cache (.meshbin) of imported MeshData, stored next to the source file
+class FMeshCache
+{
+public:
+	enum EImportFlags : uint32_t
+	{
+		IF_None			= 0,
+		IF_FlipV		= 1 << 0,
+		IF_NegateZ		= 1 << 1,
+		IF_FlipNormalZ	= 1 << 2,
+		IF_MikkTSpace	= 1 << 3,
+		IF_Optimized	= 1 << 4,
+	};
+
+	static void SetEnabled(bool Enabled) { sm_Enabled = Enabled; }
+	static bool IsEnabled() { return sm_Enabled; }
+
+	static std::string GetCachePath(const std::string& SourcePath);
+	// 64 bit FNV-1a over the contents and paths of all source files plus the import flags, a missing file hashes as empty
+	static uint64_t ComputeKey(const std::vector<std::string>& SourceFiles, uint32_t ImportFlags);
+
+	// SceneMaterials is the material table shared by all meshes of a scene, the meshes keep their own materials too
+	// the cache goes to GetCachePath(SourcePath) and remembers the size and write time of SourcePath
+	static bool Save(const std::string& SourcePath, uint64_t Key, const std::vector<const MeshData*>& Meshes, const std::vector<FMeshCacheNode>& Nodes, const std::vector<MaterialData>& SceneMaterials);
+	// fails if the cache is missing, from another version or built from other sources, or if the size or
+	// write time of SourcePath changed since the Save
+	static bool Load(const std::string& SourcePath, uint64_t Key, std::vector<MeshData*>& Meshes, std::vector<FMeshCacheNode>& Nodes, std::vector<MaterialData>& SceneMaterials);
+
+private:
+	static bool sm_Enabled;
+};
@@ -4,8 +4,12 @@
 #include "MathLib.h"
 #include "GpuBuffer.h"
 #include "Texture.h"
+#include "TextureRegistry.h"
+#include "VertexCompression.h"
+#include "MeshLod.h"
 #include <vector>
 #include <string>
+#include <memory>
 
 enum VertexElementType : uint8_t
 {
@@ -45,11 +49,17 @@ struct MaterialData
 };
 
 class MeshData;
+// draw of one submesh, see FDrawCommandList for the layout of SortKey
 struct MeshDrawCommand
 {
+	uint64_t SortKey;
 	MeshData* Mesh;
 	uint32_t StartIndex;
 	uint32_t IndexCount;
+	int32_t BaseVertex;
+	uint32_t SubMeshIndex;
+	uint32_t MaterialIndex;
+	uint32_t MeshIndex;		// scene mesh of the draw, filled in by the caller
 };
 
 struct SubMeshData
@@ -58,13 +68,23 @@ struct SubMeshData
 		: StartIndex(InStartIndex)
 		, IndexCount(InIndexCount)
 		, MaterialIndex(InMaterialIndex)
+		, BaseVertex(0)
+		, TexcoordScaleBias(1.f, 1.f, 0.f, 0.f)
 	{}
 
 	uint32_t MaterialIndex;
 	uint32_t StartIndex, IndexCount;
+	// added to the 16 bit GPU indices of the submesh
+	int32_t BaseVertex;
+	// uv range of the VC_TexcoordUNorm stream, xy scale, zw bias
+	Vector4f TexcoordScaleBias;
+	// mesh space bounds of the vertices the submesh indexes
+	FBoundingBox Bounds;
 };
 
 class FObjLoader;
+class FMaterialTable;
+struct FMeshletData;
 
 class MeshData
 {
@@ -83,16 +103,38 @@ public:
 	uint32_t GetVertexStride(VertexElementType type) const;
 	const float* GetVertexData(VertexElementType type);
 
+	// EVertexCompression flags of the GPU streams, new meshes start with the default flags
+	static void SetDefaultVertexCompression(uint32_t Flags) { sm_DefaultVertexCompression = Flags; }
+	static uint32_t GetDefaultVertexCompression() { return sm_DefaultVertexCompression; }
+	void SetVertexCompression(uint32_t Flags) { m_VertexCompression = Flags; }
+	uint32_t GetVertexCompression() const { return m_VertexCompression; }
+
+	// packs the flagged streams from the fp32 data, called before the vertex buffers are created
+	void CompressVertexStreams();
+	// what goes into the vertex buffer, the fp32 data for uncompressed streams
+	uint32_t GetStreamStride(VertexElementType type) const;
+	const void* GetStreamData(VertexElementType type);
+	DXGI_FORMAT GetStreamFormat(VertexElementType type) const;
+	// maps VC_Position positions back to mesh space, to be applied before the world matrix
+	FMatrix GetPositionDequantization() const;
+
 	uint32_t GetIndexCount() const;
 	uint32_t GetIndexSize() const;
 	uint32_t GetIndexElementSize() const;
-	const uint32_t* GetIndexData();
+	const void* GetIndexData();
+	// the GPU copy of m_indices uses 16 bit when every submesh spans less than 64k vertices
+	void PackIndices();
 
-	size_t GetMaterialCount() const { return m_materials.size(); }
+	size_t GetMaterialCount() const { return GetMaterials().size(); }
 	size_t GetMeshCount() const { return m_submeshes.size(); }
 	uint32_t GetSubIndexStart(size_t Index) const;
 	size_t GetSubIndexCount(size_t Index) const;
 	size_t GetSubMaterialIndex(size_t Index) const;
+	int32_t GetSubBaseVertex(size_t Index) const;
+	const Vector4f& GetSubTexcoordScaleBias(size_t Index) const;
+	const FBoundingBox& GetSubBounds(size_t Index) const;
+	// clamped to the index buffer
+	uint32_t GetSubTriangleCount(size_t Index) const;
 
 	void AddMaterial(const MaterialData& Material);
 	void AddSubMesh(uint32_t StartIndex, uint32_t IndexCount, uint32_t MaterialIndex);
@@ -105,14 +147,36 @@ public:
 	std::string GetNormalPath(uint32_t MtlIndex);
 	const MaterialData& GetMaterialData(size_t Index);
 
+	// meshes of one scene share a table, a mesh without one gets its own from m_materials in PostLoad
+	void SetMaterialTable(const std::shared_ptr<FMaterialTable>& Table) { m_MaterialTable = Table; }
+	const std::shared_ptr<FMaterialTable>& GetMaterialTable() const { return m_MaterialTable; }
+
 	FGpuBuffer* GetVertexBuffer(VertexElementType EleIndex) { return &m_VertexBuffer[static_cast<uint32_t>(EleIndex)]; }
 	FGpuBuffer* GetIndexBuffer() { return &m_IndexBuffer; }
 	FTexture* GetTexture(uint32_t MtlIndex, int TexIndex);
 	FTexture* GetTextureByMeshIndex(uint32_t SubMeshIndex, int TexIndex);
 
 
+	// appends a command for every submesh in submesh order, empty ones included with an IndexCount of 0
 	void CollectMeshBatch(std::vector<MeshDrawCommand>& MeshDrawCommands);
 
+	// splits every submesh into meshlets for cluster culling, see FMeshletBuilder
+	void BuildMeshlets(uint32_t MaxVertices, uint32_t MaxPrimitives);
+	const FMeshletData* GetMeshlets() const { return m_Meshlets.get(); }
+
+	// simplified index buffers over the same vertex streams, see FMeshLodBuilder. Generated before PostLoad
+	// they get their own GPU index buffers, level 0 is the mesh itself. GetLod(l).Error holds the error of a level
+	void GenerateLods(uint32_t MaxLods = FMeshLodBuilder::DEFAULT_MAX_LODS, float TargetRatio = 0.5f);
+	uint32_t GetLodCount() const { return 1 + (uint32_t)m_Lods.size(); }
+	const FMeshLod& GetLod(uint32_t Lod) const { return m_Lods[Lod - 1]; }
+	FGpuBuffer* GetLodIndexBuffer(uint32_t Lod) { return Lod == 0 ? &m_IndexBuffer : m_LodIndexBuffers[Lod - 1].get(); }
+	uint32_t GetLodSubIndexStart(uint32_t Lod, size_t Index) const;
+	size_t GetLodSubIndexCount(uint32_t Lod, size_t Index) const;
+	int32_t GetLodSubBaseVertex(uint32_t Lod, size_t Index) const;
+	// level for the screen space error of the mesh under LocalToWorld, MaxPixelError in pixels of a ViewportHeight high view
+	uint32_t SelectLod(const FMatrix& LocalToWorld, const FCamera& Camera, float ViewportHeight, float MaxPixelError = 1.f) const;
+
+	// whole mesh and per submesh bounds, AddSubMesh fills in the bounds of its submesh when the positions are in
 	void ComputeBoundingBox();
 	void GetBoundingBox(Vector3f& BoundMin, Vector3f& BoundMax);
 	void GetMeshLayout(std::vector<D3D12_INPUT_ELEMENT_DESC>& MeshLayout);
@@ -121,6 +185,9 @@ public:
 
 private:
 	void InitRenderingResource();
+	const std::vector<MaterialData>& GetMaterials() const;
+	void CompressTexcoordsUNorm(uint32_t* Packed);
+	void ComputeSubMeshBounds(SubMeshData& SubMesh) const;
 
 public:
 	std::string m_filepath;
@@ -142,7 +209,43 @@ private:
 	FGpuBuffer m_VertexBuffer[VET_Max];
 	FGpuBuffer m_IndexBuffer;
 
-	std::vector<FTexture> m_Textures;
+	std::shared_ptr<FMaterialTable> m_MaterialTable;
+
+	static uint32_t sm_DefaultVertexCompression;
+	uint32_t m_VertexCompression;
+	std::vector<uint8_t> m_CompressedStreams[VET_Max];
+	std::vector<uint16_t> m_PackedIndices;
+
+	std::unique_ptr<FMeshletData> m_Meshlets;
+	std::vector<FMeshLod> m_Lods;
+	std::vector<std::unique_ptr<FGpuBuffer>> m_LodIndexBuffers;
+	Vector3f m_PositionMin, m_PositionExtent;
+};
+
+
+// materials with their textures, TEX_PER_MATERIAL slots per material
+class FMaterialTable
+{
+public:
+	FMaterialTable() : m_Initialized(false) {}
+	explicit FMaterialTable(const std::vector<MaterialData>& Materials) : m_Materials(Materials), m_Initialized(false) {}
+
+	void AddMaterial(const MaterialData& Material) { m_Materials.push_back(Material); }
+	size_t GetMaterialCount() const { return m_Materials.size(); }
+	const std::vector<MaterialData>& GetMaterials() const { return m_Materials; }
+
+	// texture of slot TexIndex (basecolor, opacity, emissive, metallic, roughness, ao, normal), a default one for empty paths
+	static std::string GetTexturePath(const MaterialData* Material, int TexIndex);
+	static bool IsSRGBTexture(int TexIndex);
+
+	// acquires the textures from FTextureRegistry, only the first call loads
+	void InitRenderingResource();
+	FTexture* GetTexture(uint32_t MtlIndex, int TexIndex) const;
+
+private:
+	std::vector<MaterialData> m_Materials;
+	std::vector<FTextureRef> m_Textures;
+	bool m_Initialized;
 };
 
 
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MathLib.h"
+
+class MeshData;
+class FCamera;
+
+struct FLodSubMesh
+{
+	uint32_t StartIndex;	// into FMeshLod::Indices
+	uint32_t IndexCount;
+	int32_t BaseVertex;		// added to the 16 bit GPU indices of the submesh
+};
+
+// a simplified index buffer over the unchanged vertex streams of the mesh
+struct FMeshLod
+{
+	float Error = 0.f;						// mesh space distance the surface may have moved
+	std::vector<uint32_t> Indices;
+	std::vector<FLodSubMesh> SubMeshes;		// parallel to MeshData::m_submeshes
+	std::vector<uint16_t> PackedIndices;	// GPU copy when every submesh spans less than 64k vertices
+};
+
+// Quadric edge collapse (Garland-Heckbert over position, texcoord and normal). Collapses move a vertex onto
+// one of its neighbours so that no vertex is created, borders only collapse along themselves and UV seams
+// collapse both of their sides together.
+class FMeshLodBuilder
+{
+public:
+	static const uint32_t DEFAULT_MAX_LODS = 4;
+
+	// Lods[i] keeps about TargetRatio^(i + 1) of the triangles of every submesh, the levels run in parallel
+	// and the chain stops at the first level that no longer shrinks
+	static void Build(const MeshData& Mesh, std::vector<FMeshLod>& Lods, uint32_t MaxLods = DEFAULT_MAX_LODS, float TargetRatio = 0.5f);
+
+	// simplifies the triangle list in place and returns the new index count
+	static uint32_t Simplify(const MeshData& Mesh, uint32_t* Indices, uint32_t IndexCount, uint32_t TargetIndexCount, float* ResultError = nullptr);
+
+	// coarsest level whose error stays under MaxPixelError pixels on screen, 0 is the full mesh and i the Lods[i - 1],
+	// WorldScale is the largest scale of the world matrix
+	static uint32_t SelectLod(const std::vector<FMeshLod>& Lods, const FBoundingBox& WorldBounds, float WorldScale, const FCamera& Camera, float ViewportHeight, float MaxPixelError = 1.f);
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MathLib.h"
+
+class MeshData;
+
+// post-transform cache statistics of an index list, from a FIFO cache simulation
+struct FVertexCacheStats
+{
+	uint32_t TriangleCount = 0;
+	uint32_t VertexCount = 0;	// distinct vertices referenced
+	uint32_t Misses = 0;
+
+	float GetACMR() const { return TriangleCount > 0 ? (float)Misses / TriangleCount : 0.f; }	// misses per triangle, 0.5 at best
+	float GetATVR() const { return VertexCount > 0 ? (float)Misses / VertexCount : 0.f; }		// misses per vertex, 1.0 at best
+};
+
+// Index and vertex reordering run on imported meshes. The triangles of each submesh are sorted for the
+// post-transform cache (Tipsify) and then, cluster by cluster, for overdraw. Vertices follow in first use order.
+class FMeshOptimizer
+{
+public:
+	static const uint32_t DEFAULT_CACHE_SIZE = 16;
+
+	// the OBJ and glTF loaders run Optimize on every mesh when enabled, off by default
+	static void SetImportOptimization(bool Enabled) { sm_ImportOptimization = Enabled; }
+	static bool IsImportOptimizationEnabled() { return sm_ImportOptimization; }
+
+	static void Optimize(MeshData& Mesh, bool PrintStats = false);
+
+	// Tipsify, ClusterStarts receives the first index of every cluster that starts after a cache flush
+	static void OptimizeVertexCache(uint32_t* Indices, uint32_t IndexCount, uint32_t VertexCount, uint32_t CacheSize, std::vector<uint32_t>* ClusterStarts = nullptr);
+	// sorts the clusters so that the outward facing ones go first
+	static void OptimizeOverdraw(uint32_t* Indices, uint32_t IndexCount, const Vector3f* Positions, const std::vector<uint32_t>& ClusterStarts);
+	// renumbers the vertices in order of first use and permutes all vertex streams
+	static void OptimizeVertexFetch(MeshData& Mesh);
+	// renumbers the indices in order of first use, Remap receives the new index of every vertex, unreferenced ones go last
+	static void RemapVertexFetch(uint32_t* Indices, size_t IndexCount, uint32_t VertexCount, std::vector<uint32_t>& Remap);
+
+	static FVertexCacheStats AnalyzeVertexCache(const uint32_t* Indices, uint32_t IndexCount, uint32_t VertexCount, uint32_t CacheSize = DEFAULT_CACHE_SIZE);
+	// sum over the submeshes, each is a draw of its own
+	static FVertexCacheStats AnalyzeVertexCache(const MeshData& Mesh, uint32_t CacheSize = DEFAULT_CACHE_SIZE);
+
+private:
+	static bool sm_ImportOptimization;
+};
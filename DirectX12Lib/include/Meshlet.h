@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MathLib.h"
+
+class MeshData;
+class FCamera;
+
+struct FMeshlet
+{
+	uint32_t VertexOffset;		// into FMeshletData::Vertices
+	uint32_t VertexCount;
+	uint32_t PrimitiveOffset;	// into FMeshletData::Primitives, 3 local indices per triangle
+	uint32_t PrimitiveCount;
+
+	Vector3f Center;
+	float Radius;
+
+	// back facing from every point with dot(normalize(ConeApex - Eye), ConeAxis) >= ConeCutoff
+	Vector3f ConeApex;
+	Vector3f ConeAxis;
+	float ConeCutoff;			// 1 when the normals spread too much to ever cull
+};
+
+// meshlets of each submesh in SubMeshes[i].x (first meshlet) and .y (count)
+struct FMeshletData
+{
+	std::vector<FMeshlet> Meshlets;
+	std::vector<uint32_t> Vertices;		// mesh vertex index per meshlet vertex
+	std::vector<uint8_t> Primitives;	// meshlet vertex index per corner
+	std::vector<Vector2i> SubMeshes;
+};
+
+struct FClusterCullStats
+{
+	uint32_t MeshletCount = 0;
+	uint32_t FrustumCulled = 0;
+	uint32_t ConeCulled = 0;
+	uint32_t TriangleCount = 0;
+	uint32_t VisibleTriangles = 0;
+
+	float GetCulledRate() const { return TriangleCount > 0 ? 1.f - (float)VisibleTriangles / TriangleCount : 0.f; }
+};
+
+class FMeshletBuilder
+{
+public:
+	static const uint32_t DEFAULT_MAX_VERTICES = 64;
+	static const uint32_t DEFAULT_MAX_PRIMITIVES = 124;
+
+	// triangles are taken in index order, run the index optimizer first for compact meshlets
+	static void Build(const MeshData& Mesh, FMeshletData& Result, uint32_t MaxVertices = DEFAULT_MAX_VERTICES, uint32_t MaxPrimitives = DEFAULT_MAX_PRIMITIVES);
+
+	// appends the indices of the meshlets that pass the frustum and cone test, the cone test is skipped when
+	// LocalToWorld scales non-uniformly or shears
+	static void Cull(const FMeshletData& Data, const FMatrix& LocalToWorld, const FCamera& Camera, std::vector<uint32_t>& VisibleMeshlets, FClusterCullStats* Stats = nullptr);
+
+private:
+	static void ComputeBounds(const MeshData& Mesh, const FMeshletData& Data, FMeshlet& Meshlet);
+};
@@ -54,7 +54,7 @@ protected:
 	FGpuBuffer m_VertexBuffer[VET_Max];
 	FGpuBuffer m_IndexBuffer;
 
-	std::vector<FTexture> m_Textures;
+	std::shared_ptr<FMaterialTable> m_MaterialTable;
 
 	FBoundingBox m_BoundingBox;
 };
\ No newline at end of file
@@ -3,11 +3,14 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <iosfwd>
 #include "MathLib.h"
+#include "TangentGenerator.h"
 
 
 class MeshData;
 struct MaterialData;
+struct FMemoryUsage;
 
 
 struct ObjVertexIndex
@@ -24,6 +27,37 @@ struct ObjVertexIndex
 			return ni < rhs.ni;
 		return false;
 	}
+
+	bool operator == (const ObjVertexIndex& rhs) const
+	{
+		return vi == rhs.vi && ti == rhs.ti && ni == rhs.ni;
+	}
+};
+
+// flat open addressing (linear probing) map from a vertex index triple to the collected vertex index
+class FObjVertexCache
+{
+public:
+	// Keys[i] is the key of index i, the caller appends Key to it whenever FindOrAdd returns NewIndex
+	explicit FObjVertexCache(const std::vector<ObjVertexIndex>& Keys) : m_Keys(Keys), m_Mask(0), m_Size(0) {}
+
+	// sizes the table for Count keys without rehashing
+	void Reserve(size_t Count);
+	// returns the index cached for Key, or caches and returns NewIndex if Key is not present
+	uint32_t FindOrAdd(const ObjVertexIndex& Key, uint32_t NewIndex);
+	size_t Size() const { return m_Size; }
+
+private:
+	static const uint32_t EmptySlot = 0xffffffff;
+
+	static size_t Hash(const ObjVertexIndex& Key);
+	void Rehash(size_t Capacity);
+
+	// slots only hold indices, a quarter of the memory of storing the keys again
+	const std::vector<ObjVertexIndex>& m_Keys;
+	std::vector<uint32_t> m_Slots;
+	size_t m_Mask;
+	size_t m_Size;
 };
 
 struct ObjFace
@@ -79,39 +113,85 @@ struct ObjGroup
 	std::string MaterialName;
 };
 
+// group/usemtl/mtllib line met while parsing a chunk, replayed in file order on merge
+struct ObjChunkEvent
+{
+	enum EType
+	{
+		Group,
+		UseMaterial,
+		MaterialLib,
+	};
+
+	EType Type;
+	uint32_t FaceIndex;	// number of faces of the chunk parsed before this line
+	std::string Value;
+};
+
+// face index whose relative (negative) components need the element counts of the preceding chunks
+struct ObjIndexFixup
+{
+	uint32_t Slot;
+	uint32_t RelativeMask;	// bit 0: vi, bit 1: ti, bit 2: ni
+};
+
+// records parsed from a line-aligned slice of the file
+struct ObjChunk
+{
+	std::vector<float> Positions;
+	std::vector<float> Texcoords;
+	std::vector<float> Normals;
+	std::vector<ObjVertexIndex> Indices;
+	std::vector<ObjFace> Faces;	// Start is relative to the chunk's Indices
+	std::vector<ObjChunkEvent> Events;
+	std::vector<ObjIndexFixup> Fixups;
+	uint32_t UnhandledLines = 0;
+};
+
 typedef std::map<std::string, ObjMaterial> MaterialLibType;
 
 class FObjLoader
 {
 public:
 	static MeshData* LoadObj(const std::string& FilePath, bool FlipV = false, bool NegateZ = false, bool FlipNormalZ = false);
+	// memory maps the file and parses line-aligned chunks on worker threads, the result is identical to LoadObj
+	static MeshData* LoadObjParallel(const std::string& FilePath, bool FlipV = false, bool NegateZ = false, bool FlipNormalZ = false);
+
+	// TM_MikkTSpace matches normal maps baked by most tools, TM_Accumulate keeps the vertex count
+	static void SetTangentMode(ETangentMode Mode) { sm_TangentMode = Mode; }
+	static ETangentMode GetTangentMode() { return sm_TangentMode; }
+
+	// LoadObj parses straight from the file with exactly reserved buffers, slower but peak memory stays close to the result
+	static void SetLowMemoryMode(bool Enabled) { sm_LowMemoryMode = Enabled; }
+	static bool IsLowMemoryMode() { return sm_LowMemoryMode; }
 	
 private:
+	static ETangentMode sm_TangentMode;
+	static bool sm_LowMemoryMode;
+
+	static void CountElements(std::istream& Input, size_t& PositionCount, size_t& TexcoordCount, size_t& NormalCount, size_t& IndexCount);
+	static void PrintMemoryUsage(const char* Name, const FMemoryUsage& Before);
+
 	static bool LoadMaterialLib(MaterialLibType& MtlLib, const std::string& MtlFilePath);
 
-	static inline uint32_t FixIndex(int idx, uint32_t n);
-	static bool ParseMap(const char* &str, const std::string& base_path, const std::string& map_key, std::string& OutPath);
-	static bool ParseTripleIndex(const char* &str, ObjVertexIndex& index, uint32_t vn, uint32_t tn, uint32_t nn);
-
-	static uint32_t CollectVertex(
-		const ObjVertexIndex& index,
-		std::map<ObjVertexIndex, uint32_t>& VertexCache,
-		std::vector<float>& final_vertices,
-		const std::vector<float>& in_positions,
-		const std::vector<float>& in_texcoords,
-		const std::vector<float>& in_normals,
-		std::vector<Vector3f>& final_positions,
-		std::vector<Vector2f>& final_texcoords,
-		std::vector<Vector3f>& final_normals
+	static uint64_t ComputeCacheKey(const std::string& FilePath, bool FlipV, bool NegateZ, bool FlipNormalZ);
+	static MeshData* LoadFromCache(const std::string& FilePath, uint64_t CacheKey);
+	static void SaveToCache(const std::string& FilePath, uint64_t CacheKey, const MeshData* Mesh);
+
+	static void ParseChunk(const char* Begin, const char* End, ObjChunk& Chunk, bool FlipV, bool NegateZ, bool FlipNormalZ);
+	static MeshData* BuildMeshData(
+		const std::string& FilePath,
+		std::vector<ObjGroup>& Groups,
+		MaterialLibType& MtlLib,
+		std::vector<float>& positions,
+		std::vector<float>& texcoords,
+		std::vector<float>& normals,
+		std::vector<ObjVertexIndex>& all_indices
 	);
 
-	void static CalcTangents(
-		const std::vector<Vector3f>& final_positions,
-		const std::vector<Vector2f>& final_texcoords,
-		const std::vector<Vector3f>& final_normals,
-		const std::vector<uint32_t>& final_indices,
-		std::vector<Vector4f>& final_tangents
-	);
+	static inline uint32_t FixIndex(int idx, uint32_t n);
+	static bool ParseMap(const char* &str, const std::string& base_path, const std::string& map_key, std::string& OutPath);
+	static bool ParseTripleIndex(const char* &str, ObjVertexIndex& index, uint32_t vn, uint32_t tn, uint32_t nn, uint32_t* RelativeMask = nullptr);
 
 	static inline float ParseFloat(const char*& token);
 	static inline void ParseFloat2(const char*& token, float& x, float& y);
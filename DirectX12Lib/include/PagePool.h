@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include "Assertion.h"
+
+// Recycles pages between threads once the GPU is done with them. A page comes back with the fence of the
+// last work that used it and is handed out again when that fence passed. Retired pages wait in one shard
+// per queue, fences of one queue are ordered so every shard is a heap on its fence: one page behind a slow
+// fence never hides the ones after it, on its own queue or another. A thread that finds completed pages
+// takes a few more into a cache of its own, the requests after that need no lock. Knows nothing of the
+// device, the caller says which fences completed and owns the pages.
+template<typename PageType>
+class FPagePool
+{
+public:
+	static const uint32_t THREAD_CACHE_SIZE = 4;
+	static const uint32_t NUM_SHARDS = 4;		// the queue type in the top bits of a fence
+	static const uint32_t MAX_POOLS = 8;
+
+	struct FStats
+	{
+		uint64_t ThreadCacheHits;
+		uint64_t ShardHits;
+		uint64_t Misses;
+	};
+
+	FPagePool()
+		: m_Id(ms_NextId++)
+		, m_Generation(1)
+	{
+		Assert(m_Id < MAX_POOLS);
+		ResetStats();
+	}
+
+	// a page whose fence completed, nullptr when there is none. IsComplete(Fence) asks the fence
+	template<typename FenceFunction>
+	PageType* Request(const FenceFunction& IsComplete)
+	{
+		FThreadCache& Cache = GetThreadCache();
+		if (Cache.Count > 0)
+		{
+			m_ThreadCacheHits.fetch_add(1, std::memory_order_relaxed);
+			return Cache.Pages[--Cache.Count];
+		}
+
+		for (uint32_t s = 0; s < NUM_SHARDS; ++s)
+		{
+			FShard& Shard = m_Shards[s];
+			if (Shard.Size.load(std::memory_order_relaxed) == 0)
+				continue;
+
+			std::lock_guard<std::mutex> Lock(Shard.Mutex);
+			if (Shard.Pages.empty() || !IsComplete(Shard.Pages.top().Fence))
+				continue;
+
+			PageType* Page = Shard.Pages.top().Page;
+			Shard.Pages.pop();
+			// refill the cache while the lock is held anyway
+			while (Cache.Count < THREAD_CACHE_SIZE && !Shard.Pages.empty() && IsComplete(Shard.Pages.top().Fence))
+			{
+				Cache.Pages[Cache.Count++] = Shard.Pages.top().Page;
+				Shard.Pages.pop();
+			}
+			Shard.Size.store((uint32_t)Shard.Pages.size(), std::memory_order_relaxed);
+			m_ShardHits.fetch_add(1, std::memory_order_relaxed);
+			return Page;
+		}
+
+		m_Misses.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	// Fence is signaled after the last use of the pages
+	void Discard(uint64_t Fence, PageType* const* Pages, size_t Count)
+	{
+		FShard& Shard = m_Shards[GetShard(Fence)];
+		std::lock_guard<std::mutex> Lock(Shard.Mutex);
+		for (size_t i = 0; i < Count; ++i)
+		{
+			Shard.Pages.push(FEntry{ Fence, Pages[i] });
+		}
+		Shard.Size.store((uint32_t)Shard.Pages.size(), std::memory_order_relaxed);
+	}
+
+	// forgets every page, the thread caches of all threads included. The owner frees the pages
+	void Reset()
+	{
+		for (uint32_t s = 0; s < NUM_SHARDS; ++s)
+		{
+			std::lock_guard<std::mutex> Lock(m_Shards[s].Mutex);
+			m_Shards[s].Pages = std::priority_queue<FEntry, std::vector<FEntry>, FLaterFence>();
+			m_Shards[s].Size.store(0, std::memory_order_relaxed);
+		}
+		m_Generation.fetch_add(1);
+	}
+
+	FStats GetStats() const
+	{
+		FStats Stats;
+		Stats.ThreadCacheHits = m_ThreadCacheHits.load();
+		Stats.ShardHits = m_ShardHits.load();
+		Stats.Misses = m_Misses.load();
+		return Stats;
+	}
+	void ResetStats()
+	{
+		m_ThreadCacheHits = 0;
+		m_ShardHits = 0;
+		m_Misses = 0;
+	}
+
+private:
+	struct FEntry
+	{
+		uint64_t Fence;
+		PageType* Page;
+	};
+
+	struct FLaterFence
+	{
+		bool operator()(const FEntry& A, const FEntry& B) const { return A.Fence > B.Fence; }
+	};
+
+	struct FShard
+	{
+		std::mutex Mutex;
+		std::priority_queue<FEntry, std::vector<FEntry>, FLaterFence> Pages;
+		std::atomic<uint32_t> Size{ 0 };	// read without the lock to skip empty shards
+	};
+
+	// pages whose fence already passed
+	struct FThreadCache
+	{
+		uint32_t Generation = 0;
+		uint32_t Count = 0;
+		PageType* Pages[THREAD_CACHE_SIZE];
+	};
+
+	static uint32_t GetShard(uint64_t Fence) { return (uint32_t)(Fence >> 56) % NUM_SHARDS; }
+
+	FThreadCache& GetThreadCache()
+	{
+		static thread_local FThreadCache Caches[MAX_POOLS];
+		FThreadCache& Cache = Caches[m_Id];
+		const uint32_t Generation = m_Generation.load(std::memory_order_relaxed);
+		if (Cache.Generation != Generation)
+		{
+			Cache.Generation = Generation;
+			Cache.Count = 0;
+		}
+		return Cache;
+	}
+
+	const uint32_t m_Id;
+	std::atomic<uint32_t> m_Generation;
+	FShard m_Shards[NUM_SHARDS];
+	std::atomic<uint64_t> m_ThreadCacheHits;
+	std::atomic<uint64_t> m_ShardHits;
+	std::atomic<uint64_t> m_Misses;
+
+	static std::atomic<uint32_t> ms_NextId;
+};
+
+template<typename PageType>
+std::atomic<uint32_t> FPagePool<PageType>::ms_NextId(0);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+class FParallel
+{
+public:
+	static uint32_t GetNumWorkers()
+	{
+		uint32_t NumThreads = std::thread::hardware_concurrency();
+		return NumThreads > 0 ? NumThreads : 1;
+	}
+
+	// Calls Function(Index) for every Index in [0, Count), indices are handed out one by one to the workers.
+	// The calling thread works too, so Count == 1 or MaxWorkers == 1 runs inline.
+	template<typename FunctionType>
+	static void For(uint32_t Count, const FunctionType& Function, uint32_t MaxWorkers = 0)
+	{
+		uint32_t NumWorkers = (std::min)(Count, MaxWorkers > 0 ? MaxWorkers : GetNumWorkers());
+		if (NumWorkers <= 1)
+		{
+			for (uint32_t i = 0; i < Count; ++i)
+				Function(i);
+			return;
+		}
+
+		std::atomic<uint32_t> NextIndex(0);
+		auto Worker = [&NextIndex, &Function, Count]()
+		{
+			for (uint32_t i = NextIndex++; i < Count; i = NextIndex++)
+				Function(i);
+		};
+
+		std::vector<std::thread> Threads;
+		Threads.reserve(NumWorkers - 1);
+		for (uint32_t t = 1; t < NumWorkers; ++t)
+			Threads.emplace_back(Worker);
+		Worker();
+		for (size_t t = 0; t < Threads.size(); ++t)
+			Threads[t].join();
+	}
+};
@@ -1,9 +1,9 @@
 ﻿#pragma once
 
-#include <map>
 #include <d3d12.h>
 #include "d3dx12.h"
 #include "Common.h"
+#include "PipelineStateCache.h"
 
 class FRootSignature;
 
@@ -22,7 +22,16 @@ public:
 
 	const FRootSignature& GetRootSignature() const { return *m_RootSignature; }
 	
-	ID3D12PipelineState* GetPipelineStateObject() const { return m_PipelineState; }
+	// Finalize only queues the creation, the first call waits for it
+	ID3D12PipelineState* GetPipelineStateObject() const
+	{
+		if (m_PipelineState == nullptr && m_PipelineFuture.valid())
+		{
+			m_PipelineState = m_PipelineFuture.get();
+		}
+		return m_PipelineState;
+	}
+	bool IsReady() const { return m_PipelineState != nullptr || (m_PipelineFuture.valid() && m_PipelineFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready); }
 
 public:
 	static D3D12_RASTERIZER_DESC RasterizerDefault;
@@ -41,10 +50,8 @@ public:
 protected:
 	const FRootSignature* m_RootSignature;
 	
-	ID3D12PipelineState* m_PipelineState;
-
-	static std::map<size_t, ComPtr<ID3D12PipelineState>> ms_GraphicsPSHashMap;
-	static std::map<size_t, ComPtr<ID3D12PipelineState>> ms_ComputePSHashMap;
+	mutable ID3D12PipelineState* m_PipelineState;
+	FPipelineStateFuture m_PipelineFuture;
 };
 
 
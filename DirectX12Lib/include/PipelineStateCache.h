@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
+#include <d3d12.h>
+#include <dxgi1_4.h>
+#include "Common.h"
+#include "PipelineStateKey.h"
+
+class FRootSignature;
+
+// Pipeline state being created on a worker, get() blocks until it is there and rethrows a failed creation
+typedef std::shared_future<ID3D12PipelineState*> FPipelineStateFuture;
+
+// Every pipeline state of the process by its full description. New ones are loaded from a pipeline library
+// on disk or created on worker threads, the library is written back on Destroy when it grew. The file is
+// named after the adapter and its driver version, a driver update starts a new one.
+class FPipelineStateCache
+{
+public:
+	struct FStats
+	{
+		uint32_t Requests;
+		uint32_t Loaded;		// from the library on disk
+		uint32_t Compiled;
+	};
+
+	static FPipelineStateCache& Get();
+
+	// Adapter names the library file, without it nothing is read or written
+	void Create(ID3D12Device* Device, IDXGIAdapter1* Adapter);
+	void Destroy();
+
+	FPipelineStateFuture GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, const FRootSignature& RootSignature);
+	FPipelineStateFuture GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, const FRootSignature& RootSignature);
+
+	FStats GetStats();
+
+private:
+	FPipelineStateCache();
+
+	struct FEntry
+	{
+		ComPtr<ID3D12PipelineState> PipelineState;
+		FPipelineStateFuture Future;
+	};
+
+	// adds the entry and queues Create for the workers, which fills in Entry->PipelineState. m_Mutex is held
+	FPipelineStateFuture Enqueue(FPipelineStateKey&& Key, std::function<ID3D12PipelineState*(FEntry*, const std::wstring&)>&& Create);
+	ID3D12PipelineState* Store(FEntry* Entry, const std::wstring& Name, ID3D12PipelineState* PipelineState, bool Loaded);
+	void OpenLibrary(IDXGIAdapter1* Adapter);
+	void SaveLibrary();
+	void WorkerLoop();
+
+	ID3D12Device* m_Device;
+	std::mutex m_Mutex;
+	std::unordered_map<FPipelineStateKey, std::unique_ptr<FEntry>, FPipelineStateKey::FHasher> m_Entries;
+	FStats m_Stats;
+
+	// pipeline library, the blob it was created from has to outlive it
+	ComPtr<ID3D12PipelineLibrary> m_Library;
+	std::vector<char> m_LibraryBlob;
+	std::string m_LibraryFile;
+	bool m_LibraryChanged;
+
+	std::vector<std::thread> m_Workers;
+	std::deque<std::function<void()>> m_Jobs;
+	std::condition_variable m_JobReady;
+	bool m_Quit;
+};
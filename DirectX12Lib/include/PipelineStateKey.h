@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <d3d12.h>
+
+// Bytes of a pipeline description with everything behind its pointers inlined: shader code, input layout
+// with its semantic names and the serialized root signature, which the caller passes in. Equal keys make
+// equal pipelines, the hash only picks the bucket and names the pipeline on disk. Needs no device.
+class FPipelineStateKey
+{
+public:
+	FPipelineStateKey() : m_Hash(0) {}
+
+	static FPipelineStateKey Make(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, const std::vector<uint8_t>& RootSignatureBlob);
+	static FPipelineStateKey Make(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, const std::vector<uint8_t>& RootSignatureBlob);
+
+	uint64_t GetHash() const { return m_Hash; }
+	const std::vector<uint8_t>& GetBytes() const { return m_Bytes; }
+	// the name of the pipeline in the library
+	std::wstring GetName() const;
+
+	bool operator==(const FPipelineStateKey& Other) const { return m_Hash == Other.m_Hash && m_Bytes == Other.m_Bytes; }
+
+	struct FHasher
+	{
+		size_t operator()(const FPipelineStateKey& Key) const { return (size_t)Key.m_Hash; }
+	};
+
+private:
+	void Append(const void* Data, size_t Size);
+	void AppendShader(const D3D12_SHADER_BYTECODE& Shader);
+	void AppendRootSignature(const std::vector<uint8_t>& Blob);
+	void Finish();
+
+	std::vector<uint8_t> m_Bytes;
+	uint64_t m_Hash;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <utility>
+
+// Hands out ranges of [0, Size) and takes them back in any order. The free ranges are kept by offset, to
+// merge a freed range with its neighbours, and by size, so a request splits the smallest range that holds
+// it. Knows nothing of what the ranges index and is not thread safe.
+class FRangeAllocator
+{
+public:
+	static const uint32_t INVALID_OFFSET = ~0u;
+
+	struct FStats
+	{
+		uint32_t Size;
+		uint32_t FreeSize;
+		uint32_t NumFreeRanges;
+		uint32_t LargestFreeRange;
+	};
+
+	explicit FRangeAllocator(uint32_t Size = 0);
+
+	// forgets all allocations, everything is free again
+	void Reset(uint32_t Size);
+
+	// offset of Count consecutive elements, INVALID_OFFSET when no free range is large enough
+	uint32_t Allocate(uint32_t Count);
+	// Offset and Count as they came from Allocate
+	void Free(uint32_t Offset, uint32_t Count);
+
+	uint32_t GetSize() const { return m_Size; }
+	uint32_t GetFreeSize() const { return m_FreeSize; }
+	uint32_t GetLargestFreeRange() const { return m_BySize.empty() ? 0 : m_BySize.rbegin()->first; }
+	FStats GetStats() const;
+
+private:
+	void AddFreeRange(uint32_t Offset, uint32_t Count);
+	void RemoveFreeRange(std::map<uint32_t, uint32_t>::iterator Iter);
+
+	uint32_t m_Size;
+	uint32_t m_FreeSize;
+	std::map<uint32_t, uint32_t> m_ByOffset;			// offset -> count
+	std::set<std::pair<uint32_t, uint32_t> > m_BySize;	// count, offset
+};
@@ -19,8 +19,15 @@ public:
 	
 	void Destroy();
 
-	// swap chain & present
+	// waits until the swap chain takes another frame and the GPU released the frame slot, once per Present
+	void BeginFrame();
+	// swap chain & present, ends the frame
 	UINT Present();
+	// 0 presents without waiting for vertical blank
+	void SetSyncInterval(UINT SyncInterval) { m_SyncInterval = SyncInterval; }
+	UINT GetSyncInterval() const { return m_SyncInterval; }
+	// how far the CPU may run ahead of the GPU and the display
+	void SetFramesInFlight(UINT Count);
 	FColorBuffer& GetBackBuffer();
 	D3D12_CPU_DESCRIPTOR_HANDLE GetCurrentBackBufferView();
 	D3D12_CPU_DESCRIPTOR_HANDLE GetDepthStencilHandle();
@@ -34,8 +41,11 @@ private:
 private:
 	//ComPtr<ID3D12Device> m_d3d12Device;
 	
-	static const UINT BUFFER_COUNT = 2;
+	static const UINT BUFFER_COUNT = 3;
 	UINT m_frameIndex = 0;
+	UINT m_SyncInterval = 1;
+	HANDLE m_FrameLatencyWaitable = nullptr;
+	bool m_FrameBegun = false;
 
 	ComPtr<IDXGISwapChain3> m_swapChain;
 	FColorBuffer m_BackBuffers[BUFFER_COUNT];
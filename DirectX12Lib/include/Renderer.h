@@ -1,14 +1,79 @@
 #pragma once
 
 #include "Common.h"
+#include "MathLib.h"
+#include "DrawCommandList.h"
 
 class Scene;
 class MeshNode;
+class MeshData;
+class FCamera;
 class FCommandContext;
+
+struct FSceneCullStats
+{
+	uint32_t MeshCount = 0;
+	uint32_t VisibleMeshes = 0;
+	uint32_t SubMeshCount = 0;
+	uint32_t VisibleSubMeshes = 0;
+	uint64_t TriangleCount = 0;
+	uint64_t VisibleTriangles = 0;
+};
+
+struct FDrawStats
+{
+	uint32_t DrawCount = 0;
+	uint32_t MeshBinds = 0;			// vertex and index buffer changes
+	uint32_t MaterialBinds = 0;		// texture table or bindless index changes
+};
+
+// Draws go through a FDrawCommandList kept across frames, sorted so that buffers and textures are only bound
+// when they change from one draw to the next
 class Renderer
 {
 public:
+	// every submesh in the state order of the draw list
 	void Draw(Scene* pScene, FCommandContext& CommandContext, bool UseDefaultMaterial = true);
+	// draws only the meshes and submeshes whose world bounds touch the view frustum of Camera, sorted by the sort mode
+	void Draw(Scene* pScene, const FCamera& Camera, FCommandContext& CommandContext, bool UseDefaultMaterial = true);
+	void SetSortMode(FDrawCommandList::ESortMode Mode) { m_SortMode = Mode; }
+	// with the default material a material change then only sets the TEX_PER_MATERIAL bindless indices of its
+	// textures as root constants at MaterialRootIndex, INVALID_INDEX for the missing ones, and no views are
+	// copied. The bindless table is bound at TableRootIndex, see BindlessMaterial.hlsl
+	void SetBindlessMaterials(UINT MaterialRootIndex, UINT TableRootIndex);
+	const FDrawStats& GetDrawStats() const { return m_DrawStats; }
+
+	// fills the visible lists, meshes are queried from the scene BVH and only the submeshes of visible meshes
+	// are tested after them, the scene transforms have to be up to date
+	void Cull(Scene* pScene, const FFrustum& Frustum);
+	const FSceneCullStats& GetCullStats() const { return m_CullStats; }
 
 private:
-};
\ No newline at end of file
+	void Submit(FCommandContext& CommandContext, bool UseDefaultMaterial, const uint32_t* Order, uint32_t Count);
+
+	struct FVisibleMesh
+	{
+		uint32_t MeshIndex;
+		uint32_t FirstSubMesh;	// into m_VisibleSubMeshes
+		uint32_t SubMeshCount;
+	};
+
+	FSceneCullStats m_CullStats;
+	std::vector<FVisibleMesh> m_VisibleMeshes;
+	std::vector<uint32_t> m_VisibleSubMeshes;
+
+	FDrawCommandList m_DrawCommands;
+	FDrawCommandList::ESortMode m_SortMode = FDrawCommandList::SORT_STATE;
+	FDrawStats m_DrawStats;
+	bool m_BindlessMaterials = false;
+	UINT m_MaterialRootIndex = 0;
+	UINT m_BindlessTableRootIndex = 0;
+	std::vector<uint32_t> m_VisibleCommands;
+	std::vector<uint32_t> m_DrawOrder;
+
+	// scratch of Cull, kept to avoid allocating every frame
+	FBoundingBoxSoA m_WorldBounds;
+	std::vector<uint32_t> m_Visible;
+	std::vector<uint32_t> m_FirstCandidate;
+	std::vector<uint32_t> m_VisibleCandidates;
+};
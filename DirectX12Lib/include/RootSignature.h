@@ -66,6 +66,13 @@ public:
 		SetTableRange(0, Type, Register, Count);
 	}
 
+	// unbounded SRVs for FCommandContext::SetBindlessTable, the shader declares an unsized array in Space
+	void InitAsBindlessTable(UINT Register, UINT Space, D3D12_SHADER_VISIBILITY Visibility = D3D12_SHADER_VISIBILITY_ALL)
+	{
+		InitAsDescriptorTable(1, Visibility);
+		SetTableRange(0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, Register, UINT_MAX, Space);
+	}
+
 	void InitAsDescriptorTable(UINT RangeCount, D3D12_SHADER_VISIBILITY Visibility = D3D12_SHADER_VISIBILITY_ALL)
 	{
 		m_RootParam.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
@@ -138,6 +145,8 @@ public:
 	uint32_t GetSamplerTableBitMap() const { return m_SamplerTableBitMap; }
 	uint32_t GetDescriptorTableBitMap() const { return m_DescriptorTableBitMap; }
 	uint32_t GetDescriptorTableSize(uint32_t RootIndex) const { return m_DescriptorTableSize[RootIndex]; }
+	// what Finalize created the signature from, the pipeline state cache keys on it
+	const std::vector<uint8_t>& GetSerializedBlob() const { return m_SerializedBlob; }
 
 
 protected:
@@ -152,4 +161,5 @@ protected:
 	std::vector<FRootParameter> m_ParamArray;
 	std::vector< D3D12_STATIC_SAMPLER_DESC> m_StaticSamplerArray;
 	ID3D12RootSignature* m_D3DRootSignature = nullptr;
+	std::vector<uint8_t> m_SerializedBlob;
 };
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "MathLib.h"
 #include "MeshData.h"
+#include "TransformHierarchy.h"
+#include "Bvh.h"
 
 
 class MeshNode;
@@ -12,9 +14,15 @@ class SceneNode
 {
 public:
 	SceneNode();
+	// identity until the scene registered the node and ran UpdateTransforms
 	const FMatrix& GetLocalToWorld() const;
 	void AddChild(SceneNode* Node);
-	void UpdateTransform();
+	// adds the node and its subtree to the store, the parent must already be in it
+	void RegisterTransform(FTransformHierarchy& Hierarchy);
+	void SetScale(const Vector3f& InScale);
+	void SetRotation(const FQuaternion& InRotation);
+	void SetTranslation(const Vector3f& InTranslation);
+	uint32_t GetTransformId() const { return TransformId; }
 	virtual bool IsMeshNode() const;
 	virtual MeshData* GetFirstMeshData();
 	virtual void PostLoad();
@@ -25,13 +33,14 @@ public:
 	SceneNode* Parent;
 	std::vector<SceneNode*> Children;
 
+	// initial local transform, use the setters once the node is registered
 	Vector3f Scale;
 	Vector3f Translation;
 	FQuaternion Rotation;
-	FMatrix LocalToWorld;
 
 private:
-	bool LocalToWorldUpdated;
+	FTransformHierarchy* Hierarchy;
+	uint32_t TransformId;
 };
 
 
@@ -61,7 +70,43 @@ public:
 	uint32_t GetMeshCount() const { return (uint32_t)MeshList.size(); }
 	MeshNode* GetMeshByIndex(uint32_t Index) { return MeshList[Index]; }
 
+	// recomputes the world matrices of the nodes moved since the last call and refits the mesh BVH
+	uint32_t UpdateTransforms(uint32_t MaxWorkers = 0);
+	const FTransformHierarchy& GetTransforms() const { return Transforms; }
+
+	// world bounds of the meshes, indexed like GetMeshByIndex
+	const FBoundingBox& GetMeshWorldBounds(uint32_t Index) const { return MeshBounds[Index]; }
+	const FBvh& GetMeshBvh() const { return MeshBvh; }
+	// append mesh indices in no particular order
+	void QueryMeshes(const FFrustum& Frustum, std::vector<uint32_t>& Result) const { MeshBvh.QueryFrustum(Frustum, Result); }
+	void QueryMeshes(const FBoundingBox& Box, std::vector<uint32_t>& Result) const { MeshBvh.QueryBox(Box, Result); }
+	// mesh whose bounds the ray enters first, for picking, nullptr on a miss
+	MeshNode* RayCast(const Vector3f& Origin, const Vector3f& Direction, float* HitDistance = nullptr) const;
+	// totals over all meshes
+	uint32_t GetSubMeshCount() const { return SubMeshCount; }
+	uint64_t GetTriangleCount() const { return TriangleCount; }
+
+	// changes whenever the mesh list is rebuilt, call MarkChanged after swapping meshes or materials of loaded
+	// nodes so that lists cached against the scene are rebuilt
+	uint32_t GetVersion() const { return Version; }
+	void MarkChanged() { ++Version; }
+
+	// one material table for all meshes of the scene
+	void SetMaterialTable(const std::shared_ptr<FMaterialTable>& Table) { MaterialTable = Table; }
+	const std::shared_ptr<FMaterialTable>& GetMaterialTable() const { return MaterialTable; }
+
 private:
 	std::vector<SceneNode*> Nodes;
 	std::vector<MeshNode*> MeshList;
+	std::shared_ptr<FMaterialTable> MaterialTable;
+	FTransformHierarchy Transforms;
+
+	void UpdateMeshBounds(uint32_t Index);
+
+	std::vector<FBoundingBox> MeshBounds;
+	std::vector<uint32_t> MovedMeshes;
+	FBvh MeshBvh;
+	uint32_t SubMeshCount;
+	uint64_t TriangleCount;
+	uint32_t Version;
 };
\ No newline at end of file
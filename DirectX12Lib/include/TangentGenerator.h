@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MathLib.h"
+
+enum ETangentMode
+{
+	TM_Accumulate,	// sum of the area weighted face tangents, one tangent per vertex
+	TM_MikkTSpace,	// angle weighted like MikkTSpace, vertices shared by mirrored faces are split
+};
+
+// Per vertex tangents for an indexed triangle list, w holds the bitangent sign.
+// The faces are processed on worker threads, the result doesn't depend on the number of threads.
+class FTangentGenerator
+{
+public:
+	// TM_MikkTSpace may append vertices (copies of positions, texcoords and normals) and rewrite the indices that use them
+	static void Generate(
+		ETangentMode Mode,
+		std::vector<Vector3f>& Positions,
+		std::vector<Vector2f>& Texcoords,
+		std::vector<Vector3f>& Normals,
+		std::vector<uint32_t>& Indices,
+		std::vector<Vector4f>& Tangents
+	);
+
+private:
+	static uint32_t GenerateAccumulate(
+		const std::vector<Vector3f>& Positions,
+		const std::vector<Vector2f>& Texcoords,
+		const std::vector<Vector3f>& Normals,
+		const std::vector<uint32_t>& Indices,
+		std::vector<Vector4f>& Tangents
+	);
+	static uint32_t GenerateMikkTSpace(
+		std::vector<Vector3f>& Positions,
+		std::vector<Vector2f>& Texcoords,
+		std::vector<Vector3f>& Normals,
+		std::vector<uint32_t>& Indices,
+		std::vector<Vector4f>& Tangents
+	);
+
+	// Offsets[v]..Offsets[v+1] are the corners (3 * triangle + k) using vertex v, in triangle order
+	static void BuildVertexCorners(const std::vector<uint32_t>& Indices, uint32_t VertexCount, std::vector<uint32_t>& Offsets, std::vector<uint32_t>& Corners);
+	// Gram-Schmidt against the normal and handedness from the bitangent, returns the number of degenerated tangents
+	static uint32_t Orthogonalize(const Vector3f* Normals, const Vector3f* Tan1, const Vector3f* Tan2, Vector4f* Tangents, uint32_t Count);
+};
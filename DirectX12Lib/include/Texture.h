@@ -1,12 +1,16 @@
 ﻿#pragma once
 
 #include "D3D12Resource.h"
+#include "BindlessIndexAllocator.h"
 
 class FTexture : public FD3D12Resource
 {
 public:
-	FTexture() : m_Width(0), m_Height(0) { m_CpuDescriptorHandle.ptr = D3D12_CPU_VIRTUAL_ADDRESS_UNKNOWN; }
-	FTexture(D3D12_CPU_DESCRIPTOR_HANDLE Handle) : m_CpuDescriptorHandle(Handle) {}
+	FTexture() : m_Width(0), m_Height(0), m_NumDescriptors(0), m_BindlessIndex(FBindlessIndexAllocator::INVALID_INDEX) { m_CpuDescriptorHandle.ptr = D3D12_CPU_VIRTUAL_ADDRESS_UNKNOWN; }
+	// the SRV stays with the caller
+	FTexture(D3D12_CPU_DESCRIPTOR_HANDLE Handle) : m_CpuDescriptorHandle(Handle), m_NumDescriptors(0), m_BindlessIndex(FBindlessIndexAllocator::INVALID_INDEX) {}
+	// gives the SRV and the bindless index back, textures shared through FTextureRef are never destroyed explicitly
+	~FTexture();
 
 	void Create(uint32_t Width, uint32_t Height, DXGI_FORMAT Format, const void* InitialData);
 	virtual void LoadFromFile(const std::wstring& FileName, bool IsSRGB = true);
@@ -16,10 +20,22 @@ public:
 	int GetHeight() const { return m_Height; }
 
 	D3D12_CPU_DESCRIPTOR_HANDLE GetSRV() const { return m_CpuDescriptorHandle; }
+	// the SRV in the bindless table, INVALID_INDEX without one or when the table was full
+	uint32_t GetBindlessIndex() const { return m_BindlessIndex; }
+
+	virtual void Destroy() override;
 
 protected:
+	// the SRV descriptors of the texture, kept across reloads while Count stays the same
+	void AllocateDescriptors(uint32_t Count);
+	void FreeDescriptors();
+	// after every new SRV, a reloaded texture gets a new index and the old one retires with the frames using it
+	void RegisterBindless();
+
 	int m_Width, m_Height;
 	D3D12_CPU_DESCRIPTOR_HANDLE m_CpuDescriptorHandle;
+	uint32_t m_NumDescriptors;	// allocated by the texture, 0 when the SRV came from outside
+	uint32_t m_BindlessIndex;
 };
 
 class FTextureArray : public FTexture
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class FTexture;
+
+typedef std::shared_ptr<FTexture> FTextureRef;
+
+// Hands out shared textures keyed by normalized path and color space, every file is decoded and uploaded once.
+// The registry only keeps weak references, a texture is released with its last handle. Decoding runs outside
+// the lock, concurrent requests for a file in flight wait on its future instead of loading it again.
+class FTextureRegistry
+{
+public:
+	static FTextureRef Acquire(const std::string& FilePath, bool IsSRGB);
+
+	// lower case, forward slashes, "." and "dir/.." segments removed
+	static std::string NormalizePath(const std::string& FilePath);
+
+	static uint32_t GetLiveCount();
+	static uint32_t GetRequestCount() { return sm_RequestCount; }
+	static uint32_t GetLoadCount() { return sm_LoadCount; }
+
+private:
+	struct FEntry
+	{
+		std::weak_ptr<FTexture> Texture;
+		std::shared_future<FTextureRef> Pending;	// valid while the first request decodes the file
+	};
+
+	static std::mutex sm_Mutex;
+	static std::unordered_map<std::string, FEntry> sm_Textures;
+	static uint32_t sm_RequestCount;
+	static uint32_t sm_LoadCount;
+};
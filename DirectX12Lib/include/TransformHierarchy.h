@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "MathLib.h"
+
+// Flat transform store of a node hierarchy. Nodes are kept as parallel arrays sorted by depth so that a
+// parent is always finished before its children, and Update walks the levels in order, recomputing only
+// the nodes marked dirty and everything under them. Ids returned by Add stay valid, slots move on resort.
+class FTransformHierarchy
+{
+public:
+	static const uint32_t INVALID_ID = 0xffffffff;
+	// levels smaller than this update on the calling thread
+	static const uint32_t PARALLEL_MIN_NODES = 8192;
+
+	FTransformHierarchy();
+
+	// Parent is an id returned earlier or INVALID_ID for a root
+	uint32_t Add(uint32_t Parent, const Vector3f& Scale, const FQuaternion& Rotation, const Vector3f& Translation);
+	void Clear();
+	uint32_t GetCount() const { return (uint32_t)m_Parents.size(); }
+	uint32_t GetLevelCount() const { return m_LevelStarts.empty() ? 0 : (uint32_t)m_LevelStarts.size() - 1; }
+
+	void SetScale(uint32_t Id, const Vector3f& Scale);
+	void SetRotation(uint32_t Id, const FQuaternion& Rotation);
+	void SetTranslation(uint32_t Id, const Vector3f& Translation);
+	void SetLocal(uint32_t Id, const Vector3f& Scale, const FQuaternion& Rotation, const Vector3f& Translation);
+
+	const Vector3f& GetScale(uint32_t Id) const { return m_Scales[m_IdToSlot[Id]]; }
+	const FQuaternion& GetRotation(uint32_t Id) const { return m_Rotations[m_IdToSlot[Id]]; }
+	const Vector3f& GetTranslation(uint32_t Id) const { return m_Translations[m_IdToSlot[Id]]; }
+	// valid after the Update that follows the last change
+	const FMatrix& GetLocalToWorld(uint32_t Id) const { return m_LocalToWorld[m_IdToSlot[Id]]; }
+
+	// recomputes the dirty subtrees and returns how many nodes were touched
+	uint32_t Update(uint32_t MaxWorkers = 0);
+	// whether the last Update recomputed the node
+	bool WasUpdated(uint32_t Id) const { uint32_t Slot = m_IdToSlot[Id]; return (m_Updated[Slot >> 6] >> (Slot & 63)) & 1; }
+
+private:
+	void MarkDirty(uint32_t Slot);
+	void SortByDepth();
+	uint32_t UpdateRange(uint32_t Begin, uint32_t End);
+
+	bool TestDirty(uint32_t Slot) const { return (m_Dirty[Slot >> 6] >> (Slot & 63)) & 1; }
+	void SetDirty(uint32_t Slot) { m_Dirty[Slot >> 6] |= 1ull << (Slot & 63); }
+
+	// by slot, sorted by depth once m_Sorted is set
+	std::vector<uint32_t> m_Parents;		// parent slot or INVALID_ID
+	std::vector<uint32_t> m_Depths;
+	std::vector<Vector3f> m_Scales;
+	std::vector<FQuaternion> m_Rotations;
+	std::vector<Vector3f> m_Translations;
+	std::vector<FMatrix> m_LocalToWorld;
+	std::vector<uint64_t> m_Dirty;			// a bit per slot
+	std::vector<uint64_t> m_Updated;		// the dirty bits as the last Update left them
+	std::vector<uint32_t> m_SlotToId;
+
+	std::vector<uint32_t> m_IdToSlot;
+	std::vector<uint32_t> m_LevelStarts;	// first slot of every depth and the end
+	uint32_t m_FirstDirtyDepth;				// INVALID_ID when nothing is dirty
+	uint32_t m_LastDirtyDepth;				// deepest node marked since the last Update
+	uint32_t m_UpdatedFirstWord;			// m_Updated is clear before this word
+	bool m_Sorted;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+
+// Space bookkeeping of the staging ring behind FUploadService and of the upload ring of a LinearAllocator.
+// Allocations go front to back and wrap, they belong to the open batch until SubmitBatch closes it with the
+// fence its work signals. A batch keeps its space until Retire sees that fence complete. Batches are retired
+// in submission order, which is exact because they all run on one queue. Knows nothing of the device, the
+// caller owns the memory and the fence.
+class FUploadRing
+{
+public:
+	static const uint64_t INVALID_OFFSET = ~0ull;
+
+	explicit FUploadRing(uint64_t Capacity = 0);
+
+	// forgets all batches, the serials keep counting
+	void Reset(uint64_t Capacity);
+	uint64_t GetCapacity() const { return m_Capacity; }
+	uint64_t GetUsedSize() const { return m_Head - m_Tail; }
+
+	// offset of Size bytes at Alignment, a power of two dividing the capacity. INVALID_OFFSET when they
+	// do not fit in front of the oldest batch still in flight
+	uint64_t Allocate(uint64_t Size, uint64_t Alignment);
+
+	// serial of the batch being filled, the first one is 1
+	uint64_t GetOpenBatch() const { return m_OpenBatch; }
+	bool IsOpenBatchEmpty() const { return !m_OpenBatchUsed; }
+	// for work of the open batch that takes no ring space
+	void MarkOpenBatchUsed() { m_OpenBatchUsed = true; }
+	// closes the open batch, FenceValue has to grow from batch to batch. Returns the closed serial
+	uint64_t SubmitBatch(uint64_t FenceValue);
+
+	// frees the batches whose fence is at most CompletedFence
+	void Retire(uint64_t CompletedFence);
+	// retires the batches in order up to the first whose fence IsComplete does not accept, without waiting
+	template <typename FenceFunction>
+	void RetireCompleted(const FenceFunction& IsComplete)
+	{
+		while (!m_Batches.empty() && IsComplete(m_Batches.front().Fence))
+			Retire(m_Batches.front().Fence);
+	}
+	bool IsBatchRetired(uint64_t Batch) const;
+	// fence of a submitted batch still in flight, 0 for the open batch and retired ones
+	uint64_t GetBatchFence(uint64_t Batch) const;
+	// fence of the oldest batch in flight, 0 when none is
+	uint64_t GetOldestFence() const { return m_Batches.empty() ? 0 : m_Batches.front().Fence; }
+
+private:
+	struct FBatch
+	{
+		uint64_t Serial;
+		uint64_t End;		// ring position after its last allocation
+		uint64_t Fence;
+	};
+
+	// positions count bytes since Reset and never wrap, the offset is the position modulo the capacity
+	uint64_t m_Capacity;
+	uint64_t m_Head;
+	uint64_t m_Tail;
+	uint64_t m_OpenBatch;
+	bool m_OpenBatchUsed;
+	std::deque<FBatch> m_Batches;
+};
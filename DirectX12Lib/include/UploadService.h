@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <d3d12.h>
+#include "Common.h"
+#include "UploadRing.h"
+
+class FCommandContext;
+class FCommandQueue;
+class FD3D12Resource;
+
+// Batch of an upload, 0 for none
+struct FUploadTicket
+{
+	uint64_t Batch;
+
+	FUploadTicket() : Batch(0) {}
+	explicit FUploadTicket(uint64_t InBatch) : Batch(InBatch) {}
+	bool IsValid() const { return Batch != 0; }
+};
+
+// Resource initialization on the copy queue. The data is staged in a persistently mapped ring and the
+// copies of many uploads are recorded into one copy list, which is submitted when a context that waits on
+// it is executed, when the ring is full or by Submit. The graphics queue waits on the GPU and only in
+// the contexts that use the upload, see FCommandContext::WaitForUpload.
+//
+// The copy queue can only write resources in the COMMON or COPY_DEST state and they decay to COMMON when
+// the copies are done, so that is the state the destinations are left in.
+class FUploadService
+{
+public:
+	static const uint64_t DEFAULT_RING_SIZE = 32 * 1024 * 1024;
+
+	FUploadService();
+
+	void Create(ID3D12Device* Device, uint64_t RingSize = DEFAULT_RING_SIZE);
+	void Destroy();
+
+	// whether the copy queue can write Dest as it is
+	static bool CanUpload(const FD3D12Resource& Dest);
+	FUploadTicket UploadBuffer(FD3D12Resource& Dest, const void* Data, size_t NumBytes, size_t DestOffset = 0);
+	FUploadTicket UploadTexture(FD3D12Resource& Dest, UINT FirstSubresource, UINT NumSubresources, const D3D12_SUBRESOURCE_DATA SubData[]);
+
+	// submits the open batch if anything was recorded
+	void Submit();
+	bool IsComplete(FUploadTicket Ticket);
+	// blocks the CPU, for data the CPU reads back or memory it frees
+	void WaitForUpload(FUploadTicket Ticket);
+	// makes Queue wait on the GPU until the batch of Ticket is done, submitting it first when it is open
+	void MakeQueueWait(FCommandQueue& Queue, D3D12_COMMAND_LIST_TYPE Type, FUploadTicket Ticket);
+
+private:
+	// space for Size bytes in the open batch, stalls for the oldest batch when the ring is full. Returns the
+	// CPU address of the space, Buffer and Offset locate it for the copy
+	uint8_t* AllocateStaging(uint64_t Size, uint64_t Alignment, ID3D12Resource** Buffer, uint64_t* Offset);
+	ID3D12Resource* CreateUploadBuffer(uint64_t Size);
+	void SubmitOpenBatch();
+	void RetireCompleted();
+	FCommandContext& GetContext();
+	FUploadTicket FinishUpload(FD3D12Resource& Dest);
+
+	struct FDedicatedBuffer
+	{
+		uint64_t Batch;
+		ComPtr<ID3D12Resource> Buffer;
+	};
+
+	std::mutex m_Mutex;
+	ID3D12Device* m_Device;
+	ComPtr<ID3D12Resource> m_RingBuffer;
+	uint8_t* m_RingCpu;
+	FUploadRing m_Ring;
+	// staging for uploads larger than the ring, released with their batch
+	std::deque<FDedicatedBuffer> m_DedicatedBuffers;
+	FCommandContext* m_Context;
+	// newest fence each queue type was made to wait for
+	uint64_t m_QueueWaitFence[4];
+};
+
+extern FUploadService g_UploadService;
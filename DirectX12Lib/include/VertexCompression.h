@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include "MathLib.h"
+
+// Opt-in compressed vertex streams, see MeshData::SetVertexCompression.
+// Streams without a flag stay fp32.
+enum EVertexCompression : uint32_t
+{
+	VC_None				= 0,
+	VC_Normal			= 1 << 0,	// octahedral, R16G16_SNORM
+	VC_Tangent			= 1 << 1,	// R10G10B10A2_UNORM, xyz biased to [0,1], bitangent sign in alpha
+	VC_TexcoordHalf		= 1 << 2,	// R16G16_FLOAT
+	VC_TexcoordUNorm	= 1 << 3,	// R16G16_UNORM in the uv range of the submesh, wins over VC_TexcoordHalf
+	VC_Position			= 1 << 4,	// R16G16B16A16_UNORM in the bounding box, needs the dequantization transform
+
+	// no shader constants needed beside the decode functions of VertexCompression.hlsl
+	VC_Default			= VC_Normal | VC_Tangent | VC_TexcoordHalf,
+};
+
+// CPU side encoders of the compressed formats, the decoders return what the input assembler and
+// VertexCompression.hlsl compute. Worst case errors measured over dense sweeps:
+//   octahedral normal	0.0075 degrees
+//   10:10:10:2 tangent	0.1 degrees after renormalization, the sign is exact
+//   half texcoord		relative 2^-11, |uv| is clamped to 65504
+//   unorm16			about range / 131070 per component
+class FVertexCompression
+{
+public:
+	static uint32_t EncodeOctNormal(const Vector3f& Normal);
+	static Vector3f DecodeOctNormal(uint32_t Packed);
+
+	static uint32_t EncodeTangent(const Vector4f& Tangent);
+	static Vector4f DecodeTangent(uint32_t Packed);
+
+	static uint16_t FloatToHalf(float Value);
+	static float HalfToFloat(uint16_t Value);
+	static uint32_t EncodeHalf2(const Vector2f& Value);
+	static Vector2f DecodeHalf2(uint32_t Packed);
+
+	// Min and Extent describe the range, an empty extent encodes 0
+	static uint32_t EncodeUNorm16x2(const Vector2f& Value, const Vector2f& Min, const Vector2f& Extent);
+	static Vector2f DecodeUNorm16x2(uint32_t Packed, const Vector2f& Min, const Vector2f& Extent);
+	static uint64_t EncodeUNorm16x3(const Vector3f& Value, const Vector3f& Min, const Vector3f& Extent);
+	static Vector3f DecodeUNorm16x3(uint64_t Packed, const Vector3f& Min, const Vector3f& Extent);
+
+private:
+	static int16_t FloatToSNorm16(float Value);
+	static float SNorm16ToFloat(int16_t Value);
+	static uint32_t FloatToUNorm(float Value, uint32_t MaxValue);
+	static Vector2f OctWrap(const Vector2f& Value);
+};
@@ -4,8 +4,11 @@
 #include "D3D12RHI.h"
 #include "Timer.h"
 #include "ImguiManager.h"
+#include "RenderWindow.h"
+#include "CommandListManager.h"
 #include <iostream>
 
+extern FCommandListManager g_CommandListManager;
 
 bool ApplicationWin32::Initialize(FGame* game)
 {
@@ -51,10 +54,14 @@ void ApplicationWin32::Run(FGame* game)
 			::DispatchMessage(&msg);
 		}
 
+		// before the update, so that input is sampled as late as the pacing allows
+		RenderWindow::Get().BeginFrame();
 		game->OnUpdate();
 		game->OnRender();
 	}while(msg.message != WM_QUIT);
 
+	// frames may still be in flight
+	g_CommandListManager.IdleGPU();
 	game->OnShutdown();
 
 	this->Terminate();
@@ -0,0 +1,42 @@
+#include "BindlessIndexAllocator.h"
+#include "Assertion.h"
+
+FBindlessIndexAllocator::FBindlessIndexAllocator(uint32_t Capacity)
+	: m_PendingCount(0)
+{
+	Reset(Capacity);
+}
+
+void FBindlessIndexAllocator::Reset(uint32_t Capacity)
+{
+	m_Ranges.Reset(Capacity);
+	m_Pending.clear();
+	m_PendingCount = 0;
+}
+
+uint32_t FBindlessIndexAllocator::Allocate(uint32_t Count)
+{
+	return m_Ranges.Allocate(Count);
+}
+
+void FBindlessIndexAllocator::Free(uint32_t Index, uint32_t Count, uint64_t Fence)
+{
+	Assert(Index != INVALID_INDEX && Count > 0);
+	Assert(m_Pending.empty() || Fence >= m_Pending.back().Fence);
+	FPending Pending;
+	Pending.Fence = Fence;
+	Pending.Index = Index;
+	Pending.Count = Count;
+	m_Pending.push_back(Pending);
+	m_PendingCount += Count;
+}
+
+FBindlessIndexAllocator::FStats FBindlessIndexAllocator::GetStats() const
+{
+	FStats Stats;
+	Stats.Capacity = m_Ranges.GetSize();
+	Stats.Allocated = m_Ranges.GetSize() - m_Ranges.GetFreeSize();
+	Stats.Pending = m_PendingCount;
+	Stats.LargestFreeRange = m_Ranges.GetLargestFreeRange();
+	return Stats;
+}
@@ -0,0 +1,138 @@
+#include "BindlessTable.h"
+#include "CommandListManager.h"
+
+extern FCommandListManager g_CommandListManager;
+
+static bool IsFenceComplete(uint64_t FenceValue)
+{
+	return g_CommandListManager.IsFenceComplete(FenceValue);
+}
+
+FBindlessTable& FBindlessTable::Get()
+{
+	// never destroyed, textures of static lifetime free their indices after main returned
+	static FBindlessTable* Table = new FBindlessTable;
+	return *Table;
+}
+
+FBindlessTable::FBindlessTable()
+	: m_Device(nullptr)
+	, m_DescriptorSize(0)
+	, m_FrameSerial(0)
+	, m_CompletedFrameSerial(0)
+{
+	m_CpuStart.ptr = 0;
+	m_GpuStart.ptr = 0;
+}
+
+void FBindlessTable::Create(ID3D12Device* Device, uint32_t Capacity /*= DEFAULT_CAPACITY*/)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	Assert(m_Heap == nullptr);
+
+	D3D12_DESCRIPTOR_HEAP_DESC Desc = {};
+	Desc.NumDescriptors = Capacity;
+	Desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	Desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	Desc.NodeMask = 1;
+	ThrowIfFailed(Device->CreateDescriptorHeap(&Desc, IID_PPV_ARGS(&m_Heap)));
+	m_Heap->SetName(L"BindlessTable");
+
+	m_Device = Device;
+	m_CpuStart = m_Heap->GetCPUDescriptorHandleForHeapStart();
+	m_GpuStart = m_Heap->GetGPUDescriptorHandleForHeapStart();
+	m_DescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	m_Indices.Reset(Capacity);
+}
+
+void FBindlessTable::Destroy()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_Heap = nullptr;
+	m_Device = nullptr;
+	m_Indices.Reset(0);
+	m_FreedThisFrame.clear();
+	m_RetiredFrames.clear();
+	m_CompletedFrameSerial = m_FrameSerial;
+}
+
+uint32_t FBindlessTable::Register(D3D12_CPU_DESCRIPTOR_HANDLE Views, uint32_t Count /*= 1*/)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	Assert(m_Heap != nullptr);
+
+	ReclaimLocked();
+	uint32_t Index = m_Indices.Allocate(Count);
+	// full, wait for the frames that freed indices one after the other
+	while (Index == FBindlessIndexAllocator::INVALID_INDEX && !m_RetiredFrames.empty())
+	{
+		g_CommandListManager.WaitForFence(m_RetiredFrames.front().GraphicsFence);
+		g_CommandListManager.WaitForFence(m_RetiredFrames.front().ComputeFence);
+		ReclaimLocked();
+		Index = m_Indices.Allocate(Count);
+	}
+	if (Index == FBindlessIndexAllocator::INVALID_INDEX)
+		return Index;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE Dest;
+	Dest.ptr = m_CpuStart.ptr + (SIZE_T)Index * m_DescriptorSize;
+	m_Device->CopyDescriptorsSimple(Count, Dest, Views, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	return Index;
+}
+
+void FBindlessTable::Update(uint32_t Index, D3D12_CPU_DESCRIPTOR_HANDLE Views, uint32_t Count /*= 1*/)
+{
+	Assert(m_Heap != nullptr);
+	D3D12_CPU_DESCRIPTOR_HANDLE Dest;
+	Dest.ptr = m_CpuStart.ptr + (SIZE_T)Index * m_DescriptorSize;
+	m_Device->CopyDescriptorsSimple(Count, Dest, Views, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+void FBindlessTable::Free(uint32_t Index, uint32_t Count /*= 1*/)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_Heap == nullptr)
+		return;
+
+	m_FreedThisFrame.push_back(std::make_pair(Index, Count));
+}
+
+void FBindlessTable::EndFrame(uint64_t GraphicsFence, uint64_t ComputeFence)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_FreedThisFrame.empty())
+		return;
+
+	FRetiredFrame Frame = { ++m_FrameSerial, GraphicsFence, ComputeFence };
+	m_RetiredFrames.push_back(Frame);
+	for (const auto& Freed : m_FreedThisFrame)
+	{
+		m_Indices.Free(Freed.first, Freed.second, Frame.Serial);
+	}
+	m_FreedThisFrame.clear();
+}
+
+void FBindlessTable::ReclaimLocked()
+{
+	while (!m_RetiredFrames.empty() && IsFenceComplete(m_RetiredFrames.front().GraphicsFence)
+		&& IsFenceComplete(m_RetiredFrames.front().ComputeFence))
+	{
+		m_CompletedFrameSerial = m_RetiredFrames.front().Serial;
+		m_RetiredFrames.pop_front();
+	}
+	const uint64_t Completed = m_CompletedFrameSerial;
+	m_Indices.Reclaim([Completed](uint64_t Serial) { return Serial <= Completed; });
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE FBindlessTable::GetGpuHandle(uint32_t Index /*= 0*/) const
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE Handle;
+	Handle.ptr = m_GpuStart.ptr + (UINT64)Index * m_DescriptorSize;
+	return Handle;
+}
+
+FBindlessIndexAllocator::FStats FBindlessTable::GetStats()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	return m_Indices.GetStats();
+}
@@ -0,0 +1,445 @@
+#include "Bvh.h"
+#include "Assertion.h"
+
+#include <algorithm>
+
+namespace
+{
+	float HalfArea(const FBoundingBox& Box)
+	{
+		Vector3f Extent = Box.BoundMax - Box.BoundMin;
+		return Extent.x * Extent.y + Extent.y * Extent.z + Extent.z * Extent.x;
+	}
+
+	bool SameBox(const FBoundingBox& A, const FBoundingBox& B)
+	{
+		return A.BoundMin.x == B.BoundMin.x && A.BoundMin.y == B.BoundMin.y && A.BoundMin.z == B.BoundMin.z
+			&& A.BoundMax.x == B.BoundMax.x && A.BoundMax.y == B.BoundMax.y && A.BoundMax.z == B.BoundMax.z;
+	}
+
+	bool Overlaps(const FBoundingBox& A, const FBoundingBox& B)
+	{
+		return A.BoundMin.x <= B.BoundMax.x && A.BoundMax.x >= B.BoundMin.x
+			&& A.BoundMin.y <= B.BoundMax.y && A.BoundMax.y >= B.BoundMin.y
+			&& A.BoundMin.z <= B.BoundMax.z && A.BoundMax.z >= B.BoundMin.z;
+	}
+
+	// false when the box is behind one of the planes in Mask, the planes the box is fully in front of leave Mask
+	bool TestPlanes(const FFrustum& Frustum, const FBoundingBox& Box, uint32_t& Mask)
+	{
+		for (int i = 0; i < FFrustum::PlaneCount; ++i)
+		{
+			if (!(Mask & (1 << i)))
+				continue;
+			const Vector4f& Plane = Frustum.Planes[i];
+			Vector3f Far(
+				Plane.x >= 0.f ? Box.BoundMax.x : Box.BoundMin.x,
+				Plane.y >= 0.f ? Box.BoundMax.y : Box.BoundMin.y,
+				Plane.z >= 0.f ? Box.BoundMax.z : Box.BoundMin.z);
+			if (Vector3f(Plane).Dot(Far) + Plane.w < 0.f)
+				return false;
+			Vector3f Near(
+				Plane.x >= 0.f ? Box.BoundMin.x : Box.BoundMax.x,
+				Plane.y >= 0.f ? Box.BoundMin.y : Box.BoundMax.y,
+				Plane.z >= 0.f ? Box.BoundMin.z : Box.BoundMax.z);
+			if (Vector3f(Plane).Dot(Near) + Plane.w >= 0.f)
+				Mask &= ~(1u << i);
+		}
+		return true;
+	}
+
+	// slab test, a NaN from a ray lying in a slab plane leaves the interval as it is
+	bool IntersectRay(const FBoundingBox& Box, const Vector3f& Origin, const Vector3f& InvDirection, float MaxDistance, float& Enter)
+	{
+		float Near = 0.f, Far = MaxDistance;
+		for (int a = 0; a < 3; ++a)
+		{
+			float t0 = (Box.BoundMin[a] - Origin[a]) * InvDirection[a];
+			float t1 = (Box.BoundMax[a] - Origin[a]) * InvDirection[a];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			Near = t0 > Near ? t0 : Near;
+			Far = t1 < Far ? t1 : Far;
+			if (Near > Far)
+				return false;
+		}
+		Enter = Near;
+		return true;
+	}
+
+	Vector3f Reciprocal(const Vector3f& v)
+	{
+		return Vector3f(1.f / v.x, 1.f / v.y, 1.f / v.z);
+	}
+}
+
+void FBvh::Clear()
+{
+	m_Nodes.clear();
+	m_PrimIndices.clear();
+	m_PrimBounds.clear();
+	m_PrimLeaves.clear();
+}
+
+void FBvh::Build(const FBoundingBox* Bounds, uint32_t Count)
+{
+	Clear();
+	if (Count == 0)
+		return;
+
+	std::vector<Vector3f> Centroids(Count);
+	m_PrimIndices.resize(Count);
+	FNode Root = { FBoundingBox(), 0, Count, 0, INVALID_INDEX };
+	for (uint32_t i = 0; i < Count; ++i)
+	{
+		Centroids[i] = Bounds[i].GetCenter();
+		m_PrimIndices[i] = i;
+		Root.Bounds.Include(Bounds[i]);
+	}
+
+	// a binary tree with leaves of at least one box has at most 2 * Count - 1 nodes
+	m_Nodes.reserve(2 * Count);
+	m_Nodes.push_back(Root);
+	std::vector<uint32_t> Stack(1, 0);
+	while (!Stack.empty())
+	{
+		uint32_t NodeIndex = Stack.back();
+		Stack.pop_back();
+		Split(NodeIndex, Centroids, Bounds);
+		if (m_Nodes[NodeIndex].Left != 0)
+		{
+			Stack.push_back(m_Nodes[NodeIndex].Left + 1);
+			Stack.push_back(m_Nodes[NodeIndex].Left);
+		}
+	}
+
+	// leaf order copies of the boxes keep the leaf tests on contiguous memory
+	m_PrimBounds.resize(Count);
+	m_PrimLeaves.resize(Count);
+	for (uint32_t n = 0; n < (uint32_t)m_Nodes.size(); ++n)
+	{
+		const FNode& Node = m_Nodes[n];
+		if (Node.Left != 0)
+			continue;
+		for (uint32_t k = Node.First; k < Node.First + Node.Count; ++k)
+		{
+			m_PrimBounds[k] = Bounds[m_PrimIndices[k]];
+			m_PrimLeaves[m_PrimIndices[k]] = n;
+		}
+	}
+}
+
+void FBvh::Split(uint32_t NodeIndex, const std::vector<Vector3f>& Centroids, const FBoundingBox* Bounds)
+{
+	const uint32_t First = m_Nodes[NodeIndex].First;
+	const uint32_t Count = m_Nodes[NodeIndex].Count;
+	if (Count <= MAX_LEAF_SIZE)
+		return;
+
+	FBoundingBox CentroidBounds;
+	for (uint32_t k = First; k < First + Count; ++k)
+	{
+		const Vector3f& Centroid = Centroids[m_PrimIndices[k]];
+		CentroidBounds.Include(FBoundingBox(Centroid, Centroid));
+	}
+	Vector3f Extent = CentroidBounds.BoundMax - CentroidBounds.BoundMin;
+	int Axis = Extent.x >= Extent.y && Extent.x >= Extent.z ? 0 : (Extent.y >= Extent.z ? 1 : 2);
+
+	uint32_t* Begin = m_PrimIndices.data() + First;
+	uint32_t* End = Begin + Count;
+	uint32_t* Mid = Begin + Count / 2;
+	FBoundingBox ChildBounds[2];
+	bool HasChildBounds = false;
+	if (Extent[Axis] > 0.f)
+	{
+		const float AxisMin = CentroidBounds.BoundMin[Axis];
+		const float Scale = BIN_COUNT / Extent[Axis];
+		auto GetBin = [&](uint32_t Prim)
+		{
+			uint32_t Bin = (uint32_t)((Centroids[Prim][Axis] - AxisMin) * Scale);
+			return Bin < BIN_COUNT ? Bin : BIN_COUNT - 1;
+		};
+
+		uint32_t BinCounts[BIN_COUNT] = {};
+		FBoundingBox BinBounds[BIN_COUNT];
+		for (uint32_t* p = Begin; p < End; ++p)
+		{
+			uint32_t Bin = GetBin(*p);
+			BinCounts[Bin]++;
+			BinBounds[Bin].Include(Bounds[*p]);
+		}
+
+		// SAH cost of splitting after each bin, swept from both ends
+		float RightCost[BIN_COUNT] = {};
+		FBoundingBox Accumulated;
+		uint32_t AccumulatedCount = 0;
+		for (uint32_t b = BIN_COUNT - 1; b > 0; --b)
+		{
+			Accumulated.Include(BinBounds[b]);
+			AccumulatedCount += BinCounts[b];
+			RightCost[b] = AccumulatedCount > 0 ? HalfArea(Accumulated) * AccumulatedCount : -1.f;
+		}
+
+		float BestCost = (std::numeric_limits<float>::max)();
+		uint32_t BestBin = BIN_COUNT;
+		Accumulated = FBoundingBox();
+		AccumulatedCount = 0;
+		for (uint32_t b = 0; b + 1 < BIN_COUNT; ++b)
+		{
+			Accumulated.Include(BinBounds[b]);
+			AccumulatedCount += BinCounts[b];
+			if (AccumulatedCount == 0 || RightCost[b + 1] < 0.f)
+				continue;
+			float Cost = HalfArea(Accumulated) * AccumulatedCount + RightCost[b + 1];
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestBin = b;
+			}
+		}
+
+		if (BestBin < BIN_COUNT)
+		{
+			Mid = std::partition(Begin, End, [&](uint32_t Prim) { return GetBin(Prim) <= BestBin; });
+			for (uint32_t b = 0; b < BIN_COUNT; ++b)
+				ChildBounds[b <= BestBin ? 0 : 1].Include(BinBounds[b]);
+			HasChildBounds = true;
+		}
+	}
+	else
+	{
+		// every centroid in one point, any split is as good
+		Mid = Begin + Count / 2;
+	}
+	const uint32_t LeftCount = (uint32_t)(Mid - Begin);
+	FNode Children[2] = {
+		{ ChildBounds[0], First, LeftCount, 0, NodeIndex },
+		{ ChildBounds[1], First + LeftCount, Count - LeftCount, 0, NodeIndex } };
+	if (!HasChildBounds)
+	{
+		for (int c = 0; c < 2; ++c)
+		{
+			for (uint32_t k = Children[c].First; k < Children[c].First + Children[c].Count; ++k)
+				Children[c].Bounds.Include(Bounds[m_PrimIndices[k]]);
+		}
+	}
+	m_Nodes[NodeIndex].Left = (uint32_t)m_Nodes.size();
+	m_Nodes.push_back(Children[0]);
+	m_Nodes.push_back(Children[1]);
+}
+
+void FBvh::RefitLeaf(FNode& Node, const FBoundingBox* Bounds)
+{
+	Node.Bounds = FBoundingBox();
+	for (uint32_t k = Node.First; k < Node.First + Node.Count; ++k)
+	{
+		m_PrimBounds[k] = Bounds[m_PrimIndices[k]];
+		Node.Bounds.Include(m_PrimBounds[k]);
+	}
+}
+
+void FBvh::Refit(const FBoundingBox* Bounds)
+{
+	// children are always stored after their parent
+	for (size_t n = m_Nodes.size(); n-- > 0;)
+	{
+		FNode& Node = m_Nodes[n];
+		if (Node.Left == 0)
+		{
+			RefitLeaf(Node, Bounds);
+		}
+		else
+		{
+			Node.Bounds = m_Nodes[Node.Left].Bounds;
+			Node.Bounds.Include(m_Nodes[Node.Left + 1].Bounds);
+		}
+	}
+}
+
+void FBvh::Refit(const FBoundingBox* Bounds, const uint32_t* Changed, uint32_t ChangedCount)
+{
+	for (uint32_t c = 0; c < ChangedCount; ++c)
+	{
+		Assert(Changed[c] < m_PrimLeaves.size());
+		uint32_t NodeIndex = m_PrimLeaves[Changed[c]];
+		FBoundingBox Old = m_Nodes[NodeIndex].Bounds;
+		RefitLeaf(m_Nodes[NodeIndex], Bounds);
+
+		// climb while the bounds keep changing
+		while (!SameBox(Old, m_Nodes[NodeIndex].Bounds) && m_Nodes[NodeIndex].Parent != INVALID_INDEX)
+		{
+			NodeIndex = m_Nodes[NodeIndex].Parent;
+			FNode& Node = m_Nodes[NodeIndex];
+			Old = Node.Bounds;
+			Node.Bounds = m_Nodes[Node.Left].Bounds;
+			Node.Bounds.Include(m_Nodes[Node.Left + 1].Bounds);
+		}
+	}
+}
+
+void FBvh::AppendSubtree(const FNode& Node, std::vector<uint32_t>& Result) const
+{
+	Result.insert(Result.end(), m_PrimIndices.begin() + Node.First, m_PrimIndices.begin() + Node.First + Node.Count);
+}
+
+void FBvh::QueryFrustum(const FFrustum& Frustum, std::vector<uint32_t>& Result) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	// planes a node is fully in front of are not tested again below it
+	struct FEntry { uint32_t Node; uint32_t Mask; };
+	std::vector<FEntry> Stack;
+	Stack.reserve(64);
+	Stack.push_back({ 0, (1u << FFrustum::PlaneCount) - 1 });
+	while (!Stack.empty())
+	{
+		FEntry Entry = Stack.back();
+		Stack.pop_back();
+		const FNode& Node = m_Nodes[Entry.Node];
+		if (!TestPlanes(Frustum, Node.Bounds, Entry.Mask))
+			continue;
+
+		if (Entry.Mask == 0)
+		{
+			AppendSubtree(Node, Result);
+		}
+		else if (Node.Left == 0)
+		{
+			for (uint32_t k = Node.First; k < Node.First + Node.Count; ++k)
+			{
+				uint32_t Mask = Entry.Mask;
+				if (TestPlanes(Frustum, m_PrimBounds[k], Mask))
+					Result.push_back(m_PrimIndices[k]);
+			}
+		}
+		else
+		{
+			Stack.push_back({ Node.Left + 1, Entry.Mask });
+			Stack.push_back({ Node.Left, Entry.Mask });
+		}
+	}
+}
+
+void FBvh::QueryBox(const FBoundingBox& Box, std::vector<uint32_t>& Result) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	std::vector<uint32_t> Stack;
+	Stack.reserve(64);
+	Stack.push_back(0);
+	while (!Stack.empty())
+	{
+		const FNode& Node = m_Nodes[Stack.back()];
+		Stack.pop_back();
+		if (!Overlaps(Node.Bounds, Box))
+			continue;
+
+		if (Node.Left == 0)
+		{
+			for (uint32_t k = Node.First; k < Node.First + Node.Count; ++k)
+			{
+				if (Overlaps(m_PrimBounds[k], Box))
+					Result.push_back(m_PrimIndices[k]);
+			}
+		}
+		else
+		{
+			Stack.push_back(Node.Left + 1);
+			Stack.push_back(Node.Left);
+		}
+	}
+}
+
+void FBvh::QueryRay(const Vector3f& Origin, const Vector3f& Direction, float MaxDistance, std::vector<uint32_t>& Result) const
+{
+	if (m_Nodes.empty())
+		return;
+
+	const Vector3f InvDirection = Reciprocal(Direction);
+	std::vector<uint32_t> Stack;
+	Stack.reserve(64);
+	Stack.push_back(0);
+	while (!Stack.empty())
+	{
+		const FNode& Node = m_Nodes[Stack.back()];
+		Stack.pop_back();
+		float Enter;
+		if (!IntersectRay(Node.Bounds, Origin, InvDirection, MaxDistance, Enter))
+			continue;
+
+		if (Node.Left == 0)
+		{
+			for (uint32_t k = Node.First; k < Node.First + Node.Count; ++k)
+			{
+				if (IntersectRay(m_PrimBounds[k], Origin, InvDirection, MaxDistance, Enter))
+					Result.push_back(m_PrimIndices[k]);
+			}
+		}
+		else
+		{
+			Stack.push_back(Node.Left + 1);
+			Stack.push_back(Node.Left);
+		}
+	}
+}
+
+uint32_t FBvh::RayCast(const Vector3f& Origin, const Vector3f& Direction, float MaxDistance, float* HitDistance) const
+{
+	uint32_t Hit = INVALID_INDEX;
+	const Vector3f InvDirection = Reciprocal(Direction);
+	float Enter;
+	if (m_Nodes.empty() || !IntersectRay(m_Nodes[0].Bounds, Origin, InvDirection, MaxDistance, Enter))
+		return Hit;
+
+	// nearer child first, nodes entered beyond the best hit so far are skipped
+	struct FEntry { uint32_t Node; float Enter; };
+	std::vector<FEntry> Stack;
+	Stack.reserve(64);
+	Stack.push_back({ 0, Enter });
+	float Best = MaxDistance;
+	while (!Stack.empty())
+	{
+		FEntry Entry = Stack.back();
+		Stack.pop_back();
+		if (Entry.Enter > Best)
+			continue;
+
+		const FNode& Node = m_Nodes[Entry.Node];
+		if (Node.Left == 0)
+		{
+			for (uint32_t k = Node.First; k < Node.First + Node.Count; ++k)
+			{
+				if (IntersectRay(m_PrimBounds[k], Origin, InvDirection, Best, Enter) && (Hit == INVALID_INDEX || Enter < Best))
+				{
+					Best = Enter;
+					Hit = m_PrimIndices[k];
+				}
+			}
+			continue;
+		}
+
+		float EnterLeft, EnterRight;
+		bool HitLeft = IntersectRay(m_Nodes[Node.Left].Bounds, Origin, InvDirection, Best, EnterLeft);
+		bool HitRight = IntersectRay(m_Nodes[Node.Left + 1].Bounds, Origin, InvDirection, Best, EnterRight);
+		if (HitLeft && HitRight)
+		{
+			bool LeftFirst = EnterLeft <= EnterRight;
+			Stack.push_back(LeftFirst ? FEntry{ Node.Left + 1, EnterRight } : FEntry{ Node.Left, EnterLeft });
+			Stack.push_back(LeftFirst ? FEntry{ Node.Left, EnterLeft } : FEntry{ Node.Left + 1, EnterRight });
+		}
+		else if (HitLeft)
+		{
+			Stack.push_back({ Node.Left, EnterLeft });
+		}
+		else if (HitRight)
+		{
+			Stack.push_back({ Node.Left + 1, EnterRight });
+		}
+	}
+
+	if (Hit != INVALID_INDEX && HitDistance)
+		*HitDistance = Best;
+	return Hit;
+}
@@ -88,8 +88,16 @@ void FColorBuffer::CreateDerivedViews(ID3D12Device* Device, DXGI_FORMAT Format,
 	UAVDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
 	UAVDesc.Texture2D.MipSlice = 0;
 	Device->CreateUnorderedAccessView(m_Resource.Get(), nullptr, &UAVDesc, m_UAVHandle);
+	if (m_NumMipDescriptors > 0)
+	{
+		// recreated at another size, the mip count may differ
+		D3D12RHI::Get().FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_SRVHandleMips, m_NumMipDescriptors);
+		D3D12RHI::Get().FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_UAVHandleMips, m_NumMipDescriptors);
+		m_NumMipDescriptors = 0;
+	}
 	if (NumMips > 1)
 	{
+		m_NumMipDescriptors = NumMips;
 		m_SRVHandleMips = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, NumMips);
 		m_UAVHandleMips = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, NumMips);
 
@@ -8,14 +8,20 @@
 #include "CubeBuffer.h"
 #include "PipelineState.h"
 #include "MathLib.h"
+#include "BindlessTable.h"
 
 #include "d3dx12.h"
 
 extern FContextManager g_ContextManager;
 extern FCommandListManager g_CommandListManager;
 
+FGraphicsStateCache::FStats FCommandContext::ms_FrameStateStats;
+FGraphicsStateCache::FStats FCommandContext::ms_LastFrameStateStats;
+std::atomic<uint64_t> FCommandContext::ms_InitializeBatch(0);
+
 FCommandContext* FContextManager::AllocateContext(D3D12_COMMAND_LIST_TYPE Type)
 {
+	std::lock_guard<std::mutex> Lock(m_ContextAllocationMutex);
 	FCommandContext* Result = nullptr;
 
 	std::queue<FCommandContext*>& AvailableContexts = m_AvailableContexts[Type];
@@ -39,11 +45,13 @@ FCommandContext* FContextManager::AllocateContext(D3D12_COMMAND_LIST_TYPE Type)
 void FContextManager::FreeContext(FCommandContext* CommandContext)
 {
 	Assert(CommandContext != nullptr);
+	std::lock_guard<std::mutex> Lock(m_ContextAllocationMutex);
 	m_AvailableContexts[CommandContext->m_Type].push(CommandContext);
 }
 
 void FContextManager::DestroyAllContexts()
 {
+	std::lock_guard<std::mutex> Lock(m_ContextAllocationMutex);
 	for (uint32_t i = 0; i < 4; ++i)
 	{
 		m_ContextPool[i].clear();
@@ -56,6 +64,12 @@ void FCommandContext::DestroyAllContexts()
 	g_ContextManager.DestroyAllContexts();
 }
 
+void FCommandContext::EndFrame()
+{
+	ms_LastFrameStateStats = ms_FrameStateStats;
+	ms_FrameStateStats.Reset();
+}
+
 FCommandContext& FCommandContext::Begin(D3D12_COMMAND_LIST_TYPE Type, const std::wstring& ID /*= L""*/)
 {
 	FCommandContext* NewContext = g_ContextManager.AllocateContext(Type);
@@ -63,8 +77,13 @@ FCommandContext& FCommandContext::Begin(D3D12_COMMAND_LIST_TYPE Type, const std:
 	return *NewContext;
 }
 
-void FCommandContext::InitializeBuffer(FD3D12Resource& Dest, const void* Data, uint32_t NumBytes, size_t Offset /*= 0*/)
+FUploadTicket FCommandContext::InitializeBuffer(FD3D12Resource& Dest, const void* Data, uint32_t NumBytes, size_t Offset /*= 0*/)
 {
+	if (FUploadService::CanUpload(Dest))
+	{
+		return RecordInitializeUpload(g_UploadService.UploadBuffer(Dest, Data, NumBytes, Offset));
+	}
+
 	FCommandContext& CommandContext = FCommandContext::Begin(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
 	FAllocation Allocation = CommandContext.ReserveUploadMemory(NumBytes);
@@ -75,10 +94,16 @@ void FCommandContext::InitializeBuffer(FD3D12Resource& Dest, const void* Data, u
 	CommandContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
 
 	CommandContext.Finish(true);
+	return FUploadTicket();
 }
 
-void FCommandContext::InitializeTexture(FD3D12Resource& Dest, UINT NumSubResources, D3D12_SUBRESOURCE_DATA SubData[])
+FUploadTicket FCommandContext::InitializeTexture(FD3D12Resource& Dest, UINT NumSubResources, D3D12_SUBRESOURCE_DATA SubData[])
 {
+	if (FUploadService::CanUpload(Dest))
+	{
+		return RecordInitializeUpload(g_UploadService.UploadTexture(Dest, 0, NumSubResources, SubData));
+	}
+
 	size_t UploadBufferSize = (size_t)GetRequiredIntermediateSize(Dest.GetResource(), 0, NumSubResources);
 
 	FCommandContext& CommandContext = FCommandContext::Begin(D3D12_COMMAND_LIST_TYPE_DIRECT);
@@ -86,6 +111,22 @@ void FCommandContext::InitializeTexture(FD3D12Resource& Dest, UINT NumSubResourc
 	UpdateSubresources(CommandContext.m_CommandList, Dest.GetResource(), Allocation.D3d12Resource, 0, 0, NumSubResources, SubData);
 	CommandContext.TransitionResource(Dest,D3D12_RESOURCE_STATE_GENERIC_READ);
 	CommandContext.Finish(true);
+	return FUploadTicket();
+}
+
+FUploadTicket FCommandContext::RecordInitializeUpload(FUploadTicket Ticket)
+{
+	// uploads come from several threads, the newest batch wins
+	uint64_t Newest = ms_InitializeBatch.load();
+	while (Newest < Ticket.Batch && !ms_InitializeBatch.compare_exchange_weak(Newest, Ticket.Batch))
+	{
+	}
+	return Ticket;
+}
+
+FUploadTicket FCommandContext::GetInitializeTicket()
+{
+	return FUploadTicket(ms_InitializeBatch.load());
 }
 
 FCommandContext::~FCommandContext()
@@ -110,7 +151,7 @@ void FCommandContext::SetID(const std::wstring& ID)
 
 FCommandContext::FCommandContext(D3D12_COMMAND_LIST_TYPE Type)
 	: m_Type(Type)
-	, m_CpuLinearAllocator(ELinearAllocatorType::CpuWritable)
+	, m_CpuLinearAllocator(ELinearAllocatorType::CpuWritable, CpuAllocatorRingSize)
 	, m_GpuLinearAllocator(ELinearAllocatorType::GpuExclusive)
 	, m_DynamicSamplerDescriptorHeap(*this, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
 	, m_DynamicViewDescriptorHeap(*this, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
@@ -119,10 +160,9 @@ FCommandContext::FCommandContext(D3D12_COMMAND_LIST_TYPE Type)
 	m_CommandList = nullptr;
 	m_CurrentAllocator = nullptr;
 	
-	m_CurGraphicsRootSignature = nullptr;
-	m_CurPipelineState = nullptr;
 	m_CurComputeRootSignature = nullptr;
 	m_NumBarriersToFlush = 0;
+	m_UploadWaitBatch = 0;
 }
 
 void FCommandContext::Reset(void)
@@ -131,10 +171,10 @@ void FCommandContext::Reset(void)
 	m_CurrentAllocator = g_CommandListManager.GetQueue(m_Type).RequestAllocator();
 	m_CommandList->Reset(m_CurrentAllocator, nullptr);
 
-	m_CurGraphicsRootSignature = nullptr;
-	m_CurPipelineState = nullptr;
+	m_StateCache.Invalidate();
 	m_CurComputeRootSignature = nullptr;
 	m_NumBarriersToFlush = 0;
+	m_UploadWaitBatch = 0;
 
 	BindDescriptorHeaps();
 }
@@ -145,25 +185,35 @@ uint64_t FCommandContext::Flush(bool WaitForCompletion /*= false*/)
 	
 	Assert(m_CurrentAllocator != nullptr);
 
-	uint64_t FenceValue = g_CommandListManager.GetQueue(m_Type).ExecuteCommandList(m_CommandList);
+	FCommandQueue& Queue = g_CommandListManager.GetQueue(m_Type);
+	WaitForUploads(Queue);
+
+	uint64_t FenceValue = Queue.ExecuteCommandList(m_CommandList);
 	if (WaitForCompletion)
 	{
 		g_CommandListManager.WaitForFence(FenceValue);
 	}
 
 	m_CommandList->Reset(m_CurrentAllocator, nullptr);
-	if (m_CurGraphicsRootSignature)
+
+	// the reset list has no state left, the signatures and the pipeline carry over
+	ID3D12RootSignature* GraphicsRootSignature = m_StateCache.GetRootSignature();
+	ID3D12PipelineState* PipelineState = m_StateCache.GetPipelineState();
+	m_StateCache.Invalidate();
+	if (GraphicsRootSignature)
 	{
-		m_CommandList->SetGraphicsRootSignature(m_CurGraphicsRootSignature);
+		m_StateCache.SetRootSignature(m_CommandList, GraphicsRootSignature);
 	}
 	if (m_CurComputeRootSignature)
 	{
 		m_CommandList->SetComputeRootSignature(m_CurComputeRootSignature);
 	}
-	if (m_CurPipelineState)
+	if (PipelineState)
 	{
-		m_CommandList->SetPipelineState(m_CurPipelineState);
+		m_StateCache.SetPipelineState(m_CommandList, PipelineState);
 	}
+	m_DynamicViewDescriptorHeap.UnbindAllInvalid();
+	m_DynamicSamplerDescriptorHeap.UnbindAllInvalid();
 	BindDescriptorHeaps();
 	return FenceValue;
 }
@@ -175,6 +225,7 @@ uint64_t FCommandContext::Finish(bool WaitForCompletion /*= false*/)
 	Assert(m_CurrentAllocator != nullptr);
 
 	FCommandQueue& Queue = g_CommandListManager.GetQueue(m_Type);
+	WaitForUploads(Queue);
 
 	uint64_t FenceValue = Queue.ExecuteCommandList(m_CommandList);
 	Queue.DiscardAllocator(FenceValue, m_CurrentAllocator);
@@ -184,6 +235,9 @@ uint64_t FCommandContext::Finish(bool WaitForCompletion /*= false*/)
 	m_GpuLinearAllocator.CleanupUsedPages(FenceValue);
 	m_DynamicViewDescriptorHeap.CleanupUsedHeaps(FenceValue);
 	m_DynamicSamplerDescriptorHeap.CleanupUsedHeaps(FenceValue);
+
+	ms_FrameStateStats.Add(m_StateCache.GetStats());
+	m_StateCache.ResetStats();
 	
 	if (WaitForCompletion)
 	{
@@ -199,6 +253,25 @@ FAllocation FCommandContext::ReserveUploadMemory(size_t SizeInBytes)
 	return m_CpuLinearAllocator.Allocate(SizeInBytes);
 }
 
+void FCommandContext::WaitForUpload(FUploadTicket Ticket)
+{
+	m_UploadWaitBatch = std::max(m_UploadWaitBatch, Ticket.Batch);
+}
+
+void FCommandContext::WaitForUpload(const FD3D12Resource& Resource)
+{
+	m_UploadWaitBatch = std::max(m_UploadWaitBatch, Resource.m_UploadBatch);
+}
+
+void FCommandContext::WaitForUploads(FCommandQueue& Queue)
+{
+	// the upload contexts are the copy queue work the others wait for
+	if (m_Type == D3D12_COMMAND_LIST_TYPE_COPY)
+		return;
+	g_UploadService.MakeQueueWait(Queue, m_Type, FUploadTicket(m_UploadWaitBatch));
+	m_UploadWaitBatch = 0;
+}
+
 void FCommandContext::FlushResourceBarriers()
 {
 	if (m_NumBarriersToFlush > 0)
@@ -210,6 +283,8 @@ void FCommandContext::FlushResourceBarriers()
 
 void FCommandContext::TransitionResource(FD3D12Resource& Resource, D3D12_RESOURCE_STATES NewState, bool Flush /*= false*/)
 {
+	m_UploadWaitBatch = std::max(m_UploadWaitBatch, Resource.m_UploadBatch);
+
 	bool NeedTransition = false;
 	for (size_t i = 0; i < Resource.m_AllCurrentState.size(); ++i)
 	{
@@ -245,6 +320,7 @@ void FCommandContext::TransitionResource(FD3D12Resource& Resource, D3D12_RESOURC
 void FCommandContext::TransitionSubResource(FD3D12Resource& Resource, D3D12_RESOURCE_STATES NewState, uint32_t Subresource, bool Flush)
 {
 	Assert (Subresource < Resource.m_AllCurrentState.size());
+	m_UploadWaitBatch = std::max(m_UploadWaitBatch, Resource.m_UploadBatch);
 	D3D12_RESOURCE_STATES OldState = Resource.m_AllCurrentState[Subresource];
 	if (OldState != NewState)
 	{
@@ -272,6 +348,7 @@ void FCommandContext::SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type, ID3D12D
 	if (m_CurrentDescriptorHeaps[Type] != HeapPtr)
 	{
 		m_CurrentDescriptorHeaps[Type] = HeapPtr;
+		UnbindDynamicTables(Type);
 		BindDescriptorHeaps();
 	}
 }
@@ -284,6 +361,7 @@ void FCommandContext::SetDescriptorHeaps(UINT HeapCount, D3D12_DESCRIPTOR_HEAP_T
 		if (m_CurrentDescriptorHeaps[Type[i]] != HeapPtrs[i])
 		{
 			m_CurrentDescriptorHeaps[Type[i]] = HeapPtrs[i];
+			UnbindDynamicTables(Type[i]);
 			Changed = true;
 		}
 	}
@@ -293,6 +371,24 @@ void FCommandContext::SetDescriptorHeaps(UINT HeapCount, D3D12_DESCRIPTOR_HEAP_T
 	}
 }
 
+void FCommandContext::InvalidateState()
+{
+	m_StateCache.Invalidate();
+	m_CurComputeRootSignature = nullptr;
+	m_DynamicViewDescriptorHeap.UnbindAllInvalid();
+	m_DynamicSamplerDescriptorHeap.UnbindAllInvalid();
+	BindDescriptorHeaps();
+}
+
+void FCommandContext::UnbindDynamicTables(D3D12_DESCRIPTOR_HEAP_TYPE Type)
+{
+	// the tables committed so far point into the heap that was bound before
+	if (Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+		m_DynamicViewDescriptorHeap.UnbindAllInvalid();
+	else if (Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
+		m_DynamicSamplerDescriptorHeap.UnbindAllInvalid();
+}
+
 void FCommandContext::SetDynamicDescriptor(UINT RootIndex, UINT Offset, D3D12_CPU_DESCRIPTOR_HANDLE Handle)
 {
 	SetDynamicDescriptors(RootIndex, Offset, 1, &Handle);
@@ -300,25 +396,19 @@ void FCommandContext::SetDynamicDescriptor(UINT RootIndex, UINT Offset, D3D12_CP
 
 void FCommandContext::SetDynamicDescriptors(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[])
 {
-	m_DynamicViewDescriptorHeap.SetGraphicsDescriptorHandles(RootIndex, Offset, Count, Handles);
+	bool Staged = m_DynamicViewDescriptorHeap.SetGraphicsDescriptorHandles(RootIndex, Offset, Count, Handles);
+	m_StateCache.RecordSet(FGraphicsStateCache::STATE_DescriptorTable, Staged);
 }
 
 void FCommandContext::SetPipelineState(const FPipelineState& PipelineState)
 {
-	ID3D12PipelineState* PipelineStateObj = PipelineState.GetPipelineStateObject();
-	if (PipelineStateObj == m_CurPipelineState)
-		return;
-
-	m_CommandList->SetPipelineState(PipelineStateObj);
-	m_CurPipelineState = PipelineStateObj;
+	m_StateCache.SetPipelineState(m_CommandList, PipelineState.GetPipelineStateObject());
 }
 
 void FCommandContext::SetRootSignature(const FRootSignature& RootSignature)
 {
-	if (RootSignature.GetSignature() == m_CurGraphicsRootSignature)
+	if (!m_StateCache.SetRootSignature(m_CommandList, RootSignature.GetSignature()))
 		return;
-	m_CurGraphicsRootSignature = RootSignature.GetSignature();
-	m_CommandList->SetGraphicsRootSignature(m_CurGraphicsRootSignature);
 
 	m_DynamicViewDescriptorHeap.ParseGraphicsRootSignature(RootSignature);
 	m_DynamicSamplerDescriptorHeap.ParseGraphicsRootSignature(RootSignature);
@@ -326,12 +416,12 @@ void FCommandContext::SetRootSignature(const FRootSignature& RootSignature)
 
 void FCommandContext::SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY Topology)
 {
-	m_CommandList->IASetPrimitiveTopology(Topology);
+	m_StateCache.SetPrimitiveTopology(m_CommandList, Topology);
 }
 
 void FCommandContext::SetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& View)
 {
-	m_CommandList->IASetIndexBuffer(&View);
+	m_StateCache.SetIndexBuffer(m_CommandList, View);
 }
 
 void FCommandContext::SetVertexBuffer(UINT Slot, const D3D12_VERTEX_BUFFER_VIEW& View)
@@ -341,7 +431,7 @@ void FCommandContext::SetVertexBuffer(UINT Slot, const D3D12_VERTEX_BUFFER_VIEW&
 
 void FCommandContext::SetVertexBuffers(UINT StartSlot, UINT Count, const D3D12_VERTEX_BUFFER_VIEW View[])
 {
-	m_CommandList->IASetVertexBuffers(StartSlot, Count, View);
+	m_StateCache.SetVertexBuffers(m_CommandList, StartSlot, Count, View);
 }
 
 void FCommandContext::SetScissor(UINT left, UINT top, UINT right, UINT bottom)
@@ -351,7 +441,7 @@ void FCommandContext::SetScissor(UINT left, UINT top, UINT right, UINT bottom)
 
 void FCommandContext::SetScissor(const D3D12_RECT& rect)
 {
-	m_CommandList->RSSetScissorRects(1, &rect);
+	m_StateCache.SetScissor(m_CommandList, rect);
 }
 
 void FCommandContext::SetViewport(FLOAT x, FLOAT y, FLOAT w, FLOAT h, FLOAT minDepth /*= 0.0f*/, FLOAT maxDepth /*= 1.0f*/)
@@ -368,7 +458,7 @@ void FCommandContext::SetViewport(FLOAT x, FLOAT y, FLOAT w, FLOAT h, FLOAT minD
 
 void FCommandContext::SetViewport(const D3D12_VIEWPORT& vp)
 {
-	m_CommandList->RSSetViewports(1, &vp);
+	m_StateCache.SetViewport(m_CommandList, vp);
 }
 
 void FCommandContext::SetViewportAndScissor(UINT x, UINT y, UINT w, UINT h)
@@ -379,8 +469,8 @@ void FCommandContext::SetViewportAndScissor(UINT x, UINT y, UINT w, UINT h)
 
 void FCommandContext::SetViewportAndScissor(const D3D12_VIEWPORT& Viewport, const D3D12_RECT& Scissor)
 {
-	m_CommandList->RSSetViewports(1, &Viewport);
-	m_CommandList->RSSetScissorRects(1, &Scissor);
+	m_StateCache.SetViewport(m_CommandList, Viewport);
+	m_StateCache.SetScissor(m_CommandList, Scissor);
 }
 
 void FCommandContext::ClearColor(FColorBuffer& Target)
@@ -400,12 +490,12 @@ void FCommandContext::ClearDepth(FDepthBuffer& Target)
 
 void FCommandContext::SetRenderTargets(UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[], D3D12_CPU_DESCRIPTOR_HANDLE DSV)
 {
-	m_CommandList->OMSetRenderTargets(NumRTVs, RTVs, FALSE, &DSV);
+	m_StateCache.SetRenderTargets(m_CommandList, NumRTVs, RTVs, &DSV);
 }
 
 void FCommandContext::SetRenderTargets(UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE RTVs[])
 {
-	m_CommandList->OMSetRenderTargets(NumRTVs, RTVs, FALSE, nullptr);
+	m_StateCache.SetRenderTargets(m_CommandList, NumRTVs, RTVs, nullptr);
 }
 
 void FCommandContext::SetDepthStencilTarget(D3D12_CPU_DESCRIPTOR_HANDLE DSV)
@@ -415,7 +505,7 @@ void FCommandContext::SetDepthStencilTarget(D3D12_CPU_DESCRIPTOR_HANDLE DSV)
 
 void FCommandContext::SetStencilRef(UINT RefValue)
 {
-	m_CommandList->OMSetStencilRef(RefValue);
+	m_StateCache.SetStencilRef(m_CommandList, RefValue);
 }
 
 void FCommandContext::SetConstantArray(UINT RootIndex, UINT NumConstants, const void* Contents)
@@ -423,6 +513,14 @@ void FCommandContext::SetConstantArray(UINT RootIndex, UINT NumConstants, const
 	m_CommandList->SetGraphicsRoot32BitConstants(RootIndex, NumConstants, Contents, 0);
 }
 
+void FCommandContext::SetBindlessTable(UINT RootIndex)
+{
+	FBindlessTable& Table = FBindlessTable::Get();
+	SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Table.GetHeap());
+	m_CommandList->SetGraphicsRootDescriptorTable(RootIndex, Table.GetGpuHandle());
+	m_DynamicViewDescriptorHeap.ForgetGraphicsTable(RootIndex);
+}
+
 void FCommandContext::SetDynamicConstantBufferView(UINT RootIndex, size_t BufferSize, const void* BufferData)
 {
 	Assert(BufferData != nullptr && IsAligned(BufferSize, 16));
@@ -507,6 +605,14 @@ void FComputeContext::SetConstantArray(UINT RootIndex, UINT NumConstants, const
 	m_CommandList->SetComputeRoot32BitConstants(RootIndex, NumConstants, Contents, 0);
 }
 
+void FComputeContext::SetBindlessTable(UINT RootIndex)
+{
+	FBindlessTable& Table = FBindlessTable::Get();
+	SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Table.GetHeap());
+	m_CommandList->SetComputeRootDescriptorTable(RootIndex, Table.GetGpuHandle());
+	m_DynamicViewDescriptorHeap.ForgetComputeTable(RootIndex);
+}
+
 void FComputeContext::SetDynamicConstantBufferView(UINT RootIndex, size_t BufferSize, const void* BufferData)
 {
 	Assert(BufferData != nullptr && IsAligned(BufferSize, 16));
@@ -1,4 +1,6 @@
 ﻿#include "CommandListManager.h"
+#include "BindlessTable.h"
+#include "LinearAllocator.h"
 
 #define GET_QUEUE_TYPE(f) ((D3D12_COMMAND_LIST_TYPE)(f >> 56))
 
@@ -71,3 +73,29 @@ void FCommandListManager::WaitForFence(uint64_t FenceValue)
 	Producer.WaitForFenceValue(FenceValue);
 }
 
+void FCommandListManager::IdleGPU()
+{
+	m_GraphicsQueue.Flush();
+	m_ComputeQueue.Flush();
+	m_CopyQueue.Flush();
+}
+
+void FCommandListManager::BeginFrame()
+{
+	uint64_t FenceValue = m_FramePacer.GetWaitFence();
+	if (FenceValue != 0)
+	{
+		m_GraphicsQueue.WaitForFenceValue(FenceValue);
+	}
+}
+
+uint64_t FCommandListManager::EndFrame()
+{
+	uint64_t FenceValue = m_GraphicsQueue.Signal();
+	m_FramePacer.EndFrame(FenceValue);
+	// the compute work of the frame is submitted by now as well
+	FBindlessTable::Get().EndFrame(FenceValue, m_ComputeQueue.GetLastSignaledFence());
+	LinearAllocator::TrimAll();
+	return FenceValue;
+}
+
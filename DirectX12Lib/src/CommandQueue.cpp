@@ -65,8 +65,9 @@ uint64_t FCommandQueue::ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList> com
 		commandList.Get()
 	};
 
+	std::lock_guard<std::mutex> Lock(m_FenceMutex);
 	m_d3d12CommandQueue->ExecuteCommandLists(1, ppCommandLists);
-	uint64_t fenceValue = Signal();
+	uint64_t fenceValue = SignalLocked();
 
 	//can be reused the next time the GetCommandList method is called.
 	m_CommandListQueue.push(commandList);
@@ -75,17 +76,29 @@ uint64_t FCommandQueue::ExecuteCommandList(ComPtr<ID3D12GraphicsCommandList> com
 }
 
 uint64_t FCommandQueue::Signal()
+{
+	std::lock_guard<std::mutex> Lock(m_FenceMutex);
+	return SignalLocked();
+}
+
+uint64_t FCommandQueue::SignalLocked()
 {
 	ThrowIfFailed(m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), m_NextFenceValue));
 
 	return m_NextFenceValue++;
 }
 
+uint64_t FCommandQueue::GetLastSignaledFence()
+{
+	std::lock_guard<std::mutex> Lock(m_FenceMutex);
+	return m_NextFenceValue - 1;
+}
+
 bool FCommandQueue::IsFenceComplete(uint64_t FenceValue)
 {
 	if (FenceValue > m_LastCompletedFenceValue)
 	{
-		m_LastCompletedFenceValue = std::max(m_LastCompletedFenceValue, m_d3d12Fence->GetCompletedValue());
+		UpdateCompletedFence(m_d3d12Fence->GetCompletedValue());
 	}
 	return FenceValue <= m_LastCompletedFenceValue;
 }
@@ -95,19 +108,33 @@ void FCommandQueue::WaitForFenceValue(uint64_t FenceValue)
 	if (IsFenceComplete(FenceValue))
 		return;
 
+	// the event is auto reset, a second waiter on it could take the wake up meant for the first
+	std::lock_guard<std::mutex> Lock(m_EventMutex);
+	if (IsFenceComplete(FenceValue))
+		return;
 	ThrowIfFailed(m_d3d12Fence->SetEventOnCompletion(FenceValue, m_FenceEvent));
 	::WaitForSingleObject(m_FenceEvent, INFINITE);
-	m_LastCompletedFenceValue = FenceValue;
+	UpdateCompletedFence(FenceValue);
+}
+
+void FCommandQueue::UpdateCompletedFence(uint64_t FenceValue)
+{
+	// only moves forward, another thread may have seen a later value meanwhile
+	uint64_t Completed = m_LastCompletedFenceValue.load();
+	while (FenceValue > Completed && !m_LastCompletedFenceValue.compare_exchange_weak(Completed, FenceValue))
+	{
+	}
 }
 
 void FCommandQueue::StallForFence(uint64_t FenceValue)
 {
 	FCommandQueue& Producer = g_CommandListManager.GetQueue((D3D12_COMMAND_LIST_TYPE)(FenceValue >> 56));
-	m_d3d12CommandQueue->Wait(Producer.m_d3d12Fence.Get(), Producer.m_NextFenceValue-1);
+	m_d3d12CommandQueue->Wait(Producer.m_d3d12Fence.Get(), FenceValue);
 }
 
 void FCommandQueue::StallForProducer(FCommandQueue& Producer)
 {
+	std::lock_guard<std::mutex> Lock(Producer.m_FenceMutex);
 	Assert(Producer.m_NextFenceValue > 0);
 	m_d3d12CommandQueue->Wait(Producer.m_d3d12Fence.Get(), Producer.m_NextFenceValue-1);
 }
@@ -120,6 +147,7 @@ void FCommandQueue::Flush()
 
 ID3D12CommandAllocator* FCommandQueue::RequestAllocator()
 {
+	std::lock_guard<std::mutex> Lock(m_AllocatorMutex);
 	ID3D12CommandAllocator* Allocator = nullptr;
 	if (!m_ReadyAllocators.empty() && IsFenceComplete(m_ReadyAllocators.front().FenceValue))
 	{
@@ -138,6 +166,7 @@ ID3D12CommandAllocator* FCommandQueue::RequestAllocator()
 
 void FCommandQueue::DiscardAllocator(uint64_t FenceValue, ID3D12CommandAllocator* CommandAllocator)
 {
+	std::lock_guard<std::mutex> Lock(m_AllocatorMutex);
 	m_ReadyAllocators.emplace(CommandAllocatorEntry{ FenceValue, CommandAllocator });
 }
 
@@ -2,6 +2,9 @@
 
 #include "Common.h"
 #include <wchar.h>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
 
 #define MAX_STRING_LEN 512
 
@@ -27,3 +30,16 @@ void DoAssert(bool success, const wchar_t* file_name, int line)
 		__debugbreak();
 	}
 }
+
+FMemoryUsage GetMemoryUsage()
+{
+	FMemoryUsage Usage = {};
+	PROCESS_MEMORY_COUNTERS Counters;
+	if (::GetProcessMemoryInfo(::GetCurrentProcess(), &Counters, sizeof(Counters)))
+	{
+		Usage.WorkingSet = Counters.WorkingSetSize;
+		Usage.Committed = Counters.PagefileUsage;
+		Usage.ProcessPeak = Counters.PeakWorkingSetSize;
+	}
+	return Usage;
+}
@@ -160,6 +160,14 @@ void FCubeBuffer::CreateDerivedViews(ID3D12Device* Device, DXGI_FORMAT Format, u
 	SRVDesc.TextureCube.MostDetailedMip = 0;
 	SRVDesc.TextureCube.ResourceMinLODClamp = 0.0f;
 
+	if (m_NumViewMips > 0)
+	{
+		D3D12RHI::Get().FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_CubeSRVHandle, 1 + m_NumViewMips);
+		D3D12RHI::Get().FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, m_RTVHandle, ArraySize * m_NumViewMips);
+		D3D12RHI::Get().FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_FaceMipSRVHandle, ArraySize * m_NumViewMips);
+	}
+	m_NumViewMips = NumMips;
+
 	m_CubeSRVHandle = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1 + NumMips);
 	D3D12_CPU_DESCRIPTOR_HANDLE CurCubeSRVHandle = m_CubeSRVHandle;
 	Device->CreateShaderResourceView(m_Resource.Get(), &SRVDesc, CurCubeSRVHandle);
@@ -210,6 +218,8 @@ void FCubeBuffer::SaveCubeMap(const std::wstring& FileName)
 {
 	ScratchImage image;
 	FCommandQueue& Queue = g_CommandListManager.GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	// the capture goes to the queue directly, past the upload waits of the contexts
+	g_UploadService.WaitForUpload(FUploadTicket(m_UploadBatch));
 
 	HRESULT hr = DirectX::CaptureTexture(Queue.GetD3D12CommandQueue(), m_Resource.Get(), true/*isCubeMap*/, image, m_AllCurrentState[0], m_AllCurrentState[0]);
 	if (SUCCEEDED(hr))
@@ -348,6 +358,7 @@ std::vector<Vector3f> FCubeBuffer::GenerateSHcoeffs(int Degree, int SampleNum)
 #if 1
 	DirectX::ScratchImage image;
 	FCommandQueue& Queue = g_CommandListManager.GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	g_UploadService.WaitForUpload(FUploadTicket(m_UploadBatch));
 	hr = DirectX::CaptureTexture(Queue.GetD3D12CommandQueue(), m_Resource.Get(), true/*isCubeMap*/, image, m_AllCurrentState[0], m_AllCurrentState[0]);
 	if (SUCCEEDED(hr))
 	{
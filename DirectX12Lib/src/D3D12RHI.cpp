@@ -12,8 +12,11 @@
 #include "RenderWindow.h"
 #include "CommandContext.h"
 #include "CommandListManager.h"
+#include "UploadService.h"
 #include "DescriptorAllocator.h"
 #include "PipelineState.h"
+#include "PipelineStateCache.h"
+#include "BindlessTable.h"
 #include "GenerateMips.h"
 #include "TemporalEffects.h"
 #include "BufferManager.h"
@@ -31,6 +34,7 @@ using namespace std;
 
 FContextManager g_ContextManager;
 FCommandListManager g_CommandListManager;
+FUploadService g_UploadService;
 
 FDescriptorAllocator g_DescriptorAllocator[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES] =
 {
@@ -136,6 +140,11 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3D12RHI::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_T
 	return g_DescriptorAllocator[Type].Allocate(Count);
 }
 
+void D3D12RHI::FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE Type, D3D12_CPU_DESCRIPTOR_HANDLE Handle, UINT Count /*= 1*/)
+{
+	g_DescriptorAllocator[Type].Free(Handle, Count);
+}
+
 uint32_t D3D12RHI::GetDescriptorSize(D3D12_DESCRIPTOR_HEAP_TYPE Type)
 {
 	return g_DescriptorAllocator[Type].GetDescriptorSize();
@@ -168,6 +177,9 @@ bool D3D12RHI::Initialize()
 
 	// 3. create command list manager as well as command queues
 	g_CommandListManager.Create(m_device.Get());
+	g_UploadService.Create(m_device.Get());
+	FPipelineStateCache::Get().Create(m_device.Get(), dxgiAdapter.Get());
+	FBindlessTable::Get().Create(m_device.Get());
 
 	FPipelineState::Initialize();
 
@@ -193,10 +205,15 @@ void D3D12RHI::Destroy()
 	TemporalEffects::Destroy();
 	FGenerateMips::Destroy();
 	BufferManager::DestroyRenderingBuffers();
+	g_UploadService.Destroy();
 	FCommandContext::DestroyAllContexts();
+	FBindlessTable::Get().Destroy();
 	g_CommandListManager.Destroy();
 	FPipelineState::DestroyAll();
-	FDescriptorAllocator::DestroyAll();
+	for (uint32_t i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+	{
+		g_DescriptorAllocator[i].Destroy();
+	}
 	RenderWindow::Get().Destroy();
 }
 
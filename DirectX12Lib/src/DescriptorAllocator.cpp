@@ -1,52 +1,98 @@
 ﻿#include "DescriptorAllocator.h"
 #include "D3D12RHI.h"
 
-std::vector<ComPtr<ID3D12DescriptorHeap> > FDescriptorAllocator::sm_DescriptorPool;
+#include <algorithm>
 
 FDescriptorAllocator::FDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE Type)
 	: m_HeapType(Type)
 	, m_DescriptorSize(0)
-	, m_CurrentHeap(nullptr)
-	, m_RemainingFreeHandles(0)
 {
-	m_CurrentCpuAddress.ptr = 0;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE FDescriptorAllocator::Allocate(uint32_t Count)
 {
-	if (m_CurrentHeap == nullptr || m_RemainingFreeHandles < Count)
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_DescriptorSize == 0)
 	{
-		m_CurrentHeap = RequestNewHeap(m_HeapType);
-		m_CurrentCpuAddress = m_CurrentHeap->GetCPUDescriptorHandleForHeapStart();
-		m_RemainingFreeHandles = sm_NumDescriptorsPerHeap;
-		if (m_DescriptorSize == 0)
+		m_DescriptorSize = D3D12RHI::Get().GetD3D12Device()->GetDescriptorHandleIncrementSize(m_HeapType);
+	}
+
+	// the older heaps first, they fill up and the newer ones stay free
+	D3D12_CPU_DESCRIPTOR_HANDLE Result;
+	for (auto& Heap : m_Heaps)
+	{
+		uint32_t Offset = Heap->Ranges.Allocate(Count);
+		if (Offset != FRangeAllocator::INVALID_OFFSET)
 		{
-			m_DescriptorSize = D3D12RHI::Get().GetD3D12Device()->GetDescriptorHandleIncrementSize(m_HeapType);
+			Result.ptr = Heap->Start + (SIZE_T)Offset * m_DescriptorSize;
+			return Result;
 		}
 	}
 
-	D3D12_CPU_DESCRIPTOR_HANDLE Result = m_CurrentCpuAddress;
-	m_CurrentCpuAddress.ptr += Count * m_DescriptorSize;
-	m_RemainingFreeHandles -= Count;
-
+	FHeap* Heap = RequestNewHeap((std::max)(Count, sm_NumDescriptorsPerHeap));
+	uint32_t Offset = Heap->Ranges.Allocate(Count);
+	Assert(Offset == 0);
+	Result.ptr = Heap->Start;
 	return Result;
 }
 
-void FDescriptorAllocator::DestroyAll()
+void FDescriptorAllocator::Free(D3D12_CPU_DESCRIPTOR_HANDLE Handle, uint32_t Count)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	// a resource that outlived Destroy, its heap is gone already
+	if (m_Heaps.empty())
+		return;
+	for (auto& Heap : m_Heaps)
+	{
+		if (Handle.ptr >= Heap->Start && Handle.ptr < Heap->Start + (SIZE_T)Heap->NumDescriptors * m_DescriptorSize)
+		{
+			const SIZE_T Offset = Handle.ptr - Heap->Start;
+			Assert(Offset % m_DescriptorSize == 0);
+			Heap->Ranges.Free((uint32_t)(Offset / m_DescriptorSize), Count);
+			return;
+		}
+	}
+	Assert(false);
+}
+
+FDescriptorAllocator::FStats FDescriptorAllocator::GetStats()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	FStats Stats = {};
+	uint32_t FreeSize = 0;
+	for (auto& Heap : m_Heaps)
+	{
+		FRangeAllocator::FStats HeapStats = Heap->Ranges.GetStats();
+		Stats.NumHeaps++;
+		Stats.Capacity += HeapStats.Size;
+		Stats.NumFreeRanges += HeapStats.NumFreeRanges;
+		Stats.LargestFreeRange = (std::max)(Stats.LargestFreeRange, HeapStats.LargestFreeRange);
+		FreeSize += HeapStats.FreeSize;
+	}
+	Stats.Allocated = Stats.Capacity - FreeSize;
+	Stats.Fragmentation = FreeSize == 0 ? 0.f : 1.f - (float)Stats.LargestFreeRange / FreeSize;
+	return Stats;
+}
+
+void FDescriptorAllocator::Destroy()
 {
-	sm_DescriptorPool.clear();
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_Heaps.clear();
 }
 
-ID3D12DescriptorHeap* FDescriptorAllocator::RequestNewHeap(D3D12_DESCRIPTOR_HEAP_TYPE Type)
+FDescriptorAllocator::FHeap* FDescriptorAllocator::RequestNewHeap(uint32_t NumDescriptors)
 {
 	D3D12_DESCRIPTOR_HEAP_DESC Desc = {};
-	Desc.NumDescriptors = sm_NumDescriptorsPerHeap;
-	Desc.Type = Type;
+	Desc.NumDescriptors = NumDescriptors;
+	Desc.Type = m_HeapType;
 	Desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 	Desc.NodeMask = 1;
 
-	ComPtr<ID3D12DescriptorHeap> descriptorHeap;
-	ThrowIfFailed(D3D12RHI::Get().GetD3D12Device()->CreateDescriptorHeap(&Desc, IID_PPV_ARGS(&descriptorHeap)));
-	sm_DescriptorPool.emplace_back(descriptorHeap);
-	return descriptorHeap.Get();
+	std::unique_ptr<FHeap> Heap(new FHeap);
+	ThrowIfFailed(D3D12RHI::Get().GetD3D12Device()->CreateDescriptorHeap(&Desc, IID_PPV_ARGS(&Heap->Heap)));
+	Heap->Start = Heap->Heap->GetCPUDescriptorHandleForHeapStart().ptr;
+	Heap->NumDescriptors = NumDescriptors;
+	Heap->Ranges.Reset(NumDescriptors);
+	m_Heaps.push_back(std::move(Heap));
+	return m_Heaps.back().get();
 }
@@ -0,0 +1,173 @@
+#include "DrawCommandList.h"
+#include "Scene.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+uint64_t FDrawCommandList::MakeSortKey(uint32_t Pass, uint32_t Pso, uint32_t Material, uint32_t Mesh, uint32_t Depth)
+{
+	// ids past a field saturate, the draws stay correct and only group worse
+	return (uint64_t)(std::min)(Pass, 0xfu) << 60
+		| (uint64_t)(std::min)(Pso, 0xfffu) << 48
+		| (uint64_t)(std::min)(Material, 0xffffu) << 32
+		| (uint64_t)(std::min)(Mesh, 0xffffu) << 16
+		| (std::min)(Depth, 0xffffu);
+}
+
+uint64_t FDrawCommandList::ApplySortMode(uint64_t SortKey, uint32_t Depth, ESortMode Mode)
+{
+	if (Mode == SORT_FRONT_TO_BACK)
+		return (SortKey & 0xffff000000000000ull) | (uint64_t)Depth << 32 | ((SortKey >> 16) & 0xffffffffull);
+	return (SortKey & ~0xffffull) | Depth;
+}
+
+uint32_t FDrawCommandList::QuantizeDepth(float Depth)
+{
+	if (!(Depth > 0.f))
+		return 0;
+	// positive floats order like their bits, the top 16 keep the exponent and 7 bits of mantissa
+	uint32_t Bits;
+	memcpy(&Bits, &Depth, sizeof(Bits));
+	return Bits >> 16;
+}
+
+void FDrawCommandList::RadixSort(uint64_t* Keys, uint32_t* Values, uint32_t Count, uint64_t* TempKeys, uint32_t* TempValues)
+{
+	if (Count < 2)
+		return;
+
+	uint32_t Counts[8][256] = {};
+	for (uint32_t i = 0; i < Count; ++i)
+	{
+		const uint64_t Key = Keys[i];
+		for (uint32_t d = 0; d < 8; ++d)
+			Counts[d][(Key >> (d * 8)) & 0xff]++;
+	}
+
+	uint64_t* SrcKeys = Keys;
+	uint32_t* SrcValues = Values;
+	uint64_t* DstKeys = TempKeys;
+	uint32_t* DstValues = TempValues;
+	for (uint32_t d = 0; d < 8; ++d)
+	{
+		const uint32_t Shift = d * 8;
+		uint32_t* Digit = Counts[d];
+		if (Digit[(SrcKeys[0] >> Shift) & 0xff] == Count)
+			continue;
+
+		uint32_t Offset = 0;
+		for (uint32_t b = 0; b < 256; ++b)
+		{
+			uint32_t BucketCount = Digit[b];
+			Digit[b] = Offset;
+			Offset += BucketCount;
+		}
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			uint32_t Dst = Digit[(SrcKeys[i] >> Shift) & 0xff]++;
+			DstKeys[Dst] = SrcKeys[i];
+			DstValues[Dst] = SrcValues[i];
+		}
+		std::swap(SrcKeys, DstKeys);
+		std::swap(SrcValues, DstValues);
+	}
+
+	if (SrcKeys != Keys)
+	{
+		memcpy(Keys, SrcKeys, Count * sizeof(uint64_t));
+		memcpy(Values, SrcValues, Count * sizeof(uint32_t));
+	}
+}
+
+FDrawCommandList::FDrawCommandList()
+	: m_MaterialCount(0)
+	, m_MeshDataCount(0)
+	, m_Scene(nullptr)
+	, m_SceneVersion(0)
+	, m_Pass(0)
+	, m_Pso(0)
+{
+}
+
+bool FDrawCommandList::Update(Scene* pScene, uint32_t Pass, uint32_t Pso)
+{
+	if (pScene == m_Scene && pScene->GetVersion() == m_SceneVersion && Pass == m_Pass && Pso == m_Pso)
+		return false;
+
+	// ids in order of first use, so a scene without any sharing keeps its draws in scene order
+	std::map<std::pair<const FMaterialTable*, uint32_t>, uint32_t> MaterialIds;
+	std::unordered_map<const MeshData*, uint32_t> MeshIds;
+
+	const uint32_t MeshCount = pScene->GetMeshCount();
+	m_Commands.clear();
+	m_MeshFirstCommand.resize(MeshCount + 1);
+	for (uint32_t m = 0; m < MeshCount; ++m)
+	{
+		m_MeshFirstCommand[m] = (uint32_t)m_Commands.size();
+		MeshData* Data = pScene->GetMeshByIndex(m)->GetFirstMeshData();
+		if (Data == nullptr)
+			continue;
+
+		const size_t First = m_Commands.size();
+		Data->CollectMeshBatch(m_Commands);
+		const uint32_t MeshId = MeshIds.emplace(Data, (uint32_t)MeshIds.size()).first->second;
+		const FMaterialTable* Table = Data->GetMaterialTable().get();
+		for (size_t c = First; c < m_Commands.size(); ++c)
+		{
+			MeshDrawCommand& Command = m_Commands[c];
+			const uint32_t MaterialId = MaterialIds.emplace(std::make_pair(Table, Command.MaterialIndex), (uint32_t)MaterialIds.size()).first->second;
+			Command.MeshIndex = m;
+			Command.SortKey = MakeSortKey(Pass, Pso, MaterialId, MeshId, 0);
+		}
+	}
+	m_MeshFirstCommand[MeshCount] = (uint32_t)m_Commands.size();
+	m_MaterialCount = (uint32_t)MaterialIds.size();
+	m_MeshDataCount = (uint32_t)MeshIds.size();
+
+	const uint32_t Count = GetCount();
+	m_Keys.resize(Count);
+	m_StateOrder.resize(Count);
+	m_TempKeys.resize(Count);
+	m_TempValues.resize(Count);
+	for (uint32_t i = 0; i < Count; ++i)
+	{
+		m_Keys[i] = m_Commands[i].SortKey;
+		m_StateOrder[i] = i;
+	}
+	RadixSort(m_Keys.data(), m_StateOrder.data(), Count, m_TempKeys.data(), m_TempValues.data());
+
+	m_Scene = pScene;
+	m_SceneVersion = pScene->GetVersion();
+	m_Pass = Pass;
+	m_Pso = Pso;
+	return true;
+}
+
+void FDrawCommandList::Sort(const Scene* pScene, const uint32_t* Visible, uint32_t Count, ESortMode Mode,
+	const Vector3f& ViewOrigin, const Vector3f& ViewDirection, std::vector<uint32_t>& Order)
+{
+	Order.resize(Count);
+	m_Keys.resize(Count);
+	m_TempKeys.resize(Count);
+	m_TempValues.resize(Count);
+
+	// the depth is per mesh, consecutive commands of one mesh reuse it
+	uint32_t LastMesh = 0xffffffff;
+	uint32_t Depth = 0;
+	for (uint32_t i = 0; i < Count; ++i)
+	{
+		const MeshDrawCommand& Command = m_Commands[Visible[i]];
+		if (Command.MeshIndex != LastMesh)
+		{
+			Vector3f ToCenter = pScene->GetMeshWorldBounds(Command.MeshIndex).GetCenter() - ViewOrigin;
+			Depth = QuantizeDepth(ToCenter.Dot(ViewDirection));
+			LastMesh = Command.MeshIndex;
+		}
+		m_Keys[i] = ApplySortMode(Command.SortKey, Depth, Mode);
+		Order[i] = Visible[i];
+	}
+	RadixSort(m_Keys.data(), Order.data(), Count, m_TempKeys.data(), m_TempValues.data());
+}
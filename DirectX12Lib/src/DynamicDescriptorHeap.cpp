@@ -3,6 +3,7 @@
 #include "CommandContext.h"
 #include "CommandListManager.h"
 #include "D3D12RHI.h"
+#include <intrin.h>
 
 extern FCommandListManager g_CommandListManager;
 
@@ -116,15 +117,17 @@ D3D12_GPU_DESCRIPTOR_HANDLE FDynamicDescriptorHeap::UploadDirect(D3D12_CPU_DESCR
 void FDynamicDescriptorHeap::CopyAndBindStagedTables(FDescriptorHandleCache& HandleCache, ID3D12GraphicsCommandList* CommandList, 
 	void(STDMETHODCALLTYPE ID3D12GraphicsCommandList::*SetFunc)(UINT, D3D12_GPU_DESCRIPTOR_HANDLE))
 {
+	// binding the heap again after another one marks all tables stale, so size them afterwards
+	m_OwningContext.SetDescriptorHeap(m_HeapType, GetHeapPointer());
 	uint32_t NeededSize = HandleCache.ComputeStagedSize();
 	if (!HasSpace(NeededSize))
 	{
 		RetireCurrentHeap();
 		UnbindAllInvalid();
+		m_OwningContext.SetDescriptorHeap(m_HeapType, GetHeapPointer());
 		NeededSize = HandleCache.ComputeStagedSize();
 	}
 
-	m_OwningContext.SetDescriptorHeap(m_HeapType, GetHeapPointer());
 	HandleCache.CopyAndBindStaleTables(m_HeapType, m_DescriptorSize, AllocateDescriptor(NeededSize), CommandList, SetFunc);
 }
 
@@ -141,6 +144,14 @@ void FDynamicDescriptorHeap::FDescriptorHandleCache::UnbindAllInvalid()
 	}
 }
 
+void FDynamicDescriptorHeap::FDescriptorHandleCache::ForgetTable(UINT RootIndex)
+{
+	if (((1 << RootIndex) & m_RootDescriptorTablesBitMap) == 0)
+		return;
+	m_RootDescriptorTable[RootIndex].AssignedHandlesBitMap = 0;
+	m_StaleRootParamsBitMap &= ~(1 << RootIndex);
+}
+
 uint32_t FDynamicDescriptorHeap::FDescriptorHandleCache::ComputeStagedSize()
 {
 	uint32_t NeededSpace = 0;
@@ -188,18 +199,25 @@ void FDynamicDescriptorHeap::FDescriptorHandleCache::ParseRootSignature(D3D12_DE
 	Assert (m_MaxCachedDescriptors <= MaxNumDescriptors);
 }
 
-void FDynamicDescriptorHeap::FDescriptorHandleCache::StageDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[])
+bool FDynamicDescriptorHeap::FDescriptorHandleCache::StageDescriptorHandles(UINT RootIndex, UINT Offset, UINT Count, const D3D12_CPU_DESCRIPTOR_HANDLE Handles[])
 {
 	Assert (((1 << RootIndex) & m_RootDescriptorTablesBitMap) != 0);
 	Assert (Offset + Count <= m_RootDescriptorTable[RootIndex].TableSize);
 
 	FDescriptorTableCache& TableCache = m_RootDescriptorTable[RootIndex];
 	D3D12_CPU_DESCRIPTOR_HANDLE* CopyDest = TableCache.TableStart + Offset;
+	const uint32_t RangeBits = ((1 << Count) - 1) << Offset;
+
+	// the same handles are either still staged or bound since the last commit
+	if ((TableCache.AssignedHandlesBitMap & RangeBits) == RangeBits && memcmp(CopyDest, Handles, Count * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE)) == 0)
+		return false;
+
 	for (UINT i = 0; i < Count; ++i)
 		CopyDest[i] = Handles[i];
 
-	TableCache.AssignedHandlesBitMap |= (((1 << Count) - 1) << Offset);
+	TableCache.AssignedHandlesBitMap |= RangeBits;
 	m_StaleRootParamsBitMap |= (1 << RootIndex);
+	return true;
 }
 
 void FDynamicDescriptorHeap::FDescriptorHandleCache::CopyAndBindStaleTables(
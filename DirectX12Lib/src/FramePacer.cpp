@@ -0,0 +1,35 @@
+#include "FramePacer.h"
+#include "Assertion.h"
+
+#include <algorithm>
+
+FFramePacer::FFramePacer(uint32_t FramesInFlight)
+	: m_FramesInFlight(1)
+	, m_FrameIndex(0)
+	, m_FrameNumber(0)
+	, m_LastFence(0)
+{
+	std::fill(m_FrameFences, m_FrameFences + MAX_FRAMES_IN_FLIGHT, 0);
+	SetFramesInFlight(FramesInFlight);
+}
+
+void FFramePacer::SetFramesInFlight(uint32_t Count)
+{
+	Count = (std::max)(1u, (std::min)(Count, MAX_FRAMES_IN_FLIGHT));
+	if (Count == m_FramesInFlight)
+		return;
+
+	// the slots get renumbered, so every one of them waits for the newest frame once
+	m_FramesInFlight = Count;
+	m_FrameIndex = 0;
+	std::fill(m_FrameFences, m_FrameFences + MAX_FRAMES_IN_FLIGHT, m_LastFence);
+}
+
+void FFramePacer::EndFrame(uint64_t FenceValue)
+{
+	Assert(FenceValue >= m_LastFence);
+	m_FrameFences[m_FrameIndex] = FenceValue;
+	m_LastFence = FenceValue;
+	m_FrameIndex = (m_FrameIndex + 1) % m_FramesInFlight;
+	++m_FrameNumber;
+}
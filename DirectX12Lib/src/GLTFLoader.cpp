@@ -2,8 +2,13 @@
 #include "MeshData.h"
 #include "Common.h"
 #include "Scene.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "TangentGenerator.h"
+#include "MeshOptimizer.h"
 
 #include <iostream>
+#include <map>
 
 #define TINYGLTF_IMPLEMENTATION
 //#define STB_IMAGE_IMPLEMENTATION
@@ -17,6 +22,12 @@
 
 Scene* FGLTFLoader::LoadFromFile(const std::string& FilePath)
 {
+	uint64_t CacheKey = ComputeCacheKey(FilePath);
+	if (Scene* CachedScene = LoadFromCache(FilePath, CacheKey))
+	{
+		return CachedScene;
+	}
+
 	tinygltf::Model TinyModel;
 	tinygltf::TinyGLTF TinyLoader;
 	std::string Error, Warning;
@@ -75,23 +86,29 @@ Scene* FGLTFLoader::LoadFromFile(const std::string& FilePath)
 		Material.AoPath = GetTexture(TinyMat.additionalValues, "occlusionTexture", "../Resources/Textures/white.png");
 	}
 
+	// all meshes of the file share the material table of the scene
+	std::shared_ptr<FMaterialTable> MaterialTable = std::make_shared<FMaterialTable>(Materials);
 	Scene* MyScene = new Scene();
+	MyScene->SetMaterialTable(MaterialTable);
 
 	Assert(TinyModel.scenes.size() > 0);
 	const tinygltf::Scene& TinyScene = TinyModel.scenes[TinyModel.defaultScene > -1 ? TinyModel.defaultScene : 0];
+	std::vector<SceneNode*> LoadedNodes;
 	for (size_t i = 0; i < TinyScene.nodes.size(); ++i)
 	{
 		const tinygltf::Node& TinyNode = TinyModel.nodes[TinyScene.nodes[i]];
-		SceneNode* Node = LoadNode(nullptr, TinyNode, TinyModel, Materials);
+		SceneNode* Node = LoadNode(nullptr, TinyNode, TinyModel, MaterialTable, LoadedNodes);
 		MyScene->AddNode(Node);
 	}
 
+	SaveToCache(FilePath, CacheKey, LoadedNodes, *MaterialTable);
+
 	MyScene->PostLoad();
 
 	return MyScene;
 }
 
-SceneNode* FGLTFLoader::LoadNode(SceneNode* Parent, const tinygltf::Node& TinyNode, const tinygltf::Model& TinyModel, const std::vector<MaterialData>& Materials)
+SceneNode* FGLTFLoader::LoadNode(SceneNode* Parent, const tinygltf::Node& TinyNode, const tinygltf::Model& TinyModel, const std::shared_ptr<FMaterialTable>& Materials, std::vector<SceneNode*>& LoadedNodes)
 {
 	SceneNode* Node = nullptr;
 	if (TinyNode.mesh >= 0)
@@ -108,8 +125,13 @@ SceneNode* FGLTFLoader::LoadNode(SceneNode* Parent, const tinygltf::Node& TinyNo
 	{
 		Node = new SceneNode();
 	}
+	LoadedNodes.push_back(Node);
 
 	Node->Parent = Parent;
+	if (Parent)
+	{
+		Parent->AddChild(Node);
+	}
 	Node->Name = TinyNode.name;
 	if (TinyNode.scale.size() == 3)
 	{
@@ -126,22 +148,19 @@ SceneNode* FGLTFLoader::LoadNode(SceneNode* Parent, const tinygltf::Node& TinyNo
 
 	for (size_t i = 0; i < TinyNode.children.size(); ++i)
 	{
-		LoadNode(Node, TinyModel.nodes[TinyNode.children[i]], TinyModel, Materials);
+		LoadNode(Node, TinyModel.nodes[TinyNode.children[i]], TinyModel, Materials, LoadedNodes);
 	}
 	return Node;
 }
 
 
-MeshNode* FGLTFLoader::LoadMesh(const tinygltf::Mesh& TinyMesh, const tinygltf::Model& TinyModel, const std::vector<MaterialData>& Materials)
+MeshNode* FGLTFLoader::LoadMesh(const tinygltf::Mesh& TinyMesh, const tinygltf::Model& TinyModel, const std::shared_ptr<FMaterialTable>& Materials)
 {
 	size_t TotalIndexCount = 0;
 	size_t TotalVertexCount = 0;
 
 	MeshData* meshdata = new MeshData("");
-	for (size_t i = 0; i < Materials.size(); ++i)
-	{
-		meshdata->AddMaterial(Materials[i]);
-	}
+	meshdata->SetMaterialTable(Materials);
 	
 	bool HasNormal = false;
 	bool HasTexcoord0 = false;
@@ -315,6 +334,12 @@ MeshNode* FGLTFLoader::LoadMesh(const tinygltf::Mesh& TinyMesh, const tinygltf::
 		meshdata->AddSubMesh(IndexStart, (uint32_t)IndexCount, Primitive.material);
 	}
 
+	// glTF asks for MikkTSpace tangents when the asset has none
+	if (!HasTangent && HasNormal && HasTexcoord0)
+	{
+		FTangentGenerator::Generate(TM_MikkTSpace, final_positions, final_texcoords, final_normals, meshdata->m_indices, final_tangents);
+	}
+
 	meshdata->m_positions.swap(final_positions);
 	meshdata->m_texcoords.swap(final_texcoords);
 	meshdata->m_normals.swap(final_normals);
@@ -322,5 +347,122 @@ MeshNode* FGLTFLoader::LoadMesh(const tinygltf::Mesh& TinyMesh, const tinygltf::
 	//meshdata->m_indices.swap(final_indices);
 	meshdata->ComputeBoundingBox();
 
+	if (FMeshOptimizer::IsImportOptimizationEnabled())
+	{
+		FMeshOptimizer::Optimize(*meshdata);
+	}
+
 	return new MeshNode(meshdata);
 }
+
+uint64_t FGLTFLoader::ComputeCacheKey(const std::string& FilePath)
+{
+	if (!FMeshCache::IsEnabled())
+		return 0;
+
+	// a .gltf keeps its vertex data in external buffers, those are part of the key too
+	std::vector<std::string> SourceFiles;
+	SourceFiles.push_back(FilePath);
+	auto ExtPos = FilePath.rfind('.');
+	bool BinaryFile = ExtPos != std::string::npos && FilePath.substr(ExtPos + 1) == "glb";
+	auto LastSeparator = FilePath.find_last_of("/\\");
+	std::string BasePath = LastSeparator != std::string::npos ? FilePath.substr(0, LastSeparator + 1) : std::string();
+
+	FMappedFile File;
+	if (!BinaryFile && File.Open(FilePath) && File.GetSize() > 0)
+	{
+		std::string Json(File.GetData(), File.GetSize());
+		const std::string UriKey = "\"uri\"";
+		for (size_t Pos = Json.find(UriKey); Pos != std::string::npos; Pos = Json.find(UriKey, Pos + 1))
+		{
+			size_t Begin = Json.find('"', Json.find(':', Pos + UriKey.size()));
+			size_t End = Begin != std::string::npos ? Json.find('"', Begin + 1) : std::string::npos;
+			if (End == std::string::npos)
+				break;
+			std::string Uri = Json.substr(Begin + 1, End - Begin - 1);
+			if (Uri.size() > 4 && Uri.compare(Uri.size() - 4, 4, ".bin") == 0)
+			{
+				SourceFiles.push_back(BasePath + Uri);
+			}
+		}
+	}
+	uint32_t ImportFlags = FMeshCache::IF_None;
+	if (FMeshOptimizer::IsImportOptimizationEnabled())
+		ImportFlags |= FMeshCache::IF_Optimized;
+	return FMeshCache::ComputeKey(SourceFiles, ImportFlags);
+}
+
+Scene* FGLTFLoader::LoadFromCache(const std::string& FilePath, uint64_t CacheKey)
+{
+	std::vector<MeshData*> Meshes;
+	std::vector<FMeshCacheNode> Nodes;
+	std::vector<MaterialData> Materials;
+	if (CacheKey == 0 || !FMeshCache::Load(FilePath, CacheKey, Meshes, Nodes, Materials))
+		return nullptr;
+
+	std::shared_ptr<FMaterialTable> MaterialTable = std::make_shared<FMaterialTable>(Materials);
+	for (size_t i = 0; i < Meshes.size(); ++i)
+	{
+		Meshes[i]->SetMaterialTable(MaterialTable);
+	}
+
+	// rebuild the nodes the same way LoadNode links them
+	Scene* MyScene = new Scene();
+	MyScene->SetMaterialTable(MaterialTable);
+	std::vector<SceneNode*> SceneNodes(Nodes.size());
+	for (size_t i = 0; i < Nodes.size(); ++i)
+	{
+		const FMeshCacheNode& CacheNode = Nodes[i];
+		SceneNode* Node = CacheNode.Mesh >= 0 ? new MeshNode(Meshes[CacheNode.Mesh]) : new SceneNode();
+		Node->Parent = CacheNode.Parent >= 0 ? SceneNodes[CacheNode.Parent] : nullptr;
+		Node->Name = CacheNode.Name;
+		Node->Scale = CacheNode.Scale;
+		Node->Translation = CacheNode.Translation;
+		Node->Rotation = FQuaternion(CacheNode.Rotation);
+		SceneNodes[i] = Node;
+		if (Node->Parent == nullptr)
+		{
+			MyScene->AddNode(Node);
+		}
+		else
+		{
+			Node->Parent->AddChild(Node);
+		}
+	}
+
+	MyScene->PostLoad();
+
+	return MyScene;
+}
+
+void FGLTFLoader::SaveToCache(const std::string& FilePath, uint64_t CacheKey, const std::vector<SceneNode*>& LoadedNodes, const FMaterialTable& Materials)
+{
+	if (CacheKey == 0)
+		return;
+
+	std::map<const SceneNode*, int32_t> NodeIndices;
+	std::vector<const MeshData*> Meshes;
+	std::vector<FMeshCacheNode> Nodes(LoadedNodes.size());
+	for (size_t i = 0; i < LoadedNodes.size(); ++i)
+	{
+		SceneNode* Node = LoadedNodes[i];
+		NodeIndices[Node] = (int32_t)i;
+
+		FMeshCacheNode& CacheNode = Nodes[i];
+		CacheNode.Name = Node->Name;
+		CacheNode.Parent = Node->Parent ? NodeIndices[Node->Parent] : -1;
+		CacheNode.Scale = Node->Scale;
+		CacheNode.Translation = Node->Translation;
+		CacheNode.Rotation = Node->Rotation.q;
+		if (Node->IsMeshNode())
+		{
+			CacheNode.Mesh = (int32_t)Meshes.size();
+			Meshes.push_back(Node->GetFirstMeshData());
+		}
+	}
+
+	if (!FMeshCache::Save(FilePath, CacheKey, Meshes, Nodes, Materials.GetMaterials()))
+	{
+		std::cout << "Warning: failed to write mesh cache for " << FilePath << std::endl;
+	}
+}
@@ -125,9 +125,25 @@ D3D12_CPU_DESCRIPTOR_HANDLE FConstBuffer::CreateConstantBufferView(uint32_t Offs
 
 	D3D12_CPU_DESCRIPTOR_HANDLE hCBV = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 	D3D12RHI::Get().GetD3D12Device()->CreateConstantBufferView(&CBVDesc, hCBV);
+	m_ConstantBufferViews.push_back(hCBV);
 	return hCBV;
 }
 
+void FConstBuffer::Destroy()
+{
+	FreeConstantBufferViews();
+	FGpuBuffer::Destroy();
+}
+
+void FConstBuffer::FreeConstantBufferViews()
+{
+	for (D3D12_CPU_DESCRIPTOR_HANDLE Handle : m_ConstantBufferViews)
+	{
+		D3D12RHI::Get().FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Handle);
+	}
+	m_ConstantBufferViews.clear();
+}
+
 void* FConstBuffer::Map()
 {
 	if (m_MappedData == nullptr)
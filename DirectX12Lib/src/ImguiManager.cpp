@@ -120,6 +120,7 @@ void ImguiManager::Destroy()
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext(m_pImGuiCtx);
 	m_pImGuiCtx = nullptr;
+	m_FontTexture.Destroy();
 }
 
 void ImguiManager::NewFrame()
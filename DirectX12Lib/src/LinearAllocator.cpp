@@ -4,6 +4,8 @@
 #include "CommandQueue.h"
 #include "CommandListManager.h"
 
+#include <chrono>
+
 extern FCommandListManager g_CommandListManager;
 
 ELinearAllocatorType LinearAllocationPagePageManager::ms_TypeCounter = GpuExclusive;
@@ -43,13 +45,21 @@ void LinearAllocationPage::Unmap()
 	}
 }
 
-LinearAllocator::LinearAllocator(ELinearAllocatorType Type)
+LinearAllocator::LinearAllocator(ELinearAllocatorType Type, size_t RingSize /*= 0*/)
 	: m_AllocatorType(Type)
 	, m_CurrentPage(nullptr)
 	, m_CurrentOffset(0)
+	, m_RingSize(RingSize)
+	, m_RingPage(nullptr)
 {
 	Assert(Type > ELinearAllocatorType::InvalidAllocator && Type < ELinearAllocatorType::NumAllocatorTypes);
 	m_PageSize = (Type == ELinearAllocatorType::GpuExclusive ? GpuAllocatorPageSize : CpuAllocatorPageSize);
+	Assert(RingSize == 0 || RingSize >= m_PageSize);
+}
+
+LinearAllocator::~LinearAllocator()
+{
+	delete m_RingPage;
 }
 
 FAllocation LinearAllocator::Allocate(size_t SizeInBytes, size_t Alignment /*= DEFAULT_ALIGN*/)
@@ -61,6 +71,10 @@ FAllocation LinearAllocator::Allocate(size_t SizeInBytes, size_t Alignment /*= D
 	if (AlignedSize > m_PageSize)
 		return AllocateLargePage(AlignedSize);
 
+	FAllocation allocation;
+	if (m_RingSize > 0 && AllocateFromRing(AlignedSize, Alignment, allocation))
+		return allocation;
+
 	m_CurrentOffset = AlignUp(m_CurrentOffset, Alignment);
 	if (m_CurrentOffset + AlignedSize > m_PageSize)
 	{
@@ -78,7 +92,6 @@ FAllocation LinearAllocator::Allocate(size_t SizeInBytes, size_t Alignment /*= D
 	}
 
 	Assert (m_CurrentPage != nullptr);
-	FAllocation allocation;
 	allocation.D3d12Resource = m_CurrentPage->GetResource();
 	allocation.Offset = m_CurrentOffset;
 	allocation.CPU = (uint8_t*)m_CurrentPage->m_CpuAddress + m_CurrentOffset;
@@ -87,8 +100,39 @@ FAllocation LinearAllocator::Allocate(size_t SizeInBytes, size_t Alignment /*= D
 	return allocation;
 }
 
+bool LinearAllocator::AllocateFromRing(size_t SizeInBytes, size_t Alignment, FAllocation& Allocation)
+{
+	if (m_RingPage == nullptr)
+	{
+		m_RingPage = ms_PageManager[m_AllocatorType].CreateNewPage(m_RingSize);
+		m_Ring.Reset(m_RingSize);
+	}
+
+	uint64_t Offset = m_Ring.Allocate(SizeInBytes, Alignment);
+	if (Offset == FUploadRing::INVALID_OFFSET)
+	{
+		// reclaim what the GPU is done with, without waiting for the rest
+		m_Ring.RetireCompleted([](uint64_t Fence) { return g_CommandListManager.IsFenceComplete(Fence); });
+		Offset = m_Ring.Allocate(SizeInBytes, Alignment);
+		if (Offset == FUploadRing::INVALID_OFFSET)
+			return false;
+	}
+
+	Allocation.D3d12Resource = m_RingPage->GetResource();
+	Allocation.Offset = (size_t)Offset;
+	Allocation.CPU = (uint8_t*)m_RingPage->m_CpuAddress + Offset;
+	Allocation.GpuAddress = m_RingPage->GpuAddress + Offset;
+	return true;
+}
+
 void LinearAllocator::CleanupUsedPages(uint64_t FenceID)
 {
+	// a context only ever submits to the queue of its type, the fences of the ring batches grow
+	if (m_RingPage != nullptr && !m_Ring.IsOpenBatchEmpty())
+	{
+		m_Ring.SubmitBatch(FenceID);
+	}
+
 	if (m_CurrentPage != nullptr)
 	{
 		m_StandardPages.push_back(m_CurrentPage);
@@ -113,9 +157,15 @@ void LinearAllocator::DestroyAll()
 	ms_PageManager[1].Destroy();
 }
 
+void LinearAllocator::TrimAll()
+{
+	ms_PageManager[0].TrimLargePages();
+	ms_PageManager[1].TrimLargePages();
+}
+
 FAllocation LinearAllocator::AllocateLargePage(size_t SizeInBytes)
 {
-	LinearAllocationPage* Page = ms_PageManager[m_AllocatorType].CreateNewPage(SizeInBytes);
+	LinearAllocationPage* Page = ms_PageManager[m_AllocatorType].RequestLargePage(SizeInBytes);
 	m_LargePages.push_back(Page);
 
 	FAllocation allocation;
@@ -126,7 +176,18 @@ FAllocation LinearAllocator::AllocateLargePage(size_t SizeInBytes)
 	return allocation;
 }
 
+static bool IsFenceComplete(uint64_t FenceValue)
+{
+	return g_CommandListManager.IsFenceComplete(FenceValue);
+}
+
+static uint64_t GetTimeMs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 LinearAllocationPagePageManager::LinearAllocationPagePageManager()
+	: m_LargePagePool(LargePageBudget, LargePageMaxIdleMs)
 {
 	m_AllocatorType = ms_TypeCounter;
 	ms_TypeCounter = (ELinearAllocatorType)(ms_TypeCounter + 1);
@@ -135,16 +196,13 @@ LinearAllocationPagePageManager::LinearAllocationPagePageManager()
 
 LinearAllocationPage* LinearAllocationPagePageManager::RequestPage()
 {
-	LinearAllocationPage* Page = nullptr;
-	if (!m_RetiredPages.empty() && g_CommandListManager.IsFenceComplete(m_RetiredPages.front()->GetFenceValue()))
-	{
-		Page = m_RetiredPages.front();
-		m_RetiredPages.pop();
-	}
-	else
+	LinearAllocationPage* Page = m_RetiredPages.Request(IsFenceComplete);
+	if (Page == nullptr)
 	{
+		// created outside the lock, the device is free threaded
 		Page = CreateNewPage();
-		m_StandardPagePool.push(Page);
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_StandardPagePool.push_back(Page);
 	}
 	return Page;
 }
@@ -154,24 +212,49 @@ void LinearAllocationPagePageManager::DiscardStandardPages(uint64_t FenceID, con
 	for (auto Iter = Pages.begin(); Iter != Pages.end(); ++Iter)
 	{
 		(*Iter)->SetFenceValue(FenceID);
-		m_RetiredPages.push(*Iter);
+	}
+	if (!Pages.empty())
+	{
+		m_RetiredPages.Discard(FenceID, Pages.data(), Pages.size());
 	}
 }
 
-void LinearAllocationPagePageManager::DiscardLargePages(uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages)
+LinearAllocationPage* LinearAllocationPagePageManager::RequestLargePage(size_t SizeInBytes)
 {
-	while (!m_LargePagePool.empty() && g_CommandListManager.IsFenceComplete(m_LargePagePool.front()->GetFenceValue()))
+	LinearAllocationPage* Page = m_LargePagePool.Request(SizeInBytes, IsFenceComplete);
+	if (Page == nullptr)
 	{
-		delete m_LargePagePool.front();
-		m_LargePagePool.pop();
+		Page = CreateNewPage((size_t)FLargePagePool<LinearAllocationPage>::GetBucketSize(SizeInBytes));
 	}
+	return Page;
+}
+
+void LinearAllocationPagePageManager::DiscardLargePages(uint64_t FenceID, const std::vector<LinearAllocationPage*>& Pages)
+{
+	const uint64_t Now = GetTimeMs();
 	for (auto Iter = Pages.begin(); Iter != Pages.end(); ++Iter)
 	{
 		(*Iter)->SetFenceValue(FenceID);
-		m_LargePagePool.push(*Iter);
+		m_LargePagePool.Discard(FenceID, *Iter, (*Iter)->GetPageSize(), Now);
+	}
+	TrimLargePages();
+}
+
+void LinearAllocationPagePageManager::TrimLargePages()
+{
+	std::vector<LinearAllocationPage*> Freed;
+	m_LargePagePool.Trim(GetTimeMs(), IsFenceComplete, Freed);
+	for (LinearAllocationPage* Page : Freed)
+	{
+		delete Page;
 	}
 }
 
+void LinearAllocationPagePageManager::SetLargePageBudget(uint64_t BudgetBytes, uint64_t MaxIdleMs)
+{
+	m_LargePagePool.SetBudget(BudgetBytes, MaxIdleMs);
+}
+
 LinearAllocationPage* LinearAllocationPagePageManager::CreateNewPage(size_t PageSize)
 {
 	D3D12_HEAP_PROPERTIES HeapProps;
@@ -225,15 +308,19 @@ LinearAllocationPage* LinearAllocationPagePageManager::CreateNewPage(size_t Page
 
 void LinearAllocationPagePageManager::Destroy()
 {
-	while (!m_LargePagePool.empty())
+	std::vector<LinearAllocationPage*> LargePages;
+	m_LargePagePool.Reset(LargePages);
+	for (LinearAllocationPage* Page : LargePages)
 	{
-		delete m_LargePagePool.front();
-		m_LargePagePool.pop();
+		delete Page;
 	}
-	while (!m_StandardPagePool.empty())
+
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_RetiredPages.Reset();
+	for (LinearAllocationPage* Page : m_StandardPagePool)
 	{
-		delete m_StandardPagePool.front();
-		m_StandardPagePool.pop();
+		delete Page;
 	}
+	m_StandardPagePool.clear();
 }
 
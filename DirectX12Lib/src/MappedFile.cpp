@@ -0,0 +1,70 @@
+#include "MappedFile.h"
+#include <Windows.h>
+
+
+FMappedFile::FMappedFile()
+	: m_File(nullptr)
+	, m_Mapping(nullptr)
+	, m_Data(nullptr)
+	, m_Size(0)
+{
+}
+
+FMappedFile::~FMappedFile()
+{
+	Close();
+}
+
+bool FMappedFile::Open(const std::string& FilePath)
+{
+	Close();
+
+	HANDLE File = ::CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER FileSize;
+	if (!::GetFileSizeEx(File, &FileSize))
+	{
+		::CloseHandle(File);
+		return false;
+	}
+	m_File = File;
+	m_Size = (size_t)FileSize.QuadPart;
+
+	// an empty file can't be mapped, keep it open with no data
+	if (m_Size == 0)
+		return true;
+
+	m_Mapping = ::CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_Mapping)
+	{
+		m_Data = (const char*)::MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (m_Data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (m_Data)
+	{
+		::UnmapViewOfFile(m_Data);
+		m_Data = nullptr;
+	}
+	if (m_Mapping)
+	{
+		::CloseHandle(m_Mapping);
+		m_Mapping = nullptr;
+	}
+	if (m_File)
+	{
+		::CloseHandle(m_File);
+		m_File = nullptr;
+	}
+	m_Size = 0;
+}
@@ -42,17 +42,18 @@ Vector4f FMatrix::Column(int i) const
 
 FMatrix FMatrix::operator*(const FMatrix& rhs) const
 {
-	Vector4f c0 = rhs.Column(0);
-	Vector4f c1 = rhs.Column(1);
-	Vector4f c2 = rhs.Column(2);
-	Vector4f c3 = rhs.Column(3);
-
-	return FMatrix(
-		r0.Dot(c0), r0.Dot(c1), r0.Dot(c2), r0.Dot(c3),
-		r1.Dot(c0), r1.Dot(c1), r1.Dot(c2), r1.Dot(c3),
-		r2.Dot(c0), r2.Dot(c1), r2.Dot(c2), r2.Dot(c3),
-		r3.Dot(c0), r3.Dot(c1), r3.Dot(c2), r3.Dot(c3)
-	);
+	// every row of the result is the row of this times rhs, the sums run in the order of r.Dot(rhs.Column(j))
+	FSimdFloat4 R0 = FSimd::Load(&rhs[0].x);
+	FSimdFloat4 R1 = FSimd::Load(&rhs[1].x);
+	FSimdFloat4 R2 = FSimd::Load(&rhs[2].x);
+	FSimdFloat4 R3 = FSimd::Load(&rhs[3].x);
+
+	FMatrix Result;
+	for (int i = 0; i < 4; ++i)
+	{
+		FSimd::Store(&Result[i].x, FSimd::Transform(FSimd::Load(&(*this)[i].x), R0, R1, R2, R3));
+	}
+	return Result;
 }
 
 FMatrix& FMatrix::operator*=(const FMatrix& rhs)
@@ -86,69 +87,243 @@ Vector3f FMatrix::TransformPosition(const Vector3f& position) const
 
 FBoundingBox FMatrix::TransformBoundingBox(const FBoundingBox& BoundBox) const
 {
-	Vector3f BoundMin = TransformPosition(BoundBox.BoundMin);
-	Vector3f BoundMax = TransformPosition(BoundBox.BoundMax);
-
-	FBoundingBox Result;
-	Result.BoundMin = Min(BoundMin, BoundMax);
-	Result.BoundMax = Max(BoundMin, BoundMax);
-	return Result;
+	return TransformBoundingBox(BoundBox.BoundMin, BoundBox.BoundMax);
 }
 
 FBoundingBox FMatrix::TransformBoundingBox(const Vector3f& BoundMin, const Vector3f& BoundMax) const
 {
-	Vector3f BMin = TransformPosition(BoundMin);
-	Vector3f BMax = TransformPosition(BoundMax);
+	// Arvo: each output axis is the translation plus, per input axis, the smaller and the larger of
+	// Min * m and Max * m, which is exactly the min and max over the 8 corners
+	FSimdFloat4 NewMin = FSimd::Load(&r3.x);
+	FSimdFloat4 NewMax = NewMin;
+	for (int i = 0; i < 3; ++i)
+	{
+		FSimdFloat4 Row = FSimd::Load(&(*this)[i].x);
+		FSimdFloat4 A = FSimd::Mul(FSimd::Splat(BoundMin[i]), Row);
+		FSimdFloat4 B = FSimd::Mul(FSimd::Splat(BoundMax[i]), Row);
+		NewMin = FSimd::Add(NewMin, FSimd::Min(A, B));
+		NewMax = FSimd::Add(NewMax, FSimd::Max(A, B));
+	}
+
+	float ResultMin[4], ResultMax[4];
+	FSimd::Store(ResultMin, NewMin);
+	FSimd::Store(ResultMax, NewMax);
+	return FBoundingBox(Vector3f(ResultMin[0], ResultMin[1], ResultMin[2]), Vector3f(ResultMax[0], ResultMax[1], ResultMax[2]));
+}
 
-	FBoundingBox Result;
-	Result.BoundMin = Min(BMin, BMax);
-	Result.BoundMax = Max(BMin, BMax);
-	return Result;
+namespace
+{
+	// 4 boxes, In and Out point at MinX, MinY, MinZ, MaxX, MaxY, MaxZ, the same steps as TransformBoundingBox per lane
+	__forceinline void TransformBoundingBoxes4(const FMatrix& M, const float* const In[6], float* const Out[6], size_t i)
+	{
+		FSimdFloat4 InMin[3] = { FSimd::Load(In[0] + i), FSimd::Load(In[1] + i), FSimd::Load(In[2] + i) };
+		FSimdFloat4 InMax[3] = { FSimd::Load(In[3] + i), FSimd::Load(In[4] + i), FSimd::Load(In[5] + i) };
+		for (int c = 0; c < 3; ++c)
+		{
+			FSimdFloat4 NewMin = FSimd::Splat(M.r3[c]);
+			FSimdFloat4 NewMax = NewMin;
+			for (int r = 0; r < 3; ++r)
+			{
+				FSimdFloat4 Scale = FSimd::Splat(M[r][c]);
+				FSimdFloat4 A = FSimd::Mul(InMin[r], Scale);
+				FSimdFloat4 B = FSimd::Mul(InMax[r], Scale);
+				NewMin = FSimd::Add(NewMin, FSimd::Min(A, B));
+				NewMax = FSimd::Add(NewMax, FSimd::Max(A, B));
+			}
+			FSimd::Store(Out[c] + i, NewMin);
+			FSimd::Store(Out[c + 3] + i, NewMax);
+		}
+	}
 }
 
-FMatrix FMatrix::Transpose() const
+void FMatrix::TransformBoundingBoxes(const FBoundingBoxSoA& In, FBoundingBoxSoA& Out) const
 {
-	return FMatrix(
-		r0.x, r1.x, r2.x, r3.x,
-		r0.y, r1.y, r2.y, r3.y,
-		r0.z, r1.z, r2.z, r3.z,
-		r0.w, r1.w, r2.w, r3.w
-	);
+	const size_t Count = In.Size();
+	Out.Resize(Count);
+
+	const float* const Src[6] = { In.MinX.data(), In.MinY.data(), In.MinZ.data(), In.MaxX.data(), In.MaxY.data(), In.MaxZ.data() };
+	float* const Dst[6] = { Out.MinX.data(), Out.MinY.data(), Out.MinZ.data(), Out.MaxX.data(), Out.MaxY.data(), Out.MaxZ.data() };
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+		TransformBoundingBoxes4(*this, Src, Dst, i);
+
+	// the last 1 to 3 boxes go through zero padded copies
+	if (i < Count)
+	{
+		float Padded[6][4] = {};
+		float Result[6][4];
+		const float* const PaddedSrc[6] = { Padded[0], Padded[1], Padded[2], Padded[3], Padded[4], Padded[5] };
+		float* const ResultDst[6] = { Result[0], Result[1], Result[2], Result[3], Result[4], Result[5] };
+		for (int c = 0; c < 6; ++c)
+			for (size_t l = 0; i + l < Count; ++l)
+				Padded[c][l] = Src[c][i + l];
+		TransformBoundingBoxes4(*this, PaddedSrc, ResultDst, 0);
+		for (int c = 0; c < 6; ++c)
+			for (size_t l = 0; i + l < Count; ++l)
+				Dst[c][i + l] = Result[c][l];
+	}
 }
 
-FMatrix FMatrix::Inverse() const
+void FMatrix::TransformBoundingBoxes(const FMatrix* Matrices, const FBoundingBox* In, FBoundingBox* Out, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+		Out[i] = Matrices[i].TransformBoundingBox(In[i].BoundMin, In[i].BoundMax);
+}
+
+float FMatrix::GetMaxScale() const
+{
+	return (std::max)((std::max)(Vector3f(r0).Length(), Vector3f(r1).Length()), Vector3f(r2).Length());
+}
+
+Vector4f FMatrix::TransformSphere(const Vector4f& Sphere) const
 {
-	// https://semath.info/src/inverse-cofactor-ex4.html
-	float det =  r0.x*r1.y*r2.z*r3.w + r0.x*r1.z*r2.w*r3.y + r0.x*r1.w*r2.y*r3.z
-				-r0.x*r1.w*r2.z*r3.y - r0.x*r1.z*r2.y*r3.w - r0.x*r1.y*r2.w*r3.z
-				-r0.y*r1.x*r2.z*r3.w - r0.z*r1.x*r2.w*r3.y - r0.w*r1.x*r2.y*r3.z
-				+r0.w*r1.x*r2.z*r3.y + r0.z*r1.x*r2.y*r3.w + r0.y*r1.x*r2.w*r3.z
-				+r0.y*r1.z*r2.x*r3.w + r0.z*r1.w*r2.x*r3.y + r0.w*r1.y*r2.x*r3.z
-				-r0.w*r1.z*r2.x*r3.y - r0.z*r1.y*r2.x*r3.w - r0.y*r1.w*r2.x*r3.z
-				-r0.y*r1.z*r2.w*r3.x - r0.z*r1.w*r2.y*r3.x - r0.w*r1.y*r2.z*r3.x
-				+r0.w*r1.z*r2.y*r3.x + r0.z*r1.y*r2.w*r3.x + r0.y*r1.w*r2.z*r3.x;
+	return Vector4f(TransformPosition(Vector3f(Sphere)), Sphere.w * GetMaxScale());
+}
 
-	float A11 =  r1.y*r2.z*r3.w + r1.z*r2.w*r3.y + r1.w*r2.y*r3.z - r1.w*r2.z*r3.y - r1.z*r2.y*r3.w - r1.y*r2.w*r3.z;
-	float A12 = -r0.y*r2.z*r3.w - r0.z*r2.w*r3.y - r0.w*r2.y*r3.z + r0.w*r2.z*r3.y + r0.z*r2.y*r3.w + r0.y*r2.w*r3.z;
-	float A13 =  r0.y*r1.z*r3.w + r0.z*r1.w*r3.y + r0.w*r1.y*r3.z - r0.w*r1.z*r3.y - r0.z*r1.y*r3.w - r0.y*r1.w*r3.z;
-	float A14 = -r0.y*r1.z*r2.w - r0.z*r1.w*r2.y - r0.w*r1.y*r2.z + r0.w*r1.z*r2.y + r0.z*r1.y*r2.w + r0.y*r1.w*r2.z;
+FMatrix FMatrix::Transpose() const
+{
+	FSimdFloat4 R0 = FSimd::Load(&r0.x);
+	FSimdFloat4 R1 = FSimd::Load(&r1.x);
+	FSimdFloat4 R2 = FSimd::Load(&r2.x);
+	FSimdFloat4 R3 = FSimd::Load(&r3.x);
+	FSimd::Transpose(R0, R1, R2, R3);
+
+	FMatrix Result;
+	FSimd::Store(&Result[0].x, R0);
+	FSimd::Store(&Result[1].x, R1);
+	FSimd::Store(&Result[2].x, R2);
+	FSimd::Store(&Result[3].x, R3);
+	return Result;
+}
 
-	float A21 = -r1.x*r2.z*r3.w - r1.z*r2.w*r3.x - r1.w*r2.x*r3.z + r1.w*r2.z*r3.x + r1.z*r2.x*r3.w + r1.x*r2.w*r3.z;
-	float A22 =  r0.x*r2.z*r3.w + r0.z*r2.w*r3.x + r0.w*r2.x*r3.z - r0.w*r2.z*r3.x - r0.z*r2.x*r3.w - r0.x*r2.w*r3.z;
-	float A23 = -r0.x*r1.z*r3.w - r0.z*r1.w*r3.x - r0.w*r1.x*r3.z + r0.w*r1.z*r3.x + r0.z*r1.x*r3.w + r0.x*r1.w*r3.z;
-	float A24 =  r0.x*r1.z*r2.w + r0.z*r1.w*r2.x + r0.w*r1.x*r2.z - r0.w*r1.z*r2.x - r0.z*r1.x*r2.w - r0.x*r1.w*r2.z;
+namespace
+{
+	// 2x2 matrices in one register, (m00, m01, m10, m11)
+	FSimdFloat4 Mat2Mul(FSimdFloat4 a, FSimdFloat4 b)
+	{
+		return FSimd::Add(FSimd::Mul(a, FSimd::Swizzle<0, 3, 0, 3>(b)), FSimd::Mul(FSimd::Swizzle<1, 0, 3, 2>(a), FSimd::Swizzle<2, 1, 2, 1>(b)));
+	}
+
+	// adjugate(a) * b
+	FSimdFloat4 Mat2AdjMul(FSimdFloat4 a, FSimdFloat4 b)
+	{
+		return FSimd::Sub(FSimd::Mul(FSimd::Swizzle<3, 3, 0, 0>(a), b), FSimd::Mul(FSimd::Swizzle<1, 1, 2, 2>(a), FSimd::Swizzle<2, 3, 0, 1>(b)));
+	}
+
+	// a * adjugate(b)
+	FSimdFloat4 Mat2MulAdj(FSimdFloat4 a, FSimdFloat4 b)
+	{
+		return FSimd::Sub(FSimd::Mul(a, FSimd::Swizzle<3, 0, 3, 0>(b)), FSimd::Mul(FSimd::Swizzle<1, 0, 3, 2>(a), FSimd::Swizzle<2, 1, 2, 1>(b)));
+	}
+
+	FSimdFloat4 Cross3(FSimdFloat4 a, FSimdFloat4 b)
+	{
+		return FSimd::Sub(
+			FSimd::Mul(FSimd::Swizzle<1, 2, 0, 3>(a), FSimd::Swizzle<2, 0, 1, 3>(b)),
+			FSimd::Mul(FSimd::Swizzle<2, 0, 1, 3>(a), FSimd::Swizzle<1, 2, 0, 3>(b)));
+	}
+
+	FSimdFloat4 Dot3(FSimdFloat4 a, FSimdFloat4 b)
+	{
+		FSimdFloat4 Product = FSimd::Mul(a, b);
+		return FSimd::Add(FSimd::Add(FSimd::SplatLane<0>(Product), FSimd::SplatLane<1>(Product)), FSimd::SplatLane<2>(Product));
+	}
+
+	FMatrix StoreMatrix(FSimdFloat4 R0, FSimdFloat4 R1, FSimdFloat4 R2, FSimdFloat4 R3)
+	{
+		FMatrix Result;
+		FSimd::Store(&Result[0].x, R0);
+		FSimd::Store(&Result[1].x, R1);
+		FSimd::Store(&Result[2].x, R2);
+		FSimd::Store(&Result[3].x, R3);
+		return Result;
+	}
+}
 
-	float A31 =  r1.x*r2.y*r3.w + r1.y*r2.w*r3.x + r1.w*r2.x*r3.y - r1.w*r2.y*r3.x - r1.y*r2.x*r3.w - r1.x*r2.w*r3.y;
-	float A32 = -r0.x*r2.y*r3.w - r0.y*r2.w*r3.x - r0.w*r2.x*r3.y + r0.w*r2.y*r3.x + r0.y*r2.x*r3.w + r0.x*r2.w*r3.y;
-	float A33 =  r0.x*r1.y*r3.w + r0.y*r1.w*r3.x + r0.w*r1.x*r3.y - r0.w*r1.y*r3.x - r0.y*r1.x*r3.w - r0.x*r1.w*r3.y;
-	float A34 = -r0.x*r1.y*r2.w - r0.y*r1.w*r2.x - r0.w*r1.x*r2.y + r0.w*r1.y*r2.x + r0.y*r1.x*r2.w + r0.x*r1.w*r2.y;
+FMatrix FMatrix::Inverse() const
+{
+	// blockwise inversion over the 2x2 sub matrices [A B; C D], the cofactors come from 2x2 products
+	FSimdFloat4 R0 = FSimd::Load(&r0.x);
+	FSimdFloat4 R1 = FSimd::Load(&r1.x);
+	FSimdFloat4 R2 = FSimd::Load(&r2.x);
+	FSimdFloat4 R3 = FSimd::Load(&r3.x);
+
+	FSimdFloat4 A = FSimd::Shuffle<0, 1, 0, 1>(R0, R1);
+	FSimdFloat4 B = FSimd::Shuffle<2, 3, 2, 3>(R0, R1);
+	FSimdFloat4 C = FSimd::Shuffle<0, 1, 0, 1>(R2, R3);
+	FSimdFloat4 D = FSimd::Shuffle<2, 3, 2, 3>(R2, R3);
+
+	// |A|, |B|, |C|, |D|
+	FSimdFloat4 DetSub = FSimd::Sub(
+		FSimd::Mul(FSimd::Shuffle<0, 2, 0, 2>(R0, R2), FSimd::Shuffle<1, 3, 1, 3>(R1, R3)),
+		FSimd::Mul(FSimd::Shuffle<1, 3, 1, 3>(R0, R2), FSimd::Shuffle<0, 2, 0, 2>(R1, R3)));
+	FSimdFloat4 DetA = FSimd::SplatLane<0>(DetSub);
+	FSimdFloat4 DetB = FSimd::SplatLane<1>(DetSub);
+	FSimdFloat4 DetC = FSimd::SplatLane<2>(DetSub);
+	FSimdFloat4 DetD = FSimd::SplatLane<3>(DetSub);
+
+	FSimdFloat4 DC = Mat2AdjMul(D, C);
+	FSimdFloat4 AB = Mat2AdjMul(A, B);
+	FSimdFloat4 X = FSimd::Sub(FSimd::Mul(DetD, A), Mat2Mul(B, DC));
+	FSimdFloat4 W = FSimd::Sub(FSimd::Mul(DetA, D), Mat2Mul(C, AB));
+	FSimdFloat4 Y = FSimd::Sub(FSimd::Mul(DetB, C), Mat2MulAdj(D, AB));
+	FSimdFloat4 Z = FSimd::Sub(FSimd::Mul(DetC, B), Mat2MulAdj(A, DC));
+
+	// |M| = |A||D| + |B||C| - tr(adj(A) B adj(D) C)
+	FSimdFloat4 Trace = FSimd::Mul(AB, FSimd::Swizzle<0, 2, 1, 3>(DC));
+	Trace = FSimd::Add(Trace, FSimd::Swizzle<2, 3, 0, 1>(Trace));
+	Trace = FSimd::Add(Trace, FSimd::Swizzle<1, 0, 3, 2>(Trace));
+	FSimdFloat4 Det = FSimd::Sub(FSimd::Add(FSimd::Mul(DetA, DetD), FSimd::Mul(DetB, DetC)), Trace);
+
+	FSimdFloat4 InvDet = FSimd::Div(FSimd::Set(1.f, -1.f, -1.f, 1.f), Det);
+	X = FSimd::Mul(X, InvDet);
+	Y = FSimd::Mul(Y, InvDet);
+	Z = FSimd::Mul(Z, InvDet);
+	W = FSimd::Mul(W, InvDet);
+
+	return StoreMatrix(
+		FSimd::Shuffle<3, 1, 3, 1>(X, Y),
+		FSimd::Shuffle<2, 0, 2, 0>(X, Y),
+		FSimd::Shuffle<3, 1, 3, 1>(Z, W),
+		FSimd::Shuffle<2, 0, 2, 0>(Z, W));
+}
 
-	float A41 = -r1.x*r2.y*r3.z - r1.y*r2.z*r3.x - r1.z*r2.x*r3.y + r1.z*r2.y*r3.x + r1.y*r2.x*r3.z + r1.x*r2.z*r3.y;
-	float A42 =  r0.x*r2.y*r3.z + r0.y*r2.z*r3.x + r0.z*r2.x*r3.y - r0.z*r2.y*r3.x - r0.y*r2.x*r3.z - r0.x*r2.z*r3.y;
-	float A43 = -r0.x*r1.y*r3.z - r0.y*r1.z*r3.x - r0.z*r1.x*r3.y + r0.z*r1.y*r3.x + r0.y*r1.x*r3.z + r0.x*r1.z*r3.y;
-	float A44 =  r0.x*r1.y*r2.z + r0.y*r1.z*r2.x + r0.z*r1.x*r2.y - r0.z*r1.y*r2.x - r0.y*r1.x*r2.z - r0.x*r1.z*r2.y;
+FMatrix FMatrix::InverseAffine() const
+{
+	// with rows a, b, c the inverse of the 3x3 part has the columns b x c, c x a, a x b over the determinant
+	FSimdFloat4 R0 = FSimd::Load(&r0.x);
+	FSimdFloat4 R1 = FSimd::Load(&r1.x);
+	FSimdFloat4 R2 = FSimd::Load(&r2.x);
+	FSimdFloat4 R3 = FSimd::Load(&r3.x);
+
+	FSimdFloat4 C0 = Cross3(R1, R2);
+	FSimdFloat4 C1 = Cross3(R2, R0);
+	FSimdFloat4 C2 = Cross3(R0, R1);
+	FSimdFloat4 InvDet = FSimd::Div(FSimd::Splat(1.f), Dot3(R0, C0));
+	C0 = FSimd::Mul(C0, InvDet);
+	C1 = FSimd::Mul(C1, InvDet);
+	C2 = FSimd::Mul(C2, InvDet);
+	FSimdFloat4 C3 = FSimd::Set(0.f, 0.f, 0.f, 1.f);
+	FSimd::Transpose(C0, C1, C2, C3);
+
+	// the fourth lanes of C0..C2 are 0 after the transpose
+	FSimdFloat4 T = FSimd::Add(FSimd::Add(FSimd::Mul(FSimd::SplatLane<0>(R3), C0), FSimd::Mul(FSimd::SplatLane<1>(R3), C1)), FSimd::Mul(FSimd::SplatLane<2>(R3), C2));
+	T = FSimd::Sub(FSimd::Set(0.f, 0.f, 0.f, 1.f), T);
+	return StoreMatrix(C0, C1, C2, T);
+}
 
-	return FMatrix(A11, A12, A13, A14, A21, A22, A23, A24, A31, A32, A33, A34, A41, A42, A43, A44) * (1.f / det);
+FMatrix FMatrix::InverseRigid() const
+{
+	FSimdFloat4 R0 = FSimd::Mul(FSimd::Load(&r0.x), FSimd::Set(1.f, 1.f, 1.f, 0.f));
+	FSimdFloat4 R1 = FSimd::Mul(FSimd::Load(&r1.x), FSimd::Set(1.f, 1.f, 1.f, 0.f));
+	FSimdFloat4 R2 = FSimd::Mul(FSimd::Load(&r2.x), FSimd::Set(1.f, 1.f, 1.f, 0.f));
+	FSimdFloat4 R3 = FSimd::Load(&r3.x);
+	FSimdFloat4 Zero = FSimd::Splat(0.f);
+	FSimd::Transpose(R0, R1, R2, Zero);
+
+	FSimdFloat4 T = FSimd::Add(FSimd::Add(FSimd::Mul(FSimd::SplatLane<0>(R3), R0), FSimd::Mul(FSimd::SplatLane<1>(R3), R1)), FSimd::Mul(FSimd::SplatLane<2>(R3), R2));
+	T = FSimd::Sub(FSimd::Set(0.f, 0.f, 0.f, 1.f), T);
+	return StoreMatrix(R0, R1, R2, T);
 }
 
 FMatrix FMatrix::TranslateMatrix(const Vector3f& T)
@@ -262,17 +437,201 @@ FMatrix FMatrix::MatrixOrthoLH(float Width, float Height, float NearZ, float Far
 //	return Vector4f();
 //}
 
-Vector4f operator*(const Vector4f& vec, const FMatrix& mat)
-{
-	float d0 = vec.Dot(mat.Column(0));
-	float d1 = vec.Dot(mat.Column(1));
-	float d2 = vec.Dot(mat.Column(2));
-	float d3 = vec.Dot(mat.Column(3));
-	return Vector4f(d0, d1, d2, d3);
-}
-
 void FBoundingBox::Include(const FBoundingBox& Other)
 {
 	BoundMin = Min(BoundMin, Other.BoundMin);
 	BoundMax = Max(BoundMax, Other.BoundMax);
 }
+
+void FBoundingBoxSoA::Resize(size_t Count)
+{
+	MinX.resize(Count);
+	MinY.resize(Count);
+	MinZ.resize(Count);
+	MaxX.resize(Count);
+	MaxY.resize(Count);
+	MaxZ.resize(Count);
+}
+
+void FBoundingBoxSoA::Set(size_t Index, const FBoundingBox& Box)
+{
+	MinX[Index] = Box.BoundMin.x;
+	MinY[Index] = Box.BoundMin.y;
+	MinZ[Index] = Box.BoundMin.z;
+	MaxX[Index] = Box.BoundMax.x;
+	MaxY[Index] = Box.BoundMax.y;
+	MaxZ[Index] = Box.BoundMax.z;
+}
+
+FBoundingBox FBoundingBoxSoA::Get(size_t Index) const
+{
+	return FBoundingBox(Vector3f(MinX[Index], MinY[Index], MinZ[Index]), Vector3f(MaxX[Index], MaxY[Index], MaxZ[Index]));
+}
+
+FOrientedBox::FOrientedBox(const FBoundingBox& Box, const FMatrix& Transform)
+{
+	Center = Transform.TransformPosition(Box.GetCenter());
+	Vector3f Extent = Box.GetExtent();
+	for (int i = 0; i < 3; ++i)
+		Axes[i] = Vector3f(Transform[i]) * Extent[i];
+}
+
+FBoundingBox FOrientedBox::GetBoundingBox() const
+{
+	Vector3f Half;
+	for (int c = 0; c < 3; ++c)
+		Half[c] = fabsf(Axes[0][c]) + fabsf(Axes[1][c]) + fabsf(Axes[2][c]);
+	return FBoundingBox(Center - Half, Center + Half);
+}
+
+FFrustum::FFrustum(const FMatrix& ViewProj)
+{
+	// clip = p * ViewProj, a point is inside when -w <= x,y <= w and 0 <= z <= w
+	Vector4f c0 = ViewProj.Column(0);
+	Vector4f c1 = ViewProj.Column(1);
+	Vector4f c2 = ViewProj.Column(2);
+	Vector4f c3 = ViewProj.Column(3);
+	Planes[Left] = Vector4f(c3.x + c0.x, c3.y + c0.y, c3.z + c0.z, c3.w + c0.w);
+	Planes[Right] = Vector4f(c3.x - c0.x, c3.y - c0.y, c3.z - c0.z, c3.w - c0.w);
+	Planes[Bottom] = Vector4f(c3.x + c1.x, c3.y + c1.y, c3.z + c1.z, c3.w + c1.w);
+	Planes[Top] = Vector4f(c3.x - c1.x, c3.y - c1.y, c3.z - c1.z, c3.w - c1.w);
+	Planes[Near] = c2;
+	Planes[Far] = Vector4f(c3.x - c2.x, c3.y - c2.y, c3.z - c2.z, c3.w - c2.w);
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		float Length = Vector3f(Planes[i]).Length();
+		if (Length > 0.f)
+			Planes[i] = Planes[i] * (1.f / Length);
+	}
+}
+
+bool FFrustum::IntersectSphere(const Vector3f& Center, float Radius) const
+{
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		if (Vector3f(Planes[i]).Dot(Center) + Planes[i].w < -Radius)
+			return false;
+	}
+	return true;
+}
+
+bool FFrustum::IntersectBox(const FBoundingBox& Box) const
+{
+	// the corner furthest along the plane normal decides
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		const Vector4f& Plane = Planes[i];
+		Vector3f Corner(
+			Plane.x >= 0.f ? Box.BoundMax.x : Box.BoundMin.x,
+			Plane.y >= 0.f ? Box.BoundMax.y : Box.BoundMin.y,
+			Plane.z >= 0.f ? Box.BoundMax.z : Box.BoundMin.z);
+		if (Vector3f(Plane).Dot(Corner) + Plane.w < 0.f)
+			return false;
+	}
+	return true;
+}
+
+bool FFrustum::IntersectOrientedBox(const FOrientedBox& Box) const
+{
+	// projected radius of the box onto each plane normal
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		Vector3f Normal(Planes[i]);
+		float Radius = fabsf(Normal.Dot(Box.Axes[0])) + fabsf(Normal.Dot(Box.Axes[1])) + fabsf(Normal.Dot(Box.Axes[2]));
+		if (Normal.Dot(Box.Center) + Planes[i].w < -Radius)
+			return false;
+	}
+	return true;
+}
+
+namespace
+{
+	// bit i set when box i is behind one of the planes, Min and Max hold x, y, z of 4 boxes
+	__forceinline int BoxesOutside(const Vector4f* Planes, int PlaneCount, const FSimdFloat4 Min[3], const FSimdFloat4 Max[3])
+	{
+		const FSimdFloat4 Zero = FSimd::Splat(0.f);
+		int Outside = 0;
+		for (int i = 0; i < PlaneCount && Outside != 0xf; ++i)
+		{
+			// the sign of the plane normal picks the furthest corner for all 4 boxes at once
+			const Vector4f& Plane = Planes[i];
+			FSimdFloat4 Distance = FSimd::Add(FSimd::Mul(FSimd::Splat(Plane.x), Plane.x >= 0.f ? Max[0] : Min[0]), FSimd::Mul(FSimd::Splat(Plane.y), Plane.y >= 0.f ? Max[1] : Min[1]));
+			Distance = FSimd::Add(Distance, FSimd::Mul(FSimd::Splat(Plane.z), Plane.z >= 0.f ? Max[2] : Min[2]));
+			Distance = FSimd::Add(Distance, FSimd::Splat(Plane.w));
+			Outside |= FSimd::LessMask(Distance, Zero);
+		}
+		return Outside;
+	}
+
+	__forceinline int SpheresOutside(const Vector4f* Planes, int PlaneCount, FSimdFloat4 X, FSimdFloat4 Y, FSimdFloat4 Z, FSimdFloat4 Radius)
+	{
+		const FSimdFloat4 NegRadius = FSimd::Sub(FSimd::Splat(0.f), Radius);
+		int Outside = 0;
+		for (int i = 0; i < PlaneCount && Outside != 0xf; ++i)
+		{
+			const Vector4f& Plane = Planes[i];
+			FSimdFloat4 Distance = FSimd::Add(FSimd::Mul(FSimd::Splat(Plane.x), X), FSimd::Mul(FSimd::Splat(Plane.y), Y));
+			Distance = FSimd::Add(Distance, FSimd::Mul(FSimd::Splat(Plane.z), Z));
+			Distance = FSimd::Add(Distance, FSimd::Splat(Plane.w));
+			Outside |= FSimd::LessMask(Distance, NegRadius);
+		}
+		return Outside;
+	}
+
+	void AppendVisible(int Outside, uint32_t First, uint32_t Lanes, std::vector<uint32_t>& Visible)
+	{
+		for (uint32_t l = 0; l < Lanes; ++l)
+		{
+			if (!(Outside & (1 << l)))
+				Visible.push_back(First + l);
+		}
+	}
+}
+
+void FFrustum::CullBoxes(const FBoundingBoxSoA& Boxes, std::vector<uint32_t>& Visible) const
+{
+	const uint32_t Count = (uint32_t)Boxes.Size();
+	const float* const Src[6] = { Boxes.MinX.data(), Boxes.MinY.data(), Boxes.MinZ.data(), Boxes.MaxX.data(), Boxes.MaxY.data(), Boxes.MaxZ.data() };
+	uint32_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		FSimdFloat4 Min[3] = { FSimd::Load(Src[0] + i), FSimd::Load(Src[1] + i), FSimd::Load(Src[2] + i) };
+		FSimdFloat4 Max[3] = { FSimd::Load(Src[3] + i), FSimd::Load(Src[4] + i), FSimd::Load(Src[5] + i) };
+		AppendVisible(BoxesOutside(Planes, PlaneCount, Min, Max), i, 4, Visible);
+	}
+
+	if (i < Count)
+	{
+		float Padded[6][4] = {};
+		for (int c = 0; c < 6; ++c)
+			for (uint32_t l = 0; i + l < Count; ++l)
+				Padded[c][l] = Src[c][i + l];
+		FSimdFloat4 Min[3] = { FSimd::Load(Padded[0]), FSimd::Load(Padded[1]), FSimd::Load(Padded[2]) };
+		FSimdFloat4 Max[3] = { FSimd::Load(Padded[3]), FSimd::Load(Padded[4]), FSimd::Load(Padded[5]) };
+		AppendVisible(BoxesOutside(Planes, PlaneCount, Min, Max), i, Count - i, Visible);
+	}
+}
+
+void FFrustum::CullSpheres(const Vector4f* Spheres, uint32_t Count, std::vector<uint32_t>& Visible) const
+{
+	for (uint32_t i = 0; i < Count; i += 4)
+	{
+		const uint32_t Lanes = (std::min)(Count - i, 4u);
+		Vector4f Padded[4];
+		const Vector4f* Group = Spheres + i;
+		if (Lanes < 4)
+		{
+			for (uint32_t l = 0; l < Lanes; ++l)
+				Padded[l] = Spheres[i + l];
+			Group = Padded;
+		}
+
+		// 4 spheres in the rows, transposed to x, y, z and radius of all 4
+		FSimdFloat4 X = FSimd::Load(&Group[0].x);
+		FSimdFloat4 Y = FSimd::Load(&Group[1].x);
+		FSimdFloat4 Z = FSimd::Load(&Group[2].x);
+		FSimdFloat4 Radius = FSimd::Load(&Group[3].x);
+		FSimd::Transpose(X, Y, Z, Radius);
+		AppendVisible(SpheresOutside(Planes, PlaneCount, X, Y, Z, Radius), i, Lanes, Visible);
+	}
+}
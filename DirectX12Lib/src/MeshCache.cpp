@@ -0,0 +1,414 @@
+#include "MeshCache.h"
+#include "MeshData.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <filesystem>
+
+namespace
+{
+	const uint32_t MESH_CACHE_MAGIC = 0x4E49424D; // "MBIN"
+	const uint32_t MESH_CACHE_VERSION = 5;
+	const size_t STREAM_ALIGNMENT = 16;
+	const size_t HASH_CHUNK_SIZE = 4 * 1024 * 1024;
+	const uint64_t FNV64_OFFSET = 14695981039346656037ULL;
+	const uint64_t FNV64_PRIME = 1099511628211ULL;
+
+	struct FCacheHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint64_t FileSize;
+		uint64_t SourceSize;		// size and write time of the source file, a cheap second check besides the key
+		uint64_t SourceTime;
+		uint32_t MeshCount;
+		uint32_t NodeCount;
+		uint32_t SceneMaterialCount;
+	};
+
+	class FCacheWriter
+	{
+	public:
+		void Write(const void* Data, size_t Size)
+		{
+			const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+			m_Buffer.insert(m_Buffer.end(), Bytes, Bytes + Size);
+		}
+
+		template<typename T>
+		void Write(const T& Value)
+		{
+			Write(&Value, sizeof(T));
+		}
+
+		void WriteString(const std::string& Str)
+		{
+			Write((uint32_t)Str.size());
+			Write(Str.data(), Str.size());
+		}
+
+		template<typename T>
+		void WriteStream(const std::vector<T>& Stream)
+		{
+			Write((uint64_t)Stream.size());
+			m_Buffer.resize(AlignUp(m_Buffer.size(), STREAM_ALIGNMENT), 0);
+			if (!Stream.empty())
+				Write(Stream.data(), Stream.size() * sizeof(T));
+		}
+
+		std::vector<uint8_t>& GetBuffer() { return m_Buffer; }
+
+	private:
+		std::vector<uint8_t> m_Buffer;
+	};
+
+	class FCacheReader
+	{
+	public:
+		FCacheReader(const char* Data, size_t Size) : m_Begin(Data), m_Cursor(Data), m_End(Data + Size) {}
+
+		bool Read(void* Data, size_t Size)
+		{
+			if (Size > (size_t)(m_End - m_Cursor))
+				return false;
+			memcpy(Data, m_Cursor, Size);
+			m_Cursor += Size;
+			return true;
+		}
+
+		template<typename T>
+		bool Read(T& Value)
+		{
+			return Read(&Value, sizeof(T));
+		}
+
+		bool ReadString(std::string& Str)
+		{
+			uint32_t Length;
+			if (!Read(Length) || Length > (size_t)(m_End - m_Cursor))
+				return false;
+			Str.assign(m_Cursor, Length);
+			m_Cursor += Length;
+			return true;
+		}
+
+		// streams are plain copies out of the mapping, no per element work
+		template<typename T>
+		bool ReadStream(std::vector<T>& Stream)
+		{
+			uint64_t Count;
+			if (!Read(Count))
+				return false;
+			m_Cursor = m_Begin + AlignUp((size_t)(m_Cursor - m_Begin), STREAM_ALIGNMENT);
+			if (m_Cursor > m_End || Count > (uint64_t)(m_End - m_Cursor) / sizeof(T))
+				return false;
+			const T* First = reinterpret_cast<const T*>(m_Cursor);
+			Stream.assign(First, First + Count);
+			m_Cursor += Count * sizeof(T);
+			return true;
+		}
+
+	private:
+		const char* m_Begin;
+		const char* m_Cursor;
+		const char* m_End;
+	};
+
+	uint64_t HashBytes(const void* Data, size_t Size, uint64_t Hash = FNV64_OFFSET)
+	{
+		// FNV-1a 64
+		const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+		for (size_t i = 0; i < Size; ++i)
+		{
+			Hash = (Hash ^ Bytes[i]) * FNV64_PRIME;
+		}
+		return Hash;
+	}
+
+	uint64_t HashFile(const std::string& FilePath)
+	{
+		FMappedFile File;
+		if (!File.Open(FilePath))
+			return 0;
+
+		// chunks hash in parallel, their hashes are hashed again in order together with the size
+		const size_t Size = File.GetSize();
+		uint32_t ChunkCount = (uint32_t)((Size + HASH_CHUNK_SIZE - 1) / HASH_CHUNK_SIZE);
+		std::vector<uint64_t> ChunkHashes(ChunkCount + 1, 0);
+		FParallel::For(ChunkCount, [&](uint32_t i)
+		{
+			size_t Begin = i * HASH_CHUNK_SIZE;
+			size_t End = (std::min)(Size, Begin + HASH_CHUNK_SIZE);
+			ChunkHashes[i] = HashBytes(File.GetData() + Begin, End - Begin);
+		});
+		ChunkHashes[ChunkCount] = Size;
+		return HashBytes(ChunkHashes.data(), ChunkHashes.size() * sizeof(uint64_t));
+	}
+
+	void GetSourceStamp(const std::string& SourcePath, uint64_t& Size, uint64_t& Time)
+	{
+		std::error_code Error;
+		Size = std::filesystem::file_size(SourcePath, Error);
+		if (Error)
+			Size = 0;
+		std::filesystem::file_time_type WriteTime = std::filesystem::last_write_time(SourcePath, Error);
+		Time = Error ? 0 : (uint64_t)WriteTime.time_since_epoch().count();
+	}
+
+	void WriteMaterial(FCacheWriter& Writer, const MaterialData& Material)
+	{
+		Writer.WriteString(Material.Name);
+		Writer.WriteString(Material.BaseColorPath);
+		Writer.WriteString(Material.MetallicRoughnessPath);
+		Writer.WriteString(Material.NormalPath);
+		Writer.WriteString(Material.MetallicPath);
+		Writer.WriteString(Material.RoughnessPath);
+		Writer.WriteString(Material.AoPath);
+		Writer.WriteString(Material.OpacityPath);
+		Writer.WriteString(Material.EmissivePath);
+		Writer.Write(Material.Albedo);
+		Writer.Write(Material.Metallic);
+		Writer.Write(Material.Roughness);
+	}
+
+	bool ReadMaterial(FCacheReader& Reader, MaterialData& Material)
+	{
+		return Reader.ReadString(Material.Name)
+			&& Reader.ReadString(Material.BaseColorPath)
+			&& Reader.ReadString(Material.MetallicRoughnessPath)
+			&& Reader.ReadString(Material.NormalPath)
+			&& Reader.ReadString(Material.MetallicPath)
+			&& Reader.ReadString(Material.RoughnessPath)
+			&& Reader.ReadString(Material.AoPath)
+			&& Reader.ReadString(Material.OpacityPath)
+			&& Reader.ReadString(Material.EmissivePath)
+			&& Reader.Read(Material.Albedo)
+			&& Reader.Read(Material.Metallic)
+			&& Reader.Read(Material.Roughness);
+	}
+
+	void WriteMesh(FCacheWriter& Writer, const MeshData& Mesh)
+	{
+		Writer.WriteString(Mesh.m_filepath);
+		Writer.Write(Mesh.m_BoundMin);
+		Writer.Write(Mesh.m_BoundMax);
+
+		Writer.WriteStream(Mesh.m_positions);
+		Writer.WriteStream(Mesh.m_colors);
+		Writer.WriteStream(Mesh.m_texcoords);
+		Writer.WriteStream(Mesh.m_normals);
+		Writer.WriteStream(Mesh.m_tangents);
+		Writer.WriteStream(Mesh.m_indices);
+
+		Writer.Write((uint32_t)Mesh.m_submeshes.size());
+		for (size_t i = 0; i < Mesh.m_submeshes.size(); ++i)
+		{
+			const SubMeshData& SubMesh = Mesh.m_submeshes[i];
+			Writer.Write(SubMesh.StartIndex);
+			Writer.Write(SubMesh.IndexCount);
+			Writer.Write(SubMesh.MaterialIndex);
+			Writer.Write(SubMesh.Bounds.BoundMin);
+			Writer.Write(SubMesh.Bounds.BoundMax);
+		}
+
+		Writer.Write((uint32_t)Mesh.m_materials.size());
+		for (size_t i = 0; i < Mesh.m_materials.size(); ++i)
+		{
+			WriteMaterial(Writer, Mesh.m_materials[i]);
+		}
+	}
+
+	MeshData* ReadMesh(FCacheReader& Reader)
+	{
+		std::string FilePath;
+		if (!Reader.ReadString(FilePath))
+			return nullptr;
+
+		MeshData* Mesh = new MeshData(FilePath);
+		bool Success = Reader.Read(Mesh->m_BoundMin) && Reader.Read(Mesh->m_BoundMax)
+			&& Reader.ReadStream(Mesh->m_positions)
+			&& Reader.ReadStream(Mesh->m_colors)
+			&& Reader.ReadStream(Mesh->m_texcoords)
+			&& Reader.ReadStream(Mesh->m_normals)
+			&& Reader.ReadStream(Mesh->m_tangents)
+			&& Reader.ReadStream(Mesh->m_indices);
+
+		uint32_t SubMeshCount = 0;
+		Success = Success && Reader.Read(SubMeshCount);
+		for (uint32_t i = 0; Success && i < SubMeshCount; ++i)
+		{
+			uint32_t StartIndex, IndexCount, MaterialIndex;
+			FBoundingBox Bounds;
+			Success = Reader.Read(StartIndex) && Reader.Read(IndexCount) && Reader.Read(MaterialIndex)
+				&& Reader.Read(Bounds.BoundMin) && Reader.Read(Bounds.BoundMax);
+			if (Success)
+			{
+				Mesh->m_submeshes.emplace_back(StartIndex, IndexCount, MaterialIndex);
+				Mesh->m_submeshes.back().Bounds = Bounds;
+			}
+		}
+
+		uint32_t MaterialCount = 0;
+		Success = Success && Reader.Read(MaterialCount);
+		for (uint32_t i = 0; Success && i < MaterialCount; ++i)
+		{
+			MaterialData Material;
+			Success = ReadMaterial(Reader, Material);
+			if (Success)
+				Mesh->m_materials.push_back(Material);
+		}
+
+		if (!Success)
+		{
+			delete Mesh;
+			return nullptr;
+		}
+		return Mesh;
+	}
+}
+
+bool FMeshCache::sm_Enabled = true;
+
+std::string FMeshCache::GetCachePath(const std::string& SourcePath)
+{
+	return SourcePath + ".meshbin";
+}
+
+uint64_t FMeshCache::ComputeKey(const std::vector<std::string>& SourceFiles, uint32_t ImportFlags)
+{
+	uint64_t Key = HashBytes(&MESH_CACHE_VERSION, sizeof(MESH_CACHE_VERSION));
+	Key = HashBytes(&ImportFlags, sizeof(ImportFlags), Key);
+	for (size_t i = 0; i < SourceFiles.size(); ++i)
+	{
+		// the path too, so that swapping two dependencies changes the key
+		uint64_t Hash = HashFile(SourceFiles[i]);
+		Key = HashBytes(SourceFiles[i].data(), SourceFiles[i].size(), Key);
+		Key = HashBytes(&Hash, sizeof(Hash), Key);
+	}
+	return Key != 0 ? Key : 1;
+}
+
+bool FMeshCache::Save(const std::string& SourcePath, uint64_t Key, const std::vector<const MeshData*>& Meshes, const std::vector<FMeshCacheNode>& Nodes, const std::vector<MaterialData>& SceneMaterials)
+{
+	if (Key == 0)
+		return false;
+
+	FCacheWriter Writer;
+	FCacheHeader Header = {};
+	Header.Magic = MESH_CACHE_MAGIC;
+	Header.Version = MESH_CACHE_VERSION;
+	Header.Key = Key;
+	GetSourceStamp(SourcePath, Header.SourceSize, Header.SourceTime);
+	Header.MeshCount = (uint32_t)Meshes.size();
+	Header.NodeCount = (uint32_t)Nodes.size();
+	Header.SceneMaterialCount = (uint32_t)SceneMaterials.size();
+	Writer.Write(Header);
+
+	for (size_t i = 0; i < SceneMaterials.size(); ++i)
+	{
+		WriteMaterial(Writer, SceneMaterials[i]);
+	}
+
+	for (size_t i = 0; i < Meshes.size(); ++i)
+	{
+		WriteMesh(Writer, *Meshes[i]);
+	}
+
+	for (size_t i = 0; i < Nodes.size(); ++i)
+	{
+		const FMeshCacheNode& Node = Nodes[i];
+		Writer.WriteString(Node.Name);
+		Writer.Write(Node.Parent);
+		Writer.Write(Node.Mesh);
+		Writer.Write(Node.Scale);
+		Writer.Write(Node.Translation);
+		Writer.Write(Node.Rotation);
+	}
+
+	// patch the total size so a truncated file is rejected on load
+	std::vector<uint8_t>& Buffer = Writer.GetBuffer();
+	uint64_t FileSize = Buffer.size();
+	memcpy(Buffer.data() + offsetof(FCacheHeader, FileSize), &FileSize, sizeof(FileSize));
+
+	// write aside and rename, a crash never leaves a half written cache behind
+	std::string CachePath = GetCachePath(SourcePath);
+	std::string TempPath = CachePath + ".tmp";
+	{
+		std::ofstream File(TempPath, std::ios::binary | std::ios::trunc);
+		if (!File.is_open())
+			return false;
+		File.write((const char*)Buffer.data(), Buffer.size());
+		if (!File.good())
+			return false;
+	}
+	std::remove(CachePath.c_str());
+	return std::rename(TempPath.c_str(), CachePath.c_str()) == 0;
+}
+
+bool FMeshCache::Load(const std::string& SourcePath, uint64_t Key, std::vector<MeshData*>& Meshes, std::vector<FMeshCacheNode>& Nodes, std::vector<MaterialData>& SceneMaterials)
+{
+	if (Key == 0)
+		return false;
+
+	FMappedFile File;
+	if (!File.Open(GetCachePath(SourcePath)))
+		return false;
+
+	uint64_t SourceSize, SourceTime;
+	GetSourceStamp(SourcePath, SourceSize, SourceTime);
+	FCacheReader Reader(File.GetData(), File.GetSize());
+	FCacheHeader Header;
+	if (!Reader.Read(Header) || Header.Magic != MESH_CACHE_MAGIC || Header.Version != MESH_CACHE_VERSION
+		|| Header.Key != Key || Header.FileSize != File.GetSize()
+		|| Header.SourceSize != SourceSize || Header.SourceTime != SourceTime)
+	{
+		return false;
+	}
+
+	std::vector<MaterialData> LoadedMaterials(Header.SceneMaterialCount <= File.GetSize() ? Header.SceneMaterialCount : 0);
+	bool Success = LoadedMaterials.size() == Header.SceneMaterialCount;
+	for (uint32_t i = 0; Success && i < Header.SceneMaterialCount; ++i)
+	{
+		Success = ReadMaterial(Reader, LoadedMaterials[i]);
+	}
+
+	std::vector<MeshData*> LoadedMeshes;
+	for (uint32_t i = 0; Success && i < Header.MeshCount; ++i)
+	{
+		MeshData* Mesh = ReadMesh(Reader);
+		Success = Mesh != nullptr;
+		if (Success)
+			LoadedMeshes.push_back(Mesh);
+	}
+
+	std::vector<FMeshCacheNode> LoadedNodes(Success ? Header.NodeCount : 0);
+	for (uint32_t i = 0; Success && i < Header.NodeCount; ++i)
+	{
+		FMeshCacheNode& Node = LoadedNodes[i];
+		Success = Reader.ReadString(Node.Name)
+			&& Reader.Read(Node.Parent)
+			&& Reader.Read(Node.Mesh)
+			&& Reader.Read(Node.Scale)
+			&& Reader.Read(Node.Translation)
+			&& Reader.Read(Node.Rotation)
+			&& Node.Parent >= -1 && Node.Parent < (int32_t)i
+			&& Node.Mesh >= -1 && Node.Mesh < (int32_t)LoadedMeshes.size();
+	}
+
+	if (!Success)
+	{
+		for (size_t i = 0; i < LoadedMeshes.size(); ++i)
+			delete LoadedMeshes[i];
+		return false;
+	}
+
+	Meshes.swap(LoadedMeshes);
+	Nodes.swap(LoadedNodes);
+	SceneMaterials.swap(LoadedMaterials);
+	return true;
+}
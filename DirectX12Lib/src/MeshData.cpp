@@ -1,11 +1,81 @@
 ﻿#include "MeshData.h"
 #include "Common.h"
+#include "Meshlet.h"
+#include "Camera.h"
 
 #include <limits>
 
 
+uint32_t MeshData::sm_DefaultVertexCompression = VC_None;
+
+namespace
+{
+	// 16 bit copy of Indices relative to the lowest vertex of each range, fails when a range spans more than 64k vertices.
+	// Ranges that share indices share one base vertex too, the packed index can only hold one value
+	template<typename RangeType>
+	bool PackIndexRanges(const std::vector<uint32_t>& Indices, std::vector<RangeType>& Ranges, std::vector<uint16_t>& Packed)
+	{
+		// ranges by start, overlapping ones are merged into clusters below
+		std::vector<size_t> Order(Ranges.size());
+		for (size_t s = 0; s < Ranges.size(); ++s)
+		{
+			Ranges[s].BaseVertex = 0;
+			Order[s] = s;
+		}
+		std::sort(Order.begin(), Order.end(), [&Ranges](size_t a, size_t b) { return Ranges[a].StartIndex < Ranges[b].StartIndex; });
+
+		// indices outside the ranges keep a base vertex of 0
+		std::vector<uint32_t> BaseVertices(Indices.size(), 0);
+		for (size_t First = 0; First < Order.size(); )
+		{
+			auto RangeEnd = [&](size_t s) { return (uint32_t)std::min((size_t)Ranges[s].StartIndex + Ranges[s].IndexCount, Indices.size()); };
+			uint32_t Begin = (uint32_t)std::min((size_t)Ranges[Order[First]].StartIndex, Indices.size());
+			uint32_t End = RangeEnd(Order[First]);
+			size_t Last = First + 1;
+			for (; Last < Order.size() && Ranges[Order[Last]].StartIndex < End; ++Last)
+			{
+				End = std::max(End, RangeEnd(Order[Last]));
+			}
+
+			uint32_t MinIndex = 0xffffffff;
+			uint32_t MaxIndex = 0;
+			for (uint32_t i = Begin; i < End; ++i)
+			{
+				MinIndex = std::min(MinIndex, Indices[i]);
+				MaxIndex = std::max(MaxIndex, Indices[i]);
+			}
+			if (MinIndex <= MaxIndex && MaxIndex - MinIndex > 0xffff)
+				return false;
+			if (MinIndex > MaxIndex)
+				MinIndex = 0;
+			for (uint32_t i = Begin; i < End; ++i)
+			{
+				BaseVertices[i] = MinIndex;
+			}
+			for (size_t s = First; s < Last; ++s)
+			{
+				Ranges[Order[s]].BaseVertex = (int32_t)MinIndex;
+			}
+			First = Last;
+		}
+		for (size_t i = 0; i < Indices.size(); ++i)
+		{
+			if (Indices[i] - BaseVertices[i] > 0xffff)
+				return false;
+		}
+
+		Packed.resize(Indices.size());
+		for (size_t i = 0; i < Indices.size(); ++i)
+		{
+			Packed[i] = (uint16_t)(Indices[i] - BaseVertices[i]);
+		}
+		return true;
+	}
+}
+
 MeshData::MeshData(const std::string& filepath)
 	: m_filepath(filepath)
+	, m_VertexCompression(sm_DefaultVertexCompression)
 {
 }
 
@@ -96,6 +166,195 @@ const float* MeshData::GetVertexData(VertexElementType type)
 	}
 }
 
+void MeshData::CompressVertexStreams()
+{
+	for (int i = 0; i < VET_Max; ++i)
+	{
+		std::vector<uint8_t>().swap(m_CompressedStreams[i]);
+	}
+	m_PositionMin = Vector3f(0.f);
+	m_PositionExtent = Vector3f(1.f);
+
+	if ((m_VertexCompression & VC_Position) && !m_positions.empty())
+	{
+		Vector3f BoundMin(std::numeric_limits<float>::max());
+		Vector3f BoundMax(-std::numeric_limits<float>::max());
+		for (size_t i = 0; i < m_positions.size(); ++i)
+		{
+			BoundMin = Min(BoundMin, m_positions[i]);
+			BoundMax = Max(BoundMax, m_positions[i]);
+		}
+		m_PositionMin = BoundMin;
+		m_PositionExtent = BoundMax - BoundMin;
+
+		m_CompressedStreams[VET_Position].resize(m_positions.size() * sizeof(uint64_t));
+		uint64_t* Packed = (uint64_t*)m_CompressedStreams[VET_Position].data();
+		for (size_t i = 0; i < m_positions.size(); ++i)
+		{
+			Packed[i] = FVertexCompression::EncodeUNorm16x3(m_positions[i], m_PositionMin, m_PositionExtent);
+		}
+	}
+
+	if ((m_VertexCompression & VC_Normal) && !m_normals.empty())
+	{
+		m_CompressedStreams[VET_Normal].resize(m_normals.size() * sizeof(uint32_t));
+		uint32_t* Packed = (uint32_t*)m_CompressedStreams[VET_Normal].data();
+		for (size_t i = 0; i < m_normals.size(); ++i)
+		{
+			Packed[i] = FVertexCompression::EncodeOctNormal(m_normals[i]);
+		}
+	}
+
+	if ((m_VertexCompression & VC_Tangent) && !m_tangents.empty())
+	{
+		m_CompressedStreams[VET_Tangent].resize(m_tangents.size() * sizeof(uint32_t));
+		uint32_t* Packed = (uint32_t*)m_CompressedStreams[VET_Tangent].data();
+		for (size_t i = 0; i < m_tangents.size(); ++i)
+		{
+			Packed[i] = FVertexCompression::EncodeTangent(m_tangents[i]);
+		}
+	}
+
+	for (size_t i = 0; i < m_submeshes.size(); ++i)
+	{
+		m_submeshes[i].TexcoordScaleBias = Vector4f(1.f, 1.f, 0.f, 0.f);
+	}
+	if ((m_VertexCompression & (VC_TexcoordHalf | VC_TexcoordUNorm)) && !m_texcoords.empty())
+	{
+		m_CompressedStreams[VET_Texcoord].resize(m_texcoords.size() * sizeof(uint32_t));
+		uint32_t* Packed = (uint32_t*)m_CompressedStreams[VET_Texcoord].data();
+		// the ranges live in the submeshes, meshes without them fall back to half floats
+		if ((m_VertexCompression & VC_TexcoordUNorm) && !m_submeshes.empty())
+		{
+			CompressTexcoordsUNorm(Packed);
+		}
+		else
+		{
+			for (size_t i = 0; i < m_texcoords.size(); ++i)
+			{
+				Packed[i] = FVertexCompression::EncodeHalf2(m_texcoords[i]);
+			}
+		}
+	}
+}
+
+void MeshData::CompressTexcoordsUNorm(uint32_t* Packed)
+{
+	// submeshes sharing vertices need the same range, group them with a union find
+	std::vector<uint32_t> Group(m_submeshes.size());
+	for (uint32_t i = 0; i < (uint32_t)Group.size(); ++i)
+	{
+		Group[i] = i;
+	}
+	auto FindGroup = [&Group](uint32_t i)
+	{
+		while (Group[i] != i)
+		{
+			Group[i] = Group[Group[i]];
+			i = Group[i];
+		}
+		return i;
+	};
+
+	const uint32_t NoOwner = 0xffffffff;
+	std::vector<uint32_t> Owner(m_texcoords.size(), NoOwner);
+	for (uint32_t s = 0; s < (uint32_t)m_submeshes.size(); ++s)
+	{
+		const SubMeshData& SubMesh = m_submeshes[s];
+		for (uint32_t i = SubMesh.StartIndex; i < SubMesh.StartIndex + SubMesh.IndexCount; ++i)
+		{
+			uint32_t& VertexOwner = Owner[m_indices[i]];
+			if (VertexOwner == NoOwner)
+			{
+				VertexOwner = s;
+			}
+			else
+			{
+				uint32_t A = FindGroup(VertexOwner);
+				uint32_t B = FindGroup(s);
+				if (A != B)
+					Group[std::max(A, B)] = std::min(A, B);
+			}
+		}
+	}
+
+	std::vector<Vector2f> GroupMin(Group.size(), Vector2f(std::numeric_limits<float>::max()));
+	std::vector<Vector2f> GroupMax(Group.size(), Vector2f(-std::numeric_limits<float>::max()));
+	for (size_t i = 0; i < m_texcoords.size(); ++i)
+	{
+		if (Owner[i] != NoOwner)
+		{
+			uint32_t g = FindGroup(Owner[i]);
+			GroupMin[g] = Vector2f(std::min(GroupMin[g].x, m_texcoords[i].x), std::min(GroupMin[g].y, m_texcoords[i].y));
+			GroupMax[g] = Vector2f(std::max(GroupMax[g].x, m_texcoords[i].x), std::max(GroupMax[g].y, m_texcoords[i].y));
+		}
+	}
+
+	for (size_t i = 0; i < m_texcoords.size(); ++i)
+	{
+		// vertices no submesh draws are left at 0
+		Packed[i] = 0;
+		if (Owner[i] != NoOwner)
+		{
+			uint32_t g = FindGroup(Owner[i]);
+			Packed[i] = FVertexCompression::EncodeUNorm16x2(m_texcoords[i], GroupMin[g], GroupMax[g] - GroupMin[g]);
+		}
+	}
+
+	for (uint32_t s = 0; s < (uint32_t)m_submeshes.size(); ++s)
+	{
+		uint32_t g = FindGroup(s);
+		if (GroupMin[g].x <= GroupMax[g].x)
+		{
+			Vector2f Extent = GroupMax[g] - GroupMin[g];
+			m_submeshes[s].TexcoordScaleBias = Vector4f(Extent.x, Extent.y, GroupMin[g].x, GroupMin[g].y);
+		}
+	}
+}
+
+uint32_t MeshData::GetStreamStride(VertexElementType type) const
+{
+	if (m_CompressedStreams[type].empty())
+		return GetVertexStride(type);
+	return type == VET_Position ? sizeof(uint64_t) : sizeof(uint32_t);
+}
+
+const void* MeshData::GetStreamData(VertexElementType type)
+{
+	if (m_CompressedStreams[type].empty())
+		return GetVertexData(type);
+	return m_CompressedStreams[type].data();
+}
+
+DXGI_FORMAT MeshData::GetStreamFormat(VertexElementType type) const
+{
+	bool Compressed = !m_CompressedStreams[type].empty();
+	switch(type)
+	{
+	case VET_Position:
+		return Compressed ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+	case VET_Color:
+		return DXGI_FORMAT_R32G32B32_FLOAT;
+	case VET_Texcoord:
+		if (!Compressed)
+			return DXGI_FORMAT_R32G32_FLOAT;
+		return (m_VertexCompression & VC_TexcoordUNorm) && !m_submeshes.empty() ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16_FLOAT;
+	case VET_Normal:
+		return Compressed ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+	case VET_Tangent:
+		return Compressed ? DXGI_FORMAT_R10G10B10A2_UNORM : DXGI_FORMAT_R32G32B32A32_FLOAT;
+	default:
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+FMatrix MeshData::GetPositionDequantization() const
+{
+	if (m_CompressedStreams[VET_Position].empty())
+		return FMatrix::ScaleMatrix(1.f);
+	return FMatrix::ScaleMatrix(m_PositionExtent) * FMatrix::TranslateMatrix(m_PositionMin);
+}
+
 uint32_t MeshData::GetIndexSize() const
 {
 	return (uint32_t)m_indices.size() * GetIndexElementSize();
@@ -103,8 +362,7 @@ uint32_t MeshData::GetIndexSize() const
 
 uint32_t MeshData::GetIndexElementSize() const
 {
-	//TODO: maybe short?
-	return sizeof(uint32_t);
+	return m_PackedIndices.empty() ? sizeof(uint32_t) : sizeof(uint16_t);
 }
 
 uint32_t MeshData::GetIndexCount() const
@@ -112,11 +370,24 @@ uint32_t MeshData::GetIndexCount() const
 	return (uint32_t)m_indices.size();
 }
 
-const uint32_t* MeshData::GetIndexData()
+const void* MeshData::GetIndexData()
 {
+	if (!m_PackedIndices.empty())
+		return m_PackedIndices.data();
 	return &m_indices[0];
 }
 
+void MeshData::PackIndices()
+{
+	if (!PackIndexRanges(m_indices, m_submeshes, m_PackedIndices))
+		std::vector<uint16_t>().swap(m_PackedIndices);
+	for (size_t l = 0; l < m_Lods.size(); ++l)
+	{
+		if (!PackIndexRanges(m_Lods[l].Indices, m_Lods[l].SubMeshes, m_Lods[l].PackedIndices))
+			std::vector<uint16_t>().swap(m_Lods[l].PackedIndices);
+	}
+}
+
 uint32_t MeshData::GetSubIndexStart(size_t Index) const
 {
 	Assert(Index < m_submeshes.size());
@@ -135,6 +406,33 @@ size_t MeshData::GetSubMaterialIndex(size_t Index) const
 	return m_submeshes[Index].MaterialIndex;
 }
 
+int32_t MeshData::GetSubBaseVertex(size_t Index) const
+{
+	Assert(Index < m_submeshes.size());
+	return m_submeshes[Index].BaseVertex;
+}
+
+const Vector4f& MeshData::GetSubTexcoordScaleBias(size_t Index) const
+{
+	Assert(Index < m_submeshes.size());
+	return m_submeshes[Index].TexcoordScaleBias;
+}
+
+const FBoundingBox& MeshData::GetSubBounds(size_t Index) const
+{
+	Assert(Index < m_submeshes.size());
+	return m_submeshes[Index].Bounds;
+}
+
+uint32_t MeshData::GetSubTriangleCount(size_t Index) const
+{
+	Assert(Index < m_submeshes.size());
+	const SubMeshData& SubMesh = m_submeshes[Index];
+	if (SubMesh.StartIndex >= m_indices.size())
+		return 0;
+	return (std::min)(SubMesh.IndexCount, (uint32_t)m_indices.size() - SubMesh.StartIndex) / 3;
+}
+
 void MeshData::AddMaterial(const MaterialData& Material)
 {
 	m_materials.push_back(Material);
@@ -146,133 +444,138 @@ void MeshData::AddSubMesh(uint32_t StartIndex, uint32_t IndexCount, uint32_t Mat
 	if (IndexCount == 0)
 		IndexCount = (uint32_t)m_indices.size();
 	m_submeshes.emplace_back(StartIndex, IndexCount, MaterialIndex);
+	ComputeSubMeshBounds(m_submeshes.back());
 }
 
 std::string MeshData::GetBaseColorPath(uint32_t MtlIndex)
 {
-	std::string result;
-	if (MtlIndex < m_materials.size())
-	{
-		result = m_materials[MtlIndex].BaseColorPath;
-	}
-	if (result.empty())
-	{
-		result = "../Resources/Textures/white.png";
-	}
-	return result;
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	return FMaterialTable::GetTexturePath(MtlIndex < Materials.size() ? &Materials[MtlIndex] : nullptr, 0);
 }
 
 std::string MeshData::GetOpacityPath(uint32_t MtlIndex)
 {
-	std::string result;
-	if (MtlIndex < m_materials.size())
-	{
-		result = m_materials[MtlIndex].OpacityPath;
-	}
-	if (result.empty())
-	{
-		result = "../Resources/Textures/white.png";
-	}
-	return result;
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	return FMaterialTable::GetTexturePath(MtlIndex < Materials.size() ? &Materials[MtlIndex] : nullptr, 1);
 }
 
 std::string MeshData::GetEmissivePath(uint32_t MtlIndex)
 {
-	std::string result;
-	if (MtlIndex < m_materials.size())
-	{
-		result = m_materials[MtlIndex].EmissivePath;
-	}
-	if (result.empty())
-	{
-		result = "../Resources/Textures/black.png";
-	}
-	return result;
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	return FMaterialTable::GetTexturePath(MtlIndex < Materials.size() ? &Materials[MtlIndex] : nullptr, 2);
 }
 
 std::string MeshData::GetMetallicPath(uint32_t MtlIndex)
 {
-	std::string result;
-	if (MtlIndex < m_materials.size())
-	{
-		result = m_materials[MtlIndex].MetallicPath;
-	}
-	if (result.empty())
-	{
-		result = "../Resources/Textures/black.png";
-	}
-	return result;
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	return FMaterialTable::GetTexturePath(MtlIndex < Materials.size() ? &Materials[MtlIndex] : nullptr, 3);
 }
 
 std::string MeshData::GetRoughnessPath(uint32_t MtlIndex)
 {
-	std::string result;
-	if (MtlIndex < m_materials.size())
-	{
-		result = m_materials[MtlIndex].RoughnessPath;
-	}
-	if (result.empty())
-	{
-		result = "../Resources/Textures/black.png";
-	}
-	return result;
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	return FMaterialTable::GetTexturePath(MtlIndex < Materials.size() ? &Materials[MtlIndex] : nullptr, 4);
 }
 
 std::string MeshData::GetAOPath(uint32_t MtlIndex)
 {
-	std::string result;
-	if (MtlIndex < m_materials.size())
-	{
-		result = m_materials[MtlIndex].AoPath;
-	}
-	if (result.empty())
-	{
-		result = "../Resources/Textures/white.png";
-	}
-	return result;
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	return FMaterialTable::GetTexturePath(MtlIndex < Materials.size() ? &Materials[MtlIndex] : nullptr, 5);
 }
 
 std::string MeshData::GetNormalPath(uint32_t MtlIndex)
 {
-	std::string result;
-	if (MtlIndex < m_materials.size())
-	{
-		result = m_materials[MtlIndex].NormalPath;
-	}
-	if (result.empty())
-	{
-		result = "../Resources/Textures/default_normal.png";
-	}
-	return result;
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	return FMaterialTable::GetTexturePath(MtlIndex < Materials.size() ? &Materials[MtlIndex] : nullptr, 6);
 }
 
 const MaterialData& MeshData::GetMaterialData(size_t Index)
 {
-	Assert(Index < m_materials.size());
-	return m_materials[Index];
+	const std::vector<MaterialData>& Materials = GetMaterials();
+	Assert(Index < Materials.size());
+	return Materials[Index];
+}
+
+const std::vector<MaterialData>& MeshData::GetMaterials() const
+{
+	return m_MaterialTable ? m_MaterialTable->GetMaterials() : m_materials;
 }
 
 FTexture* MeshData::GetTexture(uint32_t MtlIndex, int TexIndex)
 {
-	uint32_t Index = TEX_PER_MATERIAL* MtlIndex + TexIndex;
-	if (Index < m_Textures.size())
-		return &m_Textures[Index];
-	else
-		return nullptr;
+	return m_MaterialTable ? m_MaterialTable->GetTexture(MtlIndex, TexIndex) : nullptr;
 }
 
 FTexture* MeshData::GetTextureByMeshIndex(uint32_t SubMeshIndex, int TexIndex)
 {
 	size_t MtlIndex = this->GetSubMaterialIndex(SubMeshIndex);
-	if (MtlIndex < m_materials.size())
-		return GetTexture(MtlIndex, TexIndex);
+	if (MtlIndex < GetMaterialCount())
+		return GetTexture((uint32_t)MtlIndex, TexIndex);
 	else
 		return nullptr;
 }
 
 void MeshData::CollectMeshBatch(std::vector<MeshDrawCommand>& MeshDrawCommands)
 {
+	for (size_t i = 0; i < m_submeshes.size(); ++i)
+	{
+		const SubMeshData& SubMesh = m_submeshes[i];
+		MeshDrawCommand Command;
+		Command.SortKey = 0;
+		Command.Mesh = this;
+		Command.StartIndex = SubMesh.StartIndex;
+		Command.IndexCount = GetSubTriangleCount(i) * 3;
+		Command.BaseVertex = SubMesh.BaseVertex;
+		Command.SubMeshIndex = (uint32_t)i;
+		Command.MaterialIndex = SubMesh.MaterialIndex;
+		Command.MeshIndex = 0;
+		MeshDrawCommands.push_back(Command);
+	}
+}
+
+void MeshData::BuildMeshlets(uint32_t MaxVertices, uint32_t MaxPrimitives)
+{
+	if (!m_Meshlets)
+		m_Meshlets.reset(new FMeshletData());
+	FMeshletBuilder::Build(*this, *m_Meshlets, MaxVertices, MaxPrimitives);
+}
+
+void MeshData::GenerateLods(uint32_t MaxLods, float TargetRatio)
+{
+	FMeshLodBuilder::Build(*this, m_Lods, MaxLods, TargetRatio);
+}
 
+uint32_t MeshData::GetLodSubIndexStart(uint32_t Lod, size_t Index) const
+{
+	if (Lod == 0)
+		return GetSubIndexStart(Index);
+	Assert(Lod <= m_Lods.size() && Index < m_Lods[Lod - 1].SubMeshes.size());
+	return m_Lods[Lod - 1].SubMeshes[Index].StartIndex;
+}
+
+size_t MeshData::GetLodSubIndexCount(uint32_t Lod, size_t Index) const
+{
+	if (Lod == 0)
+		return GetSubIndexCount(Index);
+	Assert(Lod <= m_Lods.size() && Index < m_Lods[Lod - 1].SubMeshes.size());
+	return m_Lods[Lod - 1].SubMeshes[Index].IndexCount;
+}
+
+int32_t MeshData::GetLodSubBaseVertex(uint32_t Lod, size_t Index) const
+{
+	if (Lod == 0)
+		return GetSubBaseVertex(Index);
+	Assert(Lod <= m_Lods.size() && Index < m_Lods[Lod - 1].SubMeshes.size());
+	return m_Lods[Lod - 1].SubMeshes[Index].BaseVertex;
+}
+
+uint32_t MeshData::SelectLod(const FMatrix& LocalToWorld, const FCamera& Camera, float ViewportHeight, float MaxPixelError) const
+{
+	if (m_Lods.empty())
+		return 0;
+	FBoundingBox WorldBounds = LocalToWorld.TransformBoundingBox(m_BoundMin, m_BoundMax);
+	float WorldScale = LocalToWorld.GetMaxScale();
+	return FMeshLodBuilder::SelectLod(m_Lods, WorldBounds, WorldScale, Camera, ViewportHeight, MaxPixelError);
 }
 
 void MeshData::ComputeBoundingBox()
@@ -284,6 +587,27 @@ void MeshData::ComputeBoundingBox()
 		m_BoundMin = Min(m_BoundMin, m_positions[i]);
 		m_BoundMax = Max(m_BoundMax, m_positions[i]);
 	}
+
+	for (size_t i = 0; i < m_submeshes.size(); ++i)
+	{
+		ComputeSubMeshBounds(m_submeshes[i]);
+	}
+}
+
+void MeshData::ComputeSubMeshBounds(SubMeshData& SubMesh) const
+{
+	SubMesh.Bounds = FBoundingBox();
+	// the range of a submesh added with count 0 can reach past the end of the index buffer
+	size_t End = (std::min)((size_t)SubMesh.StartIndex + SubMesh.IndexCount, m_indices.size());
+	for (size_t i = SubMesh.StartIndex; i < End; ++i)
+	{
+		uint32_t Index = m_indices[i];
+		if (Index < m_positions.size())
+		{
+			SubMesh.Bounds.BoundMin = Min(SubMesh.Bounds.BoundMin, m_positions[Index]);
+			SubMesh.Bounds.BoundMax = Max(SubMesh.Bounds.BoundMax, m_positions[Index]);
+		}
+	}
 }
 
 void MeshData::GetBoundingBox(Vector3f& BoundMin, Vector3f& BoundMax)
@@ -294,56 +618,114 @@ void MeshData::GetBoundingBox(Vector3f& BoundMin, Vector3f& BoundMax)
 
 void MeshData::GetMeshLayout(std::vector<D3D12_INPUT_ELEMENT_DESC>& MeshLayout)
 {
+	// the formats follow the streams, a compressed mesh needs the decode functions of VertexCompression.hlsl
 	UINT slot = 0;
 	if (this->HasVertexElement(VET_Position))
 	{
-		MeshLayout.push_back({ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+		MeshLayout.push_back({ "POSITION", 0, GetStreamFormat(VET_Position), slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
 	}
 	if (this->HasVertexElement(VET_Color))
 	{
-		MeshLayout.push_back({ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+		MeshLayout.push_back({ "COLOR", 0, GetStreamFormat(VET_Color), slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
 	}
 	if (this->HasVertexElement(VET_Texcoord))
 	{
-		MeshLayout.push_back({ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+		MeshLayout.push_back({ "TEXCOORD", 0, GetStreamFormat(VET_Texcoord), slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
 	}
 	if (this->HasVertexElement(VET_Normal))
 	{
-		MeshLayout.push_back({ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+		MeshLayout.push_back({ "NORMAL", 0, GetStreamFormat(VET_Normal), slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
 	}
 	if (this->HasVertexElement(VET_Tangent))
 	{
-		MeshLayout.push_back({ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+		MeshLayout.push_back({ "TANGENT", 0, GetStreamFormat(VET_Tangent), slot++, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
 	}
 }
 
 void MeshData::InitRenderingResource()
 {
+	CompressVertexStreams();
 	for (int i = 0; i < VET_Max; ++i)
 	{
 		VertexElementType elmType = VertexElementType(i);
 		if (this->HasVertexElement(elmType))
 		{
-			m_VertexBuffer[i].Create(L"VertexStream", this->GetVertexCount(), this->GetVertexStride(elmType), this->GetVertexData(elmType));
+			m_VertexBuffer[i].Create(L"VertexStream", this->GetVertexCount(), this->GetStreamStride(elmType), this->GetStreamData(elmType));
 		}
 	}
 
+	PackIndices();
 	m_IndexBuffer.Create(L"MeshIndexBuffer", this->GetIndexCount(), this->GetIndexElementSize(), this->GetIndexData());
+	m_LodIndexBuffers.clear();
+	for (size_t l = 0; l < m_Lods.size(); ++l)
+	{
+		const FMeshLod& Lod = m_Lods[l];
+		m_LodIndexBuffers.emplace_back(new FGpuBuffer());
+		if (Lod.PackedIndices.empty())
+			m_LodIndexBuffers.back()->Create(L"MeshLodIndexBuffer", (uint32_t)Lod.Indices.size(), sizeof(uint32_t), Lod.Indices.data());
+		else
+			m_LodIndexBuffers.back()->Create(L"MeshLodIndexBuffer", (uint32_t)Lod.PackedIndices.size(), sizeof(uint16_t), Lod.PackedIndices.data());
+	}
+
+	if (!m_MaterialTable)
+	{
+		m_MaterialTable = std::make_shared<FMaterialTable>(m_materials);
+	}
+	m_MaterialTable->InitRenderingResource();
+}
 
-	uint32_t MaterialCount = (uint32_t)this->GetMaterialCount();
-	m_Textures.resize(MaterialCount * TEX_PER_MATERIAL);
-	for (uint32_t i = 0; i < MaterialCount; ++i)
+std::string FMaterialTable::GetTexturePath(const MaterialData* Material, int TexIndex)
+{
+	std::string result;
+	if (Material)
 	{
-		MaterialData MtlData = this->GetMaterialData(i);
 		//basecolor, opacity, emissive, metallic, roughness, ao, normal
-		m_Textures[TEX_PER_MATERIAL * i + 0].LoadFromFile(ToWideString(this->GetBaseColorPath(i)), true);
-		m_Textures[TEX_PER_MATERIAL * i + 1].LoadFromFile(ToWideString(this->GetOpacityPath(i)), false);
-		m_Textures[TEX_PER_MATERIAL * i + 2].LoadFromFile(ToWideString(this->GetEmissivePath(i)), true);
-		m_Textures[TEX_PER_MATERIAL * i + 3].LoadFromFile(ToWideString(this->GetMetallicPath(i)), false);
-		m_Textures[TEX_PER_MATERIAL * i + 4].LoadFromFile(ToWideString(this->GetRoughnessPath(i)), false);
-		m_Textures[TEX_PER_MATERIAL * i + 5].LoadFromFile(ToWideString(this->GetAOPath(i)), false);
-		m_Textures[TEX_PER_MATERIAL * i + 6].LoadFromFile(ToWideString(this->GetNormalPath(i)), false);
+		const std::string* Paths[MeshData::TEX_PER_MATERIAL] = {
+			&Material->BaseColorPath, &Material->OpacityPath, &Material->EmissivePath, &Material->MetallicPath,
+			&Material->RoughnessPath, &Material->AoPath, &Material->NormalPath
+		};
+		result = *Paths[TexIndex];
 	}
+	if (result.empty())
+	{
+		static const char* DefaultPaths[MeshData::TEX_PER_MATERIAL] = {
+			"../Resources/Textures/white.png", "../Resources/Textures/white.png", "../Resources/Textures/black.png", "../Resources/Textures/black.png",
+			"../Resources/Textures/black.png", "../Resources/Textures/white.png", "../Resources/Textures/default_normal.png"
+		};
+		result = DefaultPaths[TexIndex];
+	}
+	return result;
+}
+
+bool FMaterialTable::IsSRGBTexture(int TexIndex)
+{
+	// basecolor and emissive
+	return TexIndex == 0 || TexIndex == 2;
+}
+
+void FMaterialTable::InitRenderingResource()
+{
+	if (m_Initialized)
+		return;
+	m_Initialized = true;
+
+	m_Textures.resize(m_Materials.size() * MeshData::TEX_PER_MATERIAL);
+	for (size_t i = 0; i < m_Materials.size(); ++i)
+	{
+		for (int j = 0; j < MeshData::TEX_PER_MATERIAL; ++j)
+		{
+			m_Textures[MeshData::TEX_PER_MATERIAL * i + j] = FTextureRegistry::Acquire(GetTexturePath(&m_Materials[i], j), IsSRGBTexture(j));
+		}
+	}
+}
+
+FTexture* FMaterialTable::GetTexture(uint32_t MtlIndex, int TexIndex) const
+{
+	size_t Index = MeshData::TEX_PER_MATERIAL * (size_t)MtlIndex + TexIndex;
+	if (Index < m_Textures.size())
+		return m_Textures[Index].get();
+	else
+		return nullptr;
 }
 
 MeshPlane::MeshPlane()
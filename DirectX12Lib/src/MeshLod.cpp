@@ -0,0 +1,725 @@
+#include "MeshLod.h"
+#include "MeshData.h"
+#include "Camera.h"
+#include "Parallel.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	const uint32_t MAX_ATTRIBUTES = 8;	// position, texcoord, normal
+	const uint32_t QUADRIC_SIZE = MAX_ATTRIBUTES * (MAX_ATTRIBUTES + 1) / 2;
+	// positions are normalized to the mesh extent, the attributes are weighted against that
+	const float TEXCOORD_WEIGHT = 1.f;
+	const float NORMAL_WEIGHT = 0.5f;
+	const float BORDER_WEIGHT = 10.f;
+	const uint32_t NoVertex = 0xffffffff;
+
+	enum EVertexKind : uint8_t
+	{
+		VK_Manifold,
+		VK_Border,	// on an open edge, only collapses along it
+		VK_Seam,	// one of two vertices at a position, collapses together with its sibling
+		VK_Locked,
+	};
+
+	// error(x) = x'Ax + 2b'x + c over the attribute vector x, A symmetric and stored as its upper triangle.
+	// W sums the weights, error / W is a mean squared distance
+	// kept in double, the error of a fine mesh is many orders below the coefficients
+	struct FQuadric
+	{
+		double A[QUADRIC_SIZE];
+		double B[MAX_ATTRIBUTES];
+		double C;
+		double W;
+	};
+
+	void AddQuadric(FQuadric& Q, const FQuadric& Other)
+	{
+		for (uint32_t i = 0; i < QUADRIC_SIZE; ++i)
+			Q.A[i] += Other.A[i];
+		for (uint32_t i = 0; i < MAX_ATTRIBUTES; ++i)
+			Q.B[i] += Other.B[i];
+		Q.C += Other.C;
+		Q.W += Other.W;
+	}
+
+	double EvaluateQuadric(const FQuadric& Q, const float* X, uint32_t N)
+	{
+		double Result = Q.C;
+		uint32_t k = 0;
+		for (uint32_t i = 0; i < N; ++i)
+		{
+			Result += 2.0 * Q.B[i] * X[i] + Q.A[k++] * X[i] * X[i];
+			for (uint32_t j = i + 1; j < N; ++j)
+				Result += 2.0 * Q.A[k++] * X[i] * X[j];
+		}
+		return Result;
+	}
+
+	// squared distance to the plane of the triangle in attribute space (Garland-Heckbert 1998)
+	void AddTriangleQuadric(FQuadric& Q, const float* P0, const float* P1, const float* P2, uint32_t N, float Weight)
+	{
+		double E1[MAX_ATTRIBUTES], E2[MAX_ATTRIBUTES];
+		double Length1 = 0.0, Projection = 0.0, Length2 = 0.0;
+		for (uint32_t i = 0; i < N; ++i)
+		{
+			E1[i] = (double)P1[i] - P0[i];
+			Length1 += E1[i] * E1[i];
+		}
+		if (Length1 <= 0.0)
+			return;
+		Length1 = sqrt(Length1);
+		for (uint32_t i = 0; i < N; ++i)
+		{
+			E1[i] /= Length1;
+			E2[i] = (double)P2[i] - P0[i];
+			Projection += E2[i] * E1[i];
+		}
+		for (uint32_t i = 0; i < N; ++i)
+		{
+			E2[i] -= Projection * E1[i];
+			Length2 += E2[i] * E2[i];
+		}
+		if (Length2 <= 0.0)
+			return;
+		Length2 = sqrt(Length2);
+
+		double PE1 = 0.0, PE2 = 0.0, PP = 0.0;
+		for (uint32_t i = 0; i < N; ++i)
+		{
+			E2[i] /= Length2;
+			PE1 += P0[i] * E1[i];
+			PE2 += P0[i] * E2[i];
+			PP += (double)P0[i] * P0[i];
+		}
+
+		uint32_t k = 0;
+		for (uint32_t i = 0; i < N; ++i)
+		{
+			for (uint32_t j = i; j < N; ++j)
+				Q.A[k++] += Weight * ((i == j ? 1.0 : 0.0) - E1[i] * E1[j] - E2[i] * E2[j]);
+			Q.B[i] += Weight * (PE1 * E1[i] + PE2 * E2[i] - P0[i]);
+		}
+		Q.C += Weight * (PP - PE1 * PE1 - PE2 * PE2);
+		Q.W += Weight;
+	}
+
+	// plane through Point with a unit Normal, on the position part only
+	void AddPlaneQuadric(FQuadric& Q, const Vector3f& Normal, const Vector3f& Point, uint32_t N, float Weight)
+	{
+		double D = -Normal.Dot(Point);
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			// row i of the packed upper triangle starts at i * N - i * (i - 1) / 2
+			uint32_t Row = i * N - i * (i - 1) / 2;
+			for (uint32_t j = i; j < 3; ++j)
+				Q.A[Row + j - i] += (double)Weight * Normal[i] * Normal[j];
+			Q.B[i] += Weight * D * Normal[i];
+		}
+		Q.C += Weight * D * D;
+		Q.W += Weight;
+	}
+
+	uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+	}
+
+	class FSimplifier
+	{
+	public:
+		FSimplifier(const MeshData& Mesh, const uint32_t* Indices, uint32_t IndexCount);
+
+		// returns the largest collapse error in normalized units
+		float Run(uint32_t TargetTriangleCount);
+		uint32_t WriteIndices(uint32_t* Indices) const;
+		float GetScale() const { return m_Scale; }
+
+	private:
+		struct FCollapse
+		{
+			uint32_t From, To;
+			uint32_t SiblingFrom, SiblingTo;
+			double Cost;
+		};
+
+		const float* GetAttributes(uint32_t v) const { return &m_Attributes[v * m_N]; }
+		Vector3f GetPosition(uint32_t v) const { return Vector3f::MakeVector(GetAttributes(v)); }
+		const uint32_t* GetTriangle(uint32_t t) const { return &m_Triangles[t * 3]; }
+
+		void ClassifyVertices();
+		void ComputeQuadrics();
+		void BuildAdjacency();
+		bool IsWeldedBorderEdge(uint32_t a, uint32_t b) const;
+		uint32_t CountSharedTriangles(uint32_t u, uint32_t v, bool Welded) const;
+		bool CanCollapse(uint32_t u, uint32_t v, FCollapse& Collapse) const;
+		bool KeepsManifold(uint32_t u, uint32_t v) const;
+		bool HasFlip(uint32_t u, uint32_t v) const;
+		double GetCost(uint32_t u, uint32_t v) const;
+
+		uint32_t m_N;
+		float m_Scale;
+		std::vector<uint32_t> m_Vertices;		// mesh vertex of every local vertex
+		std::vector<uint32_t> m_Triangles;		// local vertices
+		std::vector<float> m_Attributes;		// m_N floats per vertex
+		std::vector<uint32_t> m_Weld;			// first vertex at the same position
+		std::vector<uint32_t> m_Sibling;		// the other vertex of a seam
+		std::vector<uint8_t> m_Kind;
+		std::vector<uint64_t> m_WeldedEdges;	// sorted, one entry per triangle side
+		std::vector<FQuadric> m_Quadrics;
+		std::vector<uint32_t> m_AdjacencyOffsets;
+		std::vector<uint32_t> m_Adjacency;		// triangles around every vertex
+	};
+
+	FSimplifier::FSimplifier(const MeshData& Mesh, const uint32_t* Indices, uint32_t IndexCount)
+	{
+		bool HasTexcoord = !Mesh.m_texcoords.empty();
+		bool HasNormal = !Mesh.m_normals.empty();
+		m_N = 3 + (HasTexcoord ? 2 : 0) + (HasNormal ? 3 : 0);
+
+		m_Vertices.assign(Indices, Indices + IndexCount);
+		std::sort(m_Vertices.begin(), m_Vertices.end());
+		m_Vertices.erase(std::unique(m_Vertices.begin(), m_Vertices.end()), m_Vertices.end());
+
+		m_Triangles.reserve(IndexCount);
+		for (uint32_t i = 0; i + 2 < IndexCount; i += 3)
+		{
+			uint32_t Triangle[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				Triangle[k] = (uint32_t)(std::lower_bound(m_Vertices.begin(), m_Vertices.end(), Indices[i + k]) - m_Vertices.begin());
+			}
+			if (Triangle[0] != Triangle[1] && Triangle[1] != Triangle[2] && Triangle[2] != Triangle[0])
+				m_Triangles.insert(m_Triangles.end(), Triangle, Triangle + 3);
+		}
+
+		Vector3f BoundMin(std::numeric_limits<float>::max());
+		Vector3f BoundMax(-std::numeric_limits<float>::max());
+		for (size_t v = 0; v < m_Vertices.size(); ++v)
+		{
+			BoundMin = Min(BoundMin, Mesh.m_positions[m_Vertices[v]]);
+			BoundMax = Max(BoundMax, Mesh.m_positions[m_Vertices[v]]);
+		}
+		Vector3f Extent = BoundMax - BoundMin;
+		m_Scale = std::max(std::max(Extent.x, Extent.y), Extent.z);
+		if (!(m_Scale > 0.f))
+			m_Scale = 1.f;
+
+		m_Attributes.resize(m_Vertices.size() * m_N);
+		for (size_t v = 0; v < m_Vertices.size(); ++v)
+		{
+			float* Attributes = &m_Attributes[v * m_N];
+			uint32_t MeshVertex = m_Vertices[v];
+			Vector3f Position = (Mesh.m_positions[MeshVertex] - BoundMin) * (1.f / m_Scale);
+			*Attributes++ = Position.x;
+			*Attributes++ = Position.y;
+			*Attributes++ = Position.z;
+			if (HasTexcoord)
+			{
+				*Attributes++ = Mesh.m_texcoords[MeshVertex].x * TEXCOORD_WEIGHT;
+				*Attributes++ = Mesh.m_texcoords[MeshVertex].y * TEXCOORD_WEIGHT;
+			}
+			if (HasNormal)
+			{
+				*Attributes++ = Mesh.m_normals[MeshVertex].x * NORMAL_WEIGHT;
+				*Attributes++ = Mesh.m_normals[MeshVertex].y * NORMAL_WEIGHT;
+				*Attributes++ = Mesh.m_normals[MeshVertex].z * NORMAL_WEIGHT;
+			}
+		}
+
+		ClassifyVertices();
+		ComputeQuadrics();
+	}
+
+	void FSimplifier::ClassifyVertices()
+	{
+		uint32_t VertexCount = (uint32_t)m_Vertices.size();
+
+		// vertices at one position differ in their attributes, the loaders merge the others
+		std::vector<uint32_t> Order(VertexCount);
+		std::iota(Order.begin(), Order.end(), 0);
+		std::sort(Order.begin(), Order.end(), [this](uint32_t a, uint32_t b)
+		{
+			const float* A = GetAttributes(a);
+			const float* B = GetAttributes(b);
+			return std::lexicographical_compare(A, A + 3, B, B + 3);
+		});
+		m_Weld.resize(VertexCount);
+		std::vector<uint32_t> GroupSizes(VertexCount, 0);
+		for (uint32_t i = 0; i < VertexCount; ++i)
+		{
+			bool SamePosition = i > 0 && std::equal(GetAttributes(Order[i]), GetAttributes(Order[i]) + 3, GetAttributes(Order[i - 1]));
+			m_Weld[Order[i]] = SamePosition ? m_Weld[Order[i - 1]] : Order[i];
+			GroupSizes[m_Weld[Order[i]]]++;
+		}
+
+		std::vector<uint64_t> IndexEdges;
+		IndexEdges.reserve(m_Triangles.size());
+		m_WeldedEdges.reserve(m_Triangles.size());
+		for (size_t i = 0; i < m_Triangles.size(); i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = m_Triangles[i + k];
+				uint32_t b = m_Triangles[i + (k + 1) % 3];
+				IndexEdges.push_back(GetEdgeKey(a, b));
+				if (m_Weld[a] != m_Weld[b])
+					m_WeldedEdges.push_back(GetEdgeKey(m_Weld[a], m_Weld[b]));
+			}
+		}
+		std::sort(IndexEdges.begin(), IndexEdges.end());
+		std::sort(m_WeldedEdges.begin(), m_WeldedEdges.end());
+
+		// open edges of the welded surface are borders, the ones of the index topology also run along the seams
+		std::vector<uint32_t> BorderEdges(VertexCount, 0);
+		std::vector<uint32_t> IndexBorderEdges(VertexCount, 0);
+		std::vector<bool> NonManifold(VertexCount, false);
+		for (size_t i = 0, Next; i < m_WeldedEdges.size(); i = Next)
+		{
+			for (Next = i + 1; Next < m_WeldedEdges.size() && m_WeldedEdges[Next] == m_WeldedEdges[i]; ++Next);
+			uint32_t a = (uint32_t)(m_WeldedEdges[i] >> 32);
+			uint32_t b = (uint32_t)m_WeldedEdges[i];
+			if (Next - i == 1)
+			{
+				BorderEdges[a]++;
+				BorderEdges[b]++;
+			}
+			else if (Next - i > 2)
+			{
+				NonManifold[a] = NonManifold[b] = true;
+			}
+		}
+		for (size_t i = 0, Next; i < IndexEdges.size(); i = Next)
+		{
+			for (Next = i + 1; Next < IndexEdges.size() && IndexEdges[Next] == IndexEdges[i]; ++Next);
+			if (Next - i == 1)
+			{
+				IndexBorderEdges[(uint32_t)(IndexEdges[i] >> 32)]++;
+				IndexBorderEdges[(uint32_t)IndexEdges[i]]++;
+			}
+		}
+
+		m_Kind.assign(VertexCount, VK_Locked);
+		m_Sibling.assign(VertexCount, NoVertex);
+		for (uint32_t i = 0; i < VertexCount; ++i)
+		{
+			uint32_t v = Order[i];
+			uint32_t w = m_Weld[v];
+			if (NonManifold[w])
+				continue;
+			if (GroupSizes[w] == 1)
+			{
+				// a vertex with more than two open edges joins separate borders
+				if (BorderEdges[w] == 0)
+					m_Kind[v] = VK_Manifold;
+				else if (BorderEdges[w] == 2)
+					m_Kind[v] = VK_Border;
+			}
+			else if (GroupSizes[w] == 2 && BorderEdges[w] == 0 && IndexBorderEdges[v] == 2)
+			{
+				// the group is adjacent in Order
+				uint32_t Other = (i > 0 && m_Weld[Order[i - 1]] == w) ? Order[i - 1] : Order[i + 1];
+				if (IndexBorderEdges[Other] == 2)
+				{
+					m_Kind[v] = VK_Seam;
+					m_Sibling[v] = Other;
+				}
+			}
+		}
+	}
+
+	bool FSimplifier::IsWeldedBorderEdge(uint32_t a, uint32_t b) const
+	{
+		auto Range = std::equal_range(m_WeldedEdges.begin(), m_WeldedEdges.end(), GetEdgeKey(m_Weld[a], m_Weld[b]));
+		return Range.second - Range.first == 1;
+	}
+
+	void FSimplifier::ComputeQuadrics()
+	{
+		m_Quadrics.assign(m_Vertices.size(), FQuadric());
+		memset(m_Quadrics.data(), 0, m_Quadrics.size() * sizeof(FQuadric));
+
+		for (size_t i = 0; i < m_Triangles.size(); i += 3)
+		{
+			const uint32_t* Triangle = &m_Triangles[i];
+			Vector3f P0 = GetPosition(Triangle[0]);
+			Vector3f FaceNormal = Cross(GetPosition(Triangle[1]) - P0, GetPosition(Triangle[2]) - P0);
+			float Area = FaceNormal.Length() * 0.5f;
+
+			FQuadric Face;
+			memset(&Face, 0, sizeof(Face));
+			AddTriangleQuadric(Face, GetAttributes(Triangle[0]), GetAttributes(Triangle[1]), GetAttributes(Triangle[2]), m_N, Area);
+			for (int k = 0; k < 3; ++k)
+			{
+				AddQuadric(m_Quadrics[Triangle[k]], Face);
+			}
+
+			// planes perpendicular to the open edges keep the borders in place
+			FaceNormal = FaceNormal.SafeNormalize(0.f);
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = Triangle[k];
+				uint32_t b = Triangle[(k + 1) % 3];
+				if (!IsWeldedBorderEdge(a, b))
+					continue;
+				Vector3f Edge = GetPosition(b) - GetPosition(a);
+				Vector3f EdgeNormal = Cross(Edge, FaceNormal).SafeNormalize(0.f);
+				AddPlaneQuadric(m_Quadrics[a], EdgeNormal, GetPosition(a), m_N, BORDER_WEIGHT * Edge.Dot(Edge));
+				AddPlaneQuadric(m_Quadrics[b], EdgeNormal, GetPosition(a), m_N, BORDER_WEIGHT * Edge.Dot(Edge));
+			}
+		}
+	}
+
+	void FSimplifier::BuildAdjacency()
+	{
+		m_AdjacencyOffsets.assign(m_Vertices.size() + 1, 0);
+		for (size_t i = 0; i < m_Triangles.size(); ++i)
+		{
+			m_AdjacencyOffsets[m_Triangles[i] + 1]++;
+		}
+		for (size_t v = 0; v < m_Vertices.size(); ++v)
+		{
+			m_AdjacencyOffsets[v + 1] += m_AdjacencyOffsets[v];
+		}
+		m_Adjacency.resize(m_Triangles.size());
+		std::vector<uint32_t> Fill(m_AdjacencyOffsets.begin(), m_AdjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < m_Triangles.size(); ++i)
+		{
+			m_Adjacency[Fill[m_Triangles[i]]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	uint32_t FSimplifier::CountSharedTriangles(uint32_t u, uint32_t v, bool Welded) const
+	{
+		uint32_t Count = 0;
+		for (uint32_t i = m_AdjacencyOffsets[u]; i < m_AdjacencyOffsets[u + 1]; ++i)
+		{
+			const uint32_t* Triangle = GetTriangle(m_Adjacency[i]);
+			for (int k = 0; k < 3; ++k)
+			{
+				if (Welded ? m_Weld[Triangle[k]] == m_Weld[v] : Triangle[k] == v)
+				{
+					Count++;
+					break;
+				}
+			}
+		}
+		return Count;
+	}
+
+	bool FSimplifier::CanCollapse(uint32_t u, uint32_t v, FCollapse& Collapse) const
+	{
+		Collapse.From = u;
+		Collapse.To = v;
+		Collapse.SiblingFrom = Collapse.SiblingTo = NoVertex;
+		switch (m_Kind[u])
+		{
+		case VK_Manifold:
+			return true;
+		case VK_Border:
+			// u is alone at its position, so this counts the triangles of the welded edge
+			return CountSharedTriangles(u, v, true) == 1;
+		case VK_Seam:
+			// along the seam, where both sides have an edge between the two positions
+			if (m_Kind[v] != VK_Seam || CountSharedTriangles(u, v, false) != 1)
+				return false;
+			if (CountSharedTriangles(m_Sibling[u], m_Sibling[v], false) != 1)
+				return false;
+			Collapse.SiblingFrom = m_Sibling[u];
+			Collapse.SiblingTo = m_Sibling[v];
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool FSimplifier::KeepsManifold(uint32_t u, uint32_t v) const
+	{
+		// link condition, u and v may only share the neighbours across the collapsing triangles
+		auto GatherNeighbours = [this](uint32_t Vertex, std::vector<uint32_t>& Neighbours)
+		{
+			uint32_t Group[2] = { Vertex, m_Sibling[Vertex] };
+			for (int g = 0; g < 2 && Group[g] != NoVertex; ++g)
+			{
+				for (uint32_t i = m_AdjacencyOffsets[Group[g]]; i < m_AdjacencyOffsets[Group[g] + 1]; ++i)
+				{
+					const uint32_t* Triangle = GetTriangle(m_Adjacency[i]);
+					for (int k = 0; k < 3; ++k)
+					{
+						if (m_Weld[Triangle[k]] != m_Weld[Vertex])
+							Neighbours.push_back(m_Weld[Triangle[k]]);
+					}
+				}
+			}
+			std::sort(Neighbours.begin(), Neighbours.end());
+			Neighbours.erase(std::unique(Neighbours.begin(), Neighbours.end()), Neighbours.end());
+		};
+
+		std::vector<uint32_t> NeighboursU, NeighboursV;
+		GatherNeighbours(u, NeighboursU);
+		GatherNeighbours(v, NeighboursV);
+		uint32_t Common = 0;
+		for (size_t i = 0, j = 0; i < NeighboursU.size() && j < NeighboursV.size();)
+		{
+			if (NeighboursU[i] < NeighboursV[j])
+				++i;
+			else if (NeighboursV[j] < NeighboursU[i])
+				++j;
+			else
+				++Common, ++i, ++j;
+		}
+		uint32_t Shared = CountSharedTriangles(u, v, true);
+		if (m_Sibling[u] != NoVertex)
+			Shared += CountSharedTriangles(m_Sibling[u], v, true);
+		return Common == Shared;
+	}
+
+	bool FSimplifier::HasFlip(uint32_t u, uint32_t v) const
+	{
+		Vector3f Target = GetPosition(v);
+		for (uint32_t i = m_AdjacencyOffsets[u]; i < m_AdjacencyOffsets[u + 1]; ++i)
+		{
+			const uint32_t* Triangle = GetTriangle(m_Adjacency[i]);
+			Vector3f Before[3], After[3];
+			bool Collapsing = false;
+			for (int k = 0; k < 3; ++k)
+			{
+				Collapsing |= m_Weld[Triangle[k]] == m_Weld[v];
+				Before[k] = GetPosition(Triangle[k]);
+				After[k] = Triangle[k] == u ? Target : Before[k];
+			}
+			if (Collapsing)
+				continue;
+			Vector3f NormalBefore = Cross(Before[1] - Before[0], Before[2] - Before[0]);
+			Vector3f NormalAfter = Cross(After[1] - After[0], After[2] - After[0]);
+			if (NormalBefore.Dot(NormalAfter) <= 0.f)
+				return true;
+		}
+		return false;
+	}
+
+	double FSimplifier::GetCost(uint32_t u, uint32_t v) const
+	{
+		// u takes the attributes of v
+		const float* X = GetAttributes(v);
+		double Weight = m_Quadrics[u].W + m_Quadrics[v].W;
+		if (Weight <= 0.0)
+			return 0.0;
+		return (EvaluateQuadric(m_Quadrics[u], X, m_N) + EvaluateQuadric(m_Quadrics[v], X, m_N)) / Weight;
+	}
+
+	float FSimplifier::Run(uint32_t TargetTriangleCount)
+	{
+		uint32_t VertexCount = (uint32_t)m_Vertices.size();
+		double MaxError = 0.0;
+		std::vector<uint32_t> Neighbours;
+		std::vector<FCollapse> Collapses;
+		std::vector<uint32_t> Remap(VertexCount);
+		std::vector<bool> Touched(VertexCount);
+
+		// every pass collapses the cheapest edges whose neighbourhoods do not overlap
+		while (m_Triangles.size() / 3 > TargetTriangleCount)
+		{
+			BuildAdjacency();
+
+			// every edge once, from its lower vertex
+			Collapses.clear();
+			for (uint32_t a = 0; a < VertexCount; ++a)
+			{
+				Neighbours.clear();
+				for (uint32_t i = m_AdjacencyOffsets[a]; i < m_AdjacencyOffsets[a + 1]; ++i)
+				{
+					const uint32_t* Triangle = GetTriangle(m_Adjacency[i]);
+					for (int k = 0; k < 3; ++k)
+					{
+						if (Triangle[k] > a)
+							Neighbours.push_back(Triangle[k]);
+					}
+				}
+				std::sort(Neighbours.begin(), Neighbours.end());
+				Neighbours.erase(std::unique(Neighbours.begin(), Neighbours.end()), Neighbours.end());
+
+				for (size_t n = 0; n < Neighbours.size(); ++n)
+				{
+					uint32_t b = Neighbours[n];
+					FCollapse Best, Candidate;
+					Best.Cost = std::numeric_limits<double>::max();
+					if (CanCollapse(a, b, Candidate))
+					{
+						Candidate.Cost = GetCost(a, b) + (Candidate.SiblingFrom != NoVertex ? GetCost(Candidate.SiblingFrom, Candidate.SiblingTo) : 0.0);
+						Best = Candidate;
+					}
+					if (CanCollapse(b, a, Candidate))
+					{
+						Candidate.Cost = GetCost(b, a) + (Candidate.SiblingFrom != NoVertex ? GetCost(Candidate.SiblingFrom, Candidate.SiblingTo) : 0.0);
+						if (Candidate.Cost < Best.Cost)
+							Best = Candidate;
+					}
+					if (Best.Cost < std::numeric_limits<double>::max())
+						Collapses.push_back(Best);
+				}
+			}
+			if (Collapses.empty())
+				break;
+
+			// an edge collapse removes about two triangles, the pass stops well before the costs grow
+			auto CostLess = [](const FCollapse& a, const FCollapse& b) { return a.Cost < b.Cost; };
+			uint32_t TrianglesToRemove = (uint32_t)(m_Triangles.size() / 3) - TargetTriangleCount;
+			size_t Goal = std::min(Collapses.size(), (size_t)(TrianglesToRemove + 1) / 2);
+			std::nth_element(Collapses.begin(), Collapses.begin() + (Goal - 1), Collapses.end(), CostLess);
+			double PassLimit = std::max(Collapses[Goal - 1].Cost * 1.5, 1e-12);
+			auto PassEnd = std::partition(Collapses.begin(), Collapses.end(), [PassLimit](const FCollapse& c) { return c.Cost <= PassLimit; });
+			std::sort(Collapses.begin(), PassEnd, CostLess);
+
+			std::iota(Remap.begin(), Remap.end(), 0);
+			std::fill(Touched.begin(), Touched.end(), false);
+			uint32_t Removed = 0;
+			uint32_t Applied = 0;
+			for (auto It = Collapses.begin(); It != PassEnd && Removed < TrianglesToRemove; ++It)
+			{
+				const FCollapse& Collapse = *It;
+				bool HasSibling = Collapse.SiblingFrom != NoVertex;
+				if (Touched[Collapse.From] || Touched[Collapse.To] || (HasSibling && (Touched[Collapse.SiblingFrom] || Touched[Collapse.SiblingTo])))
+					continue;
+				if (!KeepsManifold(Collapse.From, Collapse.To) || HasFlip(Collapse.From, Collapse.To))
+					continue;
+				if (HasSibling && HasFlip(Collapse.SiblingFrom, Collapse.SiblingTo))
+					continue;
+
+				uint32_t From[2] = { Collapse.From, Collapse.SiblingFrom };
+				uint32_t To[2] = { Collapse.To, Collapse.SiblingTo };
+				for (int s = 0; s < (HasSibling ? 2 : 1); ++s)
+				{
+					Remap[From[s]] = To[s];
+					AddQuadric(m_Quadrics[To[s]], m_Quadrics[From[s]]);
+					Removed += CountSharedTriangles(From[s], To[s], false);
+					Touched[To[s]] = true;
+					for (uint32_t i = m_AdjacencyOffsets[From[s]]; i < m_AdjacencyOffsets[From[s] + 1]; ++i)
+					{
+						const uint32_t* Triangle = GetTriangle(m_Adjacency[i]);
+						Touched[Triangle[0]] = Touched[Triangle[1]] = Touched[Triangle[2]] = true;
+					}
+				}
+				MaxError = std::max(MaxError, Collapse.Cost);
+				Applied++;
+			}
+			if (Applied == 0)
+				break;
+
+			size_t Write = 0;
+			for (size_t i = 0; i < m_Triangles.size(); i += 3)
+			{
+				uint32_t a = Remap[m_Triangles[i]];
+				uint32_t b = Remap[m_Triangles[i + 1]];
+				uint32_t c = Remap[m_Triangles[i + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+				m_Triangles[Write++] = a;
+				m_Triangles[Write++] = b;
+				m_Triangles[Write++] = c;
+			}
+			m_Triangles.resize(Write);
+		}
+		return (float)sqrt(std::max(MaxError, 0.0));
+	}
+
+	uint32_t FSimplifier::WriteIndices(uint32_t* Indices) const
+	{
+		for (size_t i = 0; i < m_Triangles.size(); ++i)
+		{
+			Indices[i] = m_Vertices[m_Triangles[i]];
+		}
+		return (uint32_t)m_Triangles.size();
+	}
+}
+
+uint32_t FMeshLodBuilder::Simplify(const MeshData& Mesh, uint32_t* Indices, uint32_t IndexCount, uint32_t TargetIndexCount, float* ResultError)
+{
+	FSimplifier Simplifier(Mesh, Indices, IndexCount);
+	float Error = Simplifier.Run(TargetIndexCount / 3);
+	if (ResultError)
+		*ResultError = Error * Simplifier.GetScale();
+	return Simplifier.WriteIndices(Indices);
+}
+
+void FMeshLodBuilder::Build(const MeshData& Mesh, std::vector<FMeshLod>& Lods, uint32_t MaxLods, float TargetRatio)
+{
+	Lods.clear();
+	if (MaxLods <= 1 || Mesh.m_submeshes.empty())
+		return;
+	Assert(TargetRatio > 0.f && TargetRatio < 1.f);
+
+	struct FLevelResult
+	{
+		std::vector<uint32_t> Indices;
+		uint32_t SourceCount = 0;
+		float Error = 0.f;
+	};
+
+	// every level starts from the full submesh, so all (submesh, level) pairs are independent
+	uint32_t LevelCount = MaxLods - 1;
+	uint32_t SubMeshCount = (uint32_t)Mesh.m_submeshes.size();
+	std::vector<FLevelResult> Results(SubMeshCount * LevelCount);
+	FParallel::For((uint32_t)Results.size(), [&](uint32_t Job)
+	{
+		const SubMeshData& SubMesh = Mesh.m_submeshes[Job / LevelCount];
+		uint32_t Level = Job % LevelCount + 1;
+		size_t Start = std::min((size_t)SubMesh.StartIndex, Mesh.m_indices.size());
+		size_t End = std::min((size_t)SubMesh.StartIndex + SubMesh.IndexCount, Mesh.m_indices.size());
+		uint32_t IndexCount = (uint32_t)(End - Start) / 3 * 3;
+
+		FLevelResult& Result = Results[Job];
+		Result.SourceCount = IndexCount;
+		Result.Indices.assign(Mesh.m_indices.begin() + Start, Mesh.m_indices.begin() + Start + IndexCount);
+		uint32_t TargetIndexCount = std::max((uint32_t)(IndexCount / 3 * powf(TargetRatio, (float)Level)), 1u) * 3;
+		if (Result.Indices.empty())
+			return;
+		Result.Indices.resize(Simplify(Mesh, Result.Indices.data(), IndexCount, TargetIndexCount, &Result.Error));
+	});
+
+	size_t PreviousCount = 0;
+	for (uint32_t s = 0; s < SubMeshCount; ++s)
+	{
+		PreviousCount += Results[s * LevelCount].SourceCount;
+	}
+	float PreviousError = 0.f;
+	for (uint32_t Level = 0; Level < LevelCount; ++Level)
+	{
+		FMeshLod Lod;
+		for (uint32_t s = 0; s < SubMeshCount; ++s)
+		{
+			const FLevelResult& Result = Results[s * LevelCount + Level];
+			FLodSubMesh SubMesh = { (uint32_t)Lod.Indices.size(), (uint32_t)Result.Indices.size(), 0 };
+			Lod.SubMeshes.push_back(SubMesh);
+			Lod.Indices.insert(Lod.Indices.end(), Result.Indices.begin(), Result.Indices.end());
+			Lod.Error = std::max(Lod.Error, Result.Error);
+		}
+		// stuck on locked vertices, coarser targets would give the same triangles
+		if (Lod.Indices.empty() || Lod.Indices.size() > PreviousCount * 9 / 10)
+			break;
+		// the levels are independent runs, the selector wants the errors to grow
+		Lod.Error = std::max(Lod.Error, PreviousError);
+		PreviousCount = Lod.Indices.size();
+		PreviousError = Lod.Error;
+		Lods.push_back(std::move(Lod));
+	}
+}
+
+uint32_t FMeshLodBuilder::SelectLod(const std::vector<FMeshLod>& Lods, const FBoundingBox& WorldBounds, float WorldScale, const FCamera& Camera, float ViewportHeight, float MaxPixelError)
+{
+	Vector3f Center = (WorldBounds.BoundMin + WorldBounds.BoundMax) * 0.5f;
+	float Radius = (WorldBounds.BoundMax - WorldBounds.BoundMin).Length() * 0.5f;
+	float Distance = std::max((Center - Vector3f(Camera.GetPosition())).Length() - Radius, Camera.GetNearClip());
+
+	// size of one world unit in pixels at the closest point of the bounds
+	float PixelsPerUnit = ViewportHeight / (2.f * tanf(Camera.GetFovY() * 0.5f) * Distance);
+	for (uint32_t Lod = (uint32_t)Lods.size(); Lod > 0; --Lod)
+	{
+		if (Lods[Lod - 1].Error * WorldScale * PixelsPerUnit <= MaxPixelError)
+			return Lod;
+	}
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include "MeshOptimizer.h"
+#include "MeshData.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+bool FMeshOptimizer::sm_ImportOptimization = false;
+
+namespace
+{
+	const uint32_t InvalidIndex = 0xffffffff;
+
+	// AddSubMesh widens an empty range to the whole index buffer, which can reach past its end
+	uint32_t GetClampedCount(const MeshData& Mesh, const SubMeshData& SubMesh)
+	{
+		uint32_t IndexCount = (uint32_t)Mesh.m_indices.size();
+		return SubMesh.StartIndex < IndexCount ? std::min(SubMesh.IndexCount, IndexCount - SubMesh.StartIndex) : 0;
+	}
+
+	template<typename T>
+	void PermuteStream(std::vector<T>& Stream, const std::vector<uint32_t>& Remap)
+	{
+		if (Stream.size() != Remap.size())
+			return;
+		std::vector<T> Result(Stream.size());
+		for (size_t i = 0; i < Stream.size(); ++i)
+		{
+			Result[Remap[i]] = Stream[i];
+		}
+		Stream.swap(Result);
+	}
+}
+
+void FMeshOptimizer::Optimize(MeshData& Mesh, bool PrintStats)
+{
+	FVertexCacheStats Before;
+	if (PrintStats)
+	{
+		Before = AnalyzeVertexCache(Mesh);
+	}
+
+	// submeshes are drawn on their own, each is optimized on a local vertex numbering
+	std::vector<SubMeshData> Ranges = Mesh.m_submeshes;
+	if (Ranges.empty())
+	{
+		Ranges.emplace_back(0, (uint32_t)Mesh.m_indices.size(), 0);
+	}
+	for (size_t s = 0; s < Ranges.size(); ++s)
+	{
+		Ranges[s].IndexCount = GetClampedCount(Mesh, Ranges[s]);
+	}
+
+	// reordering a range that overlaps another one would move triangles between the two, those stay as they are
+	std::sort(Ranges.begin(), Ranges.end(), [](const SubMeshData& A, const SubMeshData& B) { return A.StartIndex < B.StartIndex; });
+	std::vector<uint8_t> Overlapping(Ranges.size(), 0);
+	uint32_t MaxEnd = 0;
+	for (size_t s = 0; s < Ranges.size(); ++s)
+	{
+		uint32_t End = Ranges[s].StartIndex + Ranges[s].IndexCount;
+		bool NextOverlaps = s + 1 < Ranges.size() && Ranges[s + 1].StartIndex < End;
+		Overlapping[s] = Ranges[s].IndexCount > 0 && (MaxEnd > Ranges[s].StartIndex || NextOverlaps);
+		MaxEnd = std::max(MaxEnd, End);
+	}
+
+	std::vector<uint32_t> GlobalToLocal(Mesh.GetVertexCount(), InvalidIndex);
+	std::vector<uint32_t> LocalToGlobal;
+	std::vector<uint32_t> LocalIndices;
+	std::vector<uint32_t> ClusterStarts;
+	for (size_t s = 0; s < Ranges.size(); ++s)
+	{
+		if (Overlapping[s])
+			continue;
+		uint32_t* Indices = Mesh.m_indices.data() + Ranges[s].StartIndex;
+		uint32_t IndexCount = Ranges[s].IndexCount - Ranges[s].IndexCount % 3;
+
+		LocalToGlobal.clear();
+		LocalIndices.resize(IndexCount);
+		for (uint32_t i = 0; i < IndexCount; ++i)
+		{
+			uint32_t& Local = GlobalToLocal[Indices[i]];
+			if (Local == InvalidIndex)
+			{
+				Local = (uint32_t)LocalToGlobal.size();
+				LocalToGlobal.push_back(Indices[i]);
+			}
+			LocalIndices[i] = Local;
+		}
+
+		OptimizeVertexCache(LocalIndices.data(), IndexCount, (uint32_t)LocalToGlobal.size(), DEFAULT_CACHE_SIZE, &ClusterStarts);
+
+		for (uint32_t i = 0; i < IndexCount; ++i)
+		{
+			Indices[i] = LocalToGlobal[LocalIndices[i]];
+		}
+		for (size_t i = 0; i < LocalToGlobal.size(); ++i)
+		{
+			GlobalToLocal[LocalToGlobal[i]] = InvalidIndex;
+		}
+
+		OptimizeOverdraw(Indices, IndexCount, Mesh.m_positions.data(), ClusterStarts);
+	}
+
+	OptimizeVertexFetch(Mesh);
+
+	if (PrintStats)
+	{
+		FVertexCacheStats After = AnalyzeVertexCache(Mesh);
+		printf("MeshOptimizer: %u triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			After.TriangleCount, Before.GetACMR(), After.GetACMR(), Before.GetATVR(), After.GetATVR());
+	}
+}
+
+void FMeshOptimizer::OptimizeVertexFetch(MeshData& Mesh)
+{
+	std::vector<uint32_t> Remap;
+	RemapVertexFetch(Mesh.m_indices.data(), Mesh.m_indices.size(), Mesh.GetVertexCount(), Remap);
+
+	PermuteStream(Mesh.m_positions, Remap);
+	PermuteStream(Mesh.m_colors, Remap);
+	PermuteStream(Mesh.m_texcoords, Remap);
+	PermuteStream(Mesh.m_normals, Remap);
+	PermuteStream(Mesh.m_tangents, Remap);
+}
+
+FVertexCacheStats FMeshOptimizer::AnalyzeVertexCache(const MeshData& Mesh, uint32_t CacheSize)
+{
+	if (Mesh.m_submeshes.empty())
+	{
+		return AnalyzeVertexCache(Mesh.m_indices.data(), (uint32_t)Mesh.m_indices.size(), Mesh.GetVertexCount(), CacheSize);
+	}
+	FVertexCacheStats Stats;
+	for (size_t s = 0; s < Mesh.m_submeshes.size(); ++s)
+	{
+		const SubMeshData& SubMesh = Mesh.m_submeshes[s];
+		FVertexCacheStats SubMeshStats = AnalyzeVertexCache(Mesh.m_indices.data() + SubMesh.StartIndex, GetClampedCount(Mesh, SubMesh), Mesh.GetVertexCount(), CacheSize);
+		Stats.TriangleCount += SubMeshStats.TriangleCount;
+		Stats.VertexCount += SubMeshStats.VertexCount;
+		Stats.Misses += SubMeshStats.Misses;
+	}
+	return Stats;
+}
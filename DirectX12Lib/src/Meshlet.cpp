@@ -0,0 +1,188 @@
+#include "Meshlet.h"
+#include "MeshData.h"
+#include "Camera.h"
+#include "Common.h"
+
+#include <algorithm>
+
+void FMeshletBuilder::Build(const MeshData& Mesh, FMeshletData& Result, uint32_t MaxVertices, uint32_t MaxPrimitives)
+{
+	// local vertex indices are stored in a byte
+	Assert(MaxVertices >= 3 && MaxVertices <= 256 && MaxPrimitives >= 1);
+
+	Result = FMeshletData();
+	const uint32_t NoSlot = 0xffffffff;
+	std::vector<uint32_t> LocalSlots(Mesh.GetVertexCount(), NoSlot);
+
+	FMeshlet Current = {};
+	auto Flush = [&]()
+	{
+		if (Current.PrimitiveCount == 0)
+			return;
+		for (uint32_t i = 0; i < Current.VertexCount; ++i)
+		{
+			LocalSlots[Result.Vertices[Current.VertexOffset + i]] = NoSlot;
+		}
+		ComputeBounds(Mesh, Result, Current);
+		Result.Meshlets.push_back(Current);
+		Current = FMeshlet();
+		Current.VertexOffset = (uint32_t)Result.Vertices.size();
+		Current.PrimitiveOffset = (uint32_t)Result.Primitives.size() / 3;
+	};
+
+	for (size_t s = 0; s < Mesh.m_submeshes.size(); ++s)
+	{
+		const SubMeshData& SubMesh = Mesh.m_submeshes[s];
+		uint32_t End = (uint32_t)std::min((size_t)SubMesh.StartIndex + SubMesh.IndexCount, Mesh.m_indices.size());
+		int32_t FirstMeshlet = (int32_t)Result.Meshlets.size();
+
+		for (uint32_t i = SubMesh.StartIndex; i + 2 < End; i += 3)
+		{
+			const uint32_t* Triangle = &Mesh.m_indices[i];
+			uint32_t NewVertices = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				bool Repeated = (k > 0 && Triangle[k] == Triangle[0]) || (k > 1 && Triangle[k] == Triangle[1]);
+				if (LocalSlots[Triangle[k]] == NoSlot && !Repeated)
+					NewVertices++;
+			}
+			if (Current.VertexCount + NewVertices > MaxVertices || Current.PrimitiveCount + 1 > MaxPrimitives)
+			{
+				Flush();
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t& Slot = LocalSlots[Triangle[k]];
+				if (Slot == NoSlot)
+				{
+					Slot = Current.VertexCount++;
+					Result.Vertices.push_back(Triangle[k]);
+				}
+				Result.Primitives.push_back((uint8_t)Slot);
+			}
+			Current.PrimitiveCount++;
+		}
+		// meshlets never span two submeshes
+		Flush();
+		Result.SubMeshes.push_back(Vector2i(FirstMeshlet, (int32_t)Result.Meshlets.size() - FirstMeshlet));
+	}
+}
+
+void FMeshletBuilder::ComputeBounds(const MeshData& Mesh, const FMeshletData& Data, FMeshlet& Meshlet)
+{
+	const uint32_t* Vertices = &Data.Vertices[Meshlet.VertexOffset];
+	const uint8_t* Primitives = &Data.Primitives[Meshlet.PrimitiveOffset * 3];
+
+	// sphere around the box center, close enough to Ritter for these small clusters
+	Vector3f BoundMin(std::numeric_limits<float>::max());
+	Vector3f BoundMax(-std::numeric_limits<float>::max());
+	for (uint32_t i = 0; i < Meshlet.VertexCount; ++i)
+	{
+		BoundMin = Min(BoundMin, Mesh.m_positions[Vertices[i]]);
+		BoundMax = Max(BoundMax, Mesh.m_positions[Vertices[i]]);
+	}
+	Meshlet.Center = (BoundMin + BoundMax) * 0.5f;
+	float RadiusSq = 0.f;
+	for (uint32_t i = 0; i < Meshlet.VertexCount; ++i)
+	{
+		Vector3f Offset = Mesh.m_positions[Vertices[i]] - Meshlet.Center;
+		RadiusSq = std::max(RadiusSq, Offset.Dot(Offset));
+	}
+	Meshlet.Radius = sqrtf(RadiusSq);
+
+	// normal cone, the axis is the mean of the unit face normals
+	std::vector<Vector3f> Normals(Meshlet.PrimitiveCount);
+	Vector3f AxisSum;
+	for (uint32_t t = 0; t < Meshlet.PrimitiveCount; ++t)
+	{
+		const Vector3f& P0 = Mesh.m_positions[Vertices[Primitives[3 * t]]];
+		const Vector3f& P1 = Mesh.m_positions[Vertices[Primitives[3 * t + 1]]];
+		const Vector3f& P2 = Mesh.m_positions[Vertices[Primitives[3 * t + 2]]];
+		Normals[t] = Cross(P1 - P0, P2 - P0).SafeNormalize(0.f);
+		AxisSum += Normals[t];
+	}
+	Meshlet.ConeAxis = AxisSum.SafeNormalize(0.f);
+	Meshlet.ConeApex = Meshlet.Center;
+	Meshlet.ConeCutoff = 1.f;
+
+	float MinDot = 1.f;
+	for (uint32_t t = 0; t < Meshlet.PrimitiveCount; ++t)
+	{
+		// degenerated triangles face nowhere
+		if (Normals[t].Dot(Normals[t]) > 0.f)
+			MinDot = std::min(MinDot, Normals[t].Dot(Meshlet.ConeAxis));
+	}
+	// past ~84 degrees the cone culls next to nothing
+	if (Meshlet.ConeAxis.Dot(Meshlet.ConeAxis) == 0.f || MinDot <= 0.1f)
+		return;
+
+	// apex on the axis behind every triangle plane, so that the test holds for the whole cluster
+	float MaxT = 0.f;
+	for (uint32_t t = 0; t < Meshlet.PrimitiveCount; ++t)
+	{
+		float Dn = Normals[t].Dot(Meshlet.ConeAxis);
+		if (Dn <= 0.f)
+			continue;
+		const Vector3f& P0 = Mesh.m_positions[Vertices[Primitives[3 * t]]];
+		float Dc = (Meshlet.Center - P0).Dot(Normals[t]);
+		MaxT = std::max(MaxT, Dc / Dn);
+	}
+	Meshlet.ConeApex = Meshlet.Center - Meshlet.ConeAxis * MaxT;
+	Meshlet.ConeCutoff = sqrtf(1.f - MinDot * MinDot);
+}
+
+void FMeshletBuilder::Cull(const FMeshletData& Data, const FMatrix& LocalToWorld, const FCamera& Camera, std::vector<uint32_t>& VisibleMeshlets, FClusterCullStats* Stats)
+{
+	FFrustum Frustum = Camera.GetFrustum();
+	Vector3f Eye = Vector3f(Camera.GetPosition());
+	float Scale = LocalToWorld.GetMaxScale();
+	// a mirroring transform flips the facing
+	Vector3f Row0(LocalToWorld[0]), Row1(LocalToWorld[1]), Row2(LocalToWorld[2]);
+	float Handedness = Cross(Row0, Row1).Dot(Row2) < 0.f ? -1.f : 1.f;
+	// the cones only survive a rotation and a uniform scale, a non-uniform scale or a shear bends the normals
+	// they bound, the meshlets of such a transform are never cone culled
+	const float Tolerance = 1e-3f * Scale * Scale;
+	bool ConeCulling = fabsf(Row0.Dot(Row0) - Scale * Scale) <= Tolerance
+		&& fabsf(Row1.Dot(Row1) - Scale * Scale) <= Tolerance
+		&& fabsf(Row2.Dot(Row2) - Scale * Scale) <= Tolerance
+		&& fabsf(Row0.Dot(Row1)) <= Tolerance && fabsf(Row1.Dot(Row2)) <= Tolerance && fabsf(Row2.Dot(Row0)) <= Tolerance;
+
+	FClusterCullStats LocalStats;
+	for (uint32_t m = 0; m < (uint32_t)Data.Meshlets.size(); ++m)
+	{
+		const FMeshlet& Meshlet = Data.Meshlets[m];
+		LocalStats.MeshletCount++;
+		LocalStats.TriangleCount += Meshlet.PrimitiveCount;
+
+		Vector3f Center = LocalToWorld.TransformPosition(Meshlet.Center);
+		if (!Frustum.IntersectSphere(Center, Meshlet.Radius * Scale))
+		{
+			LocalStats.FrustumCulled++;
+			continue;
+		}
+
+		if (ConeCulling && Meshlet.ConeCutoff < 1.f)
+		{
+			Vector3f Apex = LocalToWorld.TransformPosition(Meshlet.ConeApex);
+			Vector3f Axis = (LocalToWorld.TranslateVector(Meshlet.ConeAxis) * Handedness).SafeNormalize(0.f);
+			if ((Apex - Eye).SafeNormalize(0.f).Dot(Axis) >= Meshlet.ConeCutoff)
+			{
+				LocalStats.ConeCulled++;
+				continue;
+			}
+		}
+
+		LocalStats.VisibleTriangles += Meshlet.PrimitiveCount;
+		VisibleMeshlets.push_back(m);
+	}
+
+	if (Stats)
+	{
+		Stats->MeshletCount += LocalStats.MeshletCount;
+		Stats->FrustumCulled += LocalStats.FrustumCulled;
+		Stats->ConeCulled += LocalStats.ConeCulled;
+		Stats->TriangleCount += LocalStats.TriangleCount;
+		Stats->VisibleTriangles += LocalStats.VisibleTriangles;
+	}
+}
@@ -35,9 +35,11 @@ void FModel::Draw(FCommandContext& CommandContext, bool UseDefualtMaterial)
 	{
 		if (m_MeshData->HasVertexElement(VertexElementType(i)))
 		{
+			CommandContext.WaitForUpload(m_VertexBuffer[i]);
 			CommandContext.SetVertexBuffer(slot++, m_VertexBuffer[i].VertexBufferView());
 		}
 	}
+	CommandContext.WaitForUpload(m_IndexBuffer);
 	CommandContext.SetIndexBuffer(m_IndexBuffer.IndexBufferView());
 
 	for (size_t i = 0; i < m_MeshData->GetMeshCount(); ++i)
@@ -48,12 +50,12 @@ void FModel::Draw(FCommandContext& CommandContext, bool UseDefualtMaterial)
 			D3D12_CPU_DESCRIPTOR_HANDLE Handles[MeshData::TEX_PER_MATERIAL];
 			for (int j = 0; j < MeshData::TEX_PER_MATERIAL ; ++j)
 			{
-				Handles[j] = m_Textures[MeshData::TEX_PER_MATERIAL * MtlIndex + j].GetSRV();
+				Handles[j] = m_MaterialTable->GetTexture((uint32_t)MtlIndex, j)->GetSRV();
 			}
 			if(UseDefualtMaterial)
 				CommandContext.SetDynamicDescriptors(2, 0, MeshData::TEX_PER_MATERIAL, Handles);
 		}
-		CommandContext.DrawIndexed((UINT)m_MeshData->GetSubIndexCount(i), (UINT)m_MeshData->GetSubIndexStart(i));
+		CommandContext.DrawIndexed((UINT)m_MeshData->GetSubIndexCount(i), (UINT)m_MeshData->GetSubIndexStart(i), m_MeshData->GetSubBaseVertex(i));
 	}
 }
 
@@ -66,7 +68,7 @@ D3D12_CPU_DESCRIPTOR_HANDLE FModel::GetTextureView(uint32_t SubMeshIndex, uint32
 		size_t MtlIndex = m_MeshData->GetSubMaterialIndex(SubMeshIndex);
 		if (MtlIndex < m_MeshData->GetMaterialCount() && TexIndex < MeshData::TEX_PER_MATERIAL)
 		{
-			Result = m_Textures[MeshData::TEX_PER_MATERIAL * MtlIndex + TexIndex].GetSRV();
+			Result = m_MaterialTable->GetTexture((uint32_t)MtlIndex, TexIndex)->GetSRV();
 		}
 	}
 	return Result;
@@ -128,6 +130,7 @@ void FModel::UpdateBoundingBox()
 
 void FModel::InitializeResource()
 {
+	m_MeshData->CompressVertexStreams();
 	for (int i = 0; i < VET_Max; ++i)
 	{
 		VertexElementType elmType = VertexElementType(i);
@@ -136,25 +139,14 @@ void FModel::InitializeResource()
 			m_VertexBuffer[i].Create(
 				L"VertexStream",
 				m_MeshData->GetVertexCount(),
-				m_MeshData->GetVertexStride(elmType),
-				m_MeshData->GetVertexData(elmType));
+				m_MeshData->GetStreamStride(elmType),
+				m_MeshData->GetStreamData(elmType));
 		}
 	}
 
+	m_MeshData->PackIndices();
 	m_IndexBuffer.Create(L"MeshIndexBuffer", m_MeshData->GetIndexCount(), m_MeshData->GetIndexElementSize(), m_MeshData->GetIndexData());
 
-	uint32_t MaterialCount = (uint32_t)m_MeshData->GetMaterialCount();
-	m_Textures.resize(MaterialCount * MeshData::TEX_PER_MATERIAL);
-	for (uint32_t i = 0; i < MaterialCount; ++i)
-	{
-		MaterialData MtlData = m_MeshData->GetMaterialData(i);
-		//basecolor, opacity, emissive, metallic, roughness, ao, normal
-		m_Textures[MeshData::TEX_PER_MATERIAL * i + 0].LoadFromFile(ToWideString(m_MeshData->GetBaseColorPath(i)), true);
-		m_Textures[MeshData::TEX_PER_MATERIAL * i + 1].LoadFromFile(ToWideString(m_MeshData->GetOpacityPath(i)), false);
-		m_Textures[MeshData::TEX_PER_MATERIAL * i + 2].LoadFromFile(ToWideString(m_MeshData->GetEmissivePath(i)), true);
-		m_Textures[MeshData::TEX_PER_MATERIAL * i + 3].LoadFromFile(ToWideString(m_MeshData->GetMetallicPath(i)), false);
-		m_Textures[MeshData::TEX_PER_MATERIAL * i + 4].LoadFromFile(ToWideString(m_MeshData->GetRoughnessPath(i)), false);
-		m_Textures[MeshData::TEX_PER_MATERIAL * i + 5].LoadFromFile(ToWideString(m_MeshData->GetAOPath(i)), false);
-		m_Textures[MeshData::TEX_PER_MATERIAL * i + 6].LoadFromFile(ToWideString(m_MeshData->GetNormalPath(i)), false);
-	}
+	m_MaterialTable = std::make_shared<FMaterialTable>(m_MeshData->m_materials);
+	m_MaterialTable->InitRenderingResource();
 }
\ No newline at end of file
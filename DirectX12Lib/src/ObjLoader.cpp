@@ -3,6 +3,10 @@
 #include "Timer.h"
 #include "MeshData.h"
 #include "Common.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "Parallel.h"
+#include "MeshOptimizer.h"
 
 #include <fstream>
 #include <iostream>
@@ -15,15 +19,40 @@
 
 bool const ENABLE_TANGENT = true;
 
+ETangentMode FObjLoader::sm_TangentMode = TM_Accumulate;
+bool FObjLoader::sm_LowMemoryMode = false;
+
 MeshData* FObjLoader::LoadObj(const std::string& FilePath, bool FlipV, bool NegateZ, bool FlipNormalZ)
 {
 	double StartTime = FTimer::GetSeconds();
+	FMemoryUsage MemoryBefore = GetMemoryUsage();
 	std::cout << std::endl << "loading: " << FilePath << std::endl;
 	std::ifstream File(FilePath);
 	if (!File.is_open())
 		return nullptr;
+
+	uint64_t CacheKey = ComputeCacheKey(FilePath, FlipV, NegateZ, FlipNormalZ);
+	if (MeshData* CachedMesh = LoadFromCache(FilePath, CacheKey))
+	{
+		printf("LoadObj Time: %f (cached)\n", FTimer::GetSeconds() - StartTime);
+		return CachedMesh;
+	}
+
+	// the low memory mode reads the file line by line instead of keeping a copy of it
 	std::stringstream Buffer;
-	Buffer << File.rdbuf();
+	std::istream* Input = &File;
+	size_t PositionCount = 1024 * 1024, TexcoordCount = 1024 * 1024, NormalCount = 1024 * 1024, IndexCount = 1024 * 1024;
+	if (sm_LowMemoryMode)
+	{
+		CountElements(File, PositionCount, TexcoordCount, NormalCount, IndexCount);
+		File.clear();
+		File.seekg(0);
+	}
+	else
+	{
+		Buffer << File.rdbuf();
+		Input = &Buffer;
+	}
 
 	MaterialLibType MtlLib;
 	//ObjMaterial CurrentMaterial;
@@ -36,14 +65,14 @@ MeshData* FObjLoader::LoadObj(const std::string& FilePath, bool FlipV, bool Nega
 
 	std::string Line;
 	std::vector<float> positions;
-	positions.reserve(1024 * 1024);
+	positions.reserve(PositionCount);
 	std::vector<float> texcoords;
-	texcoords.reserve(1024 * 1024);
+	texcoords.reserve(TexcoordCount);
 	std::vector<float> normals;
-	normals.reserve(1024 * 1024);
+	normals.reserve(NormalCount);
 	std::vector<ObjVertexIndex> all_indices;
-	all_indices.reserve(1024 * 1024);
-	while (getline(Buffer, Line))
+	all_indices.reserve(IndexCount);
+	while (getline(*Input, Line))
 	{
 		//std::cout << Line << std::endl;
 		const char* line_str = Line.c_str();
@@ -169,70 +198,519 @@ MeshData* FObjLoader::LoadObj(const std::string& FilePath, bool FlipV, bool Nega
 		CurrentGroup.MaterialName = CurrentMaterialName;
 		Groups.push_back(CurrentGroup);
 	}
+	std::stringstream().swap(Buffer);
+	File.close();
 	
-	bool has_texcoord = !texcoords.empty();
-	bool has_normal = !normals.empty();
-	std::vector<float> final_vertices;
-	std::vector<Vector3f> final_positions;
-	std::vector<Vector2f> final_texcoords;
-	std::vector<Vector3f> final_normals;
-	std::vector<Vector4f> final_tangents;
-	final_positions.reserve(positions.size());
-	final_texcoords.reserve(texcoords.size());
-	final_normals.reserve(normals.size());
-	final_tangents.reserve(normals.size());
-	final_vertices.reserve(positions.size() + texcoords.size() + normals.size());
-	std::vector<uint32_t> final_indices;
-	final_indices.reserve(1024 * 1024);
-	std::map<ObjVertexIndex, uint32_t> VertexCache;
+	MeshData* meshdata = BuildMeshData(FilePath, Groups, MtlLib, positions, texcoords, normals, all_indices);
+	SaveToCache(FilePath, CacheKey, meshdata);
 
-	uint32_t VertexFloatCount = 3; // position
-	if (has_texcoord)
+	printf("LoadObj Time: %f\n", FTimer::GetSeconds() - StartTime);
+	PrintMemoryUsage("LoadObj", MemoryBefore);
+
+	return meshdata;
+}
+
+MeshData* FObjLoader::LoadObjParallel(const std::string& FilePath, bool FlipV, bool NegateZ, bool FlipNormalZ)
+{
+	double StartTime = FTimer::GetSeconds();
+	FMemoryUsage MemoryBefore = GetMemoryUsage();
+	std::cout << std::endl << "loading: " << FilePath << std::endl;
+	FMappedFile File;
+	if (!File.Open(FilePath))
+		return nullptr;
+
+	uint64_t CacheKey = ComputeCacheKey(FilePath, FlipV, NegateZ, FlipNormalZ);
+	if (MeshData* CachedMesh = LoadFromCache(FilePath, CacheKey))
 	{
-		VertexFloatCount += 2; // texcoord
+		printf("LoadObjParallel Time: %f (cached)\n", FTimer::GetSeconds() - StartTime);
+		return CachedMesh;
 	}
-	if (has_normal)
+
+	// split at line boundaries, a few chunks per worker so that uneven chunks still balance
+	const size_t MinChunkSize = 1024 * 1024;
+	const char* FileBegin = File.GetData();
+	const char* FileEnd = FileBegin + File.GetSize();
+	size_t ChunkCount = (std::min)((size_t)FParallel::GetNumWorkers() * 4, File.GetSize() / MinChunkSize);
+	ChunkCount = (std::max)(ChunkCount, (size_t)1);
+
+	std::vector<const char*> ChunkBounds;
+	ChunkBounds.push_back(FileBegin);
+	for (size_t i = 1; i < ChunkCount; ++i)
 	{
-		VertexFloatCount += 3; // normal
+		const char* Split = FileBegin + File.GetSize() * i / ChunkCount;
+		if (Split < ChunkBounds.back())
+			continue;
+		const char* NewLine = (const char*)memchr(Split, '\n', FileEnd - Split);
+		if (NewLine == nullptr)
+			break;
+		ChunkBounds.push_back(NewLine + 1);
 	}
-	if (has_texcoord && has_normal && ENABLE_TANGENT)
+	ChunkBounds.push_back(FileEnd);
+
+	uint32_t NumChunks = (uint32_t)ChunkBounds.size() - 1;
+	std::vector<ObjChunk> Chunks(NumChunks);
+	FParallel::For(NumChunks, [&](uint32_t i)
 	{
-		VertexFloatCount += 4; // tangent
+		ParseChunk(ChunkBounds[i], ChunkBounds[i + 1], Chunks[i], FlipV, NegateZ, FlipNormalZ);
+	});
+	File.Close();
+
+	// element counts of all preceding chunks
+	struct ChunkBase
+	{
+		size_t Position, Texcoord, Normal, Index;
+	};
+	std::vector<ChunkBase> Bases(NumChunks + 1);
+	Bases[0] = { 0, 0, 0, 0 };
+	for (uint32_t i = 0; i < NumChunks; ++i)
+	{
+		Bases[i + 1].Position = Bases[i].Position + Chunks[i].Positions.size();
+		Bases[i + 1].Texcoord = Bases[i].Texcoord + Chunks[i].Texcoords.size();
+		Bases[i + 1].Normal = Bases[i].Normal + Chunks[i].Normals.size();
+		Bases[i + 1].Index = Bases[i].Index + Chunks[i].Indices.size();
 	}
 
+	std::vector<float> positions(Bases[NumChunks].Position);
+	std::vector<float> texcoords(Bases[NumChunks].Texcoord);
+	std::vector<float> normals(Bases[NumChunks].Normal);
+	std::vector<ObjVertexIndex> all_indices(Bases[NumChunks].Index);
+	FParallel::For(NumChunks, [&](uint32_t i)
+	{
+		ObjChunk& Chunk = Chunks[i];
+		const ChunkBase& Base = Bases[i];
+		std::copy(Chunk.Positions.begin(), Chunk.Positions.end(), positions.begin() + Base.Position);
+		std::copy(Chunk.Texcoords.begin(), Chunk.Texcoords.end(), texcoords.begin() + Base.Texcoord);
+		std::copy(Chunk.Normals.begin(), Chunk.Normals.end(), normals.begin() + Base.Normal);
+		std::copy(Chunk.Indices.begin(), Chunk.Indices.end(), all_indices.begin() + Base.Index);
+
+		// relative indices were fixed against the chunk's own counts, add what the preceding chunks declared
+		for (size_t f = 0; f < Chunk.Fixups.size(); ++f)
+		{
+			const ObjIndexFixup& Fixup = Chunk.Fixups[f];
+			ObjVertexIndex& Index = all_indices[Base.Index + Fixup.Slot];
+			if (Fixup.RelativeMask & 1)
+				Index.vi = (int)((uint32_t)Index.vi + (uint32_t)(Base.Position / 3));
+			if (Fixup.RelativeMask & 2)
+				Index.ti = (int)((uint32_t)Index.ti + (uint32_t)(Base.Texcoord / 2));
+			if (Fixup.RelativeMask & 4)
+				Index.ni = (int)((uint32_t)Index.ni + (uint32_t)(Base.Normal / 3));
+		}
+
+		std::vector<float>().swap(Chunk.Positions);
+		std::vector<float>().swap(Chunk.Texcoords);
+		std::vector<float>().swap(Chunk.Normals);
+		std::vector<ObjVertexIndex>().swap(Chunk.Indices);
+		std::vector<ObjIndexFixup>().swap(Chunk.Fixups);
+	});
+
+	// replay g/usemtl/mtllib in file order, same state machine as LoadObj
+	MaterialLibType MtlLib;
+	std::string CurrentMaterialName;
+	bool FirstGroup = true;
+	ObjGroup CurrentGroup;
+	std::vector<ObjGroup> Groups;
+	uint32_t UnhandledLines = 0;
+	for (uint32_t c = 0; c < NumChunks; ++c)
+	{
+		const ObjChunk& Chunk = Chunks[c];
+		uint32_t IndexBase = (uint32_t)Bases[c].Index;
+		uint32_t FaceCount = (uint32_t)Chunk.Faces.size();
+		size_t e = 0;
+		for (uint32_t f = 0; f <= FaceCount; ++f)
+		{
+			for (; e < Chunk.Events.size() && Chunk.Events[e].FaceIndex == f; ++e)
+			{
+				const ObjChunkEvent& Event = Chunk.Events[e];
+				switch (Event.Type)
+				{
+				case ObjChunkEvent::Group:
+					if (!FirstGroup)
+					{
+						// flush prior group
+						CurrentGroup.MaterialName = CurrentMaterialName;
+						Groups.push_back(std::move(CurrentGroup));
+					}
+					FirstGroup = false;
+
+					CurrentGroup.Faces.clear();
+					CurrentGroup.Name = Event.Value;
+					break;
+				case ObjChunkEvent::UseMaterial:
+					CurrentMaterialName = Event.Value;
+					break;
+				case ObjChunkEvent::MaterialLib:
+					LoadMaterialLib(MtlLib, GetBasePath(FilePath) + Event.Value);
+					break;
+				}
+			}
+			if (f < FaceCount)
+			{
+				ObjFace Face = Chunk.Faces[f];
+				Face.Start += IndexBase;
+				CurrentGroup.Faces.push_back(Face);
+			}
+		}
+		UnhandledLines += Chunk.UnhandledLines;
+	}
+	Chunks.clear();
+
+	if (!FirstGroup || Groups.empty())
+	{
+		// flush prior group
+		CurrentGroup.MaterialName = CurrentMaterialName;
+		Groups.push_back(std::move(CurrentGroup));
+	}
+
+	if (UnhandledLines > 0)
+	{
+		std::cout << "Warning: " << UnhandledLines << " unhandled lines" << std::endl;
+	}
+
+	MeshData* meshdata = BuildMeshData(FilePath, Groups, MtlLib, positions, texcoords, normals, all_indices);
+	SaveToCache(FilePath, CacheKey, meshdata);
+
+	printf("LoadObjParallel Time: %f, %u chunks\n", FTimer::GetSeconds() - StartTime, NumChunks);
+	PrintMemoryUsage("LoadObjParallel", MemoryBefore);
+
+	return meshdata;
+}
+
+uint64_t FObjLoader::ComputeCacheKey(const std::string& FilePath, bool FlipV, bool NegateZ, bool FlipNormalZ)
+{
+	if (!FMeshCache::IsEnabled())
+		return 0;
+
+	// materials are cached too, so the material libraries are part of the key
+	std::vector<std::string> SourceFiles;
+	SourceFiles.push_back(FilePath);
+	FMappedFile File;
+	if (File.Open(FilePath) && File.GetSize() > 0)
+	{
+		const char* Begin = File.GetData();
+		const char* End = Begin + File.GetSize();
+		for (const char* Cursor = Begin; (Cursor = (const char*)memchr(Cursor, 'm', End - Cursor)) != nullptr; ++Cursor)
+		{
+			if (End - Cursor < 6 || strncmp(Cursor, "mtllib", 6) != 0)
+				continue;
+			const char* LineStart = Cursor;
+			while (LineStart > Begin && (LineStart[-1] == ' ' || LineStart[-1] == '\t'))
+				--LineStart;
+			if (LineStart > Begin && LineStart[-1] != '\n')
+				continue;
+
+			const char* LineEnd = (const char*)memchr(Cursor, '\n', End - Cursor);
+			std::string Line(Cursor + 6, LineEnd ? LineEnd : End);
+			if (!Line.empty() && Line.back() == '\r')
+				Line.pop_back();
+			const char* line_str = Line.c_str();
+			SkipToNoneSpace(line_str);
+			SourceFiles.push_back(GetBasePath(FilePath) + line_str);
+		}
+	}
+
+	uint32_t ImportFlags = FMeshCache::IF_None;
+	if (FlipV)
+		ImportFlags |= FMeshCache::IF_FlipV;
+	if (NegateZ)
+		ImportFlags |= FMeshCache::IF_NegateZ;
+	if (FlipNormalZ)
+		ImportFlags |= FMeshCache::IF_FlipNormalZ;
+	if (sm_TangentMode == TM_MikkTSpace)
+		ImportFlags |= FMeshCache::IF_MikkTSpace;
+	if (FMeshOptimizer::IsImportOptimizationEnabled())
+		ImportFlags |= FMeshCache::IF_Optimized;
+	return FMeshCache::ComputeKey(SourceFiles, ImportFlags);
+}
+
+MeshData* FObjLoader::LoadFromCache(const std::string& FilePath, uint64_t CacheKey)
+{
+	if (CacheKey == 0)
+		return nullptr;
+
+	std::vector<MeshData*> Meshes;
+	std::vector<FMeshCacheNode> Nodes;
+	std::vector<MaterialData> SceneMaterials;
+	if (!FMeshCache::Load(FilePath, CacheKey, Meshes, Nodes, SceneMaterials))
+		return nullptr;
+	if (Meshes.size() != 1)
+	{
+		for (size_t i = 0; i < Meshes.size(); ++i)
+			delete Meshes[i];
+		return nullptr;
+	}
+	return Meshes[0];
+}
+
+void FObjLoader::SaveToCache(const std::string& FilePath, uint64_t CacheKey, const MeshData* Mesh)
+{
+	if (CacheKey == 0 || Mesh == nullptr)
+		return;
+
+	std::vector<const MeshData*> Meshes(1, Mesh);
+	if (!FMeshCache::Save(FilePath, CacheKey, Meshes, std::vector<FMeshCacheNode>(), std::vector<MaterialData>()))
+	{
+		std::cout << "Warning: failed to write mesh cache for " << FilePath << std::endl;
+	}
+}
+
+void FObjLoader::ParseChunk(const char* Begin, const char* End, ObjChunk& Chunk, bool FlipV, bool NegateZ, bool FlipNormalZ)
+{
+	std::string Line;
+	const char* Cursor = Begin;
+	while (Cursor < End)
+	{
+		const char* LineEnd = (const char*)memchr(Cursor, '\n', End - Cursor);
+		if (LineEnd == nullptr)
+			LineEnd = End;
+		// match getline on a text mode stream, CRLF reads as LF
+		const char* ContentEnd = LineEnd;
+		if (LineEnd < End && ContentEnd > Cursor && ContentEnd[-1] == '\r')
+			--ContentEnd;
+		Line.assign(Cursor, ContentEnd);
+		Cursor = LineEnd + 1;
+
+		const char* line_str = Line.c_str();
+		float x, y, z;
+		ObjVertexIndex index;
+		SkipToNoneSpace(line_str);
+		if (*line_str == 0 || *line_str == '#')
+		{
+			continue;
+		}
+		else if (*line_str == 'v')
+		{
+			if (isspace(*(line_str + 1)))
+			{
+				// v, vertex
+				ParseFloat3(++line_str, x, y, z);
+				Chunk.Positions.push_back(x);
+				Chunk.Positions.push_back(y);
+				Chunk.Positions.push_back(NegateZ ? -z : z);
+			}
+			else if (*(line_str + 1) == 't')
+			{
+				line_str += 2;
+				// vt, texture coordinate
+				ParseFloat2(line_str, x, y);
+				if (x > 1)
+					x -= floor(x);
+				if (y > 1)
+					y -= floor(y);
+				Chunk.Texcoords.push_back(x);
+				Chunk.Texcoords.push_back(FlipV ? 1 - y : y);
+			}
+			else if (*(line_str + 1) == 'n')
+			{
+				line_str += 2;
+				// vn, normal
+				ParseFloat3(line_str, x, y, z);
+				Chunk.Normals.push_back(x);
+				Chunk.Normals.push_back(y);
+				Chunk.Normals.push_back(FlipNormalZ ? -z : z);
+			}
+			else
+			{
+				++Chunk.UnhandledLines;
+			}
+		}
+		else if (*line_str == 'f')
+		{
+			ObjFace face;
+			face.Start = (uint32_t)Chunk.Indices.size();
+			face.Num = 0;
+			while (*line_str)
+			{
+				++line_str;
+				uint32_t RelativeMask = 0;
+				if (ParseTripleIndex(line_str, index, (uint32_t)Chunk.Positions.size() / 3, (uint32_t)Chunk.Texcoords.size() / 2, (uint32_t)Chunk.Normals.size() / 3, &RelativeMask))
+				{
+					if (RelativeMask)
+					{
+						Chunk.Fixups.push_back({ (uint32_t)Chunk.Indices.size(), RelativeMask });
+					}
+					face.Num++;
+					Chunk.Indices.push_back(index);
+				}
+			}
+			Chunk.Faces.push_back(face);
+		}
+		else if (*line_str == 'g' && isspace(*(line_str + 1)))
+		{
+			++line_str;
+			SkipToNoneSpace(line_str);
+			Chunk.Events.push_back({ ObjChunkEvent::Group, (uint32_t)Chunk.Faces.size(), std::string(line_str) });
+		}
+		else if (strncmp(line_str, "mtllib", 6) == 0)
+		{
+			line_str += 6;
+			SkipToNoneSpace(line_str);
+			Chunk.Events.push_back({ ObjChunkEvent::MaterialLib, (uint32_t)Chunk.Faces.size(), std::string(line_str) });
+		}
+		else if (strncmp(line_str, "usemtl", 6) == 0)
+		{
+			line_str += 6;
+			SkipToNoneSpace(line_str);
+			Chunk.Events.push_back({ ObjChunkEvent::UseMaterial, (uint32_t)Chunk.Faces.size(), std::string(line_str) });
+		}
+		else
+		{
+			++Chunk.UnhandledLines;
+		}
+	}
+}
+
+MeshData* FObjLoader::BuildMeshData(
+	const std::string& FilePath,
+	std::vector<ObjGroup>& Groups,
+	MaterialLibType& MtlLib,
+	std::vector<float>& positions,
+	std::vector<float>& texcoords,
+	std::vector<float>& normals,
+	std::vector<ObjVertexIndex>& all_indices)
+{
+	// the source streams are released as soon as they are consumed, so the peak stays close to the result
+	bool has_texcoord = !texcoords.empty();
+	bool has_normal = !normals.empty();
+
+	// triangulated index range of every group
 	uint32_t group_size = (uint32_t)Groups.size();
+	uint32_t total_index_count = 0;
 	for (uint32_t g = 0; g < group_size; ++g)
 	{
 		ObjGroup& Group = Groups[g];
 		Group.HasNormal = has_normal;
+		Group.StartIndex = total_index_count;
+		Group.IndexCount = 0;
+		for (size_t f = 0; f < Group.Faces.size(); ++f)
+		{
+			if (Group.Faces[f].Num > 2)
+				Group.IndexCount += 3 * (Group.Faces[f].Num - 2);
+		}
+		total_index_count += Group.IndexCount;
+	}
+
+	// dedup every group on its own, in first use order, final_indices temporarily holds group local indices
+	std::vector<uint32_t> final_indices(total_index_count);
+	std::vector<std::vector<ObjVertexIndex>> GroupVertices(group_size);
+	FParallel::For(group_size, [&](uint32_t g)
+	{
+		const ObjGroup& Group = Groups[g];
+		std::vector<ObjVertexIndex>& Vertices = GroupVertices[g];
+		uint32_t* Indices = final_indices.data() + Group.StartIndex;
+
+		uint32_t CornerCount = 0;
+		for (size_t f = 0; f < Group.Faces.size(); ++f)
+			CornerCount += Group.Faces[f].Num;
+		FObjVertexCache VertexCache(Vertices);
+		VertexCache.Reserve(CornerCount);
+
+		auto CollectVertex = [&VertexCache, &Vertices](const ObjVertexIndex& Index)
+		{
+			uint32_t LocalIndex = VertexCache.FindOrAdd(Index, (uint32_t)Vertices.size());
+			if (LocalIndex == Vertices.size())
+				Vertices.push_back(Index);
+			return LocalIndex;
+		};
 
-		Group.StartIndex = (uint32_t)final_indices.size();
 		uint32_t face_size = (uint32_t)Group.Faces.size();
 		for (uint32_t f = 0; f < face_size; ++f)
 		{
-			//printf("group %s %d/%d, face %d/%d\n", Group.Name.c_str(), g, group_size, f, face_size);
 			const ObjFace& Face = Group.Faces[f];
+			if (Face.Num < 3)
+				continue;
 			ObjVertexIndex v0 = all_indices[Face.Start];
 			ObjVertexIndex v1 = all_indices[Face.Start + 1];
 			for (uint32_t e = 2; e < Face.Num; ++e)
 			{
 				ObjVertexIndex v2 = all_indices[Face.Start + e];
-				uint32_t i0 = CollectVertex(v0, VertexCache, final_vertices, positions, texcoords, normals, final_positions, final_texcoords, final_normals);
-				uint32_t i1 = CollectVertex(v1, VertexCache, final_vertices, positions, texcoords, normals, final_positions, final_texcoords, final_normals);
-				uint32_t i2 = CollectVertex(v2, VertexCache, final_vertices, positions, texcoords, normals, final_positions, final_texcoords, final_normals);
-				final_indices.push_back(i0);
-				final_indices.push_back(i1);
-				final_indices.push_back(i2);
+				*Indices++ = CollectVertex(v0);
+				*Indices++ = CollectVertex(v1);
+				*Indices++ = CollectVertex(v2);
 
 				v1 = v2;
 			}
 		}
-		Group.IndexCount = (uint32_t)final_indices.size() - Group.StartIndex;
+		std::vector<ObjFace>().swap(Groups[g].Faces);
+	});
+	std::vector<ObjVertexIndex>().swap(all_indices);
+
+	// stable global remap, walking groups in order gives the same vertex order as a single global dedup
+	size_t GroupVertexCount = 0;
+	for (uint32_t g = 0; g < group_size; ++g)
+		GroupVertexCount += GroupVertices[g].size();
+	std::vector<ObjVertexIndex> UniqueVertices;
+	UniqueVertices.reserve(GroupVertexCount);
+	std::vector<std::vector<uint32_t>> GroupRemap(group_size);
+	{
+		FObjVertexCache VertexCache(UniqueVertices);
+		VertexCache.Reserve(GroupVertexCount);
+		for (uint32_t g = 0; g < group_size; ++g)
+		{
+			std::vector<ObjVertexIndex>& Vertices = GroupVertices[g];
+			std::vector<uint32_t>& Remap = GroupRemap[g];
+			Remap.resize(Vertices.size());
+			for (size_t v = 0; v < Vertices.size(); ++v)
+			{
+				Remap[v] = VertexCache.FindOrAdd(Vertices[v], (uint32_t)UniqueVertices.size());
+				if (Remap[v] == UniqueVertices.size())
+					UniqueVertices.push_back(Vertices[v]);
+			}
+			std::vector<ObjVertexIndex>().swap(Vertices);
+		}
 	}
+	std::vector<std::vector<ObjVertexIndex>>().swap(GroupVertices);
 
-	if (has_normal && has_texcoord && ENABLE_TANGENT)
+	FParallel::For(group_size, [&](uint32_t g)
 	{
-		CalcTangents(final_positions, final_texcoords, final_normals, final_indices, final_tangents);
+		const ObjGroup& Group = Groups[g];
+		const std::vector<uint32_t>& Remap = GroupRemap[g];
+		uint32_t* Indices = final_indices.data() + Group.StartIndex;
+		for (uint32_t i = 0; i < Group.IndexCount; ++i)
+			Indices[i] = Remap[Indices[i]];
+	});
+	std::vector<std::vector<uint32_t>>().swap(GroupRemap);
+
+	// gather vertex attributes
+	uint32_t VertexCount = (uint32_t)UniqueVertices.size();
+	bool vertex_texcoord = false;
+	bool vertex_normal = false;
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		vertex_texcoord |= UniqueVertices[v].ti >= 0;
+		vertex_normal |= UniqueVertices[v].ni >= 0;
+	}
+	std::vector<Vector3f> final_positions(VertexCount);
+	// a stream is either empty or holds every vertex, the vertices of faces without the attribute get zeros
+	std::vector<Vector2f> final_texcoords(vertex_texcoord ? VertexCount : 0);
+	std::vector<Vector3f> final_normals(vertex_normal ? VertexCount : 0);
+	std::vector<Vector4f> final_tangents;
+	const uint32_t GatherBatch = 64 * 1024;
+	FParallel::For((VertexCount + GatherBatch - 1) / GatherBatch, [&](uint32_t Batch)
+	{
+		uint32_t End = (std::min)(VertexCount, (Batch + 1) * GatherBatch);
+		for (uint32_t v = Batch * GatherBatch; v < End; ++v)
+		{
+			const ObjVertexIndex& Index = UniqueVertices[v];
+			final_positions[v] = Vector3f(positions[3 * Index.vi], positions[3 * Index.vi + 1], positions[3 * Index.vi + 2]);
+			if (Index.ti >= 0)
+			{
+				final_texcoords[v] = Vector2f(texcoords[2 * Index.ti], texcoords[2 * Index.ti + 1]);
+			}
+			if (Index.ni >= 0)
+			{
+				final_normals[v] = Vector3f(normals[3 * Index.ni], normals[3 * Index.ni + 1], normals[3 * Index.ni + 2]);
+			}
+		}
+	});
+
+	std::vector<ObjVertexIndex>().swap(UniqueVertices);
+	std::vector<float>().swap(positions);
+	std::vector<float>().swap(texcoords);
+	std::vector<float>().swap(normals);
+
+	if (vertex_normal && vertex_texcoord && ENABLE_TANGENT)
+	{
+		FTangentGenerator::Generate(sm_TangentMode, final_positions, final_texcoords, final_normals, final_indices, final_tangents);
 	}
 
 	MeshData* meshdata = new MeshData(FilePath);
@@ -241,8 +719,6 @@ MeshData* FObjLoader::LoadObj(const std::string& FilePath, bool FlipV, bool Nega
 	meshdata->m_normals.swap(final_normals);
 	meshdata->m_tangents.swap(final_tangents);
 	meshdata->m_indices.swap(final_indices);
-	//Model->SetVertices(&final_vertices[0], final_vertices.size() / VertexFloatCount, sizeof(float) * VertexFloatCount);
-	//Model->SetIndices(&final_indices[0], final_indices.size());
 	meshdata->ComputeBoundingBox();
 
 	std::vector<MaterialData> UsedMaterials;
@@ -276,6 +752,11 @@ MeshData* FObjLoader::LoadObj(const std::string& FilePath, bool FlipV, bool Nega
 	}
 	meshdata->m_materials.swap(UsedMaterials);
 
+	if (FMeshOptimizer::IsImportOptimizationEnabled())
+	{
+		FMeshOptimizer::Optimize(*meshdata);
+	}
+
 	//std::vector<VertexElement> Elements;
 	//Elements.push_back({"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, sizeof(float) * 3});
 	//if (has_texcoord)
@@ -292,134 +773,105 @@ MeshData* FObjLoader::LoadObj(const std::string& FilePath, bool FlipV, bool Nega
 	//}
 	//Model->SetVertexElements(Elements);
 
-	printf("LoadObj Time: %f\n", FTimer::GetSeconds() - StartTime);
-
 	return meshdata;
 }
 
-uint32_t FObjLoader::CollectVertex(
-	const ObjVertexIndex& Index,
-	std::map<ObjVertexIndex, uint32_t>& VertexCache,
-	std::vector<float>& final_vertices,
-	const std::vector<float>& in_positions,
-	const std::vector<float>& in_texcoords,
-	const std::vector<float>& in_normals,
-	std::vector<Vector3f>& final_positions,
-	std::vector<Vector2f>& final_texcoords,
-	std::vector<Vector3f>& final_normals
-)
+void FObjLoader::CountElements(std::istream& Input, size_t& PositionCount, size_t& TexcoordCount, size_t& NormalCount, size_t& IndexCount)
 {
-	if (VertexCache.find(Index) != VertexCache.end())
-	{
-		return VertexCache[Index];
-	}
-	else
+	PositionCount = TexcoordCount = NormalCount = IndexCount = 0;
+	std::string Line;
+	while (getline(Input, Line))
 	{
-		int float_count = 3;
-		final_vertices.push_back(in_positions[3 * Index.vi]);
-		final_vertices.push_back(in_positions[3 * Index.vi + 1]);
-		final_vertices.push_back(in_positions[3 * Index.vi + 2]);
-		final_positions.emplace_back(in_positions[3 * Index.vi], in_positions[3 * Index.vi + 1], in_positions[3 * Index.vi + 2]);
-		if (Index.ti >= 0)
+		const char* line_str = Line.c_str();
+		SkipToNoneSpace(line_str);
+		if (line_str[0] == 'v' && isspace(line_str[1]))
+			PositionCount += 3;
+		else if (line_str[0] == 'v' && line_str[1] == 't')
+			TexcoordCount += 2;
+		else if (line_str[0] == 'v' && line_str[1] == 'n')
+			NormalCount += 3;
+		else if (line_str[0] == 'f' && isspace(line_str[1]))
 		{
-			final_vertices.push_back(in_texcoords[2 * Index.ti]);
-			final_vertices.push_back(in_texcoords[2 * Index.ti + 1]);
-			final_texcoords.emplace_back(in_texcoords[2 * Index.ti], in_texcoords[2 * Index.ti + 1]);
-			float_count += 2;
+			// one index per token
+			for (++line_str; *line_str; )
+			{
+				SkipToNoneSpace(line_str);
+				if (*line_str == 0)
+					break;
+				++IndexCount;
+				while (*line_str && !isspace(*line_str))
+					++line_str;
+			}
 		}
-		if (Index.ni >= 0)
+	}
+}
+
+void FObjLoader::PrintMemoryUsage(const char* Name, const FMemoryUsage& Before)
+{
+	const double MB = 1024.0 * 1024.0;
+	FMemoryUsage After = GetMemoryUsage();
+	printf("%s Memory: working set %.1f MB (%+.1f MB), committed %.1f MB (%+.1f MB), process peak %.1f MB\n", Name,
+		After.WorkingSet / MB, ((double)After.WorkingSet - (double)Before.WorkingSet) / MB,
+		After.Committed / MB, ((double)After.Committed - (double)Before.Committed) / MB, After.ProcessPeak / MB);
+}
+
+void FObjVertexCache::Reserve(size_t Count)
+{
+	// keep the load factor under 1/2
+	size_t Capacity = 16;
+	while (Capacity < Count * 2)
+		Capacity <<= 1;
+	if (Capacity > m_Slots.size())
+		Rehash(Capacity);
+}
+
+uint32_t FObjVertexCache::FindOrAdd(const ObjVertexIndex& Key, uint32_t NewIndex)
+{
+	if ((m_Size + 1) * 2 > m_Slots.size())
+		Rehash((std::max)((size_t)16, m_Slots.size() * 2));
+
+	size_t Pos = Hash(Key) & m_Mask;
+	while (true)
+	{
+		uint32_t& Entry = m_Slots[Pos];
+		if (Entry == EmptySlot)
 		{
-			final_vertices.push_back(in_normals[3 * Index.ni]);
-			final_vertices.push_back(in_normals[3 * Index.ni + 1]);
-			final_vertices.push_back(in_normals[3 * Index.ni + 2]);
-			final_normals.emplace_back(in_normals[3 * Index.ni], in_normals[3 * Index.ni + 1], in_normals[3 * Index.ni + 2]);
-			float_count += 3;
+			Entry = NewIndex;
+			++m_Size;
+			return NewIndex;
 		}
-		if (Index.ti >= 0 && Index.ni >= 0 && ENABLE_TANGENT)
+		if (m_Keys[Entry] == Key)
 		{
-			final_vertices.push_back(0.f);
-			final_vertices.push_back(0.f);
-			final_vertices.push_back(0.f);
-			final_vertices.push_back(0.f);
-			float_count += 4;
+			return Entry;
 		}
-		uint32_t final_index = (uint32_t)final_vertices.size() / float_count - 1;
-		VertexCache[Index] = final_index;
-		return final_index;
+		Pos = (Pos + 1) & m_Mask;
 	}
 }
 
-void FObjLoader::CalcTangents(
-	const std::vector<Vector3f>& final_positions,
-	const std::vector<Vector2f>& final_texcoords,
-	const std::vector<Vector3f>& final_normals,
-	const std::vector<uint32_t>& final_indices,
-	std::vector<Vector4f>& final_tangents)
+size_t FObjVertexCache::Hash(const ObjVertexIndex& Key)
 {
-	Assert(ENABLE_TANGENT);
-	Assert(final_indices.size() % 3 == 0);
-	uint32_t TriangleCount = (uint32_t)final_indices.size() / 3;
-	uint32_t VertexCount = (uint32_t)final_positions.size();
-
-	std::vector<Vector3f> tan1;
-	tan1.resize(VertexCount);
-	std::vector<Vector3f> tan2;
-	tan2.resize(VertexCount);
-	for (uint32_t a = 0; a < TriangleCount; ++a)
-	{
-		uint32_t i1 = final_indices[3 * a];
-		uint32_t i2 = final_indices[3 * a + 1];
-		uint32_t i3 = final_indices[3 * a + 2];
-
-		const Vector3f& v1 = final_positions[i1];
-		const Vector3f& v2 = final_positions[i2];
-		const Vector3f& v3 = final_positions[i3];
-		const Vector2f& w1 = final_texcoords[i1];
-		const Vector2f& w2 = final_texcoords[i2];
-		const Vector2f& w3 = final_texcoords[i3];
-
-		float x1 = v2.x - v1.x;
-		float x2 = v3.x - v1.x;
-		float y1 = v2.y - v1.y;
-		float y2 = v3.y - v1.y;
-		float z1 = v2.z - v1.z;
-		float z2 = v3.z - v1.z;
-		float s1 = w2.x - w1.x;
-		float s2 = w3.x - w1.x;
-		float t1 = w2.y - w1.y;
-		float t2 = w3.y - w1.y;
-
-		float div = s1 * t2 - s2 * t1;
-		if (div == 0.f)
-			continue;
-		float r = div == 0.f ? 0.f : 1.f / div;
-
-		Vector3f sdir((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r);
-		Vector3f tdir((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r);
+	uint64_t h = (uint64_t)(uint32_t)Key.vi * 0x9E3779B97F4A7C15ull;
+	h ^= (uint64_t)(uint32_t)Key.ti * 0xC2B2AE3D27D4EB4Full;
+	h ^= (uint64_t)(uint32_t)Key.ni * 0x165667B19E3779F9ull;
+	h ^= h >> 29;
+	return (size_t)h;
+}
 
-		tan1[i1] += sdir;
-		tan1[i2] += sdir;
-		tan1[i3] += sdir;
-		tan2[i1] += tdir;
-		tan2[i2] += tdir;
-		tan2[i3] += tdir;
-	}
-	for (uint32_t a = 0; a < VertexCount; a++)
+void FObjVertexCache::Rehash(size_t Capacity)
+{
+	std::vector<uint32_t> OldSlots;
+	OldSlots.swap(m_Slots);
+	m_Slots.assign(Capacity, (uint32_t)EmptySlot);
+	m_Mask = Capacity - 1;
+	for (size_t i = 0; i < OldSlots.size(); ++i)
 	{
-		// position(3), tex(2), normal(3), tangent(3)
-		const Vector3f& n = final_normals[a];
-		const Vector3f& t = tan1[a];
-		// Gram-Schmidt orthogonalize.
-		Vector4f tangent;
-		tangent = (t - n * n.Dot(t)).Normalize();
-		// Calculate handedness.
-		tangent.w = (Cross(n, t).Dot(tan2[a]) < 0.0f) ? -1.0f : 1.0f;
-		final_tangents.push_back(tangent);
-		if (isnan(tangent.x) || isnan(tangent.y) || isnan(tangent.z))
-		{
-			final_tangents.back() = n;
-			std::cout << "degenerated tangent, vertex index: " << a << std::endl;
-		}
+		if (OldSlots[i] == EmptySlot)
+			continue;
+		// keys are unique, only an empty slot is needed
+		size_t Pos = Hash(m_Keys[OldSlots[i]]) & m_Mask;
+		while (m_Slots[Pos] != EmptySlot)
+			Pos = (Pos + 1) & m_Mask;
+		m_Slots[Pos] = OldSlots[i];
 	}
 }
 
@@ -543,14 +995,18 @@ bool FObjLoader::ParseMap(const char* &str, const std::string& base_path, const
 	return false;
 }
 
-bool FObjLoader::ParseTripleIndex(const char* &str, ObjVertexIndex& index, uint32_t vn, uint32_t tn, uint32_t nn)
+bool FObjLoader::ParseTripleIndex(const char* &str, ObjVertexIndex& index, uint32_t vn, uint32_t tn, uint32_t nn, uint32_t* RelativeMask)
 {
 	// i/j, i//k, i/j/k
+	// RelativeMask (optional) gets a bit for each component given as a negative (relative) index
 	index.vi = index.ti = index.ni = -1;
 	str += strspn(str, " \t");
 	if (*str == 0)
 		return false;
-	index.vi = FixIndex(atoi(str), vn);
+	int idx = atoi(str);
+	if (RelativeMask && idx < 0)
+		*RelativeMask |= 1;
+	index.vi = FixIndex(idx, vn);
 	str += strcspn(str, "/ \t\r");
 	if (str[0] != '/')
 	{
@@ -563,12 +1019,18 @@ bool FObjLoader::ParseTripleIndex(const char* &str, ObjVertexIndex& index, uint3
 	{
 		// i//k
 		++str;
-		index.ni = FixIndex(atoi(str), nn);
+		idx = atoi(str);
+		if (RelativeMask && idx < 0)
+			*RelativeMask |= 4;
+		index.ni = FixIndex(idx, nn);
 		str += strcspn(str, "/ \t\r");
 		return true;
 	}
 	// i/j/k or i/j
-	index.ti = FixIndex(atoi(str), tn);
+	idx = atoi(str);
+	if (RelativeMask && idx < 0)
+		*RelativeMask |= 2;
+	index.ti = FixIndex(idx, tn);
 	str += strcspn(str, "/ \t\r");
 	
 	if (str[0] != '/')
@@ -578,7 +1040,10 @@ bool FObjLoader::ParseTripleIndex(const char* &str, ObjVertexIndex& index, uint3
 	}
 	++str;
 	
-	index.ni = FixIndex(atoi(str), nn);
+	idx = atoi(str);
+	if (RelativeMask && idx < 0)
+		*RelativeMask |= 4;
+	index.ni = FixIndex(idx, nn);
 	str += strcspn(str, "/ \t\r");
 	return true;
 }
@@ -72,8 +72,7 @@ void FPipelineState::Initialize()
 
 void FPipelineState::DestroyAll()
 {
-	ms_GraphicsPSHashMap.clear();
-	ms_ComputePSHashMap.clear();
+	FPipelineStateCache::Get().Destroy();
 }
 
 D3D12_RASTERIZER_DESC FPipelineState::RasterizerDefault;
@@ -88,9 +87,6 @@ D3D12_DEPTH_STENCIL_DESC FPipelineState::DepthStateDisabled;
 D3D12_DEPTH_STENCIL_DESC FPipelineState::DepthStateReadWrite;
 D3D12_DEPTH_STENCIL_DESC FPipelineState::DepthStateReadOnly;
 
-std::map<size_t, ComPtr<ID3D12PipelineState>> FPipelineState::ms_GraphicsPSHashMap;
-std::map<size_t, ComPtr<ID3D12PipelineState>> FPipelineState::ms_ComputePSHashMap;
-
 FGraphicsPipelineState::FGraphicsPipelineState()
 	: m_InputLayouts(nullptr)
 {
@@ -165,24 +161,10 @@ void FGraphicsPipelineState::Finalize()
 	m_PSDesc.pRootSignature = m_RootSignature->GetSignature();
 	Assert(m_PSDesc.pRootSignature != nullptr);
 
-	m_PSDesc.InputLayout.pInputElementDescs = nullptr;
-	size_t HashCode = HashState(&m_PSDesc);
-	HashCode = HashState(m_InputLayouts, m_PSDesc.InputLayout.NumElements, HashCode);
 	m_PSDesc.InputLayout.pInputElementDescs = m_InputLayouts;
 
-	//todo: cache pso
-	{
-		auto iter = ms_GraphicsPSHashMap.find(HashCode);
-		if (iter == ms_GraphicsPSHashMap.end())
-		{
-			ThrowIfFailed(D3D12RHI::Get().GetD3D12Device()->CreateGraphicsPipelineState(&m_PSDesc, IID_PPV_ARGS(&m_PipelineState)));
-			ms_GraphicsPSHashMap[HashCode].Attach(m_PipelineState);
-		}
-		else
-		{
-			m_PipelineState = ms_GraphicsPSHashMap[HashCode].Get();
-		}
-	}
+	m_PipelineState = nullptr;
+	m_PipelineFuture = FPipelineStateCache::Get().GetGraphicsPipelineState(m_PSDesc, *m_RootSignature);
 }
 
 FComputePipelineState::FComputePipelineState()
@@ -196,19 +178,6 @@ void FComputePipelineState::Finalize()
 	m_PSDesc.pRootSignature = m_RootSignature->GetSignature();
 	Assert(m_PSDesc.pRootSignature != nullptr);
 
-	size_t HashCode = HashState(&m_PSDesc);
-
-	//todo: cache pso
-	{
-		auto iter = ms_ComputePSHashMap.find(HashCode);
-		if (iter == ms_ComputePSHashMap.end())
-		{
-			ThrowIfFailed(D3D12RHI::Get().GetD3D12Device()->CreateComputePipelineState(&m_PSDesc, IID_PPV_ARGS(&m_PipelineState)));
-			ms_ComputePSHashMap[HashCode].Attach(m_PipelineState);
-		}
-		else
-		{
-			m_PipelineState = ms_ComputePSHashMap[HashCode].Get();
-		}
-	}
+	m_PipelineState = nullptr;
+	m_PipelineFuture = FPipelineStateCache::Get().GetComputePipelineState(m_PSDesc, *m_RootSignature);
 }
\ No newline at end of file
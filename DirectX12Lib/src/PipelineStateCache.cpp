@@ -0,0 +1,276 @@
+#include "PipelineStateCache.h"
+#include "RootSignature.h"
+#include "Parallel.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	std::vector<uint8_t> CopyShader(D3D12_SHADER_BYTECODE& Shader)
+	{
+		std::vector<uint8_t> Code((const uint8_t*)Shader.pShaderBytecode, (const uint8_t*)Shader.pShaderBytecode + Shader.BytecodeLength);
+		Shader.pShaderBytecode = Code.empty() ? nullptr : Code.data();
+		return Code;
+	}
+
+	// a description that owns what its pointers point at, the workers compile it after the caller moved on
+	struct FGraphicsDesc
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		std::vector<uint8_t> Shaders[5];
+		std::vector<D3D12_INPUT_ELEMENT_DESC> Elements;
+		std::vector<std::string> SemanticNames;
+		ComPtr<ID3D12RootSignature> RootSignature;
+
+		explicit FGraphicsDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& InDesc)
+			: Desc(InDesc)
+			, RootSignature(InDesc.pRootSignature)
+		{
+			Shaders[0] = CopyShader(Desc.VS);
+			Shaders[1] = CopyShader(Desc.PS);
+			Shaders[2] = CopyShader(Desc.DS);
+			Shaders[3] = CopyShader(Desc.HS);
+			Shaders[4] = CopyShader(Desc.GS);
+
+			const UINT NumElements = Desc.InputLayout.NumElements;
+			Elements.assign(Desc.InputLayout.pInputElementDescs, Desc.InputLayout.pInputElementDescs + NumElements);
+			SemanticNames.resize(NumElements);
+			for (UINT i = 0; i < NumElements; ++i)
+			{
+				SemanticNames[i] = Elements[i].SemanticName;
+				Elements[i].SemanticName = SemanticNames[i].c_str();
+			}
+			Desc.InputLayout.pInputElementDescs = NumElements > 0 ? Elements.data() : nullptr;
+		}
+	};
+
+	struct FComputeDesc
+	{
+		D3D12_COMPUTE_PIPELINE_STATE_DESC Desc;
+		std::vector<uint8_t> Shader;
+		ComPtr<ID3D12RootSignature> RootSignature;
+
+		explicit FComputeDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& InDesc)
+			: Desc(InDesc)
+			, RootSignature(InDesc.pRootSignature)
+		{
+			Shader = CopyShader(Desc.CS);
+		}
+	};
+}
+
+FPipelineStateCache& FPipelineStateCache::Get()
+{
+	static FPipelineStateCache Singleton;
+	return Singleton;
+}
+
+FPipelineStateCache::FPipelineStateCache()
+	: m_Device(nullptr)
+	, m_LibraryChanged(false)
+	, m_Quit(false)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void FPipelineStateCache::Create(ID3D12Device* Device, IDXGIAdapter1* Adapter)
+{
+	m_Device = Device;
+	m_Quit = false;
+	if (Adapter)
+	{
+		OpenLibrary(Adapter);
+	}
+
+	// the render thread mostly waits on the first pipeline it needs, leave it one core
+	const uint32_t NumWorkers = (std::max)(1u, FParallel::GetNumWorkers() - 1);
+	for (uint32_t i = 0; i < NumWorkers; ++i)
+	{
+		m_Workers.emplace_back(&FPipelineStateCache::WorkerLoop, this);
+	}
+}
+
+void FPipelineStateCache::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_JobReady.notify_all();
+	for (std::thread& Worker : m_Workers)
+	{
+		Worker.join();
+	}
+	m_Workers.clear();
+
+	SaveLibrary();
+
+	m_Entries.clear();
+	m_Library = nullptr;
+	m_LibraryBlob.clear();
+	m_LibraryChanged = false;
+	m_Device = nullptr;
+}
+
+FPipelineStateFuture FPipelineStateCache::GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, const FRootSignature& RootSignature)
+{
+	FPipelineStateKey Key = FPipelineStateKey::Make(Desc, RootSignature.GetSerializedBlob());
+
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	++m_Stats.Requests;
+	auto Iter = m_Entries.find(Key);
+	if (Iter != m_Entries.end())
+		return Iter->second->Future;
+
+	std::shared_ptr<FGraphicsDesc> Owned = std::make_shared<FGraphicsDesc>(Desc);
+	return Enqueue(std::move(Key), [this, Owned](FEntry* Entry, const std::wstring& Name)
+	{
+		ID3D12PipelineState* PipelineState = nullptr;
+		if (m_Library && SUCCEEDED(m_Library->LoadGraphicsPipeline(Name.c_str(), &Owned->Desc, IID_PPV_ARGS(&PipelineState))))
+			return Store(Entry, Name, PipelineState, true);
+		ThrowIfFailed(m_Device->CreateGraphicsPipelineState(&Owned->Desc, IID_PPV_ARGS(&PipelineState)));
+		return Store(Entry, Name, PipelineState, false);
+	});
+}
+
+FPipelineStateFuture FPipelineStateCache::GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, const FRootSignature& RootSignature)
+{
+	FPipelineStateKey Key = FPipelineStateKey::Make(Desc, RootSignature.GetSerializedBlob());
+
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	++m_Stats.Requests;
+	auto Iter = m_Entries.find(Key);
+	if (Iter != m_Entries.end())
+		return Iter->second->Future;
+
+	std::shared_ptr<FComputeDesc> Owned = std::make_shared<FComputeDesc>(Desc);
+	return Enqueue(std::move(Key), [this, Owned](FEntry* Entry, const std::wstring& Name)
+	{
+		ID3D12PipelineState* PipelineState = nullptr;
+		if (m_Library && SUCCEEDED(m_Library->LoadComputePipeline(Name.c_str(), &Owned->Desc, IID_PPV_ARGS(&PipelineState))))
+			return Store(Entry, Name, PipelineState, true);
+		ThrowIfFailed(m_Device->CreateComputePipelineState(&Owned->Desc, IID_PPV_ARGS(&PipelineState)));
+		return Store(Entry, Name, PipelineState, false);
+	});
+}
+
+FPipelineStateCache::FStats FPipelineStateCache::GetStats()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	return m_Stats;
+}
+
+FPipelineStateFuture FPipelineStateCache::Enqueue(FPipelineStateKey&& Key, std::function<ID3D12PipelineState*(FEntry*, const std::wstring&)>&& Create)
+{
+	Assert(m_Device != nullptr && !m_Workers.empty());
+
+	FEntry* Entry = new FEntry;
+	std::wstring Name = Key.GetName();
+	std::shared_ptr<std::packaged_task<ID3D12PipelineState*()>> Task = std::make_shared<std::packaged_task<ID3D12PipelineState*()>>(
+		[Entry, Name, Create]() { return Create(Entry, Name); });
+	Entry->Future = Task->get_future().share();
+	m_Entries.emplace(std::move(Key), std::unique_ptr<FEntry>(Entry));
+
+	m_Jobs.push_back([Task]() { (*Task)(); });
+	m_JobReady.notify_one();
+	return Entry->Future;
+}
+
+ID3D12PipelineState* FPipelineStateCache::Store(FEntry* Entry, const std::wstring& Name, ID3D12PipelineState* PipelineState, bool Loaded)
+{
+	Entry->PipelineState.Attach(PipelineState);
+
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (Loaded)
+	{
+		++m_Stats.Loaded;
+	}
+	else
+	{
+		++m_Stats.Compiled;
+		// fails when the name is taken by another description, that pipeline is just not persisted
+		if (m_Library && SUCCEEDED(m_Library->StorePipeline(Name.c_str(), PipelineState)))
+			m_LibraryChanged = true;
+	}
+	return PipelineState;
+}
+
+void FPipelineStateCache::OpenLibrary(IDXGIAdapter1* Adapter)
+{
+	// pipeline libraries came with ID3D12Device1, older runtimes go without the disk cache
+	ComPtr<ID3D12Device1> Device1;
+	if (FAILED(m_Device->QueryInterface(IID_PPV_ARGS(&Device1))))
+		return;
+
+	DXGI_ADAPTER_DESC1 AdapterDesc;
+	ThrowIfFailed(Adapter->GetDesc1(&AdapterDesc));
+	LARGE_INTEGER DriverVersion = {};
+	Adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &DriverVersion);
+
+	char FileName[96];
+	snprintf(FileName, sizeof(FileName), "PipelineCache_%04x_%04x_%016llx.bin",
+		AdapterDesc.VendorId, AdapterDesc.DeviceId, (unsigned long long)DriverVersion.QuadPart);
+	m_LibraryFile = FileName;
+
+	std::ifstream File(m_LibraryFile, std::ios::binary);
+	if (File.is_open())
+	{
+		m_LibraryBlob.assign(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+	}
+
+	// a missing, truncated or foreign file starts an empty library
+	if (m_LibraryBlob.empty() || FAILED(Device1->CreatePipelineLibrary(m_LibraryBlob.data(), m_LibraryBlob.size(), IID_PPV_ARGS(&m_Library))))
+	{
+		m_LibraryBlob.clear();
+		if (FAILED(Device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_Library))))
+			m_Library = nullptr;
+	}
+}
+
+void FPipelineStateCache::SaveLibrary()
+{
+	if (!m_Library || !m_LibraryChanged)
+		return;
+
+	std::vector<char> Data(m_Library->GetSerializedSize());
+	if (FAILED(m_Library->Serialize(Data.data(), Data.size())))
+		return;
+
+	// write aside and rename, a crash never leaves a half written library behind
+	std::string TempPath = m_LibraryFile + ".tmp";
+	{
+		std::ofstream File(TempPath, std::ios::binary | std::ios::trunc);
+		if (!File.is_open())
+			return;
+		File.write(Data.data(), Data.size());
+		if (!File.good())
+			return;
+	}
+	std::remove(m_LibraryFile.c_str());
+	if (std::rename(TempPath.c_str(), m_LibraryFile.c_str()) != 0)
+	{
+		std::cout << "Warning: failed to write pipeline cache " << m_LibraryFile << std::endl;
+	}
+}
+
+void FPipelineStateCache::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> Job;
+		{
+			std::unique_lock<std::mutex> Lock(m_Mutex);
+			m_JobReady.wait(Lock, [this]() { return m_Quit || !m_Jobs.empty(); });
+			// the queue is drained before quitting, every handed out future gets its pipeline
+			if (m_Jobs.empty())
+				return;
+			Job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+		}
+		Job();
+	}
+}
@@ -0,0 +1,113 @@
+#include "PipelineStateKey.h"
+#include "Assertion.h"
+
+#include <cstring>
+#include <cwchar>
+
+namespace
+{
+	enum EPipelineType : uint32_t
+	{
+		PIPELINE_Graphics,
+		PIPELINE_Compute,
+	};
+}
+
+FPipelineStateKey FPipelineStateKey::Make(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& Desc, const std::vector<uint8_t>& RootSignatureBlob)
+{
+	// no stream output in this renderer, its declarations are not part of the key
+	Assert(Desc.StreamOutput.NumEntries == 0);
+
+	FPipelineStateKey Key;
+	const uint32_t Type = PIPELINE_Graphics;
+	Key.Append(&Type, sizeof(Type));
+
+	// the fixed function state as is, with the pointers cleared and their targets appended
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC Fixed;
+	memcpy(&Fixed, &Desc, sizeof(Fixed));
+	Fixed.pRootSignature = nullptr;
+	memset(&Fixed.VS, 0, sizeof(Fixed.VS));
+	memset(&Fixed.PS, 0, sizeof(Fixed.PS));
+	memset(&Fixed.DS, 0, sizeof(Fixed.DS));
+	memset(&Fixed.HS, 0, sizeof(Fixed.HS));
+	memset(&Fixed.GS, 0, sizeof(Fixed.GS));
+	memset(&Fixed.StreamOutput, 0, sizeof(Fixed.StreamOutput));
+	Fixed.InputLayout.pInputElementDescs = nullptr;
+	memset(&Fixed.CachedPSO, 0, sizeof(Fixed.CachedPSO));
+	Key.Append(&Fixed, sizeof(Fixed));
+
+	Key.AppendShader(Desc.VS);
+	Key.AppendShader(Desc.PS);
+	Key.AppendShader(Desc.DS);
+	Key.AppendShader(Desc.HS);
+	Key.AppendShader(Desc.GS);
+	for (UINT i = 0; i < Desc.InputLayout.NumElements; ++i)
+	{
+		D3D12_INPUT_ELEMENT_DESC Element;
+		memcpy(&Element, &Desc.InputLayout.pInputElementDescs[i], sizeof(Element));
+		const char* SemanticName = Element.SemanticName;
+		Element.SemanticName = nullptr;
+		Key.Append(&Element, sizeof(Element));
+		Key.Append(SemanticName, strlen(SemanticName) + 1);
+	}
+	Key.AppendRootSignature(RootSignatureBlob);
+	Key.Finish();
+	return Key;
+}
+
+FPipelineStateKey FPipelineStateKey::Make(const D3D12_COMPUTE_PIPELINE_STATE_DESC& Desc, const std::vector<uint8_t>& RootSignatureBlob)
+{
+	FPipelineStateKey Key;
+	const uint32_t Type = PIPELINE_Compute;
+	Key.Append(&Type, sizeof(Type));
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC Fixed;
+	memcpy(&Fixed, &Desc, sizeof(Fixed));
+	Fixed.pRootSignature = nullptr;
+	memset(&Fixed.CS, 0, sizeof(Fixed.CS));
+	memset(&Fixed.CachedPSO, 0, sizeof(Fixed.CachedPSO));
+	Key.Append(&Fixed, sizeof(Fixed));
+
+	Key.AppendShader(Desc.CS);
+	Key.AppendRootSignature(RootSignatureBlob);
+	Key.Finish();
+	return Key;
+}
+
+std::wstring FPipelineStateKey::GetName() const
+{
+	wchar_t Name[32];
+	swprintf(Name, 32, L"PSO_%016llx", (unsigned long long)m_Hash);
+	return Name;
+}
+
+void FPipelineStateKey::Append(const void* Data, size_t Size)
+{
+	m_Bytes.insert(m_Bytes.end(), (const uint8_t*)Data, (const uint8_t*)Data + Size);
+}
+
+void FPipelineStateKey::AppendShader(const D3D12_SHADER_BYTECODE& Shader)
+{
+	const uint64_t Size = Shader.pShaderBytecode ? Shader.BytecodeLength : 0;
+	Append(&Size, sizeof(Size));
+	Append(Shader.pShaderBytecode, (size_t)Size);
+}
+
+void FPipelineStateKey::AppendRootSignature(const std::vector<uint8_t>& Blob)
+{
+	// by content, equal signatures are interchangeable and the key stays the same across runs
+	const uint64_t Size = Blob.size();
+	Append(&Size, sizeof(Size));
+	Append(Blob.data(), Blob.size());
+}
+
+void FPipelineStateKey::Finish()
+{
+	// 64 bit FNV-1a, the name on disk has to be the same in every run and on every compiler
+	uint64_t Hash = 14695981039346656037ull;
+	for (uint8_t Byte : m_Bytes)
+	{
+		Hash = (Hash ^ Byte) * 1099511628211ull;
+	}
+	m_Hash = Hash;
+}
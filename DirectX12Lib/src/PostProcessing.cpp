@@ -165,7 +165,8 @@ void PostProcessing::Initialize()
 
 void PostProcessing::Destroy()
 {
-
+	// a namespace global, its destructor would run after the descriptor allocators are gone
+	m_BlackTexture.Destroy();
 }
 
 void PostProcessing::Render(FCommandContext& CommandContext)
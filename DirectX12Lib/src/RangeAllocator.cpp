@@ -0,0 +1,94 @@
+#include "RangeAllocator.h"
+#include "Assertion.h"
+
+#include <iterator>
+
+FRangeAllocator::FRangeAllocator(uint32_t Size)
+	: m_Size(0)
+	, m_FreeSize(0)
+{
+	Reset(Size);
+}
+
+void FRangeAllocator::Reset(uint32_t Size)
+{
+	m_Size = Size;
+	m_FreeSize = 0;
+	m_ByOffset.clear();
+	m_BySize.clear();
+	if (Size > 0)
+	{
+		AddFreeRange(0, Size);
+	}
+}
+
+uint32_t FRangeAllocator::Allocate(uint32_t Count)
+{
+	if (Count == 0)
+		return INVALID_OFFSET;
+
+	auto Best = m_BySize.lower_bound(std::make_pair(Count, 0u));
+	if (Best == m_BySize.end())
+		return INVALID_OFFSET;
+
+	const uint32_t Offset = Best->second;
+	const uint32_t RangeCount = Best->first;
+	RemoveFreeRange(m_ByOffset.find(Offset));
+	if (RangeCount > Count)
+	{
+		AddFreeRange(Offset + Count, RangeCount - Count);
+	}
+	return Offset;
+}
+
+void FRangeAllocator::Free(uint32_t Offset, uint32_t Count)
+{
+	Assert(Count > 0 && Offset < m_Size && Count <= m_Size - Offset);
+
+	uint32_t Begin = Offset;
+	uint32_t End = Offset + Count;
+
+	auto Next = m_ByOffset.lower_bound(Offset);
+	// a free range overlapping this one means a double free
+	Assert(Next == m_ByOffset.end() || Next->first >= End);
+	if (Next != m_ByOffset.begin())
+	{
+		auto Prev = std::prev(Next);
+		Assert(Prev->first + Prev->second <= Begin);
+		if (Prev->first + Prev->second == Begin)
+		{
+			Begin = Prev->first;
+			RemoveFreeRange(Prev);
+		}
+	}
+	if (Next != m_ByOffset.end() && Next->first == End)
+	{
+		End += Next->second;
+		RemoveFreeRange(Next);
+	}
+	AddFreeRange(Begin, End - Begin);
+}
+
+FRangeAllocator::FStats FRangeAllocator::GetStats() const
+{
+	FStats Stats;
+	Stats.Size = m_Size;
+	Stats.FreeSize = m_FreeSize;
+	Stats.NumFreeRanges = (uint32_t)m_ByOffset.size();
+	Stats.LargestFreeRange = GetLargestFreeRange();
+	return Stats;
+}
+
+void FRangeAllocator::AddFreeRange(uint32_t Offset, uint32_t Count)
+{
+	m_ByOffset.emplace(Offset, Count);
+	m_BySize.emplace(Count, Offset);
+	m_FreeSize += Count;
+}
+
+void FRangeAllocator::RemoveFreeRange(std::map<uint32_t, uint32_t>::iterator Iter)
+{
+	m_BySize.erase(std::make_pair(Iter->second, Iter->first));
+	m_FreeSize -= Iter->second;
+	m_ByOffset.erase(Iter);
+}
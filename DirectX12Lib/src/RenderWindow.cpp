@@ -4,6 +4,7 @@
 #include "d3dx12.h"
 #include "CommandQueue.h"
 #include "CommandListManager.h"
+#include "CommandContext.h"
 
 const int MSAA_SAMPLE = 1;
 
@@ -24,6 +25,8 @@ void RenderWindow::Initialize()
 	m_swapChain = CreateSwapChain(Window.GetWindowHandle(), RHI.GetDXGIFactory(), g_CommandListManager.GetGraphicsQueue().GetD3D12CommandQueue(), Window.GetWidth(), Window.GetHeight(), BUFFER_COUNT);
 	
 	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+	m_swapChain->SetMaximumFrameLatency(g_CommandListManager.GetFramesInFlight());
+	m_FrameLatencyWaitable = m_swapChain->GetFrameLatencyWaitableObject();
 
 	for (int i = 0; i < BUFFER_COUNT; ++i)
 	{
@@ -35,7 +38,36 @@ void RenderWindow::Initialize()
 
 void RenderWindow::Destroy()
 {
+	if (m_FrameLatencyWaitable)
+	{
+		::CloseHandle(m_FrameLatencyWaitable);
+		m_FrameLatencyWaitable = nullptr;
+	}
+}
+
+void RenderWindow::SetFramesInFlight(UINT Count)
+{
+	g_CommandListManager.SetFramesInFlight(Count);
+	if (m_swapChain)
+	{
+		m_swapChain->SetMaximumFrameLatency(g_CommandListManager.GetFramesInFlight());
+	}
+}
+
+void RenderWindow::BeginFrame()
+{
+	if (m_FrameBegun)
+		return;
+	m_FrameBegun = true;
+
+	if (m_FrameLatencyWaitable)
+	{
+		::WaitForSingleObjectEx(m_FrameLatencyWaitable, 1000, TRUE);
+	}
+	g_CommandListManager.BeginFrame();
 
+	// resources initialized before the frame without a ticket in hand are ready for all of its work
+	g_UploadService.MakeQueueWait(g_CommandListManager.GetGraphicsQueue(), D3D12_COMMAND_LIST_TYPE_DIRECT, FCommandContext::GetInitializeTicket());
 }
 
 ComPtr<IDXGISwapChain3> RenderWindow::CreateSwapChain(HWND hwnd, IDXGIFactory4* factory, ID3D12CommandQueue* commandQueue, int width, int height, int bufferCount)
@@ -48,6 +80,7 @@ ComPtr<IDXGISwapChain3> RenderWindow::CreateSwapChain(HWND hwnd, IDXGIFactory4*
 	Desc.SampleDesc.Count = 1;
 	Desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
 	Desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+	Desc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 	ComPtr<IDXGISwapChain1> swapchain1;
 	ThrowIfFailed(factory->CreateSwapChainForHwnd(commandQueue, hwnd, &Desc, nullptr, nullptr, &swapchain1));
 
@@ -58,7 +91,10 @@ ComPtr<IDXGISwapChain3> RenderWindow::CreateSwapChain(HWND hwnd, IDXGIFactory4*
 
 UINT RenderWindow::Present()
 {
-	m_swapChain->Present(1, 0);
+	m_swapChain->Present(m_SyncInterval, 0);
+	g_CommandListManager.EndFrame();
+	FCommandContext::EndFrame();
+	m_FrameBegun = false;
 	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 	return m_frameIndex;
 }
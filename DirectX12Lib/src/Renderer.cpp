@@ -2,44 +2,184 @@
 #include "Renderer.h"
 #include "CommandContext.h"
 #include "Scene.h"
+#include "Camera.h"
+#include "BindlessTable.h"
 
+#include <algorithm>
 
 void Renderer::Draw(Scene* pScene, FCommandContext& CommandContext, bool UseDefaultMaterial)
 {
-	for (uint32_t m = 0; m < pScene->GetMeshCount(); ++m)
+	m_DrawCommands.Update(pScene);
+	const std::vector<uint32_t>& Order = m_DrawCommands.GetStateOrder();
+	Submit(CommandContext, UseDefaultMaterial, Order.data(), (uint32_t)Order.size());
+}
+
+void Renderer::Draw(Scene* pScene, const FCamera& Camera, FCommandContext& CommandContext, bool UseDefaultMaterial)
+{
+	pScene->UpdateTransforms();
+	Cull(pScene, Camera.GetFrustum());
+	m_DrawCommands.Update(pScene);
+
+	m_VisibleCommands.clear();
+	for (size_t v = 0; v < m_VisibleMeshes.size(); ++v)
 	{
-		MeshNode* Mesh = pScene->GetMeshByIndex(m);
-		MeshData* Data = Mesh->GetFirstMeshData();
-		for (int i = 0, slot = 0; i < VET_Max; ++i)
+		const FVisibleMesh& Visible = m_VisibleMeshes[v];
+		const uint32_t FirstCommand = m_DrawCommands.GetFirstCommand(Visible.MeshIndex);
+		for (uint32_t s = 0; s < Visible.SubMeshCount; ++s)
 		{
-			VertexElementType EleType = static_cast<VertexElementType>(i);
-			if (Data->HasVertexElement(EleType))
+			uint32_t Command = FirstCommand + m_VisibleSubMeshes[Visible.FirstSubMesh + s];
+			if (m_DrawCommands.GetCommand(Command).IndexCount > 0)
+				m_VisibleCommands.push_back(Command);
+		}
+	}
+
+	const Vector4f Position = Camera.GetPosition();
+	const Vector3f ViewOrigin(Position.x, Position.y, Position.z);
+	m_DrawCommands.Sort(pScene, m_VisibleCommands.data(), (uint32_t)m_VisibleCommands.size(), m_SortMode,
+		ViewOrigin, Camera.GetFocus() - ViewOrigin, m_DrawOrder);
+	Submit(CommandContext, UseDefaultMaterial, m_DrawOrder.data(), (uint32_t)m_DrawOrder.size());
+}
+
+void Renderer::SetBindlessMaterials(UINT MaterialRootIndex, UINT TableRootIndex)
+{
+	m_BindlessMaterials = true;
+	m_MaterialRootIndex = MaterialRootIndex;
+	m_BindlessTableRootIndex = TableRootIndex;
+}
+
+void Renderer::Cull(Scene* pScene, const FFrustum& Frustum)
+{
+	m_CullStats = FSceneCullStats();
+	m_VisibleMeshes.clear();
+	m_VisibleSubMeshes.clear();
+
+	// whole meshes through the scene BVH, sorted back into scene order for the draws
+	m_CullStats.MeshCount = pScene->GetMeshCount();
+	m_CullStats.SubMeshCount = pScene->GetSubMeshCount();
+	m_CullStats.TriangleCount = pScene->GetTriangleCount();
+	m_Visible.clear();
+	pScene->QueryMeshes(Frustum, m_Visible);
+	// meshes without MeshData have nothing to draw, skipped as in Scene::PostLoad and FDrawCommandList::Update
+	m_Visible.erase(std::remove_if(m_Visible.begin(), m_Visible.end(),
+		[pScene](uint32_t Index) { return pScene->GetMeshByIndex(Index)->GetFirstMeshData() == nullptr; }), m_Visible.end());
+	std::sort(m_Visible.begin(), m_Visible.end());
+
+	// then the submeshes of the surviving meshes, all in one batch
+	uint32_t CandidateCount = 0;
+	m_FirstCandidate.resize(m_Visible.size() + 1);
+	for (size_t v = 0; v < m_Visible.size(); ++v)
+	{
+		m_FirstCandidate[v] = CandidateCount;
+		CandidateCount += (uint32_t)pScene->GetMeshByIndex(m_Visible[v])->GetFirstMeshData()->GetMeshCount();
+	}
+	m_FirstCandidate[m_Visible.size()] = CandidateCount;
+
+	m_WorldBounds.Resize(CandidateCount);
+	for (size_t v = 0; v < m_Visible.size(); ++v)
+	{
+		MeshNode* Mesh = pScene->GetMeshByIndex(m_Visible[v]);
+		const MeshData* Data = Mesh->GetFirstMeshData();
+		const FMatrix& LocalToWorld = Mesh->GetLocalToWorld();
+		for (size_t i = 0; i < Data->GetMeshCount(); ++i)
+			m_WorldBounds.Set(m_FirstCandidate[v] + i, LocalToWorld.TransformBoundingBox(Data->GetSubBounds(i)));
+	}
+	m_VisibleCandidates.clear();
+	Frustum.CullBoxes(m_WorldBounds, m_VisibleCandidates);
+
+	// the visible candidates come back in order, so they group by mesh in one pass
+	size_t c = 0;
+	for (size_t v = 0; v < m_Visible.size(); ++v)
+	{
+		const MeshData* Data = pScene->GetMeshByIndex(m_Visible[v])->GetFirstMeshData();
+		FVisibleMesh Visible = { m_Visible[v], (uint32_t)m_VisibleSubMeshes.size(), 0 };
+		for (; c < m_VisibleCandidates.size() && m_VisibleCandidates[c] < m_FirstCandidate[v + 1]; ++c)
+		{
+			uint32_t SubMesh = m_VisibleCandidates[c] - m_FirstCandidate[v];
+			m_VisibleSubMeshes.push_back(SubMesh);
+			m_CullStats.VisibleTriangles += Data->GetSubTriangleCount(SubMesh);
+		}
+		Visible.SubMeshCount = (uint32_t)m_VisibleSubMeshes.size() - Visible.FirstSubMesh;
+		if (Visible.SubMeshCount > 0)
+		{
+			m_VisibleMeshes.push_back(Visible);
+			m_CullStats.VisibleSubMeshes += Visible.SubMeshCount;
+		}
+	}
+	m_CullStats.VisibleMeshes = (uint32_t)m_VisibleMeshes.size();
+}
+
+void Renderer::Submit(FCommandContext& CommandContext, bool UseDefaultMaterial, const uint32_t* Order, uint32_t Count)
+{
+	m_DrawStats = FDrawStats();
+	MeshData* BoundMesh = nullptr;
+	const FMaterialTable* BoundTable = nullptr;
+	uint32_t BoundMaterial = 0xffffffff;
+	const bool Bindless = UseDefaultMaterial && m_BindlessMaterials && FBindlessTable::Get().IsCreated();
+	if (Bindless)
+	{
+		CommandContext.SetBindlessTable(m_BindlessTableRootIndex);
+	}
+	for (uint32_t c = 0; c < Count; ++c)
+	{
+		const MeshDrawCommand& Command = m_DrawCommands.GetCommand(Order[c]);
+		if (Command.IndexCount == 0)
+			continue;
+
+		MeshData* Data = Command.Mesh;
+		if (Data != BoundMesh)
+		{
+			for (int i = 0, slot = 0; i < VET_Max; ++i)
 			{
-				CommandContext.SetVertexBuffer(slot++, Data->GetVertexBuffer(EleType)->VertexBufferView());
+				VertexElementType EleType = static_cast<VertexElementType>(i);
+				if (Data->HasVertexElement(EleType))
+				{
+					CommandContext.WaitForUpload(*Data->GetVertexBuffer(EleType));
+					CommandContext.SetVertexBuffer(slot++, Data->GetVertexBuffer(EleType)->VertexBufferView());
+				}
 			}
+			CommandContext.WaitForUpload(*Data->GetIndexBuffer());
+			CommandContext.SetIndexBuffer(Data->GetIndexBuffer()->IndexBufferView());
+			BoundMesh = Data;
+			m_DrawStats.MeshBinds++;
 		}
-		CommandContext.SetIndexBuffer(Data->GetIndexBuffer()->IndexBufferView());
 
-		for (uint32_t i = 0; i < Data->GetMeshCount(); ++i)
+		// the same material index of the same table means the same textures
+		const FMaterialTable* Table = Data->GetMaterialTable().get();
+		if (Bindless && (Table != BoundTable || Command.MaterialIndex != BoundMaterial))
+		{
+			uint32_t Indices[MeshData::TEX_PER_MATERIAL];
+			for (int j = 0; j < MeshData::TEX_PER_MATERIAL; ++j)
+			{
+				FTexture* Texture = Data->GetTextureByMeshIndex(Command.SubMeshIndex, j);
+				Indices[j] = Texture ? Texture->GetBindlessIndex() : FBindlessIndexAllocator::INVALID_INDEX;
+			}
+			CommandContext.SetConstantArray(m_MaterialRootIndex, MeshData::TEX_PER_MATERIAL, Indices);
+			m_DrawStats.MaterialBinds++;
+			BoundTable = Table;
+			BoundMaterial = Command.MaterialIndex;
+		}
+		else if (UseDefaultMaterial && (Table != BoundTable || Command.MaterialIndex != BoundMaterial))
 		{
-			size_t MtlIndex = Data->GetSubMaterialIndex(i);
-
 			bool HasTexture = false;
 			D3D12_CPU_DESCRIPTOR_HANDLE Handles[MeshData::TEX_PER_MATERIAL];
 			for (int j = 0; j < MeshData::TEX_PER_MATERIAL; ++j)
 			{
-				FTexture* Texture = Data->GetTextureByMeshIndex(i, j);
+				FTexture* Texture = Data->GetTextureByMeshIndex(Command.SubMeshIndex, j);
 				if (Texture)
 				{
 					Handles[j] = Texture->GetSRV();
 					HasTexture = true;
 				}
 			}
-			if (HasTexture && UseDefaultMaterial)
+			if (HasTexture)
 			{
 				CommandContext.SetDynamicDescriptors(2, 0, MeshData::TEX_PER_MATERIAL, Handles);
+				m_DrawStats.MaterialBinds++;
 			}
-			CommandContext.DrawIndexed((UINT)Data->GetSubIndexCount(i), (UINT)Data->GetSubIndexStart(i));
+			BoundTable = Table;
+			BoundMaterial = Command.MaterialIndex;
 		}
+		CommandContext.DrawIndexed(Command.IndexCount, Command.StartIndex, Command.BaseVertex);
+		m_DrawStats.DrawCount++;
 	}
 }
@@ -66,6 +66,15 @@ void FRootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLA
 		{
 			Assert(RootParam.DescriptorTable.pDescriptorRanges != nullptr);
 
+			// an unbounded table is bound from a heap of its own, like the bindless table, and is left to the caller
+			bool Unbounded = false;
+			for (UINT TableRange = 0; TableRange < RootParam.DescriptorTable.NumDescriptorRanges; ++TableRange)
+			{
+				Unbounded |= RootParam.DescriptorTable.pDescriptorRanges[TableRange].NumDescriptors == UINT_MAX;
+			}
+			if (Unbounded)
+				continue;
+
 			if (RootParam.DescriptorTable.pDescriptorRanges->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
 				m_SamplerTableBitMap |= (1 << i);
 			else
@@ -84,6 +93,8 @@ void FRootSignature::Finalize(const std::wstring& name, D3D12_ROOT_SIGNATURE_FLA
 		pOutBlob.GetAddressOf(), pErrorBlob.GetAddressOf()));
 
 	ThrowIfFailed(D3D12RHI::Get().GetD3D12Device()->CreateRootSignature(1, pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize(), IID_PPV_ARGS(&m_D3DRootSignature)));
+	const uint8_t* BlobData = (const uint8_t*)pOutBlob->GetBufferPointer();
+	m_SerializedBlob.assign(BlobData, BlobData + pOutBlob->GetBufferSize());
 
 	m_D3DRootSignature->SetName(name.c_str());
 }
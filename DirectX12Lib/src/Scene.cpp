@@ -4,14 +4,18 @@
 
 SceneNode::SceneNode()
 	: Parent(nullptr)
-	, LocalToWorldUpdated(false)
+	, Scale(1.f)
+	, Rotation(0.f, 0.f, 0.f, 1.f)
+	, Hierarchy(nullptr)
+	, TransformId(FTransformHierarchy::INVALID_ID)
 {
 
 }
 
 const FMatrix& SceneNode::GetLocalToWorld() const
 {
-	return LocalToWorld;
+	static const FMatrix Identity;
+	return Hierarchy ? Hierarchy->GetLocalToWorld(TransformId) : Identity;
 }
 
 void SceneNode::AddChild(SceneNode* Node)
@@ -19,25 +23,39 @@ void SceneNode::AddChild(SceneNode* Node)
 	Children.push_back(Node);
 }
 
-void SceneNode::UpdateTransform()
+void SceneNode::RegisterTransform(FTransformHierarchy& InHierarchy)
 {
-	if (!LocalToWorldUpdated)
-	{
-		FMatrix ParentToWorld;
-		if (Parent)
-		{
-			ParentToWorld = Parent->GetLocalToWorld();
-		}
-		LocalToWorld = FMatrix::ScaleMatrix(Scale) * Rotation.ToMatrix() * FMatrix::TranslateMatrix(Translation) * ParentToWorld;
-		LocalToWorldUpdated = true;
+	Assert(Parent == nullptr || Parent->Hierarchy == &InHierarchy);
+	Hierarchy = &InHierarchy;
+	TransformId = Hierarchy->Add(Parent ? Parent->TransformId : FTransformHierarchy::INVALID_ID, Scale, Rotation, Translation);
 
-		for (size_t i = 0; i < Children.size(); ++i)
-		{
-			Children[i]->UpdateTransform();
-		}
+	for (size_t i = 0; i < Children.size(); ++i)
+	{
+		Children[i]->RegisterTransform(InHierarchy);
 	}
 }
 
+void SceneNode::SetScale(const Vector3f& InScale)
+{
+	Scale = InScale;
+	if (Hierarchy)
+		Hierarchy->SetScale(TransformId, Scale);
+}
+
+void SceneNode::SetRotation(const FQuaternion& InRotation)
+{
+	Rotation = InRotation;
+	if (Hierarchy)
+		Hierarchy->SetRotation(TransformId, Rotation);
+}
+
+void SceneNode::SetTranslation(const Vector3f& InTranslation)
+{
+	Translation = InTranslation;
+	if (Hierarchy)
+		Hierarchy->SetTranslation(TransformId, Translation);
+}
+
 bool SceneNode::IsMeshNode() const
 {
 	return false;
@@ -58,12 +76,18 @@ MeshData* SceneNode::GetFirstMeshData()
 
 void SceneNode::PostLoad()
 {
-	UpdateTransform();
+	for (size_t i = 0; i < Children.size(); ++i)
+	{
+		Children[i]->PostLoad();
+	}
 }
 
 void SceneNode::CollectMeshList(std::vector<MeshNode*>& MeshList)
 {
-	
+	for (size_t i = 0; i < Children.size(); ++i)
+	{
+		Children[i]->CollectMeshList(MeshList);
+	}
 }
 
 MeshNode::MeshNode(MeshData* MData)
@@ -91,13 +115,13 @@ void MeshNode::PostLoad()
 void MeshNode::CollectMeshList(std::vector<MeshNode*>& MeshList)
 {
 	MeshList.push_back(this);
-	for (size_t i = 0; i < Children.size(); ++i)
-	{
-		Children[i]->CollectMeshList(MeshList);
-	}
+	SceneNode::CollectMeshList(MeshList);
 }
 
 Scene::Scene()
+	: SubMeshCount(0)
+	, TriangleCount(0)
+	, Version(0)
 {
 
 }
@@ -109,16 +133,77 @@ void Scene::AddNode(SceneNode* Node)
 
 void Scene::PostLoad()
 {
+	if (MaterialTable)
+	{
+		MaterialTable->InitRenderingResource();
+	}
+
+	Transforms.Clear();
 	for (size_t i = 0; i < Nodes.size(); ++i)
 	{
+		Nodes[i]->RegisterTransform(Transforms);
 		Nodes[i]->PostLoad();
 	}
+	Transforms.Update();
 
 	MeshList.clear();
 	for (size_t i = 0; i < Nodes.size(); ++i)
 	{
 		Nodes[i]->CollectMeshList(MeshList);
 	}
+
+	SubMeshCount = 0;
+	TriangleCount = 0;
+	MeshBounds.resize(MeshList.size());
+	for (uint32_t i = 0; i < (uint32_t)MeshList.size(); ++i)
+	{
+		UpdateMeshBounds(i);
+		const MeshData* Mesh = MeshList[i]->GetFirstMeshData();
+		for (size_t s = 0; Mesh && s < Mesh->GetMeshCount(); ++s)
+		{
+			TriangleCount += Mesh->GetSubTriangleCount(s);
+		}
+		SubMeshCount += Mesh ? (uint32_t)Mesh->GetMeshCount() : 0;
+	}
+	MeshBvh.Build(MeshBounds.data(), (uint32_t)MeshBounds.size());
+	++Version;
+}
+
+uint32_t Scene::UpdateTransforms(uint32_t MaxWorkers)
+{
+	uint32_t Updated = Transforms.Update(MaxWorkers);
+	if (Updated == 0)
+		return 0;
+
+	MovedMeshes.clear();
+	for (uint32_t i = 0; i < (uint32_t)MeshList.size(); ++i)
+	{
+		if (Transforms.WasUpdated(MeshList[i]->GetTransformId()))
+		{
+			UpdateMeshBounds(i);
+			MovedMeshes.push_back(i);
+		}
+	}
+
+	// walking up from every moved leaf only pays off while few of them move
+	if (MovedMeshes.size() * 4 > MeshList.size())
+		MeshBvh.Refit(MeshBounds.data());
+	else
+		MeshBvh.Refit(MeshBounds.data(), MovedMeshes.data(), (uint32_t)MovedMeshes.size());
+	return Updated;
+}
+
+void Scene::UpdateMeshBounds(uint32_t Index)
+{
+	MeshNode* Node = MeshList[Index];
+	const MeshData* Mesh = Node->GetFirstMeshData();
+	MeshBounds[Index] = Mesh ? Node->GetLocalToWorld().TransformBoundingBox(Mesh->m_BoundMin, Mesh->m_BoundMax) : FBoundingBox();
+}
+
+MeshNode* Scene::RayCast(const Vector3f& Origin, const Vector3f& Direction, float* HitDistance) const
+{
+	uint32_t Hit = MeshBvh.RayCast(Origin, Direction, (std::numeric_limits<float>::max)(), HitDistance);
+	return Hit != FBvh::INVALID_INDEX ? MeshList[Hit] : nullptr;
 }
 
 MeshData* Scene::GetFirstMesh()
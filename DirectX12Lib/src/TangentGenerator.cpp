@@ -0,0 +1,396 @@
+#include "TangentGenerator.h"
+#include "Common.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <iostream>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TANGENT_USE_SSE 1
+#else
+#define TANGENT_USE_SSE 0
+#endif
+
+namespace
+{
+	const uint32_t TriangleBatch = 16 * 1024;
+	const uint32_t VertexBatch = 1024;
+
+	uint32_t BatchCount(uint32_t Count, uint32_t BatchSize)
+	{
+		return (Count + BatchSize - 1) / BatchSize;
+	}
+
+	// corner angle of MikkTSpace, measured in the tangent plane of the vertex normal
+	float CornerAngle(const Vector3f& Normal, const Vector3f& P0, const Vector3f& P1, const Vector3f& P2)
+	{
+		Vector3f Edge1 = P0 - P1;
+		Vector3f Edge2 = P2 - P1;
+		Edge1 = (Edge1 - Normal * Normal.Dot(Edge1)).SafeNormalize(0.f);
+		Edge2 = (Edge2 - Normal * Normal.Dot(Edge2)).SafeNormalize(0.f);
+		float Cos = (std::max)(-1.f, (std::min)(1.f, Edge1.Dot(Edge2)));
+		return acosf(Cos);
+	}
+}
+
+void FTangentGenerator::Generate(
+	ETangentMode Mode,
+	std::vector<Vector3f>& Positions,
+	std::vector<Vector2f>& Texcoords,
+	std::vector<Vector3f>& Normals,
+	std::vector<uint32_t>& Indices,
+	std::vector<Vector4f>& Tangents)
+{
+	Assert(Indices.size() % 3 == 0);
+	Assert(Texcoords.size() == Positions.size() && Normals.size() == Positions.size());
+
+	uint32_t Degenerated = Mode == TM_MikkTSpace
+		? GenerateMikkTSpace(Positions, Texcoords, Normals, Indices, Tangents)
+		: GenerateAccumulate(Positions, Texcoords, Normals, Indices, Tangents);
+	if (Degenerated > 0)
+	{
+		std::cout << "degenerated tangents: " << Degenerated << std::endl;
+	}
+}
+
+uint32_t FTangentGenerator::GenerateAccumulate(
+	const std::vector<Vector3f>& Positions,
+	const std::vector<Vector2f>& Texcoords,
+	const std::vector<Vector3f>& Normals,
+	const std::vector<uint32_t>& Indices,
+	std::vector<Vector4f>& Tangents)
+{
+	uint32_t VertexCount = (uint32_t)Positions.size();
+
+	// face tangents are recomputed for each corner instead of stored, a few flops are cheaper than 24 bytes per face
+	auto FaceTangent = [&](uint32_t a, Vector3f& sdir, Vector3f& tdir)
+	{
+		uint32_t i1 = Indices[3 * a];
+		uint32_t i2 = Indices[3 * a + 1];
+		uint32_t i3 = Indices[3 * a + 2];
+
+		const Vector3f& v1 = Positions[i1];
+		const Vector3f& v2 = Positions[i2];
+		const Vector3f& v3 = Positions[i3];
+		const Vector2f& w1 = Texcoords[i1];
+		const Vector2f& w2 = Texcoords[i2];
+		const Vector2f& w3 = Texcoords[i3];
+
+		float x1 = v2.x - v1.x;
+		float x2 = v3.x - v1.x;
+		float y1 = v2.y - v1.y;
+		float y2 = v3.y - v1.y;
+		float z1 = v2.z - v1.z;
+		float z2 = v3.z - v1.z;
+		float s1 = w2.x - w1.x;
+		float s2 = w3.x - w1.x;
+		float t1 = w2.y - w1.y;
+		float t2 = w3.y - w1.y;
+
+		// faces without texcoord area are skipped
+		float div = s1 * t2 - s2 * t1;
+		if (div == 0.f)
+			return false;
+		float r = 1.f / div;
+
+		sdir = Vector3f((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r);
+		tdir = Vector3f((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r);
+		return true;
+	};
+
+	std::vector<uint32_t> Offsets, Corners;
+	BuildVertexCorners(Indices, VertexCount, Offsets, Corners);
+
+	// every vertex sums its faces in triangle order, same result as a serial scatter-add
+	Tangents.resize(VertexCount);
+	std::atomic<uint32_t> Degenerated(0);
+	FParallel::For(BatchCount(VertexCount, VertexBatch), [&](uint32_t Batch)
+	{
+		Vector3f Tan1[VertexBatch];
+		Vector3f Tan2[VertexBatch];
+		uint32_t Start = Batch * VertexBatch;
+		uint32_t Count = (std::min)(VertexCount - Start, VertexBatch);
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			uint32_t v = Start + i;
+			for (uint32_t c = Offsets[v]; c < Offsets[v + 1]; ++c)
+			{
+				Vector3f sdir, tdir;
+				if (FaceTangent(Corners[c] / 3, sdir, tdir))
+				{
+					Tan1[i] += sdir;
+					Tan2[i] += tdir;
+				}
+			}
+		}
+		Degenerated += Orthogonalize(&Normals[Start], Tan1, Tan2, &Tangents[Start], Count);
+	});
+	return Degenerated;
+}
+
+uint32_t FTangentGenerator::GenerateMikkTSpace(
+	std::vector<Vector3f>& Positions,
+	std::vector<Vector2f>& Texcoords,
+	std::vector<Vector3f>& Normals,
+	std::vector<uint32_t>& Indices,
+	std::vector<Vector4f>& Tangents)
+{
+	enum EFaceFlags : uint8_t
+	{
+		FF_Valid = 1 << 0,
+		FF_OrientPreserving = 1 << 1,
+	};
+
+	uint32_t TriangleCount = (uint32_t)Indices.size() / 3;
+	uint32_t VertexCount = (uint32_t)Positions.size();
+
+	// unit face tangents with the texcoord orientation folded in
+	std::vector<Vector3f> FaceS(TriangleCount);
+	std::vector<uint8_t> FaceFlags(TriangleCount);
+	FParallel::For(BatchCount(TriangleCount, TriangleBatch), [&](uint32_t Batch)
+	{
+		uint32_t End = (std::min)(TriangleCount, (Batch + 1) * TriangleBatch);
+		for (uint32_t f = Batch * TriangleBatch; f < End; ++f)
+		{
+			const Vector3f& p1 = Positions[Indices[3 * f]];
+			const Vector3f& p2 = Positions[Indices[3 * f + 1]];
+			const Vector3f& p3 = Positions[Indices[3 * f + 2]];
+			const Vector2f& w1 = Texcoords[Indices[3 * f]];
+			const Vector2f& w2 = Texcoords[Indices[3 * f + 1]];
+			const Vector2f& w3 = Texcoords[Indices[3 * f + 2]];
+
+			float t21x = w2.x - w1.x;
+			float t21y = w2.y - w1.y;
+			float t31x = w3.x - w1.x;
+			float t31y = w3.y - w1.y;
+			Vector3f d1 = p2 - p1;
+			Vector3f d2 = p3 - p1;
+
+			float SignedAreaSTx2 = t21x * t31y - t21y * t31x;
+			Vector3f Os = d1 * t31y - d2 * t21y;
+			float LengthOs = Os.Length();
+			uint8_t Flags = SignedAreaSTx2 > 0.f ? FF_OrientPreserving : 0;
+			if (SignedAreaSTx2 != 0.f && LengthOs > 0.f)
+			{
+				Flags |= FF_Valid;
+				FaceS[f] = Os * ((Flags & FF_OrientPreserving ? 1.f : -1.f) / LengthOs);
+			}
+			FaceFlags[f] = Flags;
+		}
+	});
+
+	std::vector<uint32_t> Offsets, Corners;
+	BuildVertexCorners(Indices, VertexCount, Offsets, Corners);
+
+	// one tangent space per vertex and orientation, a vertex used by both gets split
+	Tangents.resize(VertexCount);
+	std::vector<Vector4f> MirroredTangents(VertexCount);
+	std::vector<uint8_t> NeedsSplit(VertexCount);
+	std::atomic<uint32_t> Degenerated(0);
+	FParallel::For(BatchCount(VertexCount, VertexBatch), [&](uint32_t Batch)
+	{
+		uint32_t Start = Batch * VertexBatch;
+		uint32_t End = (std::min)(VertexCount, Start + VertexBatch);
+		uint32_t BatchDegenerated = 0;
+		for (uint32_t v = Start; v < End; ++v)
+		{
+			const Vector3f& n = Normals[v];
+			Vector3f Sum[2];
+			bool Used[2] = { false, false };
+			for (uint32_t c = Offsets[v]; c < Offsets[v + 1]; ++c)
+			{
+				uint32_t Face = Corners[c] / 3;
+				if (!(FaceFlags[Face] & FF_Valid))
+					continue;
+				uint32_t Orient = FaceFlags[Face] & FF_OrientPreserving ? 1 : 0;
+				Used[Orient] = true;
+
+				const Vector3f& Os = FaceS[Face];
+				Vector3f Projected = (Os - n * n.Dot(Os)).SafeNormalize(0.f);
+				uint32_t k = Corners[c] % 3;
+				float Angle = CornerAngle(n, Positions[Indices[3 * Face + (k + 2) % 3]], Positions[v], Positions[Indices[3 * Face + (k + 1) % 3]]);
+				Sum[Orient] += Projected * Angle;
+			}
+
+			// the vertex keeps the orientation preserving space, faces without texcoord area follow it
+			uint32_t Primary = Used[1] || !Used[0] ? 1 : 0;
+			for (uint32_t Orient = 0; Orient < 2; ++Orient)
+			{
+				if (Orient != Primary && !Used[Orient])
+					continue;
+				Vector4f& Tangent = Orient == Primary ? Tangents[v] : MirroredTangents[v];
+				Vector3f Dir = Sum[Orient].SafeNormalize(0.f);
+				if (Dir.x == 0.f && Dir.y == 0.f && Dir.z == 0.f)
+				{
+					Tangent = n;
+					++BatchDegenerated;
+				}
+				else
+				{
+					Tangent = Vector4f(Dir, Orient ? 1.f : -1.f);
+				}
+			}
+			NeedsSplit[v] = Used[0] && Used[1];
+		}
+		Degenerated += BatchDegenerated;
+	});
+
+	std::vector<uint32_t> SplitVertices;
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		if (NeedsSplit[v])
+			SplitVertices.push_back(v);
+	}
+	if (SplitVertices.empty())
+		return Degenerated;
+
+	uint32_t NewCount = VertexCount + (uint32_t)SplitVertices.size();
+	Positions.reserve(NewCount);
+	Texcoords.reserve(NewCount);
+	Normals.reserve(NewCount);
+	Tangents.reserve(NewCount);
+	for (uint32_t v : SplitVertices)
+	{
+		Positions.push_back(Positions[v]);
+		Texcoords.push_back(Texcoords[v]);
+		Normals.push_back(Normals[v]);
+		Tangents.push_back(MirroredTangents[v]);
+	}
+
+	// every corner belongs to exactly one vertex, so the splits can rewrite indices in parallel
+	uint32_t SplitCount = (uint32_t)SplitVertices.size();
+	FParallel::For(BatchCount(SplitCount, VertexBatch), [&](uint32_t Batch)
+	{
+		uint32_t End = (std::min)(SplitCount, (Batch + 1) * VertexBatch);
+		for (uint32_t s = Batch * VertexBatch; s < End; ++s)
+		{
+			uint32_t v = SplitVertices[s];
+			for (uint32_t c = Offsets[v]; c < Offsets[v + 1]; ++c)
+			{
+				uint8_t Flags = FaceFlags[Corners[c] / 3];
+				if ((Flags & FF_Valid) && !(Flags & FF_OrientPreserving))
+					Indices[Corners[c]] = VertexCount + s;
+			}
+		}
+	});
+	return Degenerated;
+}
+
+void FTangentGenerator::BuildVertexCorners(const std::vector<uint32_t>& Indices, uint32_t VertexCount, std::vector<uint32_t>& Offsets, std::vector<uint32_t>& Corners)
+{
+	uint32_t CornerCount = (uint32_t)Indices.size();
+	uint32_t NumBatches = BatchCount(CornerCount, TriangleBatch);
+
+	std::vector<std::atomic<uint32_t>> Cursors(VertexCount);
+	FParallel::For(NumBatches, [&](uint32_t Batch)
+	{
+		uint32_t End = (std::min)(CornerCount, (Batch + 1) * TriangleBatch);
+		for (uint32_t c = Batch * TriangleBatch; c < End; ++c)
+		{
+			Assert(Indices[c] < VertexCount);
+			Cursors[Indices[c]].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	Offsets.resize(VertexCount + 1);
+	uint32_t Sum = 0;
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		Offsets[v] = Sum;
+		Sum += Cursors[v].load(std::memory_order_relaxed);
+		Cursors[v].store(Offsets[v], std::memory_order_relaxed);
+	}
+	Offsets[VertexCount] = Sum;
+
+	Corners.resize(CornerCount);
+	FParallel::For(NumBatches, [&](uint32_t Batch)
+	{
+		uint32_t End = (std::min)(CornerCount, (Batch + 1) * TriangleBatch);
+		for (uint32_t c = Batch * TriangleBatch; c < End; ++c)
+		{
+			Corners[Cursors[Indices[c]].fetch_add(1, std::memory_order_relaxed)] = c;
+		}
+	});
+
+	// slots are handed out in any order, sort the short lists back into triangle order
+	FParallel::For(BatchCount(VertexCount, VertexBatch), [&](uint32_t Batch)
+	{
+		uint32_t End = (std::min)(VertexCount, (Batch + 1) * VertexBatch);
+		for (uint32_t v = Batch * VertexBatch; v < End; ++v)
+		{
+			std::sort(Corners.begin() + Offsets[v], Corners.begin() + Offsets[v + 1]);
+		}
+	});
+}
+
+uint32_t FTangentGenerator::Orthogonalize(const Vector3f* Normals, const Vector3f* Tan1, const Vector3f* Tan2, Vector4f* Tangents, uint32_t Count)
+{
+	uint32_t Degenerated = 0;
+	uint32_t i = 0;
+#if TANGENT_USE_SSE
+	// four vertices at a time, same operation order as the scalar path
+	auto Load = [](const Vector3f* V, int c)
+	{
+		return _mm_setr_ps(V[0][c], V[1][c], V[2][c], V[3][c]);
+	};
+	for (; i + 4 <= Count; i += 4)
+	{
+		__m128 nx = Load(Normals + i, 0), ny = Load(Normals + i, 1), nz = Load(Normals + i, 2);
+		__m128 tx = Load(Tan1 + i, 0), ty = Load(Tan1 + i, 1), tz = Load(Tan1 + i, 2);
+		__m128 bx = Load(Tan2 + i, 0), by = Load(Tan2 + i, 1), bz = Load(Tan2 + i, 2);
+
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+		__m128 vx = _mm_sub_ps(tx, _mm_mul_ps(nx, d));
+		__m128 vy = _mm_sub_ps(ty, _mm_mul_ps(ny, d));
+		__m128 vz = _mm_sub_ps(tz, _mm_mul_ps(nz, d));
+		__m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+		__m128 Inv = _mm_div_ps(_mm_set1_ps(1.f), Length);
+		__m128 ox = _mm_mul_ps(vx, Inv);
+		__m128 oy = _mm_mul_ps(vy, Inv);
+		__m128 oz = _mm_mul_ps(vz, Inv);
+
+		// handedness: Cross(n, t).Dot(tan2)
+		__m128 cx = _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty));
+		__m128 cy = _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz));
+		__m128 cz = _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx));
+		__m128 h = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, bx), _mm_mul_ps(cy, by)), _mm_mul_ps(cz, bz));
+		__m128 Negative = _mm_cmplt_ps(h, _mm_setzero_ps());
+		__m128 w = _mm_or_ps(_mm_and_ps(Negative, _mm_set1_ps(-1.f)), _mm_andnot_ps(Negative, _mm_set1_ps(1.f)));
+
+		int NanMask = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(_mm_cmpunord_ps(ox, ox), _mm_cmpunord_ps(oy, oy)), _mm_cmpunord_ps(oz, oz)));
+
+		_MM_TRANSPOSE4_PS(ox, oy, oz, w);
+		_mm_storeu_ps(&Tangents[i].x, ox);
+		_mm_storeu_ps(&Tangents[i + 1].x, oy);
+		_mm_storeu_ps(&Tangents[i + 2].x, oz);
+		_mm_storeu_ps(&Tangents[i + 3].x, w);
+
+		for (int k = 0; NanMask != 0 && k < 4; ++k)
+		{
+			if (NanMask & (1 << k))
+			{
+				Tangents[i + k] = Normals[i + k];
+				++Degenerated;
+			}
+		}
+	}
+#endif
+	for (; i < Count; ++i)
+	{
+		const Vector3f& n = Normals[i];
+		const Vector3f& t = Tan1[i];
+		// Gram-Schmidt orthogonalize.
+		Vector4f Tangent = (t - n * n.Dot(t)).Normalize();
+		// Calculate handedness.
+		Tangent.w = (Cross(n, t).Dot(Tan2[i]) < 0.0f) ? -1.0f : 1.0f;
+		if (isnan(Tangent.x) || isnan(Tangent.y) || isnan(Tangent.z))
+		{
+			Tangent = n;
+			++Degenerated;
+		}
+		Tangents[i] = Tangent;
+	}
+	return Degenerated;
+}
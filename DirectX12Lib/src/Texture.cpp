@@ -3,12 +3,67 @@
 #include "DirectXTex.h"
 #include "CommandContext.h"
 #include "CommandListManager.h"
+#include "BindlessTable.h"
 #include "CommandContext.h"
 
 using namespace DirectX;
 
 extern FCommandListManager g_CommandListManager;
 
+FTexture::~FTexture()
+{
+	if (m_BindlessIndex != FBindlessIndexAllocator::INVALID_INDEX)
+	{
+		FBindlessTable::Get().Free(m_BindlessIndex);
+	}
+	FreeDescriptors();
+}
+
+void FTexture::Destroy()
+{
+	if (m_BindlessIndex != FBindlessIndexAllocator::INVALID_INDEX)
+	{
+		FBindlessTable::Get().Free(m_BindlessIndex);
+		m_BindlessIndex = FBindlessIndexAllocator::INVALID_INDEX;
+	}
+	FreeDescriptors();
+	FD3D12Resource::Destroy();
+}
+
+void FTexture::AllocateDescriptors(uint32_t Count)
+{
+	if (m_NumDescriptors != Count)
+	{
+		FreeDescriptors();
+	}
+	if (m_CpuDescriptorHandle.ptr == D3D12_CPU_VIRTUAL_ADDRESS_UNKNOWN)
+	{
+		m_CpuDescriptorHandle = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, Count);
+		m_NumDescriptors = Count;
+	}
+}
+
+void FTexture::FreeDescriptors()
+{
+	if (m_NumDescriptors > 0)
+	{
+		D3D12RHI::Get().FreeDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_CpuDescriptorHandle, m_NumDescriptors);
+		m_CpuDescriptorHandle.ptr = D3D12_CPU_VIRTUAL_ADDRESS_UNKNOWN;
+		m_NumDescriptors = 0;
+	}
+}
+
+void FTexture::RegisterBindless()
+{
+	if (!FBindlessTable::Get().IsCreated())
+		return;
+	if (m_BindlessIndex != FBindlessIndexAllocator::INVALID_INDEX)
+	{
+		FBindlessTable::Get().Free(m_BindlessIndex);
+	}
+	m_BindlessIndex = FBindlessTable::Get().Register(m_CpuDescriptorHandle);
+}
+
 void FTexture::Create(uint32_t Width, uint32_t Height, DXGI_FORMAT Format, const void* InitialData)
 {
 	m_Width = Width;
@@ -49,9 +104,9 @@ void FTexture::Create(uint32_t Width, uint32_t Height, DXGI_FORMAT Format, const
 
 	FCommandContext::InitializeTexture(*this, 1, &TexData);
 
-	if (m_CpuDescriptorHandle.ptr == D3D12_CPU_VIRTUAL_ADDRESS_UNKNOWN)
-		m_CpuDescriptorHandle = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	AllocateDescriptors(1);
 	D3D12RHI::Get().GetD3D12Device()->CreateShaderResourceView(m_Resource.Get(), nullptr, m_CpuDescriptorHandle);
+	RegisterBindless();
 }
 
 void FTexture::LoadFromFile(const std::wstring& FileName, bool IsSRGB)
@@ -91,9 +146,9 @@ void FTexture::LoadFromFile(const std::wstring& FileName, bool IsSRGB)
 	Assert(subresources.size() > 0);
 	FCommandContext::InitializeTexture(*this, (UINT)subresources.size(), &subresources[0]);
 
-	if (m_CpuDescriptorHandle.ptr == D3D12_CPU_VIRTUAL_ADDRESS_UNKNOWN)
-		m_CpuDescriptorHandle = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	AllocateDescriptors(1);
 	D3D12RHI::Get().GetD3D12Device()->CreateShaderResourceView(m_Resource.Get(), nullptr, m_CpuDescriptorHandle);
+	RegisterBindless();
 
 }
 
@@ -101,6 +156,8 @@ void FTexture::SaveTexutre(const std::wstring& FileName)
 {
 	ScratchImage image;
 	FCommandQueue& Queue = g_CommandListManager.GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	// the capture goes to the queue directly, past the upload waits of the contexts
+	g_UploadService.WaitForUpload(FUploadTicket(m_UploadBatch));
 
 	HRESULT hr = DirectX::CaptureTexture(Queue.GetD3D12CommandQueue(), m_Resource.Get(), false/*isCubeMap*/, image, m_AllCurrentState[0], m_AllCurrentState[0]);
 	if (SUCCEEDED(hr))
@@ -151,8 +208,7 @@ void FTextureArray::LoadFromFile(const std::wstring& FileName, bool IsSRGB /*= t
 	Assert(subresources.size() > 0);
 	FCommandContext::InitializeTexture(*this, (UINT)subresources.size(), &subresources[0]);
 
-	if (m_CpuDescriptorHandle.ptr == D3D12_CPU_VIRTUAL_ADDRESS_UNKNOWN)
-		m_CpuDescriptorHandle = D3D12RHI::Get().AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, (UINT)image.GetMetadata().arraySize);
+	AllocateDescriptors((uint32_t)image.GetMetadata().arraySize);
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -163,4 +219,5 @@ void FTextureArray::LoadFromFile(const std::wstring& FileName, bool IsSRGB /*= t
 	srvDesc.Texture2DArray.MipLevels = -1;//没有层级
 	srvDesc.Texture2DArray.FirstArraySlice = 0;
 	D3D12RHI::Get().GetD3D12Device()->CreateShaderResourceView(m_Resource.Get(), &srvDesc, m_CpuDescriptorHandle);
+	RegisterBindless();
 }
@@ -0,0 +1,103 @@
+#include "TextureRegistry.h"
+#include "Texture.h"
+#include "Common.h"
+
+#include <vector>
+#include <cctype>
+
+std::mutex FTextureRegistry::sm_Mutex;
+std::unordered_map<std::string, FTextureRegistry::FEntry> FTextureRegistry::sm_Textures;
+uint32_t FTextureRegistry::sm_RequestCount = 0;
+uint32_t FTextureRegistry::sm_LoadCount = 0;
+
+FTextureRef FTextureRegistry::Acquire(const std::string& FilePath, bool IsSRGB)
+{
+	std::string Key = NormalizePath(FilePath) + (IsSRGB ? "|srgb" : "|linear");
+
+	std::unique_lock<std::mutex> Lock(sm_Mutex);
+	++sm_RequestCount;
+	FEntry& Entry = sm_Textures[Key];
+	FTextureRef Texture = Entry.Texture.lock();
+	if (Texture)
+		return Texture;
+	if (Entry.Pending.valid())
+	{
+		// someone else decodes it, wait without the lock
+		std::shared_future<FTextureRef> Pending = Entry.Pending;
+		Lock.unlock();
+		return Pending.get();
+	}
+	std::promise<FTextureRef> Promise;
+	Entry.Pending = Promise.get_future().share();
+	++sm_LoadCount;
+	Lock.unlock();
+
+	Texture = std::make_shared<FTexture>();
+	Texture->LoadFromFile(ToWideString(FilePath), IsSRGB);
+
+	// the entry can't be erased while its future is valid
+	Lock.lock();
+	FEntry& Loaded = sm_Textures[Key];
+	Loaded.Texture = Texture;
+	Loaded.Pending = std::shared_future<FTextureRef>();
+	Lock.unlock();
+	Promise.set_value(Texture);
+	return Texture;
+}
+
+std::string FTextureRegistry::NormalizePath(const std::string& FilePath)
+{
+	std::vector<std::string> Segments;
+	size_t Start = 0;
+	while (Start <= FilePath.size())
+	{
+		size_t End = FilePath.find_first_of("/\\", Start);
+		if (End == std::string::npos)
+			End = FilePath.size();
+		std::string Segment = FilePath.substr(Start, End - Start);
+		for (size_t i = 0; i < Segment.size(); ++i)
+			Segment[i] = (char)tolower((unsigned char)Segment[i]);
+
+		if (Segment == "..")
+		{
+			if (!Segments.empty() && Segments.back() != ".." && !Segments.back().empty())
+				Segments.pop_back();
+			else
+				Segments.push_back(Segment);
+		}
+		else if (Segment != "." && (!Segment.empty() || Segments.empty()))
+		{
+			// an empty first segment keeps a leading slash
+			Segments.push_back(Segment);
+		}
+		Start = End + 1;
+	}
+
+	std::string Result;
+	for (size_t i = 0; i < Segments.size(); ++i)
+	{
+		if (i > 0)
+			Result += '/';
+		Result += Segments[i];
+	}
+	return Result;
+}
+
+uint32_t FTextureRegistry::GetLiveCount()
+{
+	std::lock_guard<std::mutex> Lock(sm_Mutex);
+	uint32_t Count = 0;
+	for (auto it = sm_Textures.begin(); it != sm_Textures.end(); )
+	{
+		if (it->second.Texture.expired() && !it->second.Pending.valid())
+		{
+			it = sm_Textures.erase(it);
+		}
+		else
+		{
+			++Count;
+			++it;
+		}
+	}
+	return Count;
+}
@@ -0,0 +1,217 @@
+#include "TransformHierarchy.h"
+#include "Parallel.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+	template<typename T>
+	void Permute(std::vector<T>& Values, const std::vector<uint32_t>& NewSlots)
+	{
+		std::vector<T> Result(Values.size());
+		for (size_t i = 0; i < Values.size(); ++i)
+			Result[NewSlots[i]] = Values[i];
+		Values.swap(Result);
+	}
+}
+
+FTransformHierarchy::FTransformHierarchy()
+	: m_FirstDirtyDepth(INVALID_ID)
+	, m_LastDirtyDepth(0)
+	, m_UpdatedFirstWord(0)
+	, m_Sorted(true)
+{
+}
+
+uint32_t FTransformHierarchy::Add(uint32_t Parent, const Vector3f& Scale, const FQuaternion& Rotation, const Vector3f& Translation)
+{
+	Assert(Parent == INVALID_ID || Parent < m_IdToSlot.size());
+	uint32_t Id = (uint32_t)m_IdToSlot.size();
+	uint32_t Slot = GetCount();
+	uint32_t ParentSlot = Parent == INVALID_ID ? INVALID_ID : m_IdToSlot[Parent];
+
+	m_IdToSlot.push_back(Slot);
+	m_SlotToId.push_back(Id);
+	m_Parents.push_back(ParentSlot);
+	m_Depths.push_back(ParentSlot == INVALID_ID ? 0 : m_Depths[ParentSlot] + 1);
+	m_Scales.push_back(Scale);
+	m_Rotations.push_back(Rotation);
+	m_Translations.push_back(Translation);
+	m_LocalToWorld.push_back(FMatrix());
+	m_Dirty.resize((GetCount() + 63) / 64, 0);
+	m_Updated.resize(m_Dirty.size(), 0);
+
+	// slots are appended out of depth order, the next Update sorts and recomputes everything
+	m_Sorted = false;
+	return Id;
+}
+
+void FTransformHierarchy::Clear()
+{
+	m_Parents.clear();
+	m_Depths.clear();
+	m_Scales.clear();
+	m_Rotations.clear();
+	m_Translations.clear();
+	m_LocalToWorld.clear();
+	m_Dirty.clear();
+	m_Updated.clear();
+	m_SlotToId.clear();
+	m_IdToSlot.clear();
+	m_LevelStarts.clear();
+	m_FirstDirtyDepth = INVALID_ID;
+	m_LastDirtyDepth = 0;
+	m_UpdatedFirstWord = 0;
+	m_Sorted = true;
+}
+
+void FTransformHierarchy::SetScale(uint32_t Id, const Vector3f& Scale)
+{
+	uint32_t Slot = m_IdToSlot[Id];
+	m_Scales[Slot] = Scale;
+	MarkDirty(Slot);
+}
+
+void FTransformHierarchy::SetRotation(uint32_t Id, const FQuaternion& Rotation)
+{
+	uint32_t Slot = m_IdToSlot[Id];
+	m_Rotations[Slot] = Rotation;
+	MarkDirty(Slot);
+}
+
+void FTransformHierarchy::SetTranslation(uint32_t Id, const Vector3f& Translation)
+{
+	uint32_t Slot = m_IdToSlot[Id];
+	m_Translations[Slot] = Translation;
+	MarkDirty(Slot);
+}
+
+void FTransformHierarchy::SetLocal(uint32_t Id, const Vector3f& Scale, const FQuaternion& Rotation, const Vector3f& Translation)
+{
+	uint32_t Slot = m_IdToSlot[Id];
+	m_Scales[Slot] = Scale;
+	m_Rotations[Slot] = Rotation;
+	m_Translations[Slot] = Translation;
+	MarkDirty(Slot);
+}
+
+void FTransformHierarchy::MarkDirty(uint32_t Slot)
+{
+	SetDirty(Slot);
+	uint32_t Depth = m_Depths[Slot];
+	m_FirstDirtyDepth = (std::min)(m_FirstDirtyDepth, Depth);
+	m_LastDirtyDepth = (std::max)(m_LastDirtyDepth, Depth);
+}
+
+void FTransformHierarchy::SortByDepth()
+{
+	const uint32_t Count = GetCount();
+	uint32_t MaxDepth = 0;
+	for (uint32_t i = 0; i < Count; ++i)
+		MaxDepth = (std::max)(MaxDepth, m_Depths[i]);
+
+	// counting sort, stable so siblings stay in the order they were added
+	m_LevelStarts.assign(Count > 0 ? MaxDepth + 2 : 0, 0);
+	for (uint32_t i = 0; i < Count; ++i)
+		m_LevelStarts[m_Depths[i] + 1]++;
+	for (size_t d = 1; d < m_LevelStarts.size(); ++d)
+		m_LevelStarts[d] += m_LevelStarts[d - 1];
+
+	std::vector<uint32_t> NewSlots(Count);
+	std::vector<uint32_t> Next(m_LevelStarts);
+	for (uint32_t i = 0; i < Count; ++i)
+		NewSlots[i] = Next[m_Depths[i]]++;
+
+	for (uint32_t i = 0; i < Count; ++i)
+	{
+		if (m_Parents[i] != INVALID_ID)
+			m_Parents[i] = NewSlots[m_Parents[i]];
+	}
+	Permute(m_Parents, NewSlots);
+	Permute(m_Depths, NewSlots);
+	Permute(m_Scales, NewSlots);
+	Permute(m_Rotations, NewSlots);
+	Permute(m_Translations, NewSlots);
+	Permute(m_LocalToWorld, NewSlots);
+	Permute(m_SlotToId, NewSlots);
+	for (uint32_t i = 0; i < Count; ++i)
+		m_IdToSlot[m_SlotToId[i]] = i;
+
+	std::fill(m_Dirty.begin(), m_Dirty.end(), ~0ull);
+	m_FirstDirtyDepth = Count > 0 ? 0 : INVALID_ID;
+	m_LastDirtyDepth = MaxDepth;
+	m_Sorted = true;
+}
+
+uint32_t FTransformHierarchy::UpdateRange(uint32_t Begin, uint32_t End)
+{
+	// parents sit on the level above and are final, the dirty bit of a recomputed node is raised for its children
+	uint32_t Updated = 0;
+	for (uint32_t Slot = Begin; Slot < End; ++Slot)
+	{
+		uint32_t Parent = m_Parents[Slot];
+		if (!TestDirty(Slot) && (Parent == INVALID_ID || !TestDirty(Parent)))
+			continue;
+
+		// Scale * Rotation * Translation without the full matrix products
+		const FMatrix Rotation = m_Rotations[Slot].ToMatrix();
+		const Vector3f& Scale = m_Scales[Slot];
+		FMatrix Local(Rotation[0] * Scale.x, Rotation[1] * Scale.y, Rotation[2] * Scale.z, Vector4f(m_Translations[Slot], 1.f));
+		m_LocalToWorld[Slot] = Parent == INVALID_ID ? Local : Local * m_LocalToWorld[Parent];
+		SetDirty(Slot);
+		++Updated;
+	}
+	return Updated;
+}
+
+uint32_t FTransformHierarchy::Update(uint32_t MaxWorkers)
+{
+	if (!m_Sorted)
+		SortByDepth();
+	std::fill(m_Updated.begin() + (std::min)((size_t)m_UpdatedFirstWord, m_Updated.size()), m_Updated.end(), 0);
+	m_UpdatedFirstWord = (uint32_t)m_Updated.size();
+	if (m_FirstDirtyDepth == INVALID_ID)
+		return 0;
+
+	// chunk starts are multiples of 64 so that no two workers write the same dirty word
+	const uint32_t ChunkSize = PARALLEL_MIN_NODES / 4;
+	uint32_t Updated = 0;
+	for (uint32_t Depth = m_FirstDirtyDepth; Depth < GetLevelCount(); ++Depth)
+	{
+		const uint32_t Begin = m_LevelStarts[Depth];
+		const uint32_t End = m_LevelStarts[Depth + 1];
+		uint32_t LevelUpdated = 0;
+		if (End - Begin < PARALLEL_MIN_NODES)
+		{
+			LevelUpdated = UpdateRange(Begin, End);
+		}
+		else
+		{
+			// the first chunk shares its dirty word with the parents, it is done before the workers read them
+			const uint32_t FirstChunk = Begin / ChunkSize;
+			const uint32_t NumChunks = (End - 1) / ChunkSize - FirstChunk;
+			std::atomic<uint32_t> ChunkUpdated(UpdateRange(Begin, (FirstChunk + 1) * ChunkSize));
+			FParallel::For(NumChunks, [&](uint32_t Chunk)
+			{
+				uint32_t ChunkBegin = (FirstChunk + Chunk + 1) * ChunkSize;
+				uint32_t ChunkEnd = (std::min)(End, ChunkBegin + ChunkSize);
+				ChunkUpdated += UpdateRange(ChunkBegin, ChunkEnd);
+			}, MaxWorkers);
+			LevelUpdated = ChunkUpdated;
+		}
+		Updated += LevelUpdated;
+
+		// nothing changed on this level and no node below was marked
+		if (LevelUpdated == 0 && Depth >= m_LastDirtyDepth)
+			break;
+	}
+
+	// the bits left are exactly the recomputed nodes, the levels above the first dirty one have none
+	m_Updated.swap(m_Dirty);
+	m_UpdatedFirstWord = m_LevelStarts[m_FirstDirtyDepth] / 64;
+	m_FirstDirtyDepth = INVALID_ID;
+	m_LastDirtyDepth = 0;
+	return Updated;
+}
@@ -0,0 +1,91 @@
+#include "UploadRing.h"
+#include "Assertion.h"
+
+#include <algorithm>
+
+FUploadRing::FUploadRing(uint64_t Capacity)
+	: m_Capacity(0)
+	, m_Head(0)
+	, m_Tail(0)
+	, m_OpenBatch(1)
+	, m_OpenBatchUsed(false)
+{
+	Reset(Capacity);
+}
+
+void FUploadRing::Reset(uint64_t Capacity)
+{
+	m_Capacity = Capacity;
+	m_Head = 0;
+	m_Tail = 0;
+	m_OpenBatchUsed = false;
+	m_Batches.clear();
+}
+
+uint64_t FUploadRing::Allocate(uint64_t Size, uint64_t Alignment)
+{
+	Assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0);
+	Assert(m_Capacity % Alignment == 0);
+	if (Size == 0 || Size > m_Capacity)
+		return INVALID_OFFSET;
+
+	if (m_Head == m_Tail)
+	{
+		// nothing is in flight, start over at the front so that the whole capacity is usable
+		m_Head = (m_Head + m_Capacity - 1) / m_Capacity * m_Capacity;
+		m_Tail = m_Head;
+	}
+
+	uint64_t Position = (m_Head + Alignment - 1) & ~(Alignment - 1);
+	uint64_t Offset = Position % m_Capacity;
+	if (Offset + Size > m_Capacity)
+	{
+		// an allocation never straddles the end, the rest of the lap is left unused
+		Position += m_Capacity - Offset;
+		Offset = 0;
+	}
+	if (Position + Size - m_Tail > m_Capacity)
+		return INVALID_OFFSET;
+
+	m_Head = Position + Size;
+	m_OpenBatchUsed = true;
+	return Offset;
+}
+
+uint64_t FUploadRing::SubmitBatch(uint64_t FenceValue)
+{
+	Assert(m_Batches.empty() || FenceValue >= m_Batches.back().Fence);
+	FBatch Batch;
+	Batch.Serial = m_OpenBatch;
+	Batch.End = m_Head;
+	Batch.Fence = FenceValue;
+	m_Batches.push_back(Batch);
+
+	m_OpenBatchUsed = false;
+	return m_OpenBatch++;
+}
+
+void FUploadRing::Retire(uint64_t CompletedFence)
+{
+	while (!m_Batches.empty() && m_Batches.front().Fence <= CompletedFence)
+	{
+		// a batch that took no space may end before a restart of the ring
+		m_Tail = (std::max)(m_Tail, m_Batches.front().End);
+		m_Batches.pop_front();
+	}
+}
+
+bool FUploadRing::IsBatchRetired(uint64_t Batch) const
+{
+	if (Batch >= m_OpenBatch)
+		return false;
+	return m_Batches.empty() || Batch < m_Batches.front().Serial;
+}
+
+uint64_t FUploadRing::GetBatchFence(uint64_t Batch) const
+{
+	if (Batch >= m_OpenBatch || IsBatchRetired(Batch))
+		return 0;
+	// the serials in flight are consecutive
+	return m_Batches[(size_t)(Batch - m_Batches.front().Serial)].Fence;
+}
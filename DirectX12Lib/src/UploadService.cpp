@@ -0,0 +1,222 @@
+#include "UploadService.h"
+#include "CommandContext.h"
+#include "CommandListManager.h"
+#include "D3D12Resource.h"
+
+#include <algorithm>
+#include "d3dx12.h"
+
+extern FCommandListManager g_CommandListManager;
+
+FUploadService::FUploadService()
+	: m_Device(nullptr)
+	, m_RingCpu(nullptr)
+	, m_Context(nullptr)
+{
+	std::fill(m_QueueWaitFence, m_QueueWaitFence + 4, 0);
+}
+
+void FUploadService::Create(ID3D12Device* Device, uint64_t RingSize /*= DEFAULT_RING_SIZE*/)
+{
+	// textures are placed at 512 byte offsets, the ring has to be a multiple of that
+	RingSize = (RingSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(uint64_t)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+
+	m_Device = Device;
+	m_RingBuffer.Attach(CreateUploadBuffer(RingSize));
+	m_RingBuffer->SetName(L"UploadRing");
+	ThrowIfFailed(m_RingBuffer->Map(0, nullptr, (void**)&m_RingCpu));
+	m_Ring.Reset(RingSize);
+}
+
+void FUploadService::Destroy()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	SubmitOpenBatch();
+	while (uint64_t Fence = m_Ring.GetOldestFence())
+	{
+		g_CommandListManager.WaitForFence(Fence);
+		m_Ring.Retire(Fence);
+	}
+	m_DedicatedBuffers.clear();
+
+	if (m_RingBuffer)
+	{
+		m_RingBuffer->Unmap(0, nullptr);
+		m_RingBuffer = nullptr;
+	}
+	m_RingCpu = nullptr;
+	m_Ring.Reset(0);
+	m_Device = nullptr;
+}
+
+bool FUploadService::CanUpload(const FD3D12Resource& Dest)
+{
+	for (D3D12_RESOURCE_STATES State : Dest.m_AllCurrentState)
+	{
+		if (State != D3D12_RESOURCE_STATE_COMMON && State != D3D12_RESOURCE_STATE_COPY_DEST)
+			return false;
+	}
+	return true;
+}
+
+FUploadTicket FUploadService::UploadBuffer(FD3D12Resource& Dest, const void* Data, size_t NumBytes, size_t DestOffset /*= 0*/)
+{
+	Assert(CanUpload(Dest));
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+
+	ID3D12Resource* Staging = nullptr;
+	uint64_t Offset = 0;
+	uint8_t* Cpu = AllocateStaging(NumBytes, 16, &Staging, &Offset);
+	memcpy(Cpu, Data, NumBytes);
+
+	GetContext().GetCommandList()->CopyBufferRegion(Dest.GetResource(), DestOffset, Staging, Offset, NumBytes);
+	return FinishUpload(Dest);
+}
+
+FUploadTicket FUploadService::UploadTexture(FD3D12Resource& Dest, UINT FirstSubresource, UINT NumSubresources, const D3D12_SUBRESOURCE_DATA SubData[])
+{
+	Assert(CanUpload(Dest));
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+
+	uint64_t Size = GetRequiredIntermediateSize(Dest.GetResource(), FirstSubresource, NumSubresources);
+	ID3D12Resource* Staging = nullptr;
+	uint64_t Offset = 0;
+	AllocateStaging(Size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &Staging, &Offset);
+
+	// writes the rows through its own mapping of the staging buffer
+	UpdateSubresources(GetContext().GetCommandList(), Dest.GetResource(), Staging, Offset, FirstSubresource, NumSubresources,
+		const_cast<D3D12_SUBRESOURCE_DATA*>(SubData));
+	return FinishUpload(Dest);
+}
+
+void FUploadService::Submit()
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	SubmitOpenBatch();
+}
+
+bool FUploadService::IsComplete(FUploadTicket Ticket)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (!Ticket.IsValid())
+		return true;
+	RetireCompleted();
+	return m_Ring.IsBatchRetired(Ticket.Batch);
+}
+
+void FUploadService::WaitForUpload(FUploadTicket Ticket)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (!Ticket.IsValid())
+		return;
+	if (Ticket.Batch == m_Ring.GetOpenBatch())
+		SubmitOpenBatch();
+	if (uint64_t Fence = m_Ring.GetBatchFence(Ticket.Batch))
+		g_CommandListManager.WaitForFence(Fence);
+	RetireCompleted();
+}
+
+void FUploadService::MakeQueueWait(FCommandQueue& Queue, D3D12_COMMAND_LIST_TYPE Type, FUploadTicket Ticket)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (!Ticket.IsValid())
+		return;
+	if (Ticket.Batch == m_Ring.GetOpenBatch())
+		SubmitOpenBatch();
+
+	// the batches run in order on the copy queue, waiting for a newer one covers the older ones
+	uint64_t Fence = m_Ring.GetBatchFence(Ticket.Batch);
+	if (Fence == 0 || Fence <= m_QueueWaitFence[Type])
+		return;
+	Queue.StallForFence(Fence);
+	m_QueueWaitFence[Type] = Fence;
+}
+
+uint8_t* FUploadService::AllocateStaging(uint64_t Size, uint64_t Alignment, ID3D12Resource** Buffer, uint64_t* Offset)
+{
+	if (Size > m_Ring.GetCapacity())
+	{
+		FDedicatedBuffer Dedicated;
+		Dedicated.Batch = m_Ring.GetOpenBatch();
+		Dedicated.Buffer.Attach(CreateUploadBuffer(Size));
+		Dedicated.Buffer->SetName(L"UploadStaging");
+		m_DedicatedBuffers.push_back(Dedicated);
+		m_Ring.MarkOpenBatchUsed();
+
+		// mapped for as long as it lives
+		uint8_t* Cpu = nullptr;
+		ThrowIfFailed(Dedicated.Buffer->Map(0, nullptr, (void**)&Cpu));
+		*Buffer = Dedicated.Buffer.Get();
+		*Offset = 0;
+		return Cpu;
+	}
+
+	uint64_t RingOffset;
+	while ((RingOffset = m_Ring.Allocate(Size, Alignment)) == FUploadRing::INVALID_OFFSET)
+	{
+		// the open batch alone fills the ring, it has to go first
+		if (m_Ring.GetOldestFence() == 0)
+			SubmitOpenBatch();
+		uint64_t Fence = m_Ring.GetOldestFence();
+		Assert(Fence != 0);
+		g_CommandListManager.WaitForFence(Fence);
+		m_Ring.Retire(Fence);
+	}
+	*Buffer = m_RingBuffer.Get();
+	*Offset = RingOffset;
+	return m_RingCpu + RingOffset;
+}
+
+ID3D12Resource* FUploadService::CreateUploadBuffer(uint64_t Size)
+{
+	CD3DX12_HEAP_PROPERTIES HeapProps(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC ResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(Size);
+
+	ID3D12Resource* pBuffer = nullptr;
+	ThrowIfFailed(m_Device->CreateCommittedResource(
+		&HeapProps,
+		D3D12_HEAP_FLAG_NONE,
+		&ResourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&pBuffer)));
+	return pBuffer;
+}
+
+void FUploadService::SubmitOpenBatch()
+{
+	if (m_Ring.IsOpenBatchEmpty())
+		return;
+	Assert(m_Context != nullptr);
+	uint64_t Fence = m_Context->Finish();
+	m_Context = nullptr;
+	m_Ring.SubmitBatch(Fence);
+	RetireCompleted();
+}
+
+void FUploadService::RetireCompleted()
+{
+	FCommandQueue& Queue = g_CommandListManager.GetQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+	m_Ring.RetireCompleted([&Queue](uint64_t Fence) { return Queue.IsFenceComplete(Fence); });
+	while (!m_DedicatedBuffers.empty() && m_Ring.IsBatchRetired(m_DedicatedBuffers.front().Batch))
+	{
+		m_DedicatedBuffers.pop_front();
+	}
+}
+
+FCommandContext& FUploadService::GetContext()
+{
+	if (m_Context == nullptr)
+	{
+		m_Context = &FCommandContext::Begin(D3D12_COMMAND_LIST_TYPE_COPY, L"Upload");
+	}
+	return *m_Context;
+}
+
+FUploadTicket FUploadService::FinishUpload(FD3D12Resource& Dest)
+{
+	// what the copy queue wrote decays to COMMON, from there the graphics queue promotes it on first use
+	std::fill(Dest.m_AllCurrentState.begin(), Dest.m_AllCurrentState.end(), D3D12_RESOURCE_STATE_COMMON);
+	Dest.m_UploadBatch = m_Ring.GetOpenBatch();
+	return FUploadTicket(Dest.m_UploadBatch);
+}
@@ -0,0 +1,250 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+// the parts of FMeshOptimizer that only see index lists, they need no MeshData and so no device
+
+namespace
+{
+	const uint32_t InvalidIndex = 0xffffffff;
+
+	// FIFO cache over the misses, a vertex is cached while less than CacheSize misses happened since its own
+	struct FCacheSimulation
+	{
+		std::vector<uint32_t> MissStamps;
+		std::vector<uint32_t> DrawStamps;
+		uint32_t MissCount;
+		uint32_t DrawCount;
+		uint32_t CacheSize;
+
+		FCacheSimulation(uint32_t VertexCount, uint32_t InCacheSize)
+			: MissStamps(VertexCount, 0)
+			, DrawStamps(VertexCount, InvalidIndex)
+			, MissCount(InCacheSize + 1)
+			, DrawCount(0)
+			, CacheSize(InCacheSize)
+		{}
+
+		// every draw starts with a cold cache
+		void Draw(const uint32_t* Indices, uint32_t IndexCount, FVertexCacheStats& Stats)
+		{
+			for (uint32_t i = 0; i < IndexCount; ++i)
+			{
+				uint32_t v = Indices[i];
+				if (DrawStamps[v] != DrawCount)
+				{
+					DrawStamps[v] = DrawCount;
+					Stats.VertexCount++;
+				}
+				if (MissCount - MissStamps[v] > CacheSize)
+				{
+					MissStamps[v] = MissCount++;
+					Stats.Misses++;
+				}
+			}
+			Stats.TriangleCount += IndexCount / 3;
+			MissCount += CacheSize + 1;
+			DrawCount++;
+		}
+	};
+}
+
+FVertexCacheStats FMeshOptimizer::AnalyzeVertexCache(const uint32_t* Indices, uint32_t IndexCount, uint32_t VertexCount, uint32_t CacheSize)
+{
+	FVertexCacheStats Stats;
+	FCacheSimulation Simulation(VertexCount, CacheSize);
+	Simulation.Draw(Indices, IndexCount, Stats);
+	return Stats;
+}
+
+void FMeshOptimizer::OptimizeVertexCache(uint32_t* Indices, uint32_t IndexCount, uint32_t VertexCount, uint32_t CacheSize, std::vector<uint32_t>* ClusterStarts)
+{
+	uint32_t TriangleCount = IndexCount / 3;
+	if (ClusterStarts)
+	{
+		ClusterStarts->assign(TriangleCount > 0 ? 1 : 0, 0);
+	}
+	if (TriangleCount == 0)
+		return;
+
+	// triangles around each vertex
+	std::vector<uint32_t> Offsets(VertexCount + 1, 0);
+	for (uint32_t i = 0; i < TriangleCount * 3; ++i)
+	{
+		Offsets[Indices[i] + 1]++;
+	}
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		Offsets[v + 1] += Offsets[v];
+	}
+	std::vector<uint32_t> Adjacency(TriangleCount * 3);
+	std::vector<uint32_t> Fill(Offsets.begin(), Offsets.end() - 1);
+	for (uint32_t i = 0; i < TriangleCount * 3; ++i)
+	{
+		Adjacency[Fill[Indices[i]]++] = i / 3;
+	}
+
+	std::vector<uint32_t> LiveCount(VertexCount);
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		LiveCount[v] = Offsets[v + 1] - Offsets[v];
+	}
+	std::vector<uint32_t> CacheTime(VertexCount, 0);
+	std::vector<uint8_t> Emitted(TriangleCount, 0);
+	std::vector<uint32_t> DeadEnd;
+	std::vector<uint32_t> Candidates;
+	std::vector<uint32_t> Output;
+	Output.reserve(TriangleCount * 3);
+
+	uint32_t Time = CacheSize + 1;
+	uint32_t Cursor = 0;
+	uint32_t Fanning = Indices[0];
+	while (Fanning != InvalidIndex)
+	{
+		// emit all live triangles around the fanning vertex
+		Candidates.clear();
+		for (uint32_t j = Offsets[Fanning]; j < Offsets[Fanning + 1]; ++j)
+		{
+			uint32_t t = Adjacency[j];
+			if (Emitted[t])
+				continue;
+			Emitted[t] = 1;
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = Indices[3 * t + k];
+				Output.push_back(v);
+				DeadEnd.push_back(v);
+				Candidates.push_back(v);
+				LiveCount[v]--;
+				if (Time - CacheTime[v] > CacheSize)
+				{
+					CacheTime[v] = Time++;
+				}
+			}
+		}
+
+		// next fanning vertex, the oldest one that still is in the cache after its own fan
+		uint32_t Best = InvalidIndex;
+		int32_t BestPriority = -1;
+		for (size_t i = 0; i < Candidates.size(); ++i)
+		{
+			uint32_t v = Candidates[i];
+			if (LiveCount[v] == 0)
+				continue;
+			int32_t Priority = 0;
+			if (Time - CacheTime[v] + 2 * LiveCount[v] <= CacheSize)
+			{
+				Priority = (int32_t)(Time - CacheTime[v]);
+			}
+			if (Priority > BestPriority)
+			{
+				BestPriority = Priority;
+				Best = v;
+			}
+		}
+
+		if (Best == InvalidIndex)
+		{
+			// dead end, the locality is lost and a new cluster starts
+			while (!DeadEnd.empty() && Best == InvalidIndex)
+			{
+				uint32_t v = DeadEnd.back();
+				DeadEnd.pop_back();
+				if (LiveCount[v] > 0)
+					Best = v;
+			}
+			while (Cursor < VertexCount && Best == InvalidIndex)
+			{
+				if (LiveCount[Cursor] > 0)
+					Best = Cursor;
+				++Cursor;
+			}
+			if (Best != InvalidIndex && ClusterStarts)
+			{
+				ClusterStarts->push_back((uint32_t)Output.size());
+			}
+		}
+		Fanning = Best;
+	}
+
+	std::copy(Output.begin(), Output.end(), Indices);
+}
+
+void FMeshOptimizer::OptimizeOverdraw(uint32_t* Indices, uint32_t IndexCount, const Vector3f* Positions, const std::vector<uint32_t>& ClusterStarts)
+{
+	size_t ClusterCount = ClusterStarts.size();
+	if (ClusterCount < 2)
+		return;
+
+	// area weighted centroid and normal per cluster
+	std::vector<Vector3f> Centroids(ClusterCount);
+	std::vector<Vector3f> Normals(ClusterCount);
+	std::vector<float> Areas(ClusterCount, 0.f);
+	Vector3f MeshCentroid;
+	float MeshArea = 0.f;
+	for (size_t c = 0; c < ClusterCount; ++c)
+	{
+		uint32_t End = c + 1 < ClusterCount ? ClusterStarts[c + 1] : IndexCount;
+		for (uint32_t i = ClusterStarts[c]; i < End; i += 3)
+		{
+			const Vector3f& P0 = Positions[Indices[i]];
+			const Vector3f& P1 = Positions[Indices[i + 1]];
+			const Vector3f& P2 = Positions[Indices[i + 2]];
+			Vector3f Normal = Cross(P1 - P0, P2 - P0);
+			float Area = Normal.Length();
+			Centroids[c] += (P0 + P1 + P2) * (Area / 3.f);
+			Normals[c] += Normal;
+			Areas[c] += Area;
+		}
+		MeshCentroid += Centroids[c];
+		MeshArea += Areas[c];
+	}
+	if (MeshArea <= 0.f)
+		return;
+	MeshCentroid = MeshCentroid / MeshArea;
+
+	// clusters far out along their own normal tend to occlude the rest, draw them first
+	std::vector<float> SortKeys(ClusterCount, 0.f);
+	for (size_t c = 0; c < ClusterCount; ++c)
+	{
+		if (Areas[c] > 0.f)
+		{
+			SortKeys[c] = (Centroids[c] / Areas[c] - MeshCentroid).Dot(Normals[c].SafeNormalize(0.f));
+		}
+	}
+	std::vector<uint32_t> Order(ClusterCount);
+	for (uint32_t c = 0; c < (uint32_t)ClusterCount; ++c)
+	{
+		Order[c] = c;
+	}
+	std::stable_sort(Order.begin(), Order.end(), [&SortKeys](uint32_t A, uint32_t B) { return SortKeys[A] > SortKeys[B]; });
+
+	std::vector<uint32_t> Sorted;
+	Sorted.reserve(IndexCount);
+	for (size_t i = 0; i < ClusterCount; ++i)
+	{
+		uint32_t c = Order[i];
+		uint32_t End = c + 1 < ClusterCount ? ClusterStarts[c + 1] : IndexCount;
+		Sorted.insert(Sorted.end(), Indices + ClusterStarts[c], Indices + End);
+	}
+	std::copy(Sorted.begin(), Sorted.end(), Indices);
+}
+
+void FMeshOptimizer::RemapVertexFetch(uint32_t* Indices, size_t IndexCount, uint32_t VertexCount, std::vector<uint32_t>& Remap)
+{
+	Remap.assign(VertexCount, InvalidIndex);
+	uint32_t NextVertex = 0;
+	for (size_t i = 0; i < IndexCount; ++i)
+	{
+		uint32_t& NewIndex = Remap[Indices[i]];
+		if (NewIndex == InvalidIndex)
+			NewIndex = NextVertex++;
+		Indices[i] = NewIndex;
+	}
+	// unreferenced vertices go last
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		if (Remap[v] == InvalidIndex)
+			Remap[v] = NextVertex++;
+	}
+}
@@ -0,0 +1,210 @@
+#include "VertexCompression.h"
+
+#include <string.h>
+
+namespace
+{
+	float SignNotZero(float Value)
+	{
+		return Value >= 0.f ? 1.f : -1.f;
+	}
+}
+
+int16_t FVertexCompression::FloatToSNorm16(float Value)
+{
+	Value = std::min(std::max(Value, -1.f), 1.f);
+	return (int16_t)std::lround(Value * 32767.f);
+}
+
+float FVertexCompression::SNorm16ToFloat(int16_t Value)
+{
+	// -32768 and -32767 both map to -1 like the input assembler does
+	return std::max((float)Value / 32767.f, -1.f);
+}
+
+uint32_t FVertexCompression::FloatToUNorm(float Value, uint32_t MaxValue)
+{
+	Value = std::min(std::max(Value, 0.f), 1.f);
+	return (uint32_t)std::lround(Value * (float)MaxValue);
+}
+
+Vector2f FVertexCompression::OctWrap(const Vector2f& Value)
+{
+	return Vector2f((1.f - fabsf(Value.y)) * SignNotZero(Value.x), (1.f - fabsf(Value.x)) * SignNotZero(Value.y));
+}
+
+uint32_t FVertexCompression::EncodeOctNormal(const Vector3f& Normal)
+{
+	float L1 = fabsf(Normal.x) + fabsf(Normal.y) + fabsf(Normal.z);
+	if (L1 <= 0.f)
+		return EncodeOctNormal(Vector3f(0.f, 0.f, 1.f));
+
+	Vector2f Oct(Normal.x / L1, Normal.y / L1);
+	if (Normal.z < 0.f)
+		Oct = OctWrap(Oct);
+
+	// rounding each component alone is up to 2x off, keep the best of the four neighbours
+	Vector3f Direction = Normal / L1;
+	float BaseX = floorf(std::min(std::max(Oct.x, -1.f), 1.f) * 32767.f);
+	float BaseY = floorf(std::min(std::max(Oct.y, -1.f), 1.f) * 32767.f);
+	uint32_t Best = 0;
+	float BestDot = -2.f;
+	for (int i = 0; i < 4; ++i)
+	{
+		int16_t X = (int16_t)std::min(BaseX + (i & 1), 32767.f);
+		int16_t Y = (int16_t)std::min(BaseY + (i >> 1), 32767.f);
+		uint32_t Packed = (uint32_t)(uint16_t)X | ((uint32_t)(uint16_t)Y << 16);
+		float Dot = DecodeOctNormal(Packed).Dot(Direction);
+		if (Dot > BestDot)
+		{
+			BestDot = Dot;
+			Best = Packed;
+		}
+	}
+	return Best;
+}
+
+Vector3f FVertexCompression::DecodeOctNormal(uint32_t Packed)
+{
+	Vector2f Oct(SNorm16ToFloat((int16_t)(Packed & 0xffff)), SNorm16ToFloat((int16_t)(Packed >> 16)));
+	Vector3f Normal(Oct.x, Oct.y, 1.f - fabsf(Oct.x) - fabsf(Oct.y));
+	if (Normal.z < 0.f)
+	{
+		Vector2f Wrapped = OctWrap(Oct);
+		Normal.x = Wrapped.x;
+		Normal.y = Wrapped.y;
+	}
+	return Normal.Normalize();
+}
+
+uint32_t FVertexCompression::EncodeTangent(const Vector4f& Tangent)
+{
+	uint32_t X = FloatToUNorm(Tangent.x * 0.5f + 0.5f, 1023);
+	uint32_t Y = FloatToUNorm(Tangent.y * 0.5f + 0.5f, 1023);
+	uint32_t Z = FloatToUNorm(Tangent.z * 0.5f + 0.5f, 1023);
+	uint32_t W = Tangent.w < 0.f ? 0 : 3;
+	return X | (Y << 10) | (Z << 20) | (W << 30);
+}
+
+Vector4f FVertexCompression::DecodeTangent(uint32_t Packed)
+{
+	return Vector4f(
+		(float)(Packed & 0x3ff) / 1023.f * 2.f - 1.f,
+		(float)((Packed >> 10) & 0x3ff) / 1023.f * 2.f - 1.f,
+		(float)((Packed >> 20) & 0x3ff) / 1023.f * 2.f - 1.f,
+		(Packed >> 30) >= 2 ? 1.f : -1.f);
+}
+
+uint16_t FVertexCompression::FloatToHalf(float Value)
+{
+	uint32_t Bits;
+	memcpy(&Bits, &Value, sizeof(Bits));
+	uint32_t Sign = (Bits >> 16) & 0x8000;
+	uint32_t Abs = Bits & 0x7fffffff;
+
+	if (Abs > 0x7f800000)
+		return (uint16_t)(Sign | 0x7e00);
+
+	uint32_t Half;
+	uint32_t Remainder;
+	uint32_t HalfWay;
+	if (Abs < 0x33000000)
+	{
+		// below half of the smallest denormal
+		return (uint16_t)Sign;
+	}
+	else if (Abs < 0x38800000)
+	{
+		// denormal half, the implicit bit becomes explicit
+		uint32_t Mantissa = (Abs & 0x7fffff) | 0x800000;
+		uint32_t Shift = 126 - (Abs >> 23);
+		Half = Mantissa >> Shift;
+		Remainder = Mantissa & ((1u << Shift) - 1);
+		HalfWay = 1u << (Shift - 1);
+	}
+	else
+	{
+		Half = (Abs - 0x38000000) >> 13;
+		Remainder = Abs & 0x1fff;
+		HalfWay = 0x1000;
+	}
+
+	// round to nearest even, clamp to the largest finite half instead of going to infinity
+	if (Remainder > HalfWay || (Remainder == HalfWay && (Half & 1)))
+		++Half;
+	if (Half >= 0x7c00)
+		Half = 0x7bff;
+	return (uint16_t)(Sign | Half);
+}
+
+float FVertexCompression::HalfToFloat(uint16_t Value)
+{
+	uint32_t Sign = ((uint32_t)Value & 0x8000) << 16;
+	uint32_t Exponent = (Value >> 10) & 0x1f;
+	uint32_t Mantissa = Value & 0x3ff;
+
+	uint32_t Bits;
+	if (Exponent == 0)
+	{
+		float Result = (float)Mantissa * (1.f / 16777216.f);
+		return Sign ? -Result : Result;
+	}
+	else if (Exponent == 31)
+	{
+		Bits = Sign | 0x7f800000 | (Mantissa << 13);
+	}
+	else
+	{
+		Bits = Sign | ((Exponent + 112) << 23) | (Mantissa << 13);
+	}
+
+	float Result;
+	memcpy(&Result, &Bits, sizeof(Result));
+	return Result;
+}
+
+uint32_t FVertexCompression::EncodeHalf2(const Vector2f& Value)
+{
+	return (uint32_t)FloatToHalf(Value.x) | ((uint32_t)FloatToHalf(Value.y) << 16);
+}
+
+Vector2f FVertexCompression::DecodeHalf2(uint32_t Packed)
+{
+	return Vector2f(HalfToFloat((uint16_t)(Packed & 0xffff)), HalfToFloat((uint16_t)(Packed >> 16)));
+}
+
+uint32_t FVertexCompression::EncodeUNorm16x2(const Vector2f& Value, const Vector2f& Min, const Vector2f& Extent)
+{
+	uint32_t X = Extent.x > 0.f ? FloatToUNorm((Value.x - Min.x) / Extent.x, 0xffff) : 0;
+	uint32_t Y = Extent.y > 0.f ? FloatToUNorm((Value.y - Min.y) / Extent.y, 0xffff) : 0;
+	return X | (Y << 16);
+}
+
+Vector2f FVertexCompression::DecodeUNorm16x2(uint32_t Packed, const Vector2f& Min, const Vector2f& Extent)
+{
+	return Vector2f(
+		Min.x + (float)(Packed & 0xffff) / 65535.f * Extent.x,
+		Min.y + (float)(Packed >> 16) / 65535.f * Extent.y);
+}
+
+uint64_t FVertexCompression::EncodeUNorm16x3(const Vector3f& Value, const Vector3f& Min, const Vector3f& Extent)
+{
+	uint64_t Packed = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		uint64_t Component = Extent[i] > 0.f ? FloatToUNorm((Value[i] - Min[i]) / Extent[i], 0xffff) : 0;
+		Packed |= Component << (16 * i);
+	}
+	// w decodes to 1
+	return Packed | (0xffffull << 48);
+}
+
+Vector3f FVertexCompression::DecodeUNorm16x3(uint64_t Packed, const Vector3f& Min, const Vector3f& Extent)
+{
+	Vector3f Result;
+	for (int i = 0; i < 3; ++i)
+	{
+		Result[i] = Min[i] + (float)((Packed >> (16 * i)) & 0xffff) / 65535.f * Extent[i];
+	}
+	return Result;
+}
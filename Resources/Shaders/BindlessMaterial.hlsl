@@ -0,0 +1,75 @@
+#pragma pack_matrix(row_major)
+
+// The textures of a material come from the bindless table, Renderer::SetBindlessMaterials passes their
+// indices as root constants in the slot order of MeshData::TEX_PER_MATERIAL
+
+#define INVALID_INDEX 0xffffffff
+
+struct ModelViewProjection
+{
+	float4x4 projectionMatrix;
+	float4x4 modelMatrix;
+	float4x4 viewMatrix;
+};
+
+// basecolor, opacity, emissive, metallic, roughness, ao, normal
+struct MaterialIndices
+{
+	uint BaseColor;
+	uint Opacity;
+	uint Emissive;
+	uint Metallic;
+	uint Roughness;
+	uint Ao;
+	uint Normal;
+};
+
+ConstantBuffer<ModelViewProjection> MVP	: register(b0);
+ConstantBuffer<MaterialIndices> Material	: register(b1);
+Texture2D BindlessTextures[]			: register(t0, space1);
+SamplerState LinearSampler				: register(s0);
+
+struct VertexIN
+{
+	float3 inPos : POSITION;
+	float2 tex   : TEXCOORD;
+};
+
+struct VertexOutput
+{
+	float2 tex			: TEXCOORD;
+	float4 gl_Position	: SV_Position;
+};
+
+struct PixelOutput
+{
+	float4 outFragColor : SV_Target0;
+};
+
+// Default for a texture the table had no room for
+float4 SampleMaterial(uint Index, float2 UV, float4 Default)
+{
+	if (Index == INVALID_INDEX)
+		return Default;
+	// the index is the same for the whole draw, no NonUniformResourceIndex needed
+	return BindlessTextures[Index].Sample(LinearSampler, UV);
+}
+
+VertexOutput vs_main(VertexIN IN)
+{
+	VertexOutput OUT;
+	OUT.gl_Position = mul(float4(IN.inPos, 1.0f), mul(MVP.modelMatrix, mul(MVP.viewMatrix, MVP.projectionMatrix)));
+	OUT.tex = IN.tex;
+	return OUT;
+}
+
+PixelOutput ps_main(VertexOutput IN)
+{
+	PixelOutput output;
+	float4 BaseColor = SampleMaterial(Material.BaseColor, IN.tex, float4(1.0f, 1.0f, 1.0f, 1.0f));
+	float Ao = SampleMaterial(Material.Ao, IN.tex, float4(1.0f, 1.0f, 1.0f, 1.0f)).r;
+	float3 Emissive = SampleMaterial(Material.Emissive, IN.tex, float4(0.0f, 0.0f, 0.0f, 0.0f)).rgb;
+	float Opacity = SampleMaterial(Material.Opacity, IN.tex, float4(1.0f, 1.0f, 1.0f, 1.0f)).r;
+	output.outFragColor = float4(BaseColor.rgb * Ao + Emissive, BaseColor.a * Opacity);
+	return output;
+}
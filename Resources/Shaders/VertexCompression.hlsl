@@ -0,0 +1,29 @@
+// Decoders of the compressed vertex streams, see FVertexCompression and MeshData::SetVertexCompression.
+
+float2 OctWrap(float2 v)
+{
+	return (1.0 - abs(v.yx)) * (v.xy >= 0.0 ? 1.0 : -1.0);
+}
+
+// VC_Normal, input is the R16G16_SNORM value
+float3 DecodeOctNormal(float2 Oct)
+{
+	float3 n = float3(Oct.xy, 1.0 - abs(Oct.x) - abs(Oct.y));
+	if (n.z < 0.0)
+	{
+		n.xy = OctWrap(n.xy);
+	}
+	return normalize(n);
+}
+
+// VC_Tangent, input is the R10G10B10A2_UNORM value, w is the bitangent sign
+float4 DecodeTangent(float4 Packed)
+{
+	return float4(normalize(Packed.xyz * 2.0 - 1.0), Packed.w > 0.5 ? 1.0 : -1.0);
+}
+
+// VC_TexcoordUNorm, ScaleBias comes from MeshData::GetSubTexcoordScaleBias
+float2 DecodeTexcoord(float2 Packed, float4 ScaleBias)
+{
+	return Packed * ScaleBias.xy + ScaleBias.zw;
+}
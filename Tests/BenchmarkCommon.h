@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+// written by KeepAlive, a volatile with external linkage whose stores can be neither dropped nor warned about
+inline volatile char g_BenchmarkSink;
+
+// keeps the optimizer from dropping work whose result is otherwise unused
+template<typename T>
+inline void KeepAlive(const T& Value)
+{
+	char Bytes[sizeof(T)];
+	memcpy(Bytes, &Value, sizeof(T));
+	g_BenchmarkSink = Bytes[0] ^ Bytes[sizeof(T) - 1];
+}
+
+// best nanoseconds per call of Body(i) for i in [0, Count) over a few rounds
+template<typename FunctionType>
+double MeasureNs(size_t Count, const FunctionType& Body, int Rounds = 5)
+{
+	double Best = 1e30;
+	for (int r = 0; r < Rounds; ++r)
+	{
+		auto Start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < Count; ++i)
+		{
+			Body(i);
+		}
+		double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+		Best = Ns < Best ? Ns : Best;
+	}
+	return Best / (double)Count;
+}
@@ -0,0 +1,125 @@
+#include "BindlessIndexAllocator.h"
+#include "TestCommon.h"
+
+#include <random>
+#include <vector>
+
+// FBindlessIndexAllocator with frames that free indices while the GPU trails three frames behind. An index
+// must not come back before the fence it was freed with completed, and all of them come back in the end.
+namespace
+{
+	const uint32_t CAPACITY = 512;
+	const uint64_t FRAMES_IN_FLIGHT = 3;
+
+	struct FRange
+	{
+		uint32_t Index;
+		uint32_t Count;
+	};
+
+	void TestFrames()
+	{
+		FBindlessIndexAllocator Allocator(CAPACITY);
+		std::mt19937 Random(5);
+		uint64_t Completed = 0;
+		auto IsComplete = [&Completed](uint64_t Fence) { return Fence <= Completed; };
+		std::vector<FRange> Live;
+		std::vector<char> Used(CAPACITY, 0);
+		// fence each index was last freed with
+		std::vector<uint64_t> FreedAt(CAPACITY, 0);
+		uint64_t Allocations = 0, Failed = 0;
+		bool Shared = false, Early = false;
+
+		uint64_t Fence = 1;
+		for (; Fence <= 20000; ++Fence)
+		{
+			Completed = Fence > FRAMES_IN_FLIGHT ? Fence - FRAMES_IN_FLIGHT : 0;
+			Allocator.Reclaim(IsComplete);
+			CHECK(Allocator.GetOldestFence() == 0 || Allocator.GetOldestFence() > Completed);
+			for (int i = 0; i < 20; ++i)
+			{
+				if (Live.empty() || Random() % 2)
+				{
+					uint32_t Count = Random() % 10 == 0 ? 6 : 1;
+					uint32_t Index = Allocator.Allocate(Count);
+					if (Index == FBindlessIndexAllocator::INVALID_INDEX)
+					{
+						++Failed;
+						continue;
+					}
+					++Allocations;
+					for (uint32_t k = Index; k < Index + Count; ++k)
+					{
+						Shared |= Used[k] != 0;
+						Early |= FreedAt[k] > Completed;
+						Used[k] = 1;
+					}
+					Live.push_back({ Index, Count });
+				}
+				else
+				{
+					size_t k = Random() % Live.size();
+					Allocator.Free(Live[k].Index, Live[k].Count, Fence);
+					for (uint32_t j = Live[k].Index; j < Live[k].Index + Live[k].Count; ++j)
+					{
+						Used[j] = 0;
+						FreedAt[j] = Fence;
+					}
+					Live[k] = Live.back();
+					Live.pop_back();
+				}
+			}
+		}
+		CHECK(!Shared);
+		CHECK(!Early);
+
+		for (const FRange& Range : Live)
+			Allocator.Free(Range.Index, Range.Count, Fence);
+		Completed = Fence;
+		Allocator.Reclaim(IsComplete);
+		FBindlessIndexAllocator::FStats Stats = Allocator.GetStats();
+		CHECK(Stats.Allocated == 0 && Stats.Pending == 0 && Stats.LargestFreeRange == CAPACITY);
+		printf("%llu allocations, %llu failed while full\n", (unsigned long long)Allocations, (unsigned long long)Failed);
+	}
+
+	void TestFull()
+	{
+		FBindlessIndexAllocator Allocator(8);
+		uint64_t Completed = 0;
+		auto IsComplete = [&Completed](uint64_t Fence) { return Fence <= Completed; };
+		CHECK(Allocator.Allocate(6) == 0);
+		CHECK(Allocator.Allocate(2) == 6);
+		CHECK(Allocator.Allocate(1) == FBindlessIndexAllocator::INVALID_INDEX);
+
+		// freed indices stay taken until their fence completed
+		Allocator.Free(0, 6, 1);
+		Allocator.Free(6, 2, 2);
+		CHECK(Allocator.GetOldestFence() == 1);
+		FBindlessIndexAllocator::FStats Stats = Allocator.GetStats();
+		CHECK(Stats.Allocated == 8 && Stats.Pending == 8 && Stats.LargestFreeRange == 0);
+		Allocator.Reclaim(IsComplete);
+		CHECK(Allocator.Allocate(1) == FBindlessIndexAllocator::INVALID_INDEX);
+
+		Completed = 1;
+		Allocator.Reclaim(IsComplete);
+		CHECK(Allocator.GetOldestFence() == 2);
+		CHECK(Allocator.Allocate(8) == FBindlessIndexAllocator::INVALID_INDEX);
+		CHECK(Allocator.Allocate(6) == 0);
+
+		Completed = 2;
+		Allocator.Reclaim(IsComplete);
+		CHECK(Allocator.GetOldestFence() == 0 && Allocator.GetStats().Pending == 0);
+		CHECK(Allocator.Allocate(2) == 6);
+
+		Allocator.Reset(16);
+		Stats = Allocator.GetStats();
+		CHECK(Stats.Capacity == 16 && Stats.Allocated == 0 && Stats.LargestFreeRange == 16);
+	}
+}
+
+int main()
+{
+	TestFull();
+	TestFrames();
+	return TestResult();
+}
@@ -0,0 +1,56 @@
+#include "MathLib.h"
+#include "BenchmarkCommon.h"
+
+// box and sphere transforms per element, the 8 corner bounds are what TransformBoundingBox replaced
+int main()
+{
+	const size_t COUNT = 1 << 14;
+	std::mt19937 Random(1);
+	std::uniform_real_distribution<float> Uniform(-10.f, 10.f);
+	std::vector<FMatrix> Matrices(COUNT);
+	std::vector<FBoundingBox> Boxes(COUNT);
+	std::vector<Vector4f> Spheres(COUNT);
+	FBoundingBoxSoA SoA;
+	SoA.Resize(COUNT);
+	for (size_t i = 0; i < COUNT; ++i)
+	{
+		Matrices[i] = FMatrix::MatrixRotationRollPitchYaw(Uniform(Random), Uniform(Random), Uniform(Random)) * FMatrix::TranslateMatrix(Vector3f(Uniform(Random), Uniform(Random), Uniform(Random)));
+		Vector3f a(Uniform(Random), Uniform(Random), Uniform(Random));
+		Vector3f b(Uniform(Random), Uniform(Random), Uniform(Random));
+		Boxes[i] = FBoundingBox(Min(a, b), Max(a, b));
+		Spheres[i] = Vector4f(a, fabsf(b.x));
+		SoA.Set(i, Boxes[i]);
+	}
+	std::vector<FBoundingBox> Results(COUNT);
+	std::vector<Vector4f> SphereResults(COUNT);
+	FBoundingBoxSoA SoAResults;
+	const FMatrix Frustum = FMatrix::MatrixLookAtLH(Vector3f(0.f, 0.f, -20.f), Vector3f(0.f), Vector3f(0.f, 1.f, 0.f)) * FMatrix::MatrixPerspectiveFovLH(MATH_PI_HALF, 1.f, 0.1f, 100.f);
+	FFrustum ViewFrustum(Frustum);
+	std::vector<uint32_t> Visible;
+	Visible.reserve(COUNT);
+
+	printf("ns per element over %zu\n", COUNT);
+	printf("8 corners         %6.2f\n", MeasureNs(COUNT, [&](size_t i)
+	{
+		FBoundingBox Result;
+		for (int c = 0; c < 8; ++c)
+		{
+			Vector3f Corner(c & 1 ? Boxes[i].BoundMax.x : Boxes[i].BoundMin.x, c & 2 ? Boxes[i].BoundMax.y : Boxes[i].BoundMin.y, c & 4 ? Boxes[i].BoundMax.z : Boxes[i].BoundMin.z);
+			Vector3f p = Matrices[i].TransformPosition(Corner);
+			Result.Include(FBoundingBox(p, p));
+		}
+		Results[i] = Result;
+	}));
+	printf("single box        %6.2f\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = Matrices[i].TransformBoundingBox(Boxes[i]); }));
+	printf("per matrix batch  %6.2f\n", MeasureNs(1, [&](size_t) { FMatrix::TransformBoundingBoxes(Matrices.data(), Boxes.data(), Results.data(), COUNT); }) / COUNT);
+	printf("SoA batch         %6.2f\n", MeasureNs(1, [&](size_t) { Matrices[0].TransformBoundingBoxes(SoA, SoAResults); }) / COUNT);
+	printf("oriented box AABB %6.2f\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = FOrientedBox(Boxes[i], Matrices[i]).GetBoundingBox(); }));
+	printf("sphere            %6.2f\n", MeasureNs(COUNT, [&](size_t i) { SphereResults[i] = Matrices[i].TransformSphere(Spheres[i]); }));
+	printf("frustum box       %6.2f\n", MeasureNs(COUNT, [&](size_t i) { Results[i].BoundMin.x = ViewFrustum.IntersectBox(Boxes[i]) ? 1.f : 0.f; }));
+	printf("frustum SoA cull  %6.2f\n", MeasureNs(1, [&](size_t) { Visible.clear(); ViewFrustum.CullBoxes(SoA, Visible); }) / COUNT);
+	KeepAlive(Results[Random() % COUNT]);
+	KeepAlive(SphereResults[Random() % COUNT]);
+	KeepAlive(SoAResults.MinX[Random() % COUNT]);
+	KeepAlive(Visible.size());
+	return 0;
+}
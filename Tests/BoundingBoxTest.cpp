@@ -0,0 +1,97 @@
+#include "MathLib.h"
+#include "TestCommon.h"
+
+#include <string.h>
+
+// TransformBoundingBox against the bounds of the 8 transformed corners, and the batched paths against it bit for bit
+namespace
+{
+	const int NUM_BOXES = 10000;
+
+	FBoundingBox RandomBox(std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Uniform(-10.f, 10.f);
+		Vector3f a(Uniform(Random), Uniform(Random), Uniform(Random));
+		Vector3f b(Uniform(Random), Uniform(Random), Uniform(Random));
+		return FBoundingBox(Min(a, b), Max(a, b));
+	}
+
+	FMatrix RandomAffine(std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Uniform(-MATH_PI, MATH_PI);
+		std::uniform_real_distribution<float> Scale(0.1f, 4.f);
+		return FMatrix::ScaleMatrix(Vector3f(Scale(Random), Scale(Random), Scale(Random)))
+			* FMatrix::MatrixRotationRollPitchYaw(Uniform(Random), Uniform(Random), Uniform(Random))
+			* FMatrix::TranslateMatrix(Vector3f(Uniform(Random), Uniform(Random), Uniform(Random)));
+	}
+
+	FBoundingBox CornerBounds(const FMatrix& m, const FBoundingBox& Box)
+	{
+		FBoundingBox Result;
+		for (int i = 0; i < 8; ++i)
+		{
+			Vector3f Corner(i & 1 ? Box.BoundMax.x : Box.BoundMin.x, i & 2 ? Box.BoundMax.y : Box.BoundMin.y, i & 4 ? Box.BoundMax.z : Box.BoundMin.z);
+			Vector3f p = m.TransformPosition(Corner);
+			Result.Include(FBoundingBox(p, p));
+		}
+		return Result;
+	}
+
+	float MaxAbs(const Vector3f& v)
+	{
+		return std::max(std::max(fabsf(v.x), fabsf(v.y)), fabsf(v.z));
+	}
+
+	bool SameBits(const FBoundingBox& a, const FBoundingBox& b)
+	{
+		return memcmp(&a.BoundMin.x, &b.BoundMin.x, sizeof(Vector3f)) == 0 && memcmp(&a.BoundMax.x, &b.BoundMax.x, sizeof(Vector3f)) == 0;
+	}
+}
+
+int main()
+{
+	std::mt19937 Random(1);
+	std::vector<FMatrix> Matrices(NUM_BOXES);
+	std::vector<FBoundingBox> Boxes(NUM_BOXES);
+	FBoundingBoxSoA SoA;
+	SoA.Resize(NUM_BOXES);
+	for (int i = 0; i < NUM_BOXES; ++i)
+	{
+		Matrices[i] = RandomAffine(Random);
+		Boxes[i] = RandomBox(Random);
+		SoA.Set(i, Boxes[i]);
+	}
+
+	double MaxError = 0.0;
+	for (int i = 0; i < NUM_BOXES; ++i)
+	{
+		FBoundingBox Exact = Matrices[i].TransformBoundingBox(Boxes[i]);
+		FBoundingBox Corners = CornerBounds(Matrices[i], Boxes[i]);
+		float Size = std::max(MaxAbs(Corners.BoundMin), MaxAbs(Corners.BoundMax));
+		for (int c = 0; c < 3; ++c)
+		{
+			MaxError = std::max(MaxError, (double)fabsf(Exact.BoundMin[c] - Corners.BoundMin[c]) / Size);
+			MaxError = std::max(MaxError, (double)fabsf(Exact.BoundMax[c] - Corners.BoundMax[c]) / Size);
+		}
+	}
+	printf("transformed bounds: %.3g relative to the corner bounds\n", MaxError);
+	CHECK(MaxError <= 1e-5);
+
+	// one matrix over the SoA boxes
+	FBoundingBoxSoA Out;
+	Matrices[0].TransformBoundingBoxes(SoA, Out);
+	CHECK(Out.Size() == SoA.Size());
+	int Mismatches = 0;
+	for (int i = 0; i < NUM_BOXES; ++i)
+		Mismatches += SameBits(Out.Get(i), Matrices[0].TransformBoundingBox(Boxes[i])) ? 0 : 1;
+
+	// one matrix per box, in place
+	std::vector<FBoundingBox> Transformed = Boxes;
+	FMatrix::TransformBoundingBoxes(Matrices.data(), Transformed.data(), Transformed.data(), Transformed.size());
+	for (int i = 0; i < NUM_BOXES; ++i)
+		Mismatches += SameBits(Transformed[i], Matrices[i].TransformBoundingBox(Boxes[i])) ? 0 : 1;
+	printf("batched boxes: %d mismatches\n", Mismatches);
+	CHECK(Mismatches == 0);
+
+	return TestResult();
+}
@@ -0,0 +1,72 @@
+#include "Bvh.h"
+#include "BenchmarkCommon.h"
+
+// FBvh build, refit and queries over 10k to 1M boxes spread through a cube that grows with the count,
+// so that a query touches about the same number of boxes at every size
+int main()
+{
+	const uint32_t Counts[] = { 10000, 100000, 1000000 };
+	printf("%8s %10s %10s %12s %10s %10s %10s\n", "boxes", "build ms", "refit ms", "refit 1% ms", "box us", "frustum us", "ray us");
+	for (uint32_t Count : Counts)
+	{
+		std::mt19937 Random(1);
+		float Side = 10.f * cbrtf((float)Count);
+		std::uniform_real_distribution<float> Position(-Side, Side);
+		std::uniform_real_distribution<float> Size(0.5f, 2.f);
+		std::uniform_real_distribution<float> Move(-1.f, 1.f);
+		std::vector<FBoundingBox> Boxes(Count);
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			Vector3f Center(Position(Random), Position(Random), Position(Random));
+			Vector3f Extent(Size(Random), Size(Random), Size(Random));
+			Boxes[i] = FBoundingBox(Center - Extent, Center + Extent);
+		}
+
+		FBvh Bvh;
+		double BuildNs = MeasureNs(1, [&](size_t) { Bvh.Build(Boxes.data(), Count); }, 3);
+
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			Vector3f Offset(Move(Random), Move(Random), Move(Random));
+			Boxes[i] = FBoundingBox(Boxes[i].BoundMin + Offset, Boxes[i].BoundMax + Offset);
+		}
+		double RefitNs = MeasureNs(1, [&](size_t) { Bvh.Refit(Boxes.data()); }, 3);
+
+		std::vector<uint32_t> Changed;
+		for (uint32_t i = 0; i < Count; i += 100)
+			Changed.push_back(i);
+		double PartialNs = MeasureNs(1, [&](size_t) { Bvh.Refit(Boxes.data(), Changed.data(), (uint32_t)Changed.size()); }, 3);
+
+		const size_t QUERIES = 1000;
+		std::vector<Vector3f> Points(QUERIES);
+		std::vector<Vector3f> Directions(QUERIES);
+		for (size_t q = 0; q < QUERIES; ++q)
+		{
+			Points[q] = Vector3f(Position(Random), Position(Random), Position(Random));
+			Directions[q] = Vector3f(Move(Random), Move(Random), Move(Random));
+		}
+		std::vector<uint32_t> Result;
+		size_t Found = 0;
+		double BoxNs = MeasureNs(QUERIES, [&](size_t q)
+		{
+			Result.clear();
+			Bvh.QueryBox(FBoundingBox(Points[q] - Vector3f(10.f), Points[q] + Vector3f(10.f)), Result);
+			Found += Result.size();
+		});
+
+		// a 90 degree view 50 units into the scene from the middle of a face
+		FFrustum Frustum(FMatrix::MatrixLookAtLH(Vector3f(0.f, 0.f, -Side), Vector3f(0.f), Vector3f(0.f, 1.f, 0.f)) * FMatrix::MatrixPerspectiveFovLH(MATH_PI_HALF, 1.f, 0.1f, 50.f));
+		double FrustumNs = MeasureNs(10, [&](size_t)
+		{
+			Result.clear();
+			Bvh.QueryFrustum(Frustum, Result);
+			Found += Result.size();
+		});
+
+		double RayNs = MeasureNs(QUERIES, [&](size_t q) { Found += Bvh.RayCast(Points[q], Directions[q], 100.f); });
+
+		printf("%8u %10.2f %10.2f %12.3f %10.2f %10.2f %10.2f\n", Count, BuildNs * 1e-6, RefitNs * 1e-6, PartialNs * 1e-6, BoxNs * 1e-3, FrustumNs * 1e-3, RayNs * 1e-3);
+		KeepAlive(Found);
+	}
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include "Bvh.h"
+#include "TestCommon.h"
+
+#include <algorithm>
+
+// FBvh queries against brute force over the same boxes, after a build and after refits
+namespace
+{
+	const uint32_t NUM_BOXES = 5000;
+
+	FBoundingBox RandomBox(std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Position(-100.f, 100.f);
+		std::uniform_real_distribution<float> Size(0.1f, 4.f);
+		Vector3f Center(Position(Random), Position(Random), Position(Random));
+		Vector3f Extent(Size(Random), Size(Random), Size(Random));
+		return FBoundingBox(Center - Extent, Center + Extent);
+	}
+
+	bool Overlaps(const FBoundingBox& a, const FBoundingBox& b)
+	{
+		return a.BoundMin.x <= b.BoundMax.x && a.BoundMax.x >= b.BoundMin.x
+			&& a.BoundMin.y <= b.BoundMax.y && a.BoundMax.y >= b.BoundMin.y
+			&& a.BoundMin.z <= b.BoundMax.z && a.BoundMax.z >= b.BoundMin.z;
+	}
+
+	// slab test, the entry distance or -1 on a miss
+	float RayEntry(const FBoundingBox& Box, const Vector3f& Origin, const Vector3f& Direction, float MaxDistance)
+	{
+		float Near = 0.f, Far = MaxDistance;
+		for (int c = 0; c < 3; ++c)
+		{
+			float Inverse = 1.f / Direction[c];
+			float t0 = (Box.BoundMin[c] - Origin[c]) * Inverse;
+			float t1 = (Box.BoundMax[c] - Origin[c]) * Inverse;
+			Near = std::max(Near, std::min(t0, t1));
+			Far = std::min(Far, std::max(t0, t1));
+		}
+		return Near <= Far ? Near : -1.f;
+	}
+
+	void CheckQueries(const FBvh& Bvh, const std::vector<FBoundingBox>& Boxes, std::mt19937& Random)
+	{
+		CHECK(Bvh.GetCount() == Boxes.size());
+		std::uniform_real_distribution<float> Uniform(-1.f, 1.f);
+		std::vector<uint32_t> Result, Expected;
+		for (int q = 0; q < 100; ++q)
+		{
+			FBoundingBox Query = RandomBox(Random);
+			Query.BoundMax = Query.BoundMax + Vector3f(10.f);
+			Result.clear();
+			Bvh.QueryBox(Query, Result);
+			Expected.clear();
+			for (uint32_t i = 0; i < Boxes.size(); ++i)
+			{
+				if (Overlaps(Boxes[i], Query))
+					Expected.push_back(i);
+			}
+			std::sort(Result.begin(), Result.end());
+			CHECK(Result == Expected);
+
+			Vector3f Origin(Uniform(Random) * 120.f, Uniform(Random) * 120.f, Uniform(Random) * 120.f);
+			Vector3f Direction(Uniform(Random), Uniform(Random), Uniform(Random));
+			float Distance = 0.f;
+			uint32_t Hit = Bvh.RayCast(Origin, Direction, 1000.f, &Distance);
+			float Nearest = -1.f;
+			for (uint32_t i = 0; i < Boxes.size(); ++i)
+			{
+				float Entry = RayEntry(Boxes[i], Origin, Direction, 1000.f);
+				if (Entry >= 0.f && (Nearest < 0.f || Entry < Nearest))
+					Nearest = Entry;
+			}
+			if (Nearest < 0.f)
+			{
+				CHECK(Hit == FBvh::INVALID_INDEX);
+			}
+			else
+			{
+				CHECK(Hit != FBvh::INVALID_INDEX && fabsf(Distance - Nearest) <= 1e-3f * std::max(1.f, Nearest));
+			}
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 Random(1);
+	std::vector<FBoundingBox> Boxes(NUM_BOXES);
+	for (uint32_t i = 0; i < NUM_BOXES; ++i)
+		Boxes[i] = RandomBox(Random);
+
+	FBvh Bvh;
+	Bvh.Build(Boxes.data(), NUM_BOXES);
+	CheckQueries(Bvh, Boxes, Random);
+
+	// move every box, then only a few
+	std::uniform_real_distribution<float> Move(-20.f, 20.f);
+	for (uint32_t i = 0; i < NUM_BOXES; ++i)
+	{
+		Vector3f Offset(Move(Random), Move(Random), Move(Random));
+		Boxes[i] = FBoundingBox(Boxes[i].BoundMin + Offset, Boxes[i].BoundMax + Offset);
+	}
+	Bvh.Refit(Boxes.data());
+	CheckQueries(Bvh, Boxes, Random);
+
+	std::vector<uint32_t> Changed;
+	for (uint32_t i = 0; i < NUM_BOXES; i += 37)
+	{
+		Boxes[i] = RandomBox(Random);
+		Changed.push_back(i);
+	}
+	Bvh.Refit(Boxes.data(), Changed.data(), (uint32_t)Changed.size());
+	CheckQueries(Bvh, Boxes, Random);
+
+	Bvh.Clear();
+	CHECK(Bvh.GetCount() == 0);
+	std::vector<uint32_t> Result;
+	Bvh.QueryBox(Boxes[0], Result);
+	CHECK(Result.empty());
+	CHECK(Bvh.RayCast(Vector3f(0.f), Vector3f(1.f, 0.f, 0.f)) == FBvh::INVALID_INDEX);
+
+	return TestResult();
+}
@@ -0,0 +1,127 @@
+#include "FramePacer.h"
+#include "TestCommon.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// FFramePacer against a simulated GPU timeline. Fence k is done at Done[k], the GPU runs the frames one after
+// the other. The CPU waits for the fence the pacer hands out before it records into a slot, so there must
+// never be more than the frames in flight unfinished while it records, and the frame rate has to get close
+// to the bound of the slower side once frames overlap.
+namespace
+{
+	const int NUM_FRAMES = 2000;
+	const int WARMUP_FRAMES = 100;
+
+	struct FTimeline
+	{
+		double CpuMs;
+		double GpuMs;
+		double Jitter;
+	};
+
+	// frames per second after the warmup, Serial waits for every frame like Finish(true) did
+	double Run(const FTimeline& Timeline, uint32_t FramesInFlight, bool Serial)
+	{
+		FFramePacer Pacer(FramesInFlight);
+		std::mt19937 Random(7);
+		std::uniform_real_distribution<double> Scale(1.0 - Timeline.Jitter, 1.0 + Timeline.Jitter);
+		std::vector<double> Done(1, 0.0);
+		std::vector<uint32_t> SlotFrames(FFramePacer::MAX_FRAMES_IN_FLIGHT, 0);
+		double Time = 0.0, GpuFree = 0.0, Start = 0.0;
+		uint64_t Fence = 0;
+		for (int Frame = 0; Frame < NUM_FRAMES; ++Frame)
+		{
+			if (Frame == WARMUP_FRAMES)
+				Start = Time;
+
+			uint64_t WaitFence = Pacer.GetWaitFence();
+			CHECK(WaitFence < Done.size());
+			Time = std::max(Time, Done[WaitFence]);
+
+			// the frames the GPU has not finished, counting the one about to be recorded
+			uint32_t InFlight = 1;
+			for (uint64_t k = 1; k < Done.size(); ++k)
+				InFlight += Done[k] > Time ? 1 : 0;
+			CHECK(InFlight <= Pacer.GetFramesInFlight());
+			CHECK(Pacer.GetFrameIndex() < Pacer.GetFramesInFlight());
+
+			Time += Timeline.CpuMs * Scale(Random);
+			double GpuStart = std::max(Time, GpuFree);
+			GpuFree = GpuStart + Timeline.GpuMs * Scale(Random);
+			Done.push_back(GpuFree);
+			++Fence;
+			if (Serial)
+				Time = GpuFree;
+			Pacer.EndFrame(Fence);
+			CHECK(Pacer.GetLastFence() == Fence);
+		}
+		CHECK(Pacer.GetFrameNumber() == (uint64_t)NUM_FRAMES);
+		return (NUM_FRAMES - WARMUP_FRAMES) / (Time - Start) * 1000.0;
+	}
+
+	void TestThroughput()
+	{
+		const FTimeline Timelines[] = { { 8.0, 8.0, 0.3 }, { 5.0, 10.0, 0.3 }, { 10.0, 5.0, 0.3 }, { 6.0, 6.0, 0.0 } };
+		for (const FTimeline& Timeline : Timelines)
+		{
+			double Bound = 1000.0 / std::max(Timeline.CpuMs, Timeline.GpuMs);
+			double Serial = Run(Timeline, 1, true);
+			printf("cpu %.0fms gpu %.0fms jitter %.0f%%: serial %.1f fps", Timeline.CpuMs, Timeline.GpuMs, Timeline.Jitter * 100.0, Serial);
+			double Previous = 0.0;
+			for (uint32_t FramesInFlight = 1; FramesInFlight <= FFramePacer::MAX_FRAMES_IN_FLIGHT; ++FramesInFlight)
+			{
+				double Fps = Run(Timeline, FramesInFlight, false);
+				printf(", %u in flight %.1f", FramesInFlight, Fps);
+				CHECK(Fps <= Bound * 1.01);
+				// more frames in flight never slow down
+				CHECK(Fps >= Previous * 0.99);
+				if (FramesInFlight >= 2)
+					CHECK(Fps >= Serial * 1.2);
+				if (FramesInFlight >= 3)
+					CHECK(Fps >= Bound * 0.9);
+				Previous = Fps;
+			}
+			printf(" (bound %.1f)\n", Bound);
+			CHECK(Serial <= 1000.0 / (Timeline.CpuMs + Timeline.GpuMs) * 1.05);
+		}
+	}
+
+	void TestSlots()
+	{
+		FFramePacer Pacer(3);
+		CHECK(Pacer.GetWaitFence() == 0);
+		Pacer.EndFrame(5);
+		Pacer.EndFrame(6);
+		Pacer.EndFrame(7);
+		// back in the first slot, which frame 1 ended
+		CHECK(Pacer.GetFrameIndex() == 0 && Pacer.GetWaitFence() == 5);
+
+		// the renumbered slots all wait for the newest frame
+		Pacer.EndFrame(8);
+		Pacer.SetFramesInFlight(2);
+		CHECK(Pacer.GetFrameIndex() == 0 && Pacer.GetWaitFence() == 8);
+		Pacer.EndFrame(9);
+		CHECK(Pacer.GetFrameIndex() == 1 && Pacer.GetWaitFence() == 8);
+		Pacer.EndFrame(10);
+		CHECK(Pacer.GetFrameIndex() == 0 && Pacer.GetWaitFence() == 9);
+
+		// setting the same count keeps the slots
+		Pacer.SetFramesInFlight(2);
+		CHECK(Pacer.GetFrameIndex() == 0 && Pacer.GetWaitFence() == 9);
+
+		Pacer.SetFramesInFlight(9);
+		CHECK(Pacer.GetFramesInFlight() == FFramePacer::MAX_FRAMES_IN_FLIGHT);
+		Pacer.SetFramesInFlight(0);
+		CHECK(Pacer.GetFramesInFlight() == 1);
+		CHECK(Pacer.GetWaitFence() == 10);
+	}
+}
+
+int main()
+{
+	TestSlots();
+	TestThroughput();
+	return TestResult();
+}
@@ -0,0 +1,129 @@
+#include "GraphicsStateCache.h"
+#include "TestCommon.h"
+
+#include <string>
+#include <vector>
+
+// FGraphicsStateCache against a list that records the calls it gets, a redundant set must not reach the list
+// and every change has to
+namespace
+{
+	struct FRecordingList
+	{
+		std::vector<std::string> Calls;
+
+		void SetPipelineState(ID3D12PipelineState*) { Calls.push_back("pso"); }
+		void SetGraphicsRootSignature(ID3D12RootSignature*) { Calls.push_back("rootsig"); }
+		void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) { Calls.push_back("topology"); }
+		void IASetVertexBuffers(UINT StartSlot, UINT Count, const D3D12_VERTEX_BUFFER_VIEW* Views)
+		{
+			Calls.push_back("vb" + std::to_string(StartSlot) + ":" + std::to_string(Count) + "@" + std::to_string(Views[0].BufferLocation));
+		}
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) { Calls.push_back("ib"); }
+		void RSSetViewports(UINT, const D3D12_VIEWPORT*) { Calls.push_back("viewport"); }
+		void RSSetScissorRects(UINT, const D3D12_RECT*) { Calls.push_back("scissor"); }
+		void OMSetRenderTargets(UINT NumRTVs, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL, const D3D12_CPU_DESCRIPTOR_HANDLE* DSV)
+		{
+			Calls.push_back("rt" + std::to_string(NumRTVs) + (DSV ? "+dsv" : ""));
+		}
+		void OMSetStencilRef(UINT) { Calls.push_back("stencil"); }
+	};
+
+	ID3D12PipelineState PipelineA, PipelineB;
+	ID3D12RootSignature RootSignature;
+	const D3D12_VERTEX_BUFFER_VIEW VertexBuffers[3] = { { 100, 10, 4 }, { 200, 10, 8 }, { 300, 10, 12 } };
+	const D3D12_INDEX_BUFFER_VIEW IndexBuffer = { 500, 60, DXGI_FORMAT_R32_UINT };
+	const D3D12_VIEWPORT Viewport = { 0.f, 0.f, 100.f, 100.f, 0.f, 1.f };
+	const D3D12_RECT Scissor = { 0, 0, 100, 100 };
+	const D3D12_CPU_DESCRIPTOR_HANDLE RTV = { 7 }, DSV = { 9 };
+
+	void SetAll(FGraphicsStateCache& Cache, FRecordingList& List)
+	{
+		Cache.SetRootSignature(&List, &RootSignature);
+		Cache.SetPipelineState(&List, &PipelineA);
+		Cache.SetPrimitiveTopology(&List, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		Cache.SetRenderTargets(&List, 1, &RTV, &DSV);
+		Cache.SetViewport(&List, Viewport);
+		Cache.SetScissor(&List, Scissor);
+		Cache.SetVertexBuffers(&List, 0, 3, VertexBuffers);
+		Cache.SetIndexBuffer(&List, IndexBuffer);
+		Cache.SetStencilRef(&List, 0);
+	}
+
+	void TestRedundantSets()
+	{
+		FRecordingList List;
+		FGraphicsStateCache Cache;
+		for (int Draw = 0; Draw < 100; ++Draw)
+			SetAll(Cache, List);
+		CHECK(List.Calls.size() == 9);
+		CHECK(Cache.GetStats().GetIssued() == 9);
+		CHECK(Cache.GetStats().GetSkipped() == 99 * 9);
+		CHECK(Cache.GetPipelineState() == &PipelineA && Cache.GetRootSignature() == &RootSignature);
+
+		Cache.RecordSet(FGraphicsStateCache::STATE_DescriptorTable, false);
+		CHECK(Cache.GetStats().Skipped[FGraphicsStateCache::STATE_DescriptorTable] == 1);
+		Cache.ResetStats();
+		CHECK(Cache.GetStats().GetIssued() == 0 && Cache.GetStats().GetSkipped() == 0);
+	}
+
+	void TestChanges()
+	{
+		FRecordingList List;
+		FGraphicsStateCache Cache;
+		SetAll(Cache, List);
+
+		// only the span from the first to the last changed slot goes to the list
+		List.Calls.clear();
+		D3D12_VERTEX_BUFFER_VIEW Middle[3] = { VertexBuffers[0], { 250, 10, 8 }, VertexBuffers[2] };
+		CHECK(Cache.SetVertexBuffers(&List, 0, 3, Middle));
+		CHECK(List.Calls.size() == 1 && List.Calls[0] == "vb1:1@250");
+
+		List.Calls.clear();
+		D3D12_VERTEX_BUFFER_VIEW Ends[3] = { { 1, 1, 1 }, Middle[1], { 3, 3, 3 } };
+		CHECK(Cache.SetVertexBuffers(&List, 0, 3, Ends));
+		CHECK(List.Calls.size() == 1 && List.Calls[0] == "vb0:3@1");
+		CHECK(!Cache.SetVertexBuffers(&List, 2, 1, &Ends[2]));
+
+		// dropping the depth target is a change
+		List.Calls.clear();
+		CHECK(Cache.SetRenderTargets(&List, 1, &RTV, nullptr));
+		CHECK(List.Calls.size() == 1 && List.Calls[0] == "rt1");
+		CHECK(!Cache.SetRenderTargets(&List, 1, &RTV, nullptr));
+
+		CHECK(Cache.SetPipelineState(&List, &PipelineB));
+		CHECK(!Cache.SetPipelineState(&List, &PipelineB));
+		D3D12_VIEWPORT Half = Viewport;
+		Half.Width = 50.f;
+		CHECK(Cache.SetViewport(&List, Half));
+		CHECK(Cache.SetStencilRef(&List, 1));
+		CHECK(Cache.SetPrimitiveTopology(&List, D3D_PRIMITIVE_TOPOLOGY_LINELIST));
+	}
+
+	// after a reset or state set on the list directly, every set has to reach the list again
+	void TestInvalidate()
+	{
+		FRecordingList List;
+		FGraphicsStateCache Cache;
+		SetAll(Cache, List);
+
+		Cache.Invalidate();
+		CHECK(Cache.GetPipelineState() == nullptr && Cache.GetRootSignature() == nullptr);
+		List.Calls.clear();
+		SetAll(Cache, List);
+		CHECK(List.Calls.size() == 9);
+
+		// a slot the cache never saw is not assumed to hold anything
+		List.Calls.clear();
+		CHECK(Cache.SetVertexBuffers(&List, 3, 1, &VertexBuffers[0]));
+		CHECK(List.Calls.size() == 1 && List.Calls[0] == "vb3:1@100");
+	}
+}
+
+int main()
+{
+	TestRedundantSets();
+	TestChanges();
+	TestInvalidate();
+	return TestResult();
+}
@@ -0,0 +1,115 @@
+#include "LargePagePool.h"
+#include "BenchmarkCommon.h"
+
+#include <random>
+#include <vector>
+
+// Replays a trace of large allocations, bursts of 2-40 MB streaming uploads with quiet stretches in between,
+// with three frames in flight. Compares creating every page and freeing it after its fence against
+// FLargePagePool at two budgets: pages created, peak resident memory and the CPU time of the pool per frame.
+namespace
+{
+	struct FPage
+	{
+		uint64_t Size;
+	};
+
+	const uint64_t FRAMES_IN_FLIGHT = 3;
+	const uint64_t TICKS_PER_FRAME = 16;
+
+	std::vector<std::vector<uint64_t>> MakeTrace(size_t NumFrames)
+	{
+		static const uint64_t Sizes[] = { 0x210000, 0x400000, 0x555000, 0xAAB000, 0x1000000, 0x2800000 };
+		std::mt19937 Random(7);
+		std::vector<std::vector<uint64_t>> Trace(NumFrames);
+		for (size_t Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			// every third stretch of 200 frames is quiet
+			bool Burst = (Frame / 200) % 3 != 2;
+			int Count = Burst ? Random() % 4 : (Random() % 20 == 0);
+			for (int i = 0; i < Count; ++i)
+				Trace[Frame].push_back(Sizes[Random() % 6]);
+		}
+		return Trace;
+	}
+
+	void ReplayWithoutPool(const std::vector<std::vector<uint64_t>>& Trace)
+	{
+		uint64_t Creates = 0, Resident = 0, Peak = 0;
+		std::vector<std::pair<uint64_t, uint64_t>> Pending;	// fence, size
+		for (uint64_t Frame = 0; Frame < Trace.size(); ++Frame)
+		{
+			uint64_t Completed = Frame >= FRAMES_IN_FLIGHT ? Frame - FRAMES_IN_FLIGHT : 0;
+			for (size_t i = 0; i < Pending.size(); )
+			{
+				if (Pending[i].first <= Completed)
+				{
+					Resident -= Pending[i].second;
+					Pending[i] = Pending.back();
+					Pending.pop_back();
+				}
+				else
+				{
+					++i;
+				}
+			}
+			for (uint64_t Size : Trace[Frame])
+			{
+				Creates++;
+				Resident += Size;
+				Pending.push_back(std::make_pair(Frame + 1, Size));
+			}
+			Peak = (std::max)(Peak, Resident);
+		}
+		printf("%-16s %8llu %10llu %10s %12s\n", "free at fence", (unsigned long long)Creates, (unsigned long long)(Peak >> 20), "-", "-");
+	}
+
+	void ReplayWithPool(const std::vector<std::vector<uint64_t>>& Trace, uint64_t Budget)
+	{
+		FLargePagePool<FPage> Pool(Budget, 2000);
+		uint64_t Completed = 0;
+		auto IsComplete = [&Completed](uint64_t Fence) { return Fence <= Completed; };
+		std::vector<FPage*> Freed;
+		std::vector<FPage*> Used;
+		double PoolNs = 0.0;
+		for (uint64_t Frame = 0; Frame < Trace.size(); ++Frame)
+		{
+			Completed = Frame >= FRAMES_IN_FLIGHT ? Frame - FRAMES_IN_FLIGHT : 0;
+			auto Start = std::chrono::steady_clock::now();
+			for (uint64_t Size : Trace[Frame])
+			{
+				FPage* Page = Pool.Request(Size, IsComplete);
+				if (Page == nullptr)
+					Page = new FPage{ FLargePagePool<FPage>::GetBucketSize(Size) };
+				Used.push_back(Page);
+			}
+			for (FPage* Page : Used)
+				Pool.Discard(Frame + 1, Page, Page->Size, Frame * TICKS_PER_FRAME);
+			Used.clear();
+			Pool.Trim(Frame * TICKS_PER_FRAME, IsComplete, Freed);
+			PoolNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count();
+			for (FPage* Page : Freed)
+				delete Page;
+			Freed.clear();
+		}
+
+		FLargePagePool<FPage>::FStats Stats = Pool.GetStats();
+		char Name[32];
+		snprintf(Name, sizeof(Name), "pool %llu MB", (unsigned long long)(Budget >> 20));
+		printf("%-16s %8llu %10llu %10llu %12.2f\n", Name, (unsigned long long)Stats.Misses, (unsigned long long)(Stats.PeakBytesResident >> 20),
+			(unsigned long long)Stats.Hits, PoolNs / Trace.size() / 1000.0);
+		Pool.Reset(Freed);
+		for (FPage* Page : Freed)
+			delete Page;
+	}
+}
+
+int main()
+{
+	std::vector<std::vector<uint64_t>> Trace = MakeTrace(3000);
+	printf("%-16s %8s %10s %10s %12s\n", "", "creates", "peak MB", "reuses", "us / frame");
+	ReplayWithoutPool(Trace);
+	ReplayWithPool(Trace, 64ull << 20);
+	ReplayWithPool(Trace, 256ull << 20);
+	return 0;
+}
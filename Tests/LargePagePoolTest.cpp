@@ -0,0 +1,114 @@
+#include "LargePagePool.h"
+#include "TestCommon.h"
+
+// FLargePagePool size classes, reuse order and trimming, with fences the test completes by hand
+namespace
+{
+	struct FPage
+	{
+		uint64_t Size;
+	};
+
+	typedef FLargePagePool<FPage> FPool;
+
+	void TestBucketSizes()
+	{
+		uint64_t Previous = 0;
+		bool Ordered = true, Bounded = true, Stable = true;
+		for (uint64_t Size = 1; Size < (1ull << 40); Size += (Size >> 6) + 1)
+		{
+			uint64_t BucketSize = FPool::GetBucketSize(Size);
+			Stable &= BucketSize >= Size && FPool::GetBucketSize(BucketSize) == BucketSize;
+			// at most a quarter of a page goes unused
+			Bounded &= Size <= 8 || BucketSize - Size <= BucketSize / 4;
+			Ordered &= BucketSize >= Previous;
+			Previous = BucketSize;
+		}
+		CHECK(Stable);
+		CHECK(Bounded);
+		CHECK(Ordered);
+		CHECK(FPool::GetBucketSize(0x400000) == 0x400000);
+		CHECK(FPool::GetBucketSize(0x400001) == 0x500000);
+	}
+
+	void TestReuseOrder()
+	{
+		FPool Pool(~0ull, ~0ull);
+		uint64_t Completed = 0;
+		auto IsComplete = [&Completed](uint64_t Fence) { return Fence <= Completed; };
+		const uint64_t Size = 0x400000;
+
+		FPage Pages[4] = { { Size }, { Size }, { Size }, { Size } };
+		for (int i = 0; i < 4; ++i)
+			CHECK(Pool.Request(Size, IsComplete) == nullptr);
+		for (int i = 0; i < 4; ++i)
+			Pool.Discard(i + 1, &Pages[i], Size, i);
+
+		// the most recently used page that is done comes first
+		Completed = 2;
+		CHECK(Pool.Request(Size, IsComplete) == &Pages[1]);
+		Completed = 4;
+		CHECK(Pool.Request(Size, IsComplete) == &Pages[3]);
+		Pool.Discard(5, &Pages[1], Size, 10);
+		Pool.Discard(6, &Pages[3], Size, 11);
+
+		// trimming the oldest page keeps the others in the order of their use
+		std::vector<FPage*> Freed;
+		Pool.Trim(12, IsComplete, Freed);
+		CHECK(Freed.empty());
+		Pool.SetBudget(3 * Size, ~0ull);
+		Pool.Trim(12, IsComplete, Freed);
+		CHECK(Freed.size() == 1 && Freed[0] == &Pages[0]);
+		Completed = 6;
+		CHECK(Pool.Request(Size, IsComplete) == &Pages[3]);
+		CHECK(Pool.Request(Size, IsComplete) == &Pages[1]);
+		CHECK(Pool.Request(Size, IsComplete) == &Pages[2]);
+		CHECK(Pool.Request(Size, IsComplete) == nullptr);
+
+		FPool::FStats Stats = Pool.GetStats();
+		CHECK(Stats.Hits == 5 && Stats.Trimmed == 1 && Stats.BytesPooled == 0);
+	}
+
+	void TestTrim()
+	{
+		FPool Pool(8 * 0x400000, 100);
+		uint64_t Completed = 0;
+		auto IsComplete = [&Completed](uint64_t Fence) { return Fence <= Completed; };
+		std::vector<FPage> Pages(12, FPage{ 0x400000 });
+		for (size_t i = 0; i < Pages.size(); ++i)
+		{
+			Pool.Request(0x400000, IsComplete);
+			Pool.Discard(1, &Pages[i], 0x400000, i);
+		}
+		CHECK(Pool.GetStats().BytesResident == 12 * 0x400000ull);
+
+		// over budget, but nothing is done yet
+		std::vector<FPage*> Freed;
+		Pool.Trim(20, IsComplete, Freed);
+		CHECK(Freed.empty());
+
+		// down to the budget, least recently used first
+		Completed = 1;
+		Pool.Trim(20, IsComplete, Freed);
+		CHECK(Freed.size() == 4);
+		for (size_t i = 0; i < Freed.size(); ++i)
+			CHECK(Freed[i] == &Pages[i]);
+
+		// idle for too long, the ones last used before tick 10
+		Freed.clear();
+		Pool.Trim(110, IsComplete, Freed);
+		CHECK(Freed.size() == 6);
+		Freed.clear();
+		Pool.Reset(Freed);
+		CHECK(Freed.size() == 2);
+		CHECK(Pool.GetStats().BytesResident == 0 && Pool.GetStats().BytesPooled == 0);
+	}
+}
+
+int main()
+{
+	TestBucketSizes();
+	TestReuseOrder();
+	TestTrim();
+	return TestResult();
+}
@@ -0,0 +1,33 @@
+#include "MathLib.h"
+#include "MathReference.h"
+#include "BenchmarkCommon.h"
+
+// FMatrix products and inverses, the cofactor expansion Inverse replaced is timed alongside
+int main()
+{
+	const size_t COUNT = 1 << 16;
+	std::mt19937 Random(1);
+	std::uniform_real_distribution<float> Uniform(-1.f, 1.f);
+	std::vector<FMatrix> Matrices(COUNT);
+	std::vector<FMatrix> Rigid(COUNT);
+	for (size_t i = 0; i < COUNT; ++i)
+	{
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				Matrices[i][r][c] = Uniform(Random);
+		Rigid[i] = FMatrix::MatrixRotationRollPitchYaw(Uniform(Random), Uniform(Random), Uniform(Random)) * FMatrix::TranslateMatrix(Vector3f(Uniform(Random), Uniform(Random), Uniform(Random)));
+	}
+	std::vector<FMatrix> Results(COUNT);
+	const size_t Mask = COUNT - 1;
+
+	printf("%s\n", MATH_USE_SSE ? "SSE" : (MATH_USE_NEON ? "NEON" : "scalar"));
+	printf("multiply        %6.2f ns\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = Matrices[i] * Matrices[(i + 1) & Mask]; }));
+	printf("vector * matrix %6.2f ns\n", MeasureNs(COUNT, [&](size_t i) { Results[i].r0 = Matrices[(i + 1) & Mask].r1 * Matrices[i]; }));
+	printf("transpose       %6.2f ns\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = Matrices[i].Transpose(); }));
+	printf("inverse         %6.2f ns\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = Matrices[i].Inverse(); }));
+	printf("cofactor        %6.2f ns\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = CofactorInverse(Matrices[i]); }));
+	printf("inverse affine  %6.2f ns\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = Rigid[i].InverseAffine(); }));
+	printf("inverse rigid   %6.2f ns\n", MeasureNs(COUNT, [&](size_t i) { Results[i] = Rigid[i].InverseRigid(); }));
+	KeepAlive(Results[Random() & Mask]);
+	return 0;
+}
@@ -0,0 +1,208 @@
+#include "MathLib.h"
+#include "TestCommon.h"
+#include "MathReference.h"
+
+#include <string.h>
+#include <float.h>
+
+// The SIMD paths of FMatrix and FQuaternion against the plain float code they replaced. Products and
+// transposes sum in the same order and have to match bit for bit, the inverses are checked against a double
+// precision reference within the tolerance stated in MathLib.h. Built once with and once without MATH_NO_SIMD.
+namespace
+{
+	const int NUM_MATRICES = 200000;
+
+	bool SameBits(const FMatrix& a, const FMatrix& b)
+	{
+		return memcmp(&a[0].x, &b[0].x, sizeof(float) * 16) == 0;
+	}
+
+	FMatrix RandomMatrix(std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Uniform(-1.f, 1.f);
+		FMatrix Result;
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				Result[i][j] = Uniform(Random);
+		return Result;
+	}
+
+	FMatrix RandomRigid(std::mt19937& Random)
+	{
+		std::uniform_real_distribution<float> Uniform(-MATH_PI, MATH_PI);
+		std::uniform_real_distribution<float> Offset(-100.f, 100.f);
+		return FMatrix::MatrixRotationRollPitchYaw(Uniform(Random), Uniform(Random), Uniform(Random)) * FMatrix::TranslateMatrix(Vector3f(Offset(Random), Offset(Random), Offset(Random)));
+	}
+
+	// Gauss-Jordan with partial pivoting in double, false for a singular matrix
+	bool ReferenceInverse(const FMatrix& m, double Result[4][4])
+	{
+		double a[4][8];
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				a[i][j] = m[i][j];
+				a[i][j + 4] = i == j ? 1.0 : 0.0;
+			}
+		}
+		for (int c = 0; c < 4; ++c)
+		{
+			int Pivot = c;
+			for (int r = c + 1; r < 4; ++r)
+			{
+				if (fabs(a[r][c]) > fabs(a[Pivot][c]))
+					Pivot = r;
+			}
+			if (a[Pivot][c] == 0.0)
+				return false;
+			for (int j = 0; j < 8; ++j)
+				std::swap(a[c][j], a[Pivot][j]);
+			double Scale = 1.0 / a[c][c];
+			for (int j = 0; j < 8; ++j)
+				a[c][j] *= Scale;
+			for (int r = 0; r < 4; ++r)
+			{
+				if (r == c)
+					continue;
+				double Factor = a[r][c];
+				for (int j = 0; j < 8; ++j)
+					a[r][j] -= Factor * a[c][j];
+			}
+		}
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				Result[i][j] = a[i][j + 4];
+		return true;
+	}
+
+	double MaxAbs(const FMatrix& m)
+	{
+		double Result = 0.0;
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				Result = std::max(Result, (double)fabsf(m[i][j]));
+		return Result;
+	}
+
+	// largest element error over the largest element of the exact inverse
+	double InverseError(const FMatrix& Inverse, const double Reference[4][4], double ReferenceMax)
+	{
+		double Error = 0.0;
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				Error = std::max(Error, fabs(Inverse[i][j] - Reference[i][j]));
+		return Error / ReferenceMax;
+	}
+
+	void TestProducts()
+	{
+		std::mt19937 Random(1);
+		int Mismatches = 0;
+		for (int k = 0; k < NUM_MATRICES; ++k)
+		{
+			FMatrix a = RandomMatrix(Random);
+			FMatrix b = RandomMatrix(Random);
+
+			FMatrix Product = a * b;
+			FMatrix Expected;
+			for (int i = 0; i < 4; ++i)
+				for (int j = 0; j < 4; ++j)
+					Expected[i][j] = a[i].Dot(b.Column(j));
+			Mismatches += SameBits(Product, Expected) ? 0 : 1;
+
+			Vector4f v = a[0] * b;
+			Vector4f ExpectedV(a[0].Dot(b.Column(0)), a[0].Dot(b.Column(1)), a[0].Dot(b.Column(2)), a[0].Dot(b.Column(3)));
+			Mismatches += memcmp(&v.x, &ExpectedV.x, sizeof(v)) == 0 ? 0 : 1;
+
+			FMatrix Transposed = a.Transpose();
+			FMatrix ExpectedT(a.Column(0), a.Column(1), a.Column(2), a.Column(3));
+			Mismatches += SameBits(Transposed, ExpectedT) ? 0 : 1;
+
+			const Vector4f& p = a[1];
+			const Vector4f& q = b[1];
+			FQuaternion pq = FQuaternion::Mul(FQuaternion(p), FQuaternion(q));
+			Vector4f ExpectedQ(
+				+p.x * q.w + p.y * q.z - p.z * q.y + p.w * q.x,
+				-p.x * q.z + p.y * q.w + p.z * q.x + p.w * q.y,
+				+p.x * q.y - p.y * q.x + p.z * q.w + p.w * q.z,
+				-p.x * q.x - p.y * q.y - p.z * q.z + p.w * q.w);
+			Mismatches += memcmp(&pq.q.x, &ExpectedQ.x, sizeof(ExpectedQ)) == 0 ? 0 : 1;
+		}
+		printf("products: %d mismatches\n", Mismatches);
+		CHECK(Mismatches == 0);
+	}
+
+	void TestInverse()
+	{
+		std::mt19937 Random(2);
+		double MaxError = 0.0, SumError = 0.0, SumCofactorError = 0.0, MaxRatio = 0.0, MaxCofactorRatio = 0.0;
+		int Count = 0;
+		for (int k = 0; k < NUM_MATRICES; ++k)
+		{
+			FMatrix m = RandomMatrix(Random);
+			double Reference[4][4];
+			if (!ReferenceInverse(m, Reference))
+				continue;
+			double ReferenceMax = 0.0;
+			for (int i = 0; i < 4; ++i)
+				for (int j = 0; j < 4; ++j)
+					ReferenceMax = std::max(ReferenceMax, fabs(Reference[i][j]));
+			// near singular matrices say nothing about the method
+			double Condition = MaxAbs(m) * ReferenceMax;
+			if (Condition > 100.0)
+				continue;
+
+			double Error = InverseError(m.Inverse(), Reference, ReferenceMax);
+			MaxError = std::max(MaxError, Error);
+			MaxRatio = std::max(MaxRatio, Error / (FLT_EPSILON * Condition));
+			SumError += Error;
+			double CofactorError = InverseError(CofactorInverse(m), Reference, ReferenceMax);
+			MaxCofactorRatio = std::max(MaxCofactorRatio, CofactorError / (FLT_EPSILON * Condition));
+			SumCofactorError += CofactorError;
+			++Count;
+		}
+		printf("inverse over %d matrices: max %.3g, %.2f eps * condition, summed %.4f (cofactor %.2f eps * condition, summed %.4f)\n",
+			Count, MaxError, MaxRatio, SumError, MaxCofactorRatio, SumCofactorError);
+		CHECK(MaxRatio <= 16.0);
+		// no worse than the cofactor expansion on average
+		CHECK(SumError <= SumCofactorError * 1.1);
+	}
+
+	void TestAffineInverse()
+	{
+		std::mt19937 Random(3);
+		std::uniform_real_distribution<float> Scale(0.1f, 10.f);
+		double MaxAffine = 0.0, MaxRigid = 0.0;
+		for (int k = 0; k < NUM_MATRICES; ++k)
+		{
+			FMatrix Rigid = RandomRigid(Random);
+			FMatrix Affine = FMatrix::ScaleMatrix(Vector3f(Scale(Random), Scale(Random), Scale(Random))) * Rigid;
+
+			double Reference[4][4];
+			CHECK(ReferenceInverse(Rigid, Reference));
+			FMatrix InverseRigid = Rigid.InverseRigid();
+			MaxRigid = std::max(MaxRigid, InverseError(InverseRigid, Reference, 1.0) / (FLT_EPSILON * MaxAbs(Rigid)));
+			CHECK(InverseRigid[0].w == 0.f && InverseRigid[1].w == 0.f && InverseRigid[2].w == 0.f && InverseRigid[3].w == 1.f);
+
+			CHECK(ReferenceInverse(Affine, Reference));
+			double ReferenceMax = 0.0;
+			for (int i = 0; i < 4; ++i)
+				for (int j = 0; j < 4; ++j)
+					ReferenceMax = std::max(ReferenceMax, fabs(Reference[i][j]));
+			double Condition = MaxAbs(Affine) * ReferenceMax;
+			MaxAffine = std::max(MaxAffine, InverseError(Affine.InverseAffine(), Reference, ReferenceMax) / (FLT_EPSILON * Condition));
+		}
+		printf("affine inverse: %.2f eps * condition, rigid inverse: %.2f eps * |m|\n", MaxAffine, MaxRigid);
+		CHECK(MaxAffine <= 8.0);
+		CHECK(MaxRigid <= 8.0);
+	}
+}
+
+int main()
+{
+	TestProducts();
+	TestInverse();
+	TestAffineInverse();
+	return TestResult();
+}
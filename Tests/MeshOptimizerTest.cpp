@@ -0,0 +1,131 @@
+#include "MeshOptimizer.h"
+#include "TestCommon.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+// Tipsify on a grid whose triangles are shuffled, and the first use renumbering of the vertex fetch pass
+namespace
+{
+	const uint32_t GRID_SIZE = 64;
+
+	typedef std::array<uint32_t, 3> FTriangle;
+
+	// two triangles per cell of a GRID_SIZE x GRID_SIZE grid, in random order
+	std::vector<uint32_t> ShuffledGrid(std::mt19937& Random)
+	{
+		std::vector<FTriangle> Triangles;
+		for (uint32_t y = 0; y < GRID_SIZE; ++y)
+		{
+			for (uint32_t x = 0; x < GRID_SIZE; ++x)
+			{
+				uint32_t v = y * (GRID_SIZE + 1) + x;
+				Triangles.push_back({ v, v + GRID_SIZE + 1, v + 1 });
+				Triangles.push_back({ v + 1, v + GRID_SIZE + 1, v + GRID_SIZE + 2 });
+			}
+		}
+		std::shuffle(Triangles.begin(), Triangles.end(), Random);
+		std::vector<uint32_t> Indices;
+		for (size_t i = 0; i < Triangles.size(); ++i)
+		{
+			Indices.insert(Indices.end(), Triangles[i].begin(), Triangles[i].end());
+		}
+		return Indices;
+	}
+
+	// the triangles as a sorted list, each rotated to start with its smallest index so the winding counts
+	std::vector<FTriangle> SortedTriangles(const std::vector<uint32_t>& Indices)
+	{
+		std::vector<FTriangle> Triangles;
+		for (size_t i = 0; i + 2 < Indices.size(); i += 3)
+		{
+			FTriangle Triangle = { Indices[i], Indices[i + 1], Indices[i + 2] };
+			std::rotate(Triangle.begin(), std::min_element(Triangle.begin(), Triangle.end()), Triangle.end());
+			Triangles.push_back(Triangle);
+		}
+		std::sort(Triangles.begin(), Triangles.end());
+		return Triangles;
+	}
+
+	void TestVertexCache(std::mt19937& Random)
+	{
+		const uint32_t VertexCount = (GRID_SIZE + 1) * (GRID_SIZE + 1);
+		std::vector<uint32_t> Indices = ShuffledGrid(Random);
+		std::vector<uint32_t> Original = Indices;
+		FVertexCacheStats Before = FMeshOptimizer::AnalyzeVertexCache(Indices.data(), (uint32_t)Indices.size(), VertexCount);
+
+		std::vector<uint32_t> ClusterStarts;
+		FMeshOptimizer::OptimizeVertexCache(Indices.data(), (uint32_t)Indices.size(), VertexCount, FMeshOptimizer::DEFAULT_CACHE_SIZE, &ClusterStarts);
+		FVertexCacheStats After = FMeshOptimizer::AnalyzeVertexCache(Indices.data(), (uint32_t)Indices.size(), VertexCount);
+
+		CHECK(SortedTriangles(Indices) == SortedTriangles(Original));
+		CHECK(After.TriangleCount == Before.TriangleCount);
+		CHECK(After.VertexCount == VertexCount);
+		// a shuffled grid misses on nearly every vertex, Tipsify gets a regular grid below one miss per triangle
+		CHECK(Before.GetACMR() > 2.f);
+		CHECK(After.GetACMR() < 1.f);
+		CHECK(After.GetATVR() < 2.f);
+
+		CHECK(!ClusterStarts.empty() && ClusterStarts[0] == 0);
+		for (size_t c = 0; c < ClusterStarts.size(); ++c)
+		{
+			CHECK(ClusterStarts[c] % 3 == 0);
+			CHECK(ClusterStarts[c] < Indices.size());
+			CHECK(c == 0 || ClusterStarts[c] > ClusterStarts[c - 1]);
+		}
+
+		// degenerate input
+		ClusterStarts.assign(3, 7);
+		FMeshOptimizer::OptimizeVertexCache(Indices.data(), 2, VertexCount, FMeshOptimizer::DEFAULT_CACHE_SIZE, &ClusterStarts);
+		CHECK(ClusterStarts.empty());
+	}
+
+	void TestVertexFetch(std::mt19937& Random)
+	{
+		// the last vertices of the range are never referenced
+		const uint32_t VertexCount = (GRID_SIZE + 1) * (GRID_SIZE + 1) + 5;
+		std::vector<uint32_t> Indices = ShuffledGrid(Random);
+		std::vector<uint32_t> Original = Indices;
+
+		std::vector<uint32_t> Remap;
+		FMeshOptimizer::RemapVertexFetch(Indices.data(), Indices.size(), VertexCount, Remap);
+
+		// Remap is a permutation and the indices went through it
+		CHECK(Remap.size() == VertexCount);
+		std::vector<uint32_t> Sorted = Remap;
+		std::sort(Sorted.begin(), Sorted.end());
+		for (uint32_t v = 0; v < VertexCount; ++v)
+		{
+			CHECK(Sorted[v] == v);
+		}
+		for (size_t i = 0; i < Indices.size(); ++i)
+		{
+			CHECK(Indices[i] == Remap[Original[i]]);
+		}
+
+		// first use order, every index is at most one past the largest one before it
+		uint32_t NextVertex = 0;
+		for (size_t i = 0; i < Indices.size(); ++i)
+		{
+			CHECK(Indices[i] <= NextVertex);
+			if (Indices[i] == NextVertex)
+				++NextVertex;
+		}
+		CHECK(NextVertex == VertexCount - 5);
+
+		// unreferenced vertices keep their relative order after the referenced ones
+		for (uint32_t v = VertexCount - 5; v < VertexCount; ++v)
+		{
+			CHECK(Remap[v] == v);
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 Random(7);
+	TestVertexCache(Random);
+	TestVertexFetch(Random);
+	return TestResult();
+}
@@ -0,0 +1,170 @@
+#include "PagePool.h"
+#include "TestCommon.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// FPagePool under threads that request pages, use them and discard them with a fence of one of two queues,
+// while a mock GPU thread completes the fences a few submissions behind. A page must never be handed to two
+// threads at once, nor come back before the fence it was discarded with passed.
+namespace
+{
+	struct FPage
+	{
+		std::atomic<int> Users{ 0 };
+		uint64_t Fence = 0;
+	};
+
+	const uint64_t FENCE_MASK = (1ull << 56) - 1;
+	const uint64_t GPU_LAG = 8;
+
+	struct FMockGpu
+	{
+		std::atomic<uint64_t> Submitted{ 0 };
+		std::atomic<uint64_t> Completed{ 0 };
+
+		// the queue bits are ignored, all queues complete in step with the submissions
+		bool IsComplete(uint64_t Fence) const { return (Fence & FENCE_MASK) <= Completed.load(); }
+	};
+
+	struct FRunResult
+	{
+		int SharedPages = 0;
+		int EarlyPages = 0;
+		uint64_t CreatedPages = 0;
+		double PagesPerSecond = 0.0;
+	};
+
+	FRunResult Run(FPagePool<FPage>& Pool, int NumThreads, int Iterations)
+	{
+		FMockGpu Gpu;
+		std::atomic<bool> Stop{ false };
+		std::atomic<int> SharedPages{ 0 }, EarlyPages{ 0 };
+		std::atomic<uint64_t> CreatedPages{ 0 };
+		std::vector<std::unique_ptr<FPage>> AllPages[16];
+
+		std::thread GpuThread([&Gpu, &Stop]()
+		{
+			while (!Stop)
+			{
+				uint64_t Submitted = Gpu.Submitted.load();
+				if (Submitted > GPU_LAG)
+					Gpu.Completed = Submitted - GPU_LAG;
+				std::this_thread::yield();
+			}
+		});
+
+		auto IsComplete = [&Gpu](uint64_t Fence) { return Gpu.IsComplete(Fence); };
+		auto Start = std::chrono::steady_clock::now();
+		std::vector<std::thread> Threads;
+		for (int t = 0; t < NumThreads; ++t)
+		{
+			Threads.emplace_back([&, t]()
+			{
+				std::vector<FPage*> Used;
+				for (int i = 0; i < Iterations; ++i)
+				{
+					for (int p = 0; p < 3; ++p)
+					{
+						FPage* Page = Pool.Request(IsComplete);
+						if (Page == nullptr)
+						{
+							AllPages[t].emplace_back(new FPage);
+							Page = AllPages[t].back().get();
+							++CreatedPages;
+						}
+						else if (!Gpu.IsComplete(Page->Fence))
+						{
+							++EarlyPages;
+						}
+						if (++Page->Users != 1)
+							++SharedPages;
+						Used.push_back(Page);
+					}
+
+					// odd threads submit on another queue
+					uint64_t Queue = (t & 1) ? 2 : 0;
+					uint64_t Fence = (Queue << 56) | ++Gpu.Submitted;
+					for (FPage* Page : Used)
+					{
+						Page->Fence = Fence;
+						--Page->Users;
+					}
+					Pool.Discard(Fence, Used.data(), Used.size());
+					Used.clear();
+				}
+			});
+		}
+		for (std::thread& Thread : Threads)
+			Thread.join();
+		Stop = true;
+		GpuThread.join();
+		double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		Pool.Reset();
+
+		FRunResult Result;
+		Result.SharedPages = SharedPages;
+		Result.EarlyPages = EarlyPages;
+		Result.CreatedPages = CreatedPages;
+		Result.PagesPerSecond = NumThreads * Iterations * 3 / Seconds;
+		return Result;
+	}
+
+	void TestThreads()
+	{
+		const int TotalIterations = 200000;
+		for (int NumThreads : { 1, 2, 4, 8 })
+		{
+			FPagePool<FPage> Pool;
+			FRunResult Result = Run(Pool, NumThreads, TotalIterations / NumThreads);
+			FPagePool<FPage>::FStats Stats = Pool.GetStats();
+			printf("%d threads: %.1f M pages/s, %llu pages created, thread cache %llu, shards %llu, misses %llu\n", NumThreads,
+				Result.PagesPerSecond / 1e6, (unsigned long long)Result.CreatedPages, (unsigned long long)Stats.ThreadCacheHits,
+				(unsigned long long)Stats.ShardHits, (unsigned long long)Stats.Misses);
+			CHECK(Result.SharedPages == 0);
+			CHECK(Result.EarlyPages == 0);
+			// how many pages are created depends on how often the mock GPU thread gets to run, only check that
+			// the pages do get recycled
+			CHECK(Stats.ThreadCacheHits + Stats.ShardHits > 0);
+			CHECK(Stats.Misses == Result.CreatedPages);
+		}
+	}
+
+	void TestOrder()
+	{
+		FPagePool<FPage> Pool;
+		FPage Pages[3];
+		FPage* Slow = &Pages[0];
+		FPage* Fast[2] = { &Pages[1], &Pages[2] };
+		uint64_t Completed = 0;
+		auto IsComplete = [&Completed](uint64_t Fence) { return (Fence & FENCE_MASK) <= Completed; };
+
+		// a page behind a slow fence of one queue does not hide the pages of another
+		Pool.Discard(5, &Slow, 1);
+		Pool.Discard(2ull << 56 | 1, Fast, 2);
+		CHECK(Pool.Request(IsComplete) == nullptr);
+		Completed = 1;
+		FPage* First = Pool.Request(IsComplete);
+		FPage* Second = Pool.Request(IsComplete);
+		CHECK(First != nullptr && Second != nullptr && First != Second && First != Slow && Second != Slow);
+		CHECK(Pool.Request(IsComplete) == nullptr);
+		Completed = 5;
+		CHECK(Pool.Request(IsComplete) == Slow);
+
+		// Reset also empties the cache of this thread
+		Pool.Discard(1, Fast, 2);
+		CHECK(Pool.Request(IsComplete) != nullptr);
+		Pool.Reset();
+		CHECK(Pool.Request(IsComplete) == nullptr);
+	}
+}
+
+int main()
+{
+	TestOrder();
+	TestThreads();
+	return TestResult();
+}
@@ -0,0 +1,132 @@
+#include "PipelineStateKey.h"
+#include "TestCommon.h"
+
+#include <string.h>
+
+// FPipelineStateKey of descriptions that differ in one thing at a time. The key follows what the pointers
+// point at, the semantic names, the shader code and the serialized root signature, and never the pointers
+namespace
+{
+	const uint8_t VertexShader[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4 };
+	const uint8_t PixelShader[] = { 0x44, 0x58, 0x42, 0x43, 5, 6, 7, 8 };
+
+	struct FTestPipeline
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+		D3D12_INPUT_ELEMENT_DESC Elements[2];
+		// names in buffers of their own, so that equal names are never equal pointers
+		char Names[2][16];
+
+		FTestPipeline()
+		{
+			memset(&Desc, 0, sizeof(Desc));
+			memset(Elements, 0, sizeof(Elements));
+			strcpy(Names[0], "POSITION");
+			strcpy(Names[1], "NORMAL");
+			for (int i = 0; i < 2; ++i)
+			{
+				Elements[i].SemanticName = Names[i];
+				Elements[i].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+				Elements[i].AlignedByteOffset = 12 * i;
+			}
+			Desc.VS = { VertexShader, sizeof(VertexShader) };
+			Desc.PS = { PixelShader, sizeof(PixelShader) };
+			Desc.SampleMask = 0xffffffff;
+			Desc.InputLayout = { Elements, 2 };
+			Desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			Desc.NumRenderTargets = 1;
+			Desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+
+		FPipelineStateKey Key(const std::vector<uint8_t>& RootSignatureBlob) const
+		{
+			return FPipelineStateKey::Make(Desc, RootSignatureBlob);
+		}
+	};
+
+	bool Differs(const FPipelineStateKey& A, const FPipelineStateKey& B)
+	{
+		return !(A == B) && A.GetHash() != B.GetHash() && A.GetName() != B.GetName();
+	}
+
+	void TestGraphics()
+	{
+		const std::vector<uint8_t> Blob = { 1, 0, 0, 0, 0x10, 0x20 };
+		FTestPipeline Base;
+		const FPipelineStateKey BaseKey = Base.Key(Blob);
+
+		// equal contents behind other pointers
+		FTestPipeline Copy;
+		ID3D12RootSignature OtherRootSignature;
+		Copy.Desc.pRootSignature = &OtherRootSignature;
+		std::vector<uint8_t> VertexShaderCopy(VertexShader, VertexShader + sizeof(VertexShader));
+		Copy.Desc.VS.pShaderBytecode = VertexShaderCopy.data();
+		const std::vector<uint8_t> BlobCopy = Blob;
+		FPipelineStateKey CopyKey = Copy.Key(BlobCopy);
+		CHECK(CopyKey == BaseKey);
+		CHECK(CopyKey.GetHash() == BaseKey.GetHash());
+		CHECK(CopyKey.GetName() == BaseKey.GetName());
+
+		// a semantic name, same length and different length
+		FTestPipeline Renamed;
+		strcpy(Renamed.Names[1], "NORMAM");
+		CHECK(Differs(Renamed.Key(Blob), BaseKey));
+		strcpy(Renamed.Names[1], "TEXCOORD");
+		CHECK(Differs(Renamed.Key(Blob), BaseKey));
+
+		// the root signature blob, a byte of it and its length
+		std::vector<uint8_t> OtherBlob = Blob;
+		OtherBlob.back() ^= 1;
+		CHECK(Differs(Base.Key(OtherBlob), BaseKey));
+		OtherBlob = Blob;
+		OtherBlob.push_back(0);
+		CHECK(Differs(Base.Key(OtherBlob), BaseKey));
+		CHECK(Differs(Base.Key(std::vector<uint8_t>()), BaseKey));
+
+		// shader code and fixed function state
+		FTestPipeline Reshaded;
+		VertexShaderCopy.back() ^= 1;
+		Reshaded.Desc.VS.pShaderBytecode = VertexShaderCopy.data();
+		CHECK(Differs(Reshaded.Key(Blob), BaseKey));
+		FTestPipeline Retargeted;
+		Retargeted.Desc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+		CHECK(Differs(Retargeted.Key(Blob), BaseKey));
+
+		// a shader moved to another stage
+		FTestPipeline Moved;
+		Moved.Desc.GS = Moved.Desc.PS;
+		Moved.Desc.PS = { nullptr, 0 };
+		CHECK(Differs(Moved.Key(Blob), BaseKey));
+
+		const std::wstring Name = BaseKey.GetName();
+		CHECK(Name.size() == 20 && Name.compare(0, 4, L"PSO_") == 0);
+	}
+
+	void TestCompute()
+	{
+		const std::vector<uint8_t> Blob = { 1, 0, 0, 0, 0x30 };
+		D3D12_COMPUTE_PIPELINE_STATE_DESC Desc;
+		memset(&Desc, 0, sizeof(Desc));
+		Desc.CS = { VertexShader, sizeof(VertexShader) };
+		const FPipelineStateKey Key = FPipelineStateKey::Make(Desc, Blob);
+
+		std::vector<uint8_t> OtherBlob = Blob;
+		OtherBlob[0] = 2;
+		CHECK(Differs(FPipelineStateKey::Make(Desc, OtherBlob), Key));
+
+		D3D12_COMPUTE_PIPELINE_STATE_DESC OtherShader = Desc;
+		OtherShader.CS = { PixelShader, sizeof(PixelShader) };
+		CHECK(Differs(FPipelineStateKey::Make(OtherShader, Blob), Key));
+
+		// the same code and signature as a graphics pipeline
+		FTestPipeline Graphics;
+		CHECK(!(Graphics.Key(Blob) == Key));
+	}
+}
+
+int main()
+{
+	TestGraphics();
+	TestCompute();
+	return TestResult();
+}
@@ -0,0 +1,78 @@
+#include "RangeAllocator.h"
+#include "BenchmarkCommon.h"
+
+#include <random>
+#include <vector>
+
+// Churns descriptor ranges like the views of resized render targets and reloaded textures do: mostly single
+// descriptors, now and then a table of 6-17, up to 20000 live. Reports the cost per operation, the
+// fragmentation left behind and the heaps of 256 a bump allocator that never frees would have created.
+namespace
+{
+	struct FRange
+	{
+		uint32_t Offset;
+		uint32_t Count;
+	};
+
+	void Churn(uint32_t Size, size_t MaxLive)
+	{
+		const int NUM_OPS = 2000000;
+		std::mt19937 Random(11);
+		FRangeAllocator Allocator(Size);
+		std::vector<FRange> Live;
+		Live.reserve(MaxLive);
+		uint64_t Allocated = 0, Failed = 0;
+		auto NextCount = [&Random]() { return Random() % 16 == 0 ? 6 + Random() % 12 : 1u; };
+		// filled up front, then it churns around MaxLive
+		while (Live.size() < MaxLive)
+		{
+			uint32_t Count = NextCount();
+			uint32_t Offset = Allocator.Allocate(Count);
+			if (Offset == FRangeAllocator::INVALID_OFFSET)
+				break;
+			Live.push_back({ Offset, Count });
+			Allocated += Count;
+		}
+
+		auto Start = std::chrono::steady_clock::now();
+		for (int Op = 0; Op < NUM_OPS; ++Op)
+		{
+			if (Live.empty() || (Live.size() < MaxLive && Random() % 2))
+			{
+				uint32_t Count = NextCount();
+				uint32_t Offset = Allocator.Allocate(Count);
+				if (Offset == FRangeAllocator::INVALID_OFFSET)
+				{
+					++Failed;
+					continue;
+				}
+				Live.push_back({ Offset, Count });
+				Allocated += Count;
+			}
+			else
+			{
+				size_t Index = Random() % Live.size();
+				Allocator.Free(Live[Index].Offset, Live[Index].Count);
+				Live[Index] = Live.back();
+				Live.pop_back();
+			}
+		}
+		double Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count() / NUM_OPS;
+		KeepAlive(Live.size());
+
+		FRangeAllocator::FStats Stats = Allocator.GetStats();
+		printf("%8u %8zu %10.1f %8zu %8u %8u %8.2f %8llu %10llu\n", Size, MaxLive, Ns, Live.size(), Stats.NumFreeRanges, Stats.LargestFreeRange,
+			Stats.FreeSize == 0 ? 0.0 : 1.0 - (double)Stats.LargestFreeRange / Stats.FreeSize, (unsigned long long)Failed,
+			(unsigned long long)((Allocated + 255) / 256));
+	}
+}
+
+int main()
+{
+	printf("%8s %8s %10s %8s %8s %8s %8s %8s %10s\n", "size", "max live", "ns / op", "live", "ranges", "largest", "frag", "failed", "bump heaps");
+	Churn(1024, 200);
+	Churn(1 << 16, 2000);
+	Churn(1 << 16, 20000);
+	return 0;
+}
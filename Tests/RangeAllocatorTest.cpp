@@ -0,0 +1,124 @@
+#include "RangeAllocator.h"
+#include "TestCommon.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// FRangeAllocator against a model that keeps one flag per element. An allocation must only fail when the
+// model has no free run long enough, never hand out a used element, and the statistics have to match.
+namespace
+{
+	struct FRange
+	{
+		uint32_t Offset;
+		uint32_t Count;
+	};
+
+	void TestAgainstModel()
+	{
+		std::mt19937 Random(11);
+		bool Overlap = false, OutOfRange = false, FailedWithRoom = false, StatsMatch = true;
+		for (int Round = 0; Round < 200; ++Round)
+		{
+			const uint32_t Size = 1 + Random() % 2048;
+			FRangeAllocator Allocator(Size);
+			std::vector<char> Used(Size, 0);
+			std::vector<FRange> Live;
+			for (int Op = 0; Op < 5000; ++Op)
+			{
+				if (Live.empty() || Random() % 2)
+				{
+					uint32_t Count = 1 + (Random() % 8 == 0 ? Random() % 64 : Random() % 6);
+					uint32_t Offset = Allocator.Allocate(Count);
+					if (Offset == FRangeAllocator::INVALID_OFFSET)
+					{
+						uint32_t Run = 0, LongestRun = 0;
+						for (uint32_t i = 0; i < Size; ++i)
+						{
+							Run = Used[i] ? 0 : Run + 1;
+							LongestRun = std::max(LongestRun, Run);
+						}
+						FailedWithRoom |= LongestRun >= Count;
+						continue;
+					}
+					OutOfRange |= Offset + Count > Size;
+					for (uint32_t i = Offset; i < std::min(Offset + Count, Size); ++i)
+					{
+						Overlap |= Used[i] != 0;
+						Used[i] = 1;
+					}
+					Live.push_back({ Offset, Count });
+				}
+				else
+				{
+					size_t Index = Random() % Live.size();
+					Allocator.Free(Live[Index].Offset, Live[Index].Count);
+					for (uint32_t i = Live[Index].Offset; i < Live[Index].Offset + Live[Index].Count; ++i)
+						Used[i] = 0;
+					Live[Index] = Live.back();
+					Live.pop_back();
+				}
+
+				uint32_t FreeSize = 0, NumFreeRanges = 0, LargestFreeRange = 0, Run = 0;
+				for (uint32_t i = 0; i < Size; ++i)
+				{
+					if (Used[i])
+					{
+						Run = 0;
+						continue;
+					}
+					++FreeSize;
+					NumFreeRanges += Run == 0 ? 1 : 0;
+					LargestFreeRange = std::max(LargestFreeRange, ++Run);
+				}
+				FRangeAllocator::FStats Stats = Allocator.GetStats();
+				StatsMatch &= Stats.Size == Size && Stats.FreeSize == FreeSize && Stats.NumFreeRanges == NumFreeRanges
+					&& Stats.LargestFreeRange == LargestFreeRange;
+			}
+
+			// freed in any order, the ranges merge back into one
+			for (const FRange& Range : Live)
+				Allocator.Free(Range.Offset, Range.Count);
+			CHECK(Allocator.GetStats().NumFreeRanges == 1 && Allocator.GetFreeSize() == Size);
+		}
+		CHECK(!Overlap);
+		CHECK(!OutOfRange);
+		CHECK(!FailedWithRoom);
+		CHECK(StatsMatch);
+	}
+
+	void TestBestFit()
+	{
+		FRangeAllocator Allocator(16);
+		CHECK(Allocator.Allocate(0) == FRangeAllocator::INVALID_OFFSET);
+		CHECK(Allocator.Allocate(17) == FRangeAllocator::INVALID_OFFSET);
+		CHECK(Allocator.Allocate(4) == 0);
+		CHECK(Allocator.Allocate(2) == 4);
+		CHECK(Allocator.Allocate(4) == 6);
+		CHECK(Allocator.Allocate(1) == 10);
+		// free ranges of 4 at 0 and of 5 at 11, the smallest that holds a request is split
+		Allocator.Free(0, 4);
+		CHECK(Allocator.GetStats().NumFreeRanges == 2 && Allocator.GetLargestFreeRange() == 5);
+		CHECK(Allocator.Allocate(3) == 0);
+		CHECK(Allocator.Allocate(5) == 11);
+		CHECK(Allocator.Allocate(2) == FRangeAllocator::INVALID_OFFSET);
+
+		// the neighbours on both sides merge
+		Allocator.Free(4, 2);
+		Allocator.Free(10, 1);
+		Allocator.Free(6, 4);
+		CHECK(Allocator.GetStats().NumFreeRanges == 1 && Allocator.GetLargestFreeRange() == 8);
+		CHECK(Allocator.Allocate(8) == 3);
+
+		Allocator.Reset(32);
+		CHECK(Allocator.GetSize() == 32 && Allocator.GetFreeSize() == 32 && Allocator.GetLargestFreeRange() == 32);
+	}
+}
+
+int main()
+{
+	TestBestFit();
+	TestAgainstModel();
+	return TestResult();
+}
@@ -0,0 +1,13 @@
+#include "Assertion.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// the library shows a message box, here a failed Assert ends the run
+void DoAssert(bool success, const wchar_t* file_name, int line)
+{
+	if (success)
+		return;
+	fprintf(stderr, "%ls(%d): Assert failed\n", file_name, line);
+	abort();
+}
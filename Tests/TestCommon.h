@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdio.h>
+
+// failed checks are counted and printed, a test returns TestResult() from main
+inline int& TestFailures()
+{
+	static int Failures = 0;
+	return Failures;
+}
+
+inline int TestResult()
+{
+	if (TestFailures() > 0)
+		printf("%d checks failed\n", TestFailures());
+	return TestFailures() > 0 ? 1 : 0;
+}
+
+#define CHECK(Condition) \
+	do \
+	{ \
+		if (!(Condition)) \
+		{ \
+			printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #Condition); \
+			++TestFailures(); \
+		} \
+	} while (0)
@@ -0,0 +1,223 @@
+#include "UploadRing.h"
+#include "TestCommon.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+// FUploadRing against a mock fence that completes the submitted batches with a lag, like a copy queue
+// behind the CPU. No two live allocations may overlap and a batch may only be retired once its fence passed.
+// TestFrameConstants replays the ring mode of LinearAllocator: per draw constants, one batch per frame.
+namespace
+{
+	const uint64_t RING_SIZE = 64 * 1024;
+	const int NUM_ALLOCATIONS = 200000;
+
+	struct FLiveAllocation
+	{
+		uint64_t Offset;
+		uint64_t Size;
+		uint64_t Batch;
+	};
+
+	struct FMockFence
+	{
+		uint64_t NextValue = 1;
+		uint64_t Completed = 0;
+	};
+
+	void RetireLive(const FUploadRing& Ring, std::vector<FLiveAllocation>& Live)
+	{
+		Live.erase(std::remove_if(Live.begin(), Live.end(), [&Ring](const FLiveAllocation& Allocation) { return Ring.IsBatchRetired(Allocation.Batch); }), Live.end());
+	}
+
+	void TestRandomTraffic()
+	{
+		FUploadRing Ring(RING_SIZE);
+		FMockFence Fence;
+		std::mt19937 Random(1);
+		std::vector<FLiveAllocation> Live;
+		// fence of every submitted batch by serial, to check the retirement against
+		std::vector<uint64_t> BatchFences(1, 0);
+		uint64_t Bytes = 0, Stalls = 0, Batches = 0;
+		bool Overlap = false, Misaligned = false;
+
+		for (int i = 0; i < NUM_ALLOCATIONS; ++i)
+		{
+			uint64_t Size = 1 + Random() % 9000;
+			uint64_t Alignment = (Random() & 1) ? 512 : 16;
+			uint64_t Offset;
+			while ((Offset = Ring.Allocate(Size, Alignment)) == FUploadRing::INVALID_OFFSET)
+			{
+				// full, like FUploadService submit the open batch and stall for the oldest
+				if (Ring.GetOldestFence() == 0)
+				{
+					CHECK(!Ring.IsOpenBatchEmpty());
+					BatchFences.push_back(Fence.NextValue);
+					Ring.SubmitBatch(Fence.NextValue++);
+					++Batches;
+				}
+				Fence.Completed = std::max(Fence.Completed, Ring.GetOldestFence());
+				Ring.Retire(Fence.Completed);
+				RetireLive(Ring, Live);
+				++Stalls;
+			}
+
+			Misaligned |= Offset % Alignment != 0 || Offset + Size > RING_SIZE;
+			for (const FLiveAllocation& Other : Live)
+				Overlap |= !(Offset + Size <= Other.Offset || Other.Offset + Other.Size <= Offset);
+			Live.push_back({ Offset, Size, Ring.GetOpenBatch() });
+			Bytes += Size;
+			CHECK(Ring.GetUsedSize() <= RING_SIZE);
+
+			if (Random() % 8 == 0)
+			{
+				uint64_t Batch = Ring.GetOpenBatch();
+				CHECK(Ring.GetBatchFence(Batch) == 0 && !Ring.IsBatchRetired(Batch));
+				CHECK(Ring.SubmitBatch(Fence.NextValue) == Batch);
+				CHECK(Ring.GetBatchFence(Batch) == Fence.NextValue);
+				CHECK(Ring.GetOpenBatch() == Batch + 1);
+				BatchFences.push_back(Fence.NextValue++);
+				++Batches;
+			}
+
+			// the GPU trails behind
+			if (Random() % 5 == 0 && Fence.Completed + 1 < Fence.NextValue)
+			{
+				++Fence.Completed;
+				Ring.Retire(Fence.Completed);
+				RetireLive(Ring, Live);
+				// retired exactly the batches whose fence passed, in order
+				for (uint64_t Batch = 1; Batch < BatchFences.size(); ++Batch)
+					CHECK(Ring.IsBatchRetired(Batch) == (BatchFences[Batch] <= Fence.Completed));
+			}
+		}
+		CHECK(!Overlap);
+		CHECK(!Misaligned);
+
+		if (!Ring.IsOpenBatchEmpty())
+			Ring.SubmitBatch(Fence.NextValue++);
+		Ring.Retire(Fence.NextValue);
+		CHECK(Ring.GetUsedSize() == 0 && Ring.GetOldestFence() == 0);
+		CHECK(Ring.Allocate(RING_SIZE, 512) == 0);
+		CHECK(Ring.Allocate(RING_SIZE + 1, 16) == FUploadRing::INVALID_OFFSET);
+		printf("%llu MB through a %llu KB ring in %llu batches, %llu stalls\n", (unsigned long long)(Bytes >> 20),
+			(unsigned long long)(RING_SIZE >> 10), (unsigned long long)Batches, (unsigned long long)Stalls);
+	}
+
+	void TestWrap()
+	{
+		FUploadRing Ring(1024);
+		CHECK(Ring.Allocate(600, 16) == 0);
+		CHECK(Ring.SubmitBatch(1) == 1);
+		// the tail of the ring is too small, the allocation waits for batch 1 to wrap to the front
+		CHECK(Ring.Allocate(600, 16) == FUploadRing::INVALID_OFFSET);
+		CHECK(Ring.GetOldestFence() == 1);
+		Ring.Retire(0);
+		CHECK(!Ring.IsBatchRetired(1));
+		Ring.Retire(1);
+		CHECK(Ring.IsBatchRetired(1) && Ring.GetBatchFence(1) == 0);
+		CHECK(Ring.Allocate(600, 16) == 0);
+
+		// work without ring space still needs a submit
+		FUploadRing Empty(1024);
+		CHECK(Empty.IsOpenBatchEmpty());
+		Empty.MarkOpenBatchUsed();
+		CHECK(!Empty.IsOpenBatchEmpty());
+		Empty.SubmitBatch(5);
+		CHECK(Empty.IsOpenBatchEmpty() && Empty.GetOldestFence() == 5);
+
+		// Reset forgets the batches but not the serials
+		uint64_t Open = Empty.GetOpenBatch();
+		Empty.Reset(2048);
+		CHECK(Empty.GetCapacity() == 2048 && Empty.GetUsedSize() == 0 && Empty.GetOldestFence() == 0);
+		CHECK(Empty.GetOpenBatch() >= Open);
+	}
+	// the ring mode of LinearAllocator with three frames in flight. A full ring retires what the GPU is done with
+	// and falls back to the pages instead of waiting, which may only happen while the GPU stalls
+	void TestFrameConstants()
+	{
+		const uint64_t FRAME_RING_SIZE = 0x200000;
+		const uint64_t FRAMES_IN_FLIGHT = 3;
+		const int NUM_FRAMES = 1000;
+		const int STALL_BEGIN = 600, STALL_END = 630;
+
+		FUploadRing Ring(FRAME_RING_SIZE);
+		std::mt19937 Random(3);
+		uint64_t Completed = 0;
+		auto IsComplete = [&Completed](uint64_t Fence) { return Fence <= Completed; };
+		// the ranges of the frames the GPU may still read, the fence of a frame is its number
+		std::deque<std::pair<uint64_t, std::vector<FLiveAllocation>>> InFlight;
+		std::vector<FLiveAllocation> Frame;
+		uint64_t Bytes = 0, Fallbacks = 0, FallbacksOutsideStall = 0;
+		bool Overlap = false, Misaligned = false;
+
+		for (uint64_t Fence = 1; Fence <= NUM_FRAMES; ++Fence)
+		{
+			bool Stalled = Fence >= STALL_BEGIN && Fence < STALL_END;
+			if (!Stalled && Fence > FRAMES_IN_FLIGHT)
+				Completed = Fence - FRAMES_IN_FLIGHT;
+			while (!InFlight.empty() && InFlight.front().first <= Completed)
+				InFlight.pop_front();
+
+			int Draws = 50 + Random() % 300;
+			for (int Draw = 0; Draw < Draws; ++Draw)
+			{
+				uint64_t Size = Random() % 64 == 0 ? 0x4000 : 256 * (1 + Random() % 4);
+				uint64_t Offset = Ring.Allocate(Size, 256);
+				if (Offset == FUploadRing::INVALID_OFFSET)
+				{
+					Ring.RetireCompleted(IsComplete);
+					Offset = Ring.Allocate(Size, 256);
+				}
+				if (Offset == FUploadRing::INVALID_OFFSET)
+				{
+					++Fallbacks;
+					// the frames after the stall still wait for the GPU to drain it
+					if (Fence < STALL_BEGIN || Fence >= STALL_END + FRAMES_IN_FLIGHT)
+						++FallbacksOutsideStall;
+					continue;
+				}
+
+				Misaligned |= Offset % 256 != 0 || Offset + Size > FRAME_RING_SIZE;
+				for (const FLiveAllocation& Other : Frame)
+					Overlap |= !(Offset + Size <= Other.Offset || Other.Offset + Other.Size <= Offset);
+				for (const auto& Previous : InFlight)
+				{
+					for (const FLiveAllocation& Other : Previous.second)
+						Overlap |= !(Offset + Size <= Other.Offset || Other.Offset + Other.Size <= Offset);
+				}
+				Frame.push_back({ Offset, Size, Ring.GetOpenBatch() });
+				Bytes += Size;
+			}
+
+			// CleanupUsedPages of the context
+			if (!Ring.IsOpenBatchEmpty())
+				Ring.SubmitBatch(Fence);
+			InFlight.push_back(std::make_pair(Fence, std::move(Frame)));
+			Frame.clear();
+		}
+		CHECK(!Overlap);
+		CHECK(!Misaligned);
+		CHECK(Fallbacks > 0);
+		CHECK(FallbacksOutsideStall == 0);
+
+		// the frames still in flight are all that is left
+		Ring.RetireCompleted(IsComplete);
+		CHECK(Ring.GetOldestFence() == Completed + 1);
+		Completed = NUM_FRAMES;
+		Ring.RetireCompleted(IsComplete);
+		CHECK(Ring.GetUsedSize() == 0 && Ring.GetOldestFence() == 0);
+		printf("%llu MB of constants through a %llu KB ring, %llu fallbacks during a %d frame stall\n", (unsigned long long)(Bytes >> 20),
+			(unsigned long long)(FRAME_RING_SIZE >> 10), (unsigned long long)Fallbacks, STALL_END - STALL_BEGIN);
+	}
+}
+
+int main()
+{
+	TestWrap();
+	TestRandomTraffic();
+	TestFrameConstants();
+	return TestResult();
+}
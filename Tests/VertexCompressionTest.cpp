@@ -0,0 +1,138 @@
+#include "VertexCompression.h"
+#include "TestCommon.h"
+
+#include <string.h>
+#include <random>
+
+// checks the worst case errors documented in VertexCompression.h over random sweeps
+namespace
+{
+	const int NUM_SAMPLES = 1000000;
+
+	double AngleDegrees(const Vector3f& a, const Vector3f& b)
+	{
+		double Sin = std::min(1.0, (double)Cross(a, b).Length());
+		return asin(Sin) * 180.0 / MATH_PI;
+	}
+
+	Vector3f RandomDirection(std::mt19937& Random)
+	{
+		std::normal_distribution<float> Normal;
+		Vector3f Direction;
+		do
+		{
+			Direction = Vector3f(Normal(Random), Normal(Random), Normal(Random));
+		} while (Direction.Length() < 1e-6f);
+		return Direction.Normalize();
+	}
+
+	void TestOctNormal()
+	{
+		std::mt19937 Random(1);
+		const Vector3f Axes[6] = { Vector3f(1, 0, 0), Vector3f(-1, 0, 0), Vector3f(0, 1, 0), Vector3f(0, -1, 0), Vector3f(0, 0, 1), Vector3f(0, 0, -1) };
+		double MaxError = 0.0;
+		for (int i = 0; i < NUM_SAMPLES; ++i)
+		{
+			Vector3f Normal = i < 6 ? Axes[i] : RandomDirection(Random);
+			Vector3f Decoded = FVertexCompression::DecodeOctNormal(FVertexCompression::EncodeOctNormal(Normal));
+			MaxError = std::max(MaxError, AngleDegrees(Normal, Decoded));
+			CHECK(Decoded.Dot(Normal) > 0.f);
+		}
+		printf("octahedral normal: %.5f degrees\n", MaxError);
+		CHECK(MaxError <= 0.0075);
+
+		// a zero normal encodes +z instead of a NaN
+		Vector3f Zero = FVertexCompression::DecodeOctNormal(FVertexCompression::EncodeOctNormal(Vector3f(0.f, 0.f, 0.f)));
+		CHECK(Zero.z == 1.f);
+	}
+
+	void TestTangent()
+	{
+		std::mt19937 Random(2);
+		std::uniform_real_distribution<float> Uniform(-1.f, 1.f);
+		double MaxError = 0.0;
+		for (int i = 0; i < NUM_SAMPLES; ++i)
+		{
+			Vector4f Tangent(RandomDirection(Random), Uniform(Random) < 0.f ? -1.f : 1.f);
+			Vector4f Decoded = FVertexCompression::DecodeTangent(FVertexCompression::EncodeTangent(Tangent));
+			CHECK(Decoded.w == Tangent.w);
+			MaxError = std::max(MaxError, AngleDegrees(Vector3f(Tangent), Vector3f(Decoded).Normalize()));
+		}
+		printf("10:10:10:2 tangent: %.4f degrees\n", MaxError);
+		CHECK(MaxError <= 0.1);
+	}
+
+	void TestHalf()
+	{
+		// every finite half survives the trip through float bit exact
+		for (uint32_t Bits = 0; Bits < 0x10000; ++Bits)
+		{
+			if (((Bits >> 10) & 0x1f) == 31)
+				continue;
+			float Value = FVertexCompression::HalfToFloat((uint16_t)Bits);
+			CHECK(FVertexCompression::FloatToHalf(Value) == Bits);
+		}
+
+		std::mt19937 Random(3);
+		std::uniform_real_distribution<float> Uniform(-1.f, 1.f);
+		double MaxError = 0.0;
+		for (int i = 0; i < NUM_SAMPLES; ++i)
+		{
+			// normal halves only, denormals have an absolute error of 2^-25
+			float Value = Uniform(Random) * powf(2.f, (float)(int)(Uniform(Random) * 14.f));
+			if (fabsf(Value) < 6.103515625e-5f)
+				continue;
+			float Decoded = FVertexCompression::HalfToFloat(FVertexCompression::FloatToHalf(Value));
+			MaxError = std::max(MaxError, fabs(((double)Decoded - Value) / Value));
+		}
+		printf("half: relative %.3g\n", MaxError);
+		CHECK(MaxError <= 1.0 / 2048.0);
+
+		CHECK(FVertexCompression::HalfToFloat(FVertexCompression::FloatToHalf(1e6f)) == 65504.f);
+		CHECK(FVertexCompression::HalfToFloat(FVertexCompression::FloatToHalf(-1e6f)) == -65504.f);
+		CHECK(FVertexCompression::HalfToFloat(FVertexCompression::FloatToHalf(1e-9f)) == 0.f);
+
+		Vector2f Decoded = FVertexCompression::DecodeHalf2(FVertexCompression::EncodeHalf2(Vector2f(0.5f, -2.f)));
+		CHECK(Decoded.x == 0.5f && Decoded.y == -2.f);
+	}
+
+	void TestUNorm16()
+	{
+		std::mt19937 Random(4);
+		std::uniform_real_distribution<float> Uniform(0.f, 1.f);
+		Vector2f Min2(-3.f, 2.f), Extent2(7.5f, 0.25f);
+		Vector3f Min3(-100.f, 0.f, 5.f), Extent3(250.f, 1.f, 0.01f);
+		// half a step of 1/65535 plus the float rounding of the decode
+		const double Bound = 1.0 / 131070.0 + 1e-6;
+		double MaxError = 0.0;
+		for (int i = 0; i < NUM_SAMPLES; ++i)
+		{
+			Vector2f Value2(Min2.x + Uniform(Random) * Extent2.x, Min2.y + Uniform(Random) * Extent2.y);
+			Vector2f Decoded2 = FVertexCompression::DecodeUNorm16x2(FVertexCompression::EncodeUNorm16x2(Value2, Min2, Extent2), Min2, Extent2);
+			for (int c = 0; c < 2; ++c)
+				MaxError = std::max(MaxError, fabs((double)Decoded2[c] - Value2[c]) / Extent2[c]);
+
+			Vector3f Value3(Min3.x + Uniform(Random) * Extent3.x, Min3.y + Uniform(Random) * Extent3.y, Min3.z + Uniform(Random) * Extent3.z);
+			uint64_t Packed = FVertexCompression::EncodeUNorm16x3(Value3, Min3, Extent3);
+			CHECK((Packed >> 48) == 0xffff);
+			Vector3f Decoded3 = FVertexCompression::DecodeUNorm16x3(Packed, Min3, Extent3);
+			for (int c = 0; c < 3; ++c)
+				MaxError = std::max(MaxError, fabs((double)Decoded3[c] - Value3[c]) / Extent3[c]);
+		}
+		printf("unorm16: %.3g of the range\n", MaxError);
+		CHECK(MaxError <= Bound);
+
+		// an empty extent encodes 0 and decodes to Min
+		Vector2f Flat = FVertexCompression::DecodeUNorm16x2(FVertexCompression::EncodeUNorm16x2(Vector2f(4.f, 1.f), Vector2f(4.f, 0.f), Vector2f(0.f, 2.f)), Vector2f(4.f, 0.f), Vector2f(0.f, 2.f));
+		CHECK(Flat.x == 4.f && fabsf(Flat.y - 1.f) <= 2.f / 131070.f);
+	}
+}
+
+int main()
+{
+	TestOctNormal();
+	TestTangent();
+	TestHalf();
+	TestUNorm16();
+	return TestResult();
+}
@@ -19,6 +19,7 @@
 #include <chrono>
 #include <iostream>
 
+extern FCommandListManager g_CommandListManager;
 
 class Tutorial2 : public FGame
 {
@@ -76,12 +77,13 @@ public:
 		const float FovVertical = MATH_PI / 4.f;
 		m_uboVS.projectionMatrix = FMatrix::MatrixPerspectiveFovLH(FovVertical, (float)GetDesc().Width / GetDesc().Height, 0.1f, 100.f);
 
-		memcpy(m_ConstBuffer.Map(), &m_uboVS, sizeof(m_uboVS));
+		// the frames still in flight read the other slots
+		memcpy((uint8_t*)m_ConstBuffer.Map() + g_CommandListManager.GetFrameIndex() * CONST_BUFFER_STRIDE, &m_uboVS, sizeof(m_uboVS));
 
 		FCommandContext& CommandContext = FCommandContext::Begin();
 		FillCommandLists(CommandContext);
 		
-		CommandContext.Finish(true);
+		CommandContext.Finish();
 
 		RenderWindow::Get().Present();	
 	}
@@ -153,7 +155,7 @@ private:
 		CommandContext.SetPipelineState(m_PipelineState);
 		CommandContext.SetViewportAndScissor(0, 0, m_GameDesc.Width, m_GameDesc.Height);
 
-		CommandContext.SetDynamicDescriptor(0, 0, m_ConstBuffer.CreateConstantBufferView(0, sizeof(m_uboVS)));
+		CommandContext.SetDynamicDescriptor(0, 0, m_ConstBufferViews[g_CommandListManager.GetFrameIndex()]);
 
 		RenderWindow& renderWindow = RenderWindow::Get();
 		auto BackBuffer = renderWindow.GetBackBuffer();
@@ -177,7 +179,11 @@ private:
 
 	void SetupUniformBuffer()
 	{
-		m_ConstBuffer.CreateUpload(L"ConstBuffer", sizeof(m_uboVS));
+		m_ConstBuffer.CreateUpload(L"ConstBuffer", CONST_BUFFER_STRIDE * FFramePacer::MAX_FRAMES_IN_FLIGHT);
+		for (uint32_t i = 0; i < FFramePacer::MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			m_ConstBufferViews[i] = m_ConstBuffer.CreateConstantBufferView(i * CONST_BUFFER_STRIDE, sizeof(m_uboVS));
+		}
 	}
 
 private:
@@ -196,7 +202,10 @@ private:
 
 	FGpuBuffer m_VertexBuffer;
 	FGpuBuffer m_IndexBuffer;
+	// a constant buffer per frame in flight
+	static const uint32_t CONST_BUFFER_STRIDE = 256;
 	FConstBuffer m_ConstBuffer;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_ConstBufferViews[FFramePacer::MAX_FRAMES_IN_FLIGHT];
 
 	Vector3f m_ClearColor;
 
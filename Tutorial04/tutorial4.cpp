@@ -81,7 +81,7 @@ public:
 		FCommandContext& CommandContext = FCommandContext::Begin();
 		FillCommandLists(CommandContext);
 		
-		CommandContext.Finish(true);
+		CommandContext.Finish();
 
 		RenderWindow::Get().Present();	
 	}
@@ -40,6 +40,7 @@ public:
 	void OnStartup()
 	{
 		SetupRootSignature();
+		m_Renderer.SetBindlessMaterials(1, 2);
 
 		m_Scene = FGLTFLoader::LoadFromFile("../Resources/gltf2.0/DamagedHelmet/glTF/DamagedHelmet.gltf");
 
@@ -90,7 +91,7 @@ public:
 		FCommandContext& CommandContext = FCommandContext::Begin();
 		FillCommandLists(CommandContext);
 		
-		CommandContext.Finish(true);
+		CommandContext.Finish();
 
 		RenderWindow::Get().Present();
 	}
@@ -100,9 +101,11 @@ private:
 	{
 		FSamplerDesc DefaultSamplerDesc;
 
-		m_RootSignature.Reset(2, 1);
+		// the material textures come from the bindless table, a material change only sets their indices
+		m_RootSignature.Reset(3, 1);
 		m_RootSignature[0].InitAsConstants(0, sizeof(m_uboVS) / 4, D3D12_SHADER_VISIBILITY_VERTEX);
-		m_RootSignature[1].InitAsDescriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0, 1, D3D12_SHADER_VISIBILITY_PIXEL);
+		m_RootSignature[1].InitAsConstants(1, MeshData::TEX_PER_MATERIAL, D3D12_SHADER_VISIBILITY_PIXEL);
+		m_RootSignature[2].InitAsBindlessTable(0, 1, D3D12_SHADER_VISIBILITY_PIXEL);
 		m_RootSignature.InitStaticSampler(0, DefaultSamplerDesc, D3D12_SHADER_VISIBILITY_PIXEL);
 		m_RootSignature.Finalize(L"RootSignature", D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 	}
@@ -114,9 +117,9 @@ private:
 
 	void SetupShaders()
 	{
-		m_vertexShader = D3D12RHI::Get().CreateShader(L"../Resources/Shaders/triangle.hlsl", "vs_main", "vs_5_1");
+		m_vertexShader = D3D12RHI::Get().CreateShader(L"../Resources/Shaders/BindlessMaterial.hlsl", "vs_main", "vs_5_1");
 
-		m_pixelShader = D3D12RHI::Get().CreateShader(L"../Resources/Shaders/triangle.hlsl", "ps_main", "ps_5_1");
+		m_pixelShader = D3D12RHI::Get().CreateShader(L"../Resources/Shaders/BindlessMaterial.hlsl", "ps_main", "ps_5_1");
 	}
 
 	void SetupPipelineState()
@@ -159,12 +162,7 @@ private:
 		CommandContext.ClearDepth(g_SceneDepthZ);
 		CommandContext.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-		FTexture* Texture = m_Scene->GetFirstMesh()->GetTexture(0, 0);
-		if (Texture)
-		{
-			CommandContext.SetDynamicDescriptor(1, 0, Texture->GetSRV());
-		}
-		m_Renderer->Draw(m_Scene, CommandContext, false);
+		m_Renderer.Draw(m_Scene, CommandContext);
 
 		CommandContext.TransitionResource(BackBuffer, D3D12_RESOURCE_STATE_PRESENT, true);
 	}
@@ -189,7 +187,7 @@ private:
 
 	MeshData* m_mesh_data;
 	Scene* m_Scene;
-	Renderer* m_Renderer;
+	Renderer m_Renderer;
 };
 
 int main()
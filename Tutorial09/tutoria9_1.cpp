@@ -217,7 +217,7 @@ public:
 		OnGUI(CommandContext);
 
 		CommandContext.TransitionResource(RenderWindow::Get().GetBackBuffer(), D3D12_RESOURCE_STATE_PRESENT);
-		CommandContext.Finish(true);
+		CommandContext.Finish();
 
 		RenderWindow::Get().Present();
 	}
@@ -445,6 +445,8 @@ private:
 
 		GfxContext.TransitionResource(m_CubeBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, true);
 		
+		// loaded just before, also from within a frame
+		GfxContext.WaitForUpload(m_TextureLongLat);
 		GfxContext.SetDynamicDescriptor(1, 0, m_TextureLongLat.GetSRV());
 
 		m_VSConstants.ModelMatrix = FMatrix(); // identity